@@ -1,6 +1,13 @@
 import os
 import json
+import hashlib
+import hmac
+import random
+import socket
 import sqlite3
+import struct
+import threading
+import time
 from datetime import datetime
 
 from flask import Flask, jsonify, request, send_from_directory
@@ -17,6 +24,20 @@ DB_PATH = os.path.join(REPO_ROOT, "alarms.db")
 # Set ESP32_API_BASE env var to like "http://esp32.local" or "http://192.168.1.50"
 ESP32_API_BASE = os.environ.get("ESP32_API_BASE", "")
 
+# Group triggers: one signed multicast packet makes every unit in the
+# building strike at the same moment (see esp32/src/group_trigger.h).
+# GONG_TRIGGER_KEY must match trigger_key in the device config.
+GONG_TRIGGER_KEY = os.environ.get("GONG_TRIGGER_KEY", "")
+GONG_TRIGGER_GROUP = os.environ.get("GONG_TRIGGER_GROUP", "239.255.71.71")
+GONG_TRIGGER_PORT = int(os.environ.get("GONG_TRIGGER_PORT", "4771"))
+# Local address of the interface facing the devices; empty = routing table
+GONG_TRIGGER_IFACE = os.environ.get("GONG_TRIGGER_IFACE", "")
+GROUP_TRIGGER_LEAD_MS = 500
+GROUP_TRIGGER_HORIZON_MS = 10 * 60 * 1000
+GROUP_TRIGGER_COPIES = 3
+GROUP_OP_PLAY = 1
+GROUP_OP_STOP = 2
+
 
 def get_db_connection() -> sqlite3.Connection:
     conn = sqlite3.connect(DB_PATH)
@@ -38,6 +59,27 @@ def init_db_if_needed() -> None:
             )
             """
         )
+        # Change tracking for the device sync: every change gets the next
+        # value of the change counter, deletes leave a tombstone
+        columns = [r["name"] for r in conn.execute("PRAGMA table_info(alarms)").fetchall()]
+        if "version" not in columns:
+            conn.execute("ALTER TABLE alarms ADD COLUMN version INTEGER NOT NULL DEFAULT 0")
+        conn.execute(
+            """
+            CREATE TABLE IF NOT EXISTS alarm_tombstones (
+              id INTEGER PRIMARY KEY,
+              version INTEGER NOT NULL
+            )
+            """
+        )
+        conn.execute(
+            """
+            CREATE TABLE IF NOT EXISTS sync_state (
+              key TEXT PRIMARY KEY,
+              value INTEGER
+            )
+            """
+        )
         conn.commit()
     finally:
         conn.close()
@@ -53,6 +95,25 @@ def serialize_alarm_row(row: sqlite3.Row) -> dict:
     }
 
 
+def get_sync_value(conn: sqlite3.Connection, key: str):
+    row = conn.execute("SELECT value FROM sync_state WHERE key = ?", (key,)).fetchone()
+    return row["value"] if row else None
+
+
+def set_sync_value(conn: sqlite3.Connection, key: str, value) -> None:
+    conn.execute(
+        "INSERT INTO sync_state (key, value) VALUES (?, ?) "
+        "ON CONFLICT(key) DO UPDATE SET value = excluded.value",
+        (key, value),
+    )
+
+
+def next_change(conn: sqlite3.Connection) -> int:
+    change = (get_sync_value(conn, "change") or 0) + 1
+    set_sync_value(conn, "change", change)
+    return change
+
+
 app = Flask(__name__, static_folder=None)
 CORS(app)
 
@@ -103,12 +164,13 @@ def create_alarm():
     conn = get_db_connection()
     try:
         cur = conn.execute(
-            "INSERT INTO alarms (time, days, duration, active) VALUES (?, ?, ?, ?)",
-            (time_str, days_json, duration, active),
+            "INSERT INTO alarms (time, days, duration, active, version) VALUES (?, ?, ?, ?, ?)",
+            (time_str, days_json, duration, active, next_change(conn)),
         )
         conn.commit()
         alarm_id = cur.lastrowid
         row = conn.execute("SELECT * FROM alarms WHERE id = ?", (alarm_id,)).fetchone()
+        sync_worker.request()
         return jsonify(serialize_alarm_row(row)), 201
     finally:
         conn.close()
@@ -137,15 +199,17 @@ def update_alarm(alarm_id: int):
     if not fields:
         return jsonify({"error": "no fields to update"}), 400
 
-    values.append(alarm_id)
-
     conn = get_db_connection()
     try:
+        if not conn.execute("SELECT 1 FROM alarms WHERE id = ?", (alarm_id,)).fetchone():
+            return jsonify({"error": "not found"}), 404
+        fields.append("version = ?")
+        values.append(next_change(conn))
+        values.append(alarm_id)
         conn.execute(f"UPDATE alarms SET {', '.join(fields)} WHERE id = ?", values)
         conn.commit()
         row = conn.execute("SELECT * FROM alarms WHERE id = ?", (alarm_id,)).fetchone()
-        if not row:
-            return jsonify({"error": "not found"}), 404
+        sync_worker.request()
         return jsonify(serialize_alarm_row(row))
     finally:
         conn.close()
@@ -156,9 +220,14 @@ def delete_alarm(alarm_id: int):
     conn = get_db_connection()
     try:
         cur = conn.execute("DELETE FROM alarms WHERE id = ?", (alarm_id,))
-        conn.commit()
         if cur.rowcount == 0:
             return jsonify({"error": "not found"}), 404
+        conn.execute(
+            "INSERT OR REPLACE INTO alarm_tombstones (id, version) VALUES (?, ?)",
+            (alarm_id, next_change(conn)),
+        )
+        conn.commit()
+        sync_worker.request()
         return jsonify({"status": "deleted", "id": alarm_id})
     finally:
         conn.close()
@@ -177,6 +246,183 @@ def proxy_to_esp32(path: str):
         return jsonify({"error": f"proxy failed: {exc}"}), 502
 
 
+class GroupTriggerSender:
+    """Sends group trigger packets; the layout matches encodeGroupTrigger()."""
+
+    def __init__(self) -> None:
+        self._lock = threading.Lock()
+        self._sender = random.getrandbits(32)
+        self._sequence = 0
+
+    def send(self, op: int, track: int, delay_ms: int) -> dict:
+        key = GONG_TRIGGER_KEY.encode("utf-8")
+        fire_at_us = time.time_ns() // 1000 + delay_ms * 1000
+        with self._lock:
+            self._sequence = (self._sequence + 1) & 0xFFFFFFFF
+            sequence = self._sequence
+        body = struct.pack(">4sBBHIIq", b"GONG", 1, op, track, self._sender, sequence, fire_at_us)
+        packet = body + hmac.new(key, body, hashlib.sha256).digest()[:16]
+
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+            if GONG_TRIGGER_IFACE:
+                sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(GONG_TRIGGER_IFACE))
+            # Multicast over WiFi is not acknowledged; devices drop the copies
+            for _ in range(GROUP_TRIGGER_COPIES):
+                sock.sendto(packet, (GONG_TRIGGER_GROUP, GONG_TRIGGER_PORT))
+        finally:
+            sock.close()
+        return {"status": "sent", "sequence": sequence, "fire_at_ms": fire_at_us // 1000}
+
+
+group_sender = GroupTriggerSender()
+
+
+def group_trigger(op: int, track: int = 0):
+    if not GONG_TRIGGER_KEY:
+        return jsonify({"error": "GONG_TRIGGER_KEY is not configured on server"}), 503
+    try:
+        delay_ms = int(request.args.get("delay_ms", GROUP_TRIGGER_LEAD_MS))
+    except ValueError:
+        delay_ms = -1
+    if delay_ms < 0 or delay_ms > GROUP_TRIGGER_HORIZON_MS:
+        return jsonify({"error": "invalid delay_ms"}), 400
+    try:
+        result = group_sender.send(op, track, delay_ms)
+    except OSError as exc:
+        return jsonify({"error": f"send failed: {exc}"}), 502
+    if op == GROUP_OP_PLAY:
+        result["track"] = track
+    return jsonify(result), 202
+
+
+def device_alarm(row: sqlite3.Row) -> dict:
+    alarm = serialize_alarm_row(row)
+    return {k: alarm[k] for k in ("id", "time", "days", "duration", "active")}
+
+
+def sync_to_esp32(full: bool = False) -> dict:
+    """Push alarm changes the device has not acknowledged yet.
+
+    sync_state keeps the device's alarm-set version ("device_version") and
+    the backend change counter it corresponds to ("acked_change"). A delta
+    carries only alarms and tombstones newer than acked_change. If the
+    device set changed behind our back (409), the whole set is sent once
+    and the backend copy wins.
+    """
+    if not ESP32_API_BASE:
+        return {"status": "disabled"}
+
+    with sync_lock:
+        conn = get_db_connection()
+        try:
+            device_version = get_sync_value(conn, "device_version")
+            acked = get_sync_value(conn, "acked_change") or 0
+            full = full or device_version is None
+            for attempt in range(2):
+                change = get_sync_value(conn, "change") or 0
+                if full:
+                    rows = conn.execute("SELECT * FROM alarms ORDER BY id").fetchall()
+                    batch = {"full": True, "upserts": [device_alarm(r) for r in rows]}
+                else:
+                    rows = conn.execute(
+                        "SELECT * FROM alarms WHERE version > ? ORDER BY id", (acked,)
+                    ).fetchall()
+                    deleted = conn.execute(
+                        "SELECT id FROM alarm_tombstones WHERE version > ? ORDER BY id", (acked,)
+                    ).fetchall()
+                    if not rows and not deleted:
+                        return {"status": "up-to-date", "version": device_version}
+                    batch = {
+                        "base": device_version,
+                        "upserts": [device_alarm(r) for r in rows],
+                        "deletes": [r["id"] for r in deleted],
+                    }
+
+                target = ESP32_API_BASE.rstrip("/") + "/api/alarms/sync"
+                try:
+                    resp = requests.post(target, json=batch, timeout=5)
+                except requests.RequestException as exc:
+                    return {"status": "error", "error": f"sync failed: {exc}"}
+
+                if resp.status_code == 409 and not full:
+                    full = True
+                    continue
+                if resp.status_code != 200:
+                    return {"status": "error", "code": resp.status_code, "error": resp.text}
+
+                version = resp.json().get("version")
+                set_sync_value(conn, "device_version", version)
+                set_sync_value(conn, "acked_change", change)
+                # Tombstones the device has seen are no longer needed
+                conn.execute("DELETE FROM alarm_tombstones WHERE version <= ?", (change,))
+                conn.commit()
+                return {
+                    "status": "synced",
+                    "full": full,
+                    "conflict": attempt > 0,
+                    "version": version,
+                    "upserts": len(batch["upserts"]),
+                    "deletes": len(batch.get("deletes", [])),
+                }
+        finally:
+            conn.close()
+    return {"status": "error", "error": "sync did not converge"}
+
+
+class SyncWorker:
+    """Background sync: bursts of edits collapse into one push."""
+
+    def __init__(self) -> None:
+        self._wake = threading.Event()
+        self._thread = None
+        self.last_result = None
+
+    def request(self) -> None:
+        if not ESP32_API_BASE:
+            return
+        if self._thread is None:
+            self._thread = threading.Thread(target=self._run, daemon=True)
+            self._thread.start()
+        self._wake.set()
+
+    def _run(self) -> None:
+        while True:
+            self._wake.wait()
+            self._wake.clear()
+            self.last_result = sync_to_esp32()
+
+
+sync_lock = threading.Lock()
+sync_worker = SyncWorker()
+
+
+@app.route("/api/sync", methods=["GET"])
+def sync_status():
+    conn = get_db_connection()
+    try:
+        return jsonify({
+            "device": ESP32_API_BASE or None,
+            "device_version": get_sync_value(conn, "device_version"),
+            "acked_change": get_sync_value(conn, "acked_change") or 0,
+            "change": get_sync_value(conn, "change") or 0,
+            "last_result": sync_worker.last_result,
+        })
+    finally:
+        conn.close()
+
+
+@app.route("/api/sync", methods=["POST"])
+def sync_now():
+    full = request.args.get("full") in ("1", "true", "True")
+    result = sync_to_esp32(full=full)
+    code = 200 if result["status"] in ("synced", "up-to-date") else 502
+    if result["status"] == "disabled":
+        code = 503
+    return jsonify(result), code
+
+
 @app.route("/api/audio/play", methods=["POST"])  # proxy to ESP32
 def audio_play():
     return proxy_to_esp32("/api/audio/play")
@@ -202,8 +448,25 @@ def audio_volume():
     return proxy_to_esp32(path)
 
 
+@app.route("/api/group/play", methods=["POST"])  # all units, same moment
+def group_play():
+    try:
+        track = int(request.args.get("num", "0"))
+    except ValueError:
+        track = 0
+    if track <= 0 or track > 0xFFFF:
+        return jsonify({"error": "invalid track number"}), 400
+    return group_trigger(GROUP_OP_PLAY, track)
+
+
+@app.route("/api/group/stop", methods=["POST"])
+def group_stop():
+    return group_trigger(GROUP_OP_STOP)
+
+
 def main():
     init_db_if_needed()
+    sync_worker.request()
     host = os.environ.get("HOST", "0.0.0.0")
     port = int(os.environ.get("PORT", "5001"))
     debug = bool(os.environ.get("DEBUG", "").lower() in ("1", "true", "yes"))
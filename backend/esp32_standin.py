@@ -0,0 +1,162 @@
+"""Stand-in for the ESP32 alarm API, runnable on a Linux host.
+
+Implements the device side of the alarm sync protocol with the same
+semantics as esp32/src/main.cpp: a versioned in-memory alarm set, local
+CRUD that bumps the version, and POST /api/alarms/sync that applies a
+batch atomically or answers 409 when the base version does not match.
+
+    python3 esp32_standin.py --port 5080
+    ESP32_API_BASE=http://127.0.0.1:5080 python3 app.py
+
+Local edits on the stand-in (POST /api/alarms etc.) make the next backend
+delta conflict, which exercises the full-resync path.
+"""
+
+import argparse
+import re
+import threading
+
+from flask import Flask, jsonify, request
+
+ALARM_MAX_COUNT = 256
+TIME_RE = re.compile(r"^([01]\d|2[0-3]):[0-5]\d$")
+
+app = Flask(__name__)
+lock = threading.Lock()
+alarms = {}
+version = 0
+
+
+def truthy(value) -> bool:
+    return value in (True, 1, "1", "true", "True")
+
+
+def parse_alarm(payload, alarm: dict, partial: bool):
+    """Same validation as alarmFromJson() on the device; returns an error or None."""
+    if not isinstance(payload, dict):
+        return "invalid json"
+    if not partial and ("time" not in payload or "duration" not in payload):
+        return "time and positive duration are required"
+    if "time" in payload:
+        if not TIME_RE.match(str(payload["time"])):
+            return "invalid time"
+        alarm["time"] = payload["time"]
+    if "duration" in payload:
+        duration = int(payload["duration"] or 0)
+        if duration <= 0 or duration > 0xFFFF:
+            return "time and positive duration are required"
+        alarm["duration"] = duration
+    if "days" in payload:
+        alarm["days"] = sorted({int(d) for d in payload["days"] or [] if 0 <= int(d) < 7})
+    if "active" in payload:
+        alarm["active"] = truthy(payload["active"])
+    elif not partial:
+        alarm["active"] = False
+    if "track" in payload:
+        track = int(payload["track"] or 0)
+        if track < 1 or track > 255:
+            return "invalid track number"
+        alarm["track"] = track
+    elif not partial:
+        alarm["track"] = 1
+    alarm.setdefault("days", [])
+    return None
+
+
+def bump() -> int:
+    global version
+    version += 1
+    return version
+
+
+@app.route("/api/alarms", methods=["GET"])
+def list_alarms():
+    with lock:
+        items = [alarms[k] for k in sorted(alarms)]
+        return jsonify({"alarms": items, "version": version})
+
+
+@app.route("/api/alarms", methods=["POST"])
+def create_alarm():
+    alarm = {}
+    error = parse_alarm(request.get_json(silent=True), alarm, False)
+    if error:
+        return jsonify({"error": error}), 400
+    with lock:
+        if len(alarms) >= ALARM_MAX_COUNT:
+            return jsonify({"error": "alarm table is full"}), 507
+        alarm["id"] = max(alarms, default=0) + 1
+        alarms[alarm["id"]] = alarm
+        bump()
+        return jsonify(alarm), 201
+
+
+@app.route("/api/alarms/<int:alarm_id>", methods=["PUT"])
+def update_alarm(alarm_id: int):
+    with lock:
+        if alarm_id not in alarms:
+            return jsonify({"error": "not found"}), 404
+        alarm = dict(alarms[alarm_id])
+        error = parse_alarm(request.get_json(silent=True), alarm, True)
+        if error:
+            return jsonify({"error": error}), 400
+        alarms[alarm_id] = alarm
+        bump()
+        return jsonify(alarm)
+
+
+@app.route("/api/alarms/<int:alarm_id>", methods=["DELETE"])
+def delete_alarm(alarm_id: int):
+    with lock:
+        if alarms.pop(alarm_id, None) is None:
+            return jsonify({"error": "not found"}), 404
+        bump()
+        return jsonify({"status": "deleted", "id": alarm_id})
+
+
+@app.route("/api/alarms/sync", methods=["POST"])
+def sync_alarms():
+    batch = request.get_json(silent=True)
+    if not isinstance(batch, dict):
+        return jsonify({"error": "invalid json"}), 400
+    full = bool(batch.get("full"))
+    if not full and not isinstance(batch.get("base"), int):
+        return jsonify({"error": "base version required"}), 400
+
+    upserts = {}
+    for item in batch.get("upserts") or []:
+        alarm_id = int(item.get("id") or 0) if isinstance(item, dict) else 0
+        if alarm_id < 1 or alarm_id > 0xFFFF:
+            return jsonify({"error": "invalid id"}), 400
+        alarm = {}
+        error = parse_alarm(item, alarm, False)
+        if error:
+            return jsonify({"error": error}), 400
+        alarm["id"] = alarm_id
+        upserts[alarm_id] = alarm
+    deletes = [] if full else [int(d) for d in batch.get("deletes") or []]
+
+    with lock:
+        if not full and batch["base"] != version:
+            return jsonify({"error": "version mismatch", "version": version}), 409
+        result = {} if full else dict(alarms)
+        for alarm_id in deletes:
+            result.pop(alarm_id, None)
+        result.update(upserts)
+        if len(result) > ALARM_MAX_COUNT:
+            return jsonify({"error": "alarm table is full"}), 507
+        alarms.clear()
+        alarms.update(result)
+        return jsonify({"version": bump(), "upserts": len(upserts), "deletes": len(deletes)})
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=5080)
+    args = parser.parse_args()
+    app.run(host=args.host, port=args.port)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,238 @@
+#include "bench.h"
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+// ---- учёт выделений памяти ----
+
+// Считаются все выделения в потоке замера: new (String, std::vector)
+// и malloc/calloc/realloc из C-кода (ArduinoJson, буферы веб-сервера).
+// Вызовы перехватываются поверх функций glibc.
+static thread_local bool countAllocations = false;
+static thread_local uint64_t allocatedBytes = 0;
+static thread_local uint64_t allocationCount = 0;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+static void countAllocation(size_t size) {
+  if (countAllocations) {
+    allocatedBytes += size;
+    allocationCount++;
+  }
+}
+
+void *malloc(size_t size) {
+  countAllocation(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  countAllocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  countAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+}
+
+static void *countedAlloc(size_t size) {
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+// ---- замер ----
+
+struct BenchResult {
+  const char *name;
+  uint64_t iterations;
+  double nsPerOp;
+  double bytesPerOp;
+  double allocsPerOp;
+  double maxNs;       // < 0 — порога нет
+  double maxBytes;
+  bool regressed;
+};
+
+static uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t timeBatch(const BenchCase &bench, uint32_t iterations) {
+  uint64_t start = nowNs();
+  bench.run(iterations);
+  return nowNs() - start;
+}
+
+static const int kSamples = 5;
+
+static void measure(const BenchCase &bench, uint32_t budgetMs, BenchResult &result) {
+  // Прогрев и подбор числа повторов: партия не короче budget / kSamples
+  uint64_t sampleNs = (uint64_t)budgetMs * 1000000 / kSamples;
+  uint32_t iterations = 1;
+  timeBatch(bench, 1);
+  while (iterations < (1u << 30)) {
+    uint64_t elapsed = timeBatch(bench, iterations);
+    if (elapsed >= sampleNs / 4) {
+      uint64_t scaled = elapsed ? (uint64_t)iterations * sampleNs / elapsed : iterations * 2ULL;
+      iterations = (uint32_t)std::min<uint64_t>(std::max<uint64_t>(scaled, 1), 1u << 30);
+      break;
+    }
+    iterations *= 2;
+  }
+
+  // Медиана нескольких партий устойчивее к вытеснению процесса
+  double samples[kSamples];
+  for (int i = 0; i < kSamples; i++) {
+    samples[i] = (double)timeBatch(bench, iterations) / iterations;
+  }
+  std::sort(samples, samples + kSamples);
+
+  allocatedBytes = 0;
+  allocationCount = 0;
+  countAllocations = true;
+  bench.run(iterations);
+  countAllocations = false;
+
+  result.name = bench.name;
+  result.iterations = iterations;
+  result.nsPerOp = samples[kSamples / 2];
+  result.bytesPerOp = (double)allocatedBytes / iterations;
+  result.allocsPerOp = (double)allocationCount / iterations;
+}
+
+// ---- пороги ----
+
+// {"tolerance_pct": 25, "benchmarks": {"name": {"max_ns": 100, "max_bytes": 0}}}
+// max_ns допускает превышение на tolerance_pct (шум замера), max_bytes —
+// точный: число выделений от запуска к запуску не меняется.
+static bool loadThresholds(const char *path, DynamicJsonDocument &doc) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  String text;
+  char chunk[512];
+  size_t length;
+  while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    text.concat(chunk, length);
+  }
+  fclose(file);
+  if (deserializeJson(doc, text) != DeserializationError::Ok) {
+    fprintf(stderr, "bench: не удалось разобрать %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+static void applyThreshold(const DynamicJsonDocument &doc, BenchResult &result) {
+  result.maxNs = -1;
+  result.maxBytes = -1;
+  result.regressed = false;
+  JsonVariantConst limits = doc["benchmarks"][result.name];
+  if (limits.isNull()) {
+    return;
+  }
+  double tolerance = doc["tolerance_pct"] | 0.0;
+  if (!limits["max_ns"].isNull()) {
+    result.maxNs = limits["max_ns"] | 0.0;
+    if (result.nsPerOp > result.maxNs * (1.0 + tolerance / 100.0)) {
+      result.regressed = true;
+    }
+  }
+  if (!limits["max_bytes"].isNull()) {
+    result.maxBytes = limits["max_bytes"] | 0.0;
+    if (result.bytesPerOp > result.maxBytes) {
+      result.regressed = true;
+    }
+  }
+}
+
+// ---- вывод ----
+
+static bool writeResults(const char *path, const BenchResult *results, size_t count, int failed) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  fprintf(file, "{\"benchmarks\":[");
+  for (size_t i = 0; i < count; i++) {
+    const BenchResult &r = results[i];
+    fprintf(file, "%s\n  {\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,"
+                  "\"bytes_per_op\":%.2f,\"allocs_per_op\":%.2f",
+            i ? "," : "", r.name, (unsigned long long)r.iterations, r.nsPerOp, r.bytesPerOp, r.allocsPerOp);
+    if (r.maxNs >= 0) {
+      fprintf(file, ",\"max_ns\":%.0f", r.maxNs);
+    }
+    if (r.maxBytes >= 0) {
+      fprintf(file, ",\"max_bytes\":%.0f", r.maxBytes);
+    }
+    fprintf(file, ",\"regressed\":%s}", r.regressed ? "true" : "false");
+  }
+  fprintf(file, "\n],\"failed\":%d}\n", failed);
+  fclose(file);
+  return true;
+}
+
+static const char *envOr(const char *name, const char *fallback) {
+  const char *value = getenv(name);
+  return value && *value ? value : fallback;
+}
+
+int runBenchmarks(const BenchCase *cases, size_t count) {
+  const char *filter = getenv("GONG_BENCH_FILTER");
+  uint32_t budgetMs = strtoul(envOr("GONG_BENCH_MS", "200"), nullptr, 10);
+  const char *outPath = envOr("GONG_BENCH_OUT", "bench_results.json");
+  const char *thresholdsPath = envOr("GONG_BENCH_THRESHOLDS", "bench/thresholds.json");
+
+  DynamicJsonDocument thresholds(4096);
+  if (!loadThresholds(thresholdsPath, thresholds)) {
+    printf("bench: пороги не заданы (%s)\n", thresholdsPath);
+  }
+
+  BenchResult *results = new BenchResult[count];
+  size_t done = 0;
+  int failed = 0;
+  printf("%-28s %12s %10s %10s %12s\n", "benchmark", "ns/op", "B/op", "allocs/op", "iterations");
+  for (size_t i = 0; i < count; i++) {
+    if (filter && !strstr(cases[i].name, filter)) {
+      continue;
+    }
+    BenchResult &result = results[done++];
+    measure(cases[i], budgetMs ? budgetMs : 1, result);
+    applyThreshold(thresholds, result);
+    if (result.regressed) {
+      failed++;
+    }
+    printf("%-28s %12.1f %10.1f %10.2f %12llu%s\n", result.name, result.nsPerOp, result.bytesPerOp,
+           result.allocsPerOp, (unsigned long long)result.iterations, result.regressed ? "  REGRESSED" : "");
+  }
+
+  if (!writeResults(outPath, results, done, failed)) {
+    fprintf(stderr, "bench: не удалось записать %s\n", outPath);
+  }
+  printf("%zu случаев, превышений порога: %d; результаты в %s\n", done, failed, outPath);
+  delete[] results;
+  return failed;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Микробенчмарки горячих путей прошивки (env:bench, сборка для Linux).
+// Каждый случай выполняет операцию iterations раз; раннер подбирает
+// число повторов, меряет нс на операцию и байты, выделенные из кучи
+// за операцию, пишет результаты в JSON и сравнивает их с порогами.
+
+struct BenchCase {
+  const char *name;
+  void (*run)(uint32_t iterations);
+};
+
+// Не даёт компилятору выбросить вычисленное значение
+template <typename T>
+inline void benchKeep(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Запускает случаи, печатает таблицу и пишет JSON.
+// Переменные окружения:
+//   GONG_BENCH_FILTER      — только случаи, имя которых содержит строку;
+//   GONG_BENCH_MS          — время замера одного случая (200 мс);
+//   GONG_BENCH_OUT         — файл результатов (bench_results.json);
+//   GONG_BENCH_THRESHOLDS  — файл порогов (bench/thresholds.json).
+// Возвращает число случаев, превысивших пороги.
+int runBenchmarks(const BenchCase *cases, size_t count);
@@ -0,0 +1,713 @@
+// Случаи бенчмарков: те же функции и те же шаги, что в обработчиках
+// server.on() из src/main.cpp, на данных типичного размера.
+
+#include <Arduino.h>
+#include <lwip/sockets.h>
+#include <stdio.h>
+
+#include "alarm_json.h"
+#include "alarm_scheduler.h"
+#include "audio_commands.h"
+#include "bench.h"
+#include "config_store.h"
+#include "dfplayer.h"
+#include "esp32_trace.h"
+#include "event_journal.h"
+#include "gong_web_server.h"
+#include "json_writer.h"
+#include "metrics_writer.h"
+#include "occurrence_cache.h"
+#include "route_stats.h"
+#include "spsc_ring.h"
+#include "template_renderer.h"
+#include "web_templates.h"
+
+// ---- данные ----
+
+// Неделя 2026-10-12 (Пн), локальное время в мкс
+static const int64_t kMondayUs = 1791763200LL * 1000000;
+
+static AlarmScheduler scheduler;
+static RouteStats routeStats;
+// Кольца точек трассировки (в прошивке — в main.cpp)
+TraceBuffer traceBuffer;
+
+// 32 будильника вразброс по суткам и дням — как у реального расписания
+static void fillScheduler() {
+  if (scheduler.size() > 0) {
+    return;
+  }
+  for (uint16_t i = 0; i < 32; i++) {
+    AlarmEntry alarm = {};
+    alarm.id = i + 1;
+    alarm.minuteOfDay = (i * 97) % MINUTES_PER_DAY;
+    alarm.days = i % 3 == 0 ? ALARM_ALL_DAYS : (uint32_t)(0x15 << (i % 3));
+    alarm.duration = 5 + i % 30;
+    alarm.active = i % 5 != 0;
+    alarm.track = 1 + i % 4;
+    scheduler.upsert(alarm);
+  }
+}
+
+// Приёмник чанков: считает байты, никуда не отправляет
+class NullSink : public ChunkSink {
+public:
+  void write(const char *data, size_t length) override {
+    benchKeep(data);
+    bytes += length;
+  }
+  size_t bytes = 0;
+};
+
+// ---- страницы и JSON ----
+
+class BenchPageContext : public TemplateContext {
+public:
+  void slot(uint8_t slot, TemplateWriter &out) override {
+    switch (slot) {
+      case SLOT_WIFI_STATE:
+        out.text("Подключен");
+        break;
+      case SLOT_IP:
+        out.raw("192.168.1.57");
+        break;
+      case SLOT_SSID:
+        out.text("Dhamma <Hall>");
+        break;
+      case SLOT_PASS:
+        out.text("secret&pass");
+        break;
+      case SLOT_DFPLAYER_STATE:
+        out.text("Играет трек ");
+        out.number(3);
+        break;
+      case SLOT_VOLUME:
+        out.number(20);
+        break;
+    }
+  }
+
+  bool section(uint8_t slot) override {
+    return slot == SLOT_WIFI_CONNECTED;
+  }
+};
+
+// GET /status: шаблон через буфер 512 байт
+static void benchRenderStatusPage(uint32_t iterations) {
+  BenchPageContext ctx;
+  NullSink sink;
+  for (uint32_t i = 0; i < iterations; i++) {
+    char buffer[512];
+    TemplateWriter out(buffer, sizeof(buffer), sink);
+    renderTemplate(kTemplate_status, ctx, out);
+    out.flush();
+  }
+  benchKeep(sink.bytes);
+}
+
+// GET /audio: шаблон через буфер 512 байт
+static void benchRenderAudioPage(uint32_t iterations) {
+  BenchPageContext ctx;
+  NullSink sink;
+  for (uint32_t i = 0; i < iterations; i++) {
+    char buffer[512];
+    TemplateWriter out(buffer, sizeof(buffer), sink);
+    renderTemplate(kTemplate_audio, ctx, out);
+    out.flush();
+  }
+  benchKeep(sink.bytes);
+}
+
+// Прежние обработчики /status и /audio (до шаблонов): страница
+// собиралась в String через += и уходила в server.send() целиком.
+// Оставлены для сравнения с render_status_page и render_audio_page.
+static void benchLegacyStatusPage(uint32_t iterations) {
+  NullSink sink;
+  bool connected = true;
+  String ip = "192.168.1.57";
+  String wifi_ssid = "Dhamma Hall";
+  for (uint32_t i = 0; i < iterations; i++) {
+    String html = "<!DOCTYPE html><html><head>";
+    html += "<meta charset='UTF-8'>";
+    html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
+    html += "<title>Статус системы</title>";
+    html += "</head><body>";
+    html += "<h2>Статус системы</h2>";
+    html += "<p><strong>WiFi:</strong> ";
+    html += (connected ? "Подключен" : "Отключен");
+    html += "</p>";
+    if (connected) {
+      html += "<p><strong>IP адрес:</strong> ";
+      html += ip;
+      html += "</p>";
+      html += "<p><strong>SSID:</strong> ";
+      html += wifi_ssid;
+      html += "</p>";
+    }
+    html += "<p><strong>DFPlayer:</strong> ";
+    html += "Готов";
+    html += "</p>";
+    html += "<p><a href='/'>Назад</a></p>";
+    html += "</body></html>";
+    sink.write(html.c_str(), html.length());
+  }
+  benchKeep(sink.bytes);
+}
+
+static void benchLegacyAudioPage(uint32_t iterations) {
+  NullSink sink;
+  for (uint32_t i = 0; i < iterations; i++) {
+    String html = "<!DOCTYPE html><html><head>";
+    html += "<meta charset='UTF-8'>";
+    html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
+    html += "<title>Управление аудио</title>";
+    html += "</head><body>";
+    html += "<h2>Управление аудио</h2>";
+    html += "<h3>Воспроизведение</h3>";
+    html += "<button onclick='playAudio()'>Воспроизвести</button> ";
+    html += "<button onclick='stopAudio()'>Остановить</button><br><br>";
+    html += "<h3>Громкость</h3>";
+    html += "<input type='range' id='volume' min='0' max='30' value='20' onchange='setVolume(this.value)'> ";
+    html += "<span id='volValue'>20</span><br><br>";
+    html += "<h3>Выбор трека</h3>";
+    html += "<input type='number' id='track' min='1' max='100' value='1'> ";
+    html += "<button onclick='playTrack()'>Воспроизвести трек</button><br><br>";
+    html += "<p><a href='/'>Назад</a></p>";
+    html += "<script>";
+    html += "function playAudio() { fetch('/api/audio/play', {method:'POST'}).then(r=>r.json()).then(d=>alert(d.status)); }";
+    html += "function stopAudio() { fetch('/api/audio/stop', {method:'POST'}).then(r=>r.json()).then(d=>alert(d.status)); }";
+    html += "function setVolume(val) { document.getElementById('volValue').textContent = val; fetch('/api/audio/volume?value='+val, {method:'POST'}).then(r=>r.json()).then(d=>alert('Громкость: ' + d.volume)); }";
+    html += "function playTrack() { let track = document.getElementById('track').value; fetch('/api/audio/track?num='+track, {method:'POST'}).then(r=>r.json()).then(d=>alert(d.status + ' трек: ' + d.track)); }";
+    html += "</script>";
+    html += "</body></html>";
+    sink.write(html.c_str(), html.length());
+  }
+  benchKeep(sink.bytes);
+}
+
+// GET /api/alarms: JsonWriter в буфер ответа 512 байт, как JsonReply
+static void benchRenderAlarmsJson(uint32_t iterations) {
+  fillScheduler();
+  NullSink sink;
+  for (uint32_t i = 0; i < iterations; i++) {
+    char buffer[512];
+    TemplateWriter out(buffer, sizeof(buffer), sink);
+    JsonWriter json(out);
+    json.beginObject();
+    json.beginArray("alarms");
+    for (size_t j = 0; j < scheduler.size(); j++) {
+      alarmToJson(scheduler.at(j), json);
+    }
+    json.endArray();
+    json.number("version", 42);
+    json.endObject();
+    out.flush();
+  }
+  benchKeep(sink.bytes);
+}
+
+// GET /api/schedule: срабатывания дня из кэша
+static void benchRenderScheduleJson(uint32_t iterations) {
+  fillScheduler();
+  // Кэш собирается один раз: его выделения не относятся к ответу
+  static OccurrenceCache cache;
+  int32_t today = (int32_t)(kMondayUs / 86400000000LL);
+  if (!cache.covers(today)) {
+    cache.rebuild(today, scheduler);
+  }
+  NullSink sink;
+  for (uint32_t i = 0; i < iterations; i++) {
+    char buffer[512];
+    TemplateWriter out(buffer, sizeof(buffer), sink);
+    JsonWriter json(out);
+    json.beginObject();
+    json.string("date", "2026-10-12");
+    json.beginArray("alarms");
+    OccurrenceList list = cache.day(today);
+    for (size_t j = 0; j < list.size(); j++) {
+      occurrenceToJson(list[j], json);
+    }
+    json.endArray();
+    json.endObject();
+    out.flush();
+  }
+  benchKeep(sink.bytes);
+}
+
+// GET /api/metrics: маршруты с гистограммами
+static void benchRenderMetrics(uint32_t iterations) {
+  static const char *kRoutes[] = {"GET /status", "GET /api/alarms", "POST /api/alarms", "GET /api/metrics"};
+  if (routeStats.size() == 0) {
+    for (const char *route : kRoutes) {
+      RouteStat *stat = routeStats.add(route);
+      for (uint32_t us = 100; us < 200000; us = us * 3 / 2) {
+        routeStats.record(stat, us);
+      }
+    }
+  }
+  NullSink sink;
+  for (uint32_t i = 0; i < iterations; i++) {
+    char buffer[1460];
+    TemplateWriter out(buffer, sizeof(buffer), sink);
+    MetricsWriter metrics(out);
+    metrics.family("gong_uptime_seconds", "gauge", "Time since boot");
+    metrics.sample("gong_uptime_seconds", 86400);
+    metrics.family("gong_heap_free_bytes", "gauge", "Free heap");
+    metrics.sample("gong_heap_free_bytes", 180000);
+    metrics.family("gong_http_request_duration_seconds", "histogram", "HTTP handler latency");
+    for (size_t j = 0; j < routeStats.size(); j++) {
+      const RouteStat &stat = routeStats.at(j);
+      metrics.histogram("gong_http_request_duration_seconds", "route", stat.route, stat);
+    }
+    out.flush();
+  }
+  benchKeep(sink.bytes);
+}
+
+// ---- разбор запросов ----
+
+// Доступ к разбору аргументов веб-сервера без сокета
+class BenchServer : public GongWebServer {
+public:
+  BenchServer() : GongWebServer(0) {}
+  // Как processRequest(): разбор на месте, поэтому — по копии строки
+  void parse(const char *query, size_t length) {
+    memcpy(_query, query, length);
+    _query[length] = '\0';
+    _arena.reset();
+    reserveArgs(countArguments(_query, length));
+    parseArguments(_query, length);
+  }
+
+private:
+  char _query[128];
+};
+
+// POST /api/audio/track?num=3 и /api/calendar?month=...
+static void benchParseQueryArgs(uint32_t iterations) {
+  static BenchServer server;
+  static const char kQuery[] = "num=3&volume=25&month=2026-10&ssid=Dhamma%20Hall";
+  long sum = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    server.parse(kQuery, sizeof(kQuery) - 1);
+    if (server.hasArg("num")) {
+      sum += server.arg("num").toInt();
+    }
+    sum += server.arg("volume").toInt();
+  }
+  benchKeep(sum);
+}
+
+// POST /api/alarms
+static void benchParseAlarmJson(uint32_t iterations) {
+  static const char kBody[] = "{\"time\":\"07:30\",\"duration\":30,\"days\":[0,1,2,3,4],\"active\":true,\"track\":2}";
+  for (uint32_t i = 0; i < iterations; i++) {
+    AlarmEntry alarm = {};
+    const char *error = nullptr;
+    bool ok = alarmFromJson(kBody, sizeof(kBody) - 1, alarm, false, error);
+    benchKeep(ok);
+    benchKeep(alarm);
+  }
+}
+
+// Запрос API целиком через сокет: приём, разбор, обработчик в духе
+// POST /api/audio/track (аргументы-виды, ответ JsonWriter в арене),
+// запись ответа. Клиент keep-alive на loopback в том же потоке.
+class ApiRequestBench {
+public:
+  ApiRequestBench() : _server(0) {}
+
+  bool start() {
+    if (_client >= 0) {
+      return true;
+    }
+    _server.on("/api/audio/track", HTTP_POST, [this]() { handleTrack(); });
+    if (!_server.begin()) {
+      return false;
+    }
+    _client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(_server.port());
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(_client, (struct sockaddr *)&address, sizeof(address)) != 0) {
+      ::close(_client);
+      _client = -1;
+      return false;
+    }
+    int noDelay = 1;
+    setsockopt(_client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return true;
+  }
+
+  // Один запрос и ответ; false — ответ не пришёл
+  bool request() {
+    static const char kRequest[] =
+      "POST /api/audio/track?num=3&duration_ms=30000 HTTP/1.1\r\n"
+      "Host: gong.local\r\n"
+      "Content-Length: 0\r\n\r\n";
+    if (send(_client, kRequest, sizeof(kRequest) - 1, 0) != (ssize_t)(sizeof(kRequest) - 1)) {
+      return false;
+    }
+    // Ответ короткий: уходит за один проход handleClient()
+    size_t received = 0;
+    for (int pass = 0; pass < 100 && !complete(received); pass++) {
+      _server.handleClient();
+      ssize_t n = recv(_client, _response + received, sizeof(_response) - received, MSG_DONTWAIT);
+      if (n > 0) {
+        received += n;
+      }
+    }
+    return complete(received);
+  }
+
+private:
+  void handleTrack() {
+    long num;
+    if (!_server.arg("num").toLong(num) || num <= 0) {
+      _server.send(400, "application/json", "{\"error\":\"invalid track number\"}");
+      return;
+    }
+    char *buffer = (char *)_server.arena().alloc(512);
+    TemplateWriter out(buffer, 512);
+    JsonWriter json(out);
+    json.beginObject();
+    json.string("status", "playing");
+    json.number("track", num);
+    json.number("id", ++_id);
+    json.endObject();
+    _server.send(202, "application/json", out.data(), out.length());
+  }
+
+  // Заголовки и тело по Content-Length
+  bool complete(size_t received) {
+    _response[received] = '\0';
+    const char *end = strstr(_response, "\r\n\r\n");
+    const char *length = strstr(_response, "Content-Length: ");
+    return end && length && received >= (size_t)(end + 4 - _response) + (size_t)atoi(length + 16);
+  }
+
+  GongWebServer _server;
+  int _client = -1;
+  uint32_t _id = 0;
+  char _response[512];
+};
+
+static void benchApiRequest(uint32_t iterations) {
+  static ApiRequestBench bench;
+  if (!bench.start()) {
+    fprintf(stderr, "api_request: нет loopback-сокета\n");
+    return;
+  }
+  uint32_t ok = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    ok += bench.request();
+  }
+  benchKeep(ok);
+}
+
+// ---- настройки ----
+
+// Два слота в памяти вместо файлов SPIFFS
+class MemoryConfigStorage : public ConfigStorage {
+public:
+  size_t read(uint8_t slot, uint8_t *data, size_t capacity) override {
+    size_t length = _length[slot] < capacity ? _length[slot] : capacity;
+    memcpy(data, _data[slot], length);
+    return length;
+  }
+  bool write(uint8_t slot, const uint8_t *data, size_t length) override {
+    memcpy(_data[slot], data, length);
+    _length[slot] = length;
+    return true;
+  }
+
+private:
+  uint8_t _data[2][ConfigStore::kMaxRecord] = {};
+  size_t _length[2] = {0, 0};
+};
+
+static void fillConfig(GongConfig &config) {
+  memset(&config, 0, sizeof(config));
+  copyConfigString(config.wifiSsid, sizeof(config.wifiSsid), "Dhamma Hall", 11);
+  copyConfigString(config.wifiPass, sizeof(config.wifiPass), "anicca-dukkha-anatta", 20);
+  copyConfigString(config.timezone, sizeof(config.timezone), "MSK-3", 5);
+  copyConfigString(config.ntpServer, sizeof(config.ntpServer), "pool.ntp.org", 12);
+  config.volume = 20;
+  config.missedGraceSec = 60;
+}
+
+// Загрузка при старте: обе копии, CRC, выбор свежей (бывший readWiFiConfig)
+static void benchConfigLoad(uint32_t iterations) {
+  static MemoryConfigStorage storage;
+  static ConfigStore writer(storage);
+  static bool filled = false;
+  if (!filled) {
+    GongConfig config;
+    fillConfig(config);
+    writer.commit(config);
+    writer.commit(config);
+    filled = true;
+  }
+  ConfigStore store(storage);
+  for (uint32_t i = 0; i < iterations; i++) {
+    GongConfig config;
+    fillConfig(config);
+    bool ok = store.load(config);
+    benchKeep(ok);
+    benchKeep(config);
+  }
+}
+
+// Перенос config.txt прежних прошивок: разбор строк "key=value"
+static void benchLegacyConfigParse(uint32_t iterations) {
+  static const char *kLines[] = {"wifi_ssid=Dhamma Hall", "wifi_pass=anicca-dukkha-anatta", "volume=20"};
+  for (uint32_t i = 0; i < iterations; i++) {
+    GongConfig config;
+    memset(&config, 0, sizeof(config));
+    for (const char *line : kLines) {
+      applyLegacyConfigLine(line, strlen(line), config);
+    }
+    benchKeep(config);
+  }
+}
+
+// ---- DFPlayer ----
+
+static void benchDfplayerEncode(uint32_t iterations) {
+  uint8_t frame[DFPLAYER_FRAME_SIZE];
+  for (uint32_t i = 0; i < iterations; i++) {
+    dfplayer::encodeFrame(dfplayer::CMD_PLAY_TRACK, (uint16_t)(i & 0xFF), false, frame);
+    benchKeep(frame);
+  }
+}
+
+static void benchDfplayerParse(uint32_t iterations) {
+  uint8_t frame[DFPLAYER_FRAME_SIZE];
+  dfplayer::encodeFrame(dfplayer::EVT_TRACK_DONE, 3, false, frame);
+  dfplayer::FrameParser parser;
+  uint32_t frames = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (uint8_t byte : frame) {
+      frames += parser.feed(byte);
+    }
+  }
+  benchKeep(frames);
+}
+
+// Путь команды удара между задачами: id, кольцо TimingTask -> audioTask,
+// очередь со схлопыванием, статус выполнения
+static void benchAudioCommandPath(uint32_t iterations) {
+  static AudioCommandLog log;
+  static SpscRing<AudioCommand, 16> ring;
+  static AudioCommandQueue queue(log);
+  for (uint32_t i = 0; i < iterations; i++) {
+    AudioCommand command = {log.issue(), AudioOp::Strike, (uint16_t)(i & 0xFF)};
+    ring.push(command);
+    while (const AudioCommand *next = ring.peek()) {
+      if (!queue.push(*next)) {
+        break;
+      }
+      ring.drop();
+    }
+    AudioCommand sent;
+    if (queue.pop(sent)) {
+      queue.complete(sent.id, true);
+    }
+    benchKeep(sent);
+  }
+}
+
+// ---- журнал событий ----
+
+// Сегменты журнала в памяти вместо файлов SPIFFS
+class MemoryJournalStorage : public JournalStorage {
+public:
+  size_t length(uint8_t segment) override { return _length[segment]; }
+  size_t read(uint8_t segment, size_t offset, uint8_t *data, size_t length) override {
+    if (offset >= _length[segment]) {
+      return 0;
+    }
+    if (length > _length[segment] - offset) {
+      length = _length[segment] - offset;
+    }
+    memcpy(data, _data[segment] + offset, length);
+    return length;
+  }
+  bool append(uint8_t segment, const uint8_t *data, size_t length) override {
+    if (length > EVENT_JOURNAL_SEGMENT_SIZE - _length[segment]) {
+      return false;
+    }
+    memcpy(_data[segment] + _length[segment], data, length);
+    _length[segment] += length;
+    return true;
+  }
+  bool erase(uint8_t segment) override {
+    _length[segment] = 0;
+    return true;
+  }
+
+private:
+  uint8_t _data[EVENT_JOURNAL_SEGMENTS][EVENT_JOURNAL_SEGMENT_SIZE];
+  size_t _length[EVENT_JOURNAL_SEGMENTS] = {};
+};
+
+static MemoryJournalStorage journalStorage;
+
+static JournalRecord journalRecord(uint32_t i) {
+  JournalRecord record = {};
+  record.time = 1791763200 + i * 60;
+  record.type = (uint8_t)JournalEvent::Alarm;
+  record.alarmId = (uint16_t)(i % 50 + 1);
+  record.track = 1;
+  record.latencyUs = (int32_t)(i % 1000);
+  return record;
+}
+
+// Событие от производителя (удар, WiFi): копия в очередь журнала; это
+// всё, что делает задача-производитель, запись во flash — в journalTask
+static void benchJournalQueue(uint32_t iterations) {
+  static JournalQueue queue;
+  for (uint32_t i = 0; i < iterations; i++) {
+    queue.push(journalRecord(i));
+    JournalRecord record;
+    queue.pop(record);
+    benchKeep(record);
+  }
+}
+
+// Запись события в сегмент: номер, CRC, переход к следующему сегменту
+static void benchJournalAppend(uint32_t iterations) {
+  static EventJournal journal(journalStorage);
+  for (uint32_t i = 0; i < iterations; i++) {
+    JournalRecord record = journalRecord(i);
+    bool ok = journal.append(record);
+    benchKeep(ok);
+  }
+}
+
+// Страница /api/journal за час посреди заполненного журнала
+static void benchJournalQuery(uint32_t iterations) {
+  static MemoryJournalStorage storage;
+  static EventJournal journal(storage);
+  static bool filled = false;
+  const uint32_t total = EVENT_JOURNAL_SEGMENTS * EventJournal::kRecordsPerSegment;
+  if (!filled) {
+    for (uint32_t i = 0; i < total; i++) {
+      JournalRecord record = journalRecord(i);
+      journal.append(record);
+    }
+    filled = true;
+  }
+  JournalRecord page[32];
+  for (uint32_t i = 0; i < iterations; i++) {
+    uint32_t from = journalRecord(total / 2 + i % 64).time;
+    bool more;
+    size_t count = journal.query(from, from + 3600, 0, page, 32, more);
+    benchKeep(count);
+    benchKeep(page);
+  }
+}
+
+// ---- трассировка ----
+
+// Точка трассировки в рабочей сборке: такты, ядро, задача, слот кольца
+static void benchTraceEvent(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    TRACE_INSTANT("bench", i);
+  }
+  benchKeep(traceBuffer);
+}
+
+// GET /api/trace: полные кольца обоих ядер в JSON
+static void benchTraceExport(uint32_t iterations) {
+  static TraceBuffer buffer;
+  static const char *kNames[] = {"fire_group", "audio_command", "uart_write", "GET /api/status"};
+  for (uint8_t core = 0; core < TRACE_CORES; core++) {
+    // Метка часов и за ней события — кольцо заполнено целиком
+    buffer.record(core, TracePhase::Clock, nullptr, nullptr, 0, (uint32_t)kMondayUs);
+    for (uint32_t i = 0; i < TRACE_BUFFER_EVENTS - 1; i++) {
+      TracePhase phase = i % 2 == 0 ? TracePhase::Begin : TracePhase::End;
+      buffer.record(core, phase, kNames[i / 2 % 4], &buffer, i * 2400, i % 3);
+    }
+  }
+  char chunk[512];
+  NullSink sink;
+  for (uint32_t i = 0; i < iterations; i++) {
+    TemplateWriter out(chunk, sizeof(chunk), sink);
+    JsonWriter json(out);
+    json.beginObject();
+    json.beginArray("traceEvents");
+    size_t written = 0;
+    for (uint8_t core = 0; core < TRACE_CORES; core++) {
+      written += buffer.exportChrome(core, json, kMondayUs + 1000000, 240);
+    }
+    json.endArray();
+    json.endObject();
+    out.flush();
+    benchKeep(written);
+  }
+  benchKeep(sink.bytes);
+}
+
+// ---- будильники ----
+
+// Следующее срабатывание для таймера будильников
+static void benchNextAlarm(uint32_t iterations) {
+  fillScheduler();
+  AlarmFire fire;
+  for (uint32_t i = 0; i < iterations; i++) {
+    // Сдвигаемся по неделе, чтобы поиск не попадал в одно место
+    int64_t fromUs = kMondayUs + (int64_t)(i % MINUTES_PER_WEEK) * 60000000LL;
+    bool found = scheduler.nextFire(fromUs, fire);
+    benchKeep(found);
+    benchKeep(fire);
+  }
+}
+
+// Пересборка кэша срабатываний при смене дня
+static void benchOccurrenceRebuild(uint32_t iterations) {
+  fillScheduler();
+  static OccurrenceCache cache;
+  int32_t today = (int32_t)(kMondayUs / 86400000000LL);
+  for (uint32_t i = 0; i < iterations; i++) {
+    cache.rebuild(today + (int32_t)(i % 7), scheduler);
+    benchKeep(cache);
+  }
+}
+
+static const BenchCase kBenchCases[] = {
+  {"render_status_page",    benchRenderStatusPage},
+  {"render_audio_page",     benchRenderAudioPage},
+  {"legacy_status_page",    benchLegacyStatusPage},
+  {"legacy_audio_page",     benchLegacyAudioPage},
+  {"render_alarms_json",    benchRenderAlarmsJson},
+  {"render_schedule_json",  benchRenderScheduleJson},
+  {"render_metrics",        benchRenderMetrics},
+  {"parse_query_args",      benchParseQueryArgs},
+  {"parse_alarm_json",      benchParseAlarmJson},
+  {"api_request",           benchApiRequest},
+  {"config_load",           benchConfigLoad},
+  {"legacy_config_parse",   benchLegacyConfigParse},
+  {"dfplayer_encode_frame", benchDfplayerEncode},
+  {"dfplayer_parse_frame",  benchDfplayerParse},
+  {"audio_command_path",    benchAudioCommandPath},
+  {"journal_queue",         benchJournalQueue},
+  {"journal_append",        benchJournalAppend},
+  {"journal_query",         benchJournalQuery},
+  {"trace_event",           benchTraceEvent},
+  {"trace_export",          benchTraceExport},
+  {"next_alarm",            benchNextAlarm},
+  {"occurrence_rebuild",    benchOccurrenceRebuild},
+};
+
+// Точка входа lib/hal_native вызывает setup(); код возврата — число
+// превышений порога, чтобы CI падал на регрессии
+void setup() {
+  int failed = runBenchmarks(kBenchCases, sizeof(kBenchCases) / sizeof(kBenchCases[0]));
+  fflush(stdout);
+  exit(failed ? 1 : 0);
+}
+
+void loop() {}
@@ -3,14 +3,56 @@ $(document).ready(function() {
   let currentAlarms = [];
   let editingAlarmId = null;
 
-  // --- Время ---
-  function updateTime() {
-    $.get('/api/time', function(data) {
-      $('#current-time').text('Текущее время: ' + (data.time || '—'));
+  // --- Время и события устройства ---
+  function showTime(data) {
+    $('#current-time').text('Текущее время: ' + (data.time || '—'));
+  }
+  function showPlayer(data) {
+    let text = data.online ? (data.playing ? 'Играет трек #' + data.track : 'Плеер готов') : 'Плеер не отвечает';
+    if (data.online) text += ', громкость ' + data.volume;
+    $('#player-state').text(text);
+  }
+  function showAlarm(data) {
+    const at = new Date(data.at_ms).toLocaleTimeString();
+    const what = data.source === 'group' ? 'Групповой удар' : 'Будильник #' + data.id;
+    $('#audio-status').text(what + ': трек #' + data.track + ' в ' + at);
+  }
+
+  // Без EventSource (или если устройство отказало в подписке) — опрос раз в секунду
+  let pollTimer = null;
+  function startPolling() {
+    if (pollTimer) return;
+    const poll = function() { $.get('/api/time', showTime); };
+    pollTimer = setInterval(poll, 1000);
+    poll();
+    $.get('/api/audio/status', showPlayer);
+  }
+
+  if (window.EventSource) {
+    const events = new EventSource('/api/events');
+    const on = function(type, handler) {
+      events.addEventListener(type, function(e) { handler(JSON.parse(e.data)); });
+    };
+    on('time', showTime);
+    on('player', showPlayer);
+    on('alarm', showAlarm);
+    let scheduleVersion = null;
+    on('schedule', function(data) {
+      // Первое событие — текущая версия, список уже загружен
+      if (scheduleVersion !== null && data.version !== scheduleVersion) loadAlarms();
+      scheduleVersion = data.version;
     });
+    events.onopen = function() {
+      if (pollTimer) {
+        clearInterval(pollTimer);
+        pollTimer = null;
+      }
+    };
+    // Обрыв браузер переподключает сам (retry: 3000); опрос — пока потока нет
+    events.onerror = startPolling;
+  } else {
+    startPolling();
   }
-  setInterval(updateTime, 1000);
-  updateTime();
 
   // --- Утилиты ---
   const dayLabels = ['Пн','Вт','Ср','Чт','Пт','Сб','Вс'];
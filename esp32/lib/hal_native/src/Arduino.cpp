@@ -0,0 +1,270 @@
+#include "Arduino.h"
+
+#include <arpa/inet.h>
+#include <malloc.h>
+#include <sys/random.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "fake_uart.h"
+
+// ---- время ----
+
+static const auto processStart = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - processStart)
+      .count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processStart)
+      .count();
+}
+
+int64_t esp_timer_get_time() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processStart)
+      .count();
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+// ---- Print / Stream ----
+
+size_t Print::write(const uint8_t *data, size_t length) {
+  size_t written = 0;
+  while (length--) {
+    written += write(*data++);
+  }
+  return written;
+}
+
+size_t Print::write(const char *text) {
+  return text ? write((const uint8_t *)text, strlen(text)) : 0;
+}
+
+size_t Print::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  char *text = nullptr;
+  int length = vasprintf(&text, format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  size_t written = write((const uint8_t *)text, length);
+  free(text);
+  return written;
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+      return c;
+    }
+    delay(1);
+  } while (millis() - start < _timeoutMs);
+  return -1;
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[count++] = (uint8_t)c;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) {
+      break;
+    }
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    result += (char)c;
+    c = timedRead();
+  }
+  return result;
+}
+
+// ---- IPAddress ----
+
+IPAddress::IPAddress(uint32_t address) {
+  memcpy(_bytes, &address, 4);
+}
+
+IPAddress::operator uint32_t() const {
+  uint32_t address;
+  memcpy(&address, _bytes, 4);
+  return address;
+}
+
+bool IPAddress::operator==(const IPAddress &other) const {
+  return memcmp(_bytes, other._bytes, 4) == 0;
+}
+
+bool IPAddress::fromString(const char *address) {
+  struct in_addr parsed;
+  if (inet_pton(AF_INET, address, &parsed) != 1) {
+    return false;
+  }
+  memcpy(_bytes, &parsed.s_addr, 4);
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+  return String(buf);
+}
+
+// ---- UART ----
+
+HardwareSerial Serial(0);
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+  (void)baud;
+  (void)config;
+  (void)rxPin;
+  (void)txPin;
+  if (_uartNr == 0) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    return;
+  }
+  _uart = FakeUart::forPort(_uartNr);
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout) {
+  (void)onlyOnTimeout;
+  if (_uart) {
+    _uart->onReceive(function);
+  }
+}
+
+int HardwareSerial::available() {
+  return _uart ? _uart->available() : 0;
+}
+
+int HardwareSerial::read() {
+  return _uart ? _uart->read() : -1;
+}
+
+int HardwareSerial::peek() {
+  return _uart ? _uart->peek() : -1;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length) {
+  if (_uartNr == 0) {
+    return fwrite(data, 1, length, stdout);
+  }
+  if (_uart) {
+    _uart->write(data, length);
+  }
+  return length;
+}
+
+// ---- система ----
+
+static std::vector<char *> processArgs;
+
+void nativeSetArgs(int argc, char **argv) {
+  processArgs.assign(argv, argv + argc);
+  processArgs.push_back(nullptr);
+}
+
+esp_reset_reason_t esp_reset_reason() {
+  const char *reason = getenv("GONG_RESET_REASON");
+  return reason && strcmp(reason, "SW") == 0 ? ESP_RST_SW : ESP_RST_POWERON;
+}
+
+uint32_t esp_random() {
+  uint32_t value = 0;
+  if (getrandom(&value, sizeof(value), 0) != sizeof(value)) {
+    value = (uint32_t)rand();
+  }
+  return value;
+}
+
+void esp_restart() {
+  fflush(stdout);
+  fflush(stderr);
+  if (!processArgs.empty()) {
+    // Открытые сокеты не должны пережить «перезагрузку»
+    for (int fd = 3; fd < 1024; fd++) {
+      close(fd);
+    }
+    setenv("GONG_RESET_REASON", "SW", 1);
+    execv("/proc/self/exe", processArgs.data());
+  }
+  _exit(0);
+}
+
+EspClass ESP;
+
+void EspClass::restart() {
+  esp_restart();
+}
+
+// Куча процесса: размер — занятое + свободное внутри арены malloc
+uint32_t EspClass::getFreeHeap() {
+  return heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  static uint32_t minFree = UINT32_MAX;
+  uint32_t current = getFreeHeap();
+  if (current < minFree) {
+    minFree = current;
+  }
+  return minFree;
+}
+
+uint32_t EspClass::getHeapSize() {
+  struct mallinfo2 info = mallinfo2();
+  return info.arena + info.hblkhd;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+  return heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  (void)caps;
+  struct mallinfo2 info = mallinfo2();
+  return info.fordblks;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  (void)caps;
+  // Арена malloc растёт по требованию; наибольший блок — свободное в ней
+  struct mallinfo2 info = mallinfo2();
+  return info.fordblks;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Arduino-ESP32 на Linux: сборка прошивки как обычного процесса
+// (env:native). Здесь только то, чем пользуется прошивка; поведение
+// повторяет Arduino-ESP32 2.0.x там, где от него зависит код.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "WString.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define PROGMEM
+#define PGM_P const char *
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+#define SERIAL_8N1 0x800001c
+
+// UART: номер 0 — консоль (stdout), остальные — поддельные устройства
+// (см. fake_uart.h)
+class HardwareSerial : public Stream {
+public:
+  typedef std::function<void(void)> OnReceiveCb;
+
+  explicit HardwareSerial(int uartNr) : _uartNr(uartNr) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+  void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t length) override;
+  using Print::write;
+
+private:
+  int _uartNr;
+  class FakeUart *_uart = nullptr;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  void restart();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getHeapSize();
+  uint32_t getMaxAllocHeap();
+  // Такт счётчика XTHAL_GET_CCOUNT() на хосте — наносекунда
+  uint32_t getCpuFreqMHz() { return 1000; }
+};
+
+extern EspClass ESP;
+
+// Аргументы процесса: ESP.restart() перезапускает его через exec
+void nativeSetArgs(int argc, char **argv);
@@ -0,0 +1,143 @@
+#include "FS.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SPIFFS.h"
+
+fs::FS SPIFFS;
+
+namespace fs {
+
+File::File(FILE *file, const char *path) : _file(file, fclose), _path(path) {}
+
+size_t File::write(const uint8_t *data, size_t length) {
+  return _file ? fwrite(data, 1, length, _file.get()) : 0;
+}
+
+int File::available() {
+  if (!_file) {
+    return 0;
+  }
+  long current = ftell(_file.get());
+  return current < 0 ? 0 : (int)(size() - current);
+}
+
+int File::read() {
+  return _file ? fgetc(_file.get()) : -1;
+}
+
+int File::peek() {
+  if (!_file) {
+    return -1;
+  }
+  int c = fgetc(_file.get());
+  if (c != EOF) {
+    ungetc(c, _file.get());
+  }
+  return c;
+}
+
+size_t File::read(uint8_t *buffer, size_t length) {
+  return _file ? fread(buffer, 1, length, _file.get()) : 0;
+}
+
+bool File::seek(uint32_t position) {
+  return _file && fseek(_file.get(), position, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+  return _file ? ftell(_file.get()) : 0;
+}
+
+size_t File::size() const {
+  if (!_file) {
+    return 0;
+  }
+  fflush(_file.get());
+  struct stat st;
+  return fstat(fileno(_file.get()), &st) == 0 ? st.st_size : 0;
+}
+
+void File::flush() {
+  if (_file) {
+    fflush(_file.get());
+  }
+}
+
+void File::close() {
+  _file.reset();
+}
+
+bool FS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel) {
+  (void)basePath;
+  (void)maxOpenFiles;
+  (void)partitionLabel;
+  const char *root = getenv("GONG_FS_DIR");
+  _root = root && *root ? root : "./fs";
+  struct stat st;
+  if (stat(_root.c_str(), &st) == 0) {
+    return S_ISDIR(st.st_mode);
+  }
+  // Как SPIFFS.begin(true): пустой раздел «форматируется» при первом запуске
+  return formatOnFail && mkdir(_root.c_str(), 0755) == 0;
+}
+
+String FS::hostPath(const char *path) const {
+  // ФС плоская, как SPIFFS: «/dir/name» — имя файла с косой чертой
+  String name(path);
+  while (name.startsWith("/")) {
+    name = name.substring(1);
+  }
+  String escaped;
+  for (unsigned int i = 0; i < name.length(); i++) {
+    escaped += name[i] == '/' ? '%' : name[i];
+  }
+  return _root + "/" + escaped;
+}
+
+File FS::open(const char *path, const char *mode) {
+  String host = hostPath(path);
+  const char *hostMode = strcmp(mode, FILE_WRITE) == 0 ? "wb" : strcmp(mode, FILE_APPEND) == 0 ? "ab" : "rb";
+  FILE *file = fopen(host.c_str(), hostMode);
+  return file ? File(file, path) : File();
+}
+
+bool FS::exists(const char *path) {
+  return access(hostPath(path).c_str(), F_OK) == 0;
+}
+
+bool FS::remove(const char *path) {
+  return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+size_t FS::totalBytes() {
+  // Раздел SPIFFS по умолчанию (default.csv) — 1.4 МБ
+  return 0x160000;
+}
+
+size_t FS::usedBytes() {
+  size_t used = 0;
+  DIR *dir = opendir(_root.c_str());
+  if (!dir) {
+    return 0;
+  }
+  while (struct dirent *entry = readdir(dir)) {
+    struct stat st;
+    String host = _root + "/" + entry->d_name;
+    if (stat(host.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      used += st.st_size;
+    }
+  }
+  closedir(dir);
+  return used;
+}
+
+}  // namespace fs
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+
+#include "Print.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+// Файл на диске хоста; копии File разделяют один FILE*, как в Arduino
+class File : public Stream {
+public:
+  File() {}
+  explicit File(FILE *file, const char *path);
+
+  explicit operator bool() const { return _file != nullptr; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t length) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buffer, size_t length);
+  bool seek(uint32_t position);
+  size_t position() const;
+  size_t size() const;
+  void flush();
+  void close();
+  const char *path() const { return _path.c_str(); }
+
+private:
+  std::shared_ptr<FILE> _file;
+  String _path;
+};
+
+// Файловая система в каталоге хоста (GONG_FS_DIR, по умолчанию ./fs)
+class FS {
+public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+             const char *partitionLabel = nullptr);
+  File open(const char *path, const char *mode = FILE_READ);
+  File open(const String &path, const char *mode = FILE_READ) { return open(path.c_str(), mode); }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *from, const char *to);
+  size_t totalBytes();
+  size_t usedBytes();
+
+  // Путь на диске хоста для пути внутри ФС
+  String hostPath(const char *path) const;
+
+private:
+  String _root;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Print.h"
+#include "WString.h"
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _bytes{a, b, c, d} {}
+  IPAddress(const uint8_t *address) : _bytes{address[0], address[1], address[2], address[3]} {}
+  // Адрес в сетевом порядке байт, как in_addr.s_addr
+  explicit IPAddress(uint32_t address);
+
+  uint8_t operator[](int index) const { return _bytes[index]; }
+  uint8_t &operator[](int index) { return _bytes[index]; }
+  operator uint32_t() const;
+  bool operator==(const IPAddress &other) const;
+
+  bool fromString(const char *address);
+  bool fromString(const String &address) { return fromString(address.c_str()); }
+  String toString() const;
+  size_t printTo(Print &p) const override { return p.print(toString()); }
+
+private:
+  uint8_t _bytes[4];
+};
@@ -0,0 +1,137 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string formatInteger(unsigned long long value, unsigned char base, bool negative) {
+  if (base < 2 || base > 36) {
+    base = 10;
+  }
+  char buf[72];
+  char *p = buf + sizeof(buf);
+  *--p = '\0';
+  do {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative) {
+    *--p = '-';
+  }
+  return p;
+}
+
+String::String(long value, unsigned char base)
+    : _s(base == 10 && value < 0 ? formatInteger(-(unsigned long long)value, base, true)
+                                 : formatInteger((unsigned long)value, base, false)) {}
+
+String::String(unsigned long value, unsigned char base) : _s(formatInteger(value, base, false)) {}
+
+String::String(long long value, unsigned char base)
+    : _s(base == 10 && value < 0 ? formatInteger(-(unsigned long long)value, base, true)
+                                 : formatInteger((unsigned long long)value, base, false)) {}
+
+String::String(unsigned long long value, unsigned char base) : _s(formatInteger(value, base, false)) {}
+
+String::String(double value, unsigned int decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+  _s = buf;
+}
+
+bool String::equalsIgnoreCase(const String &other) const {
+  return _s.size() == other._s.size() && strcasecmp(_s.c_str(), other._s.c_str()) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = _s.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &text, unsigned int from) const {
+  size_t pos = _s.find(text._s, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t pos = _s.rfind(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return _s.size() >= suffix._s.size() &&
+         _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int tmp = from;
+    from = to;
+    to = tmp;
+  }
+  if (from >= _s.size()) {
+    return String();
+  }
+  if (to > _s.size()) {
+    to = _s.size();
+  }
+  return String(_s.substr(from, to - from));
+}
+
+void String::trim() {
+  size_t begin = 0;
+  while (begin < _s.size() && isspace((unsigned char)_s[begin])) {
+    begin++;
+  }
+  size_t end = _s.size();
+  while (end > begin && isspace((unsigned char)_s[end - 1])) {
+    end--;
+  }
+  _s = _s.substr(begin, end - begin);
+}
+
+void String::toLowerCase() {
+  for (char &c : _s) {
+    c = tolower((unsigned char)c);
+  }
+}
+
+void String::toUpperCase() {
+  for (char &c : _s) {
+    c = toupper((unsigned char)c);
+  }
+}
+
+long String::toInt() const {
+  return strtol(_s.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const {
+  return strtof(_s.c_str(), nullptr);
+}
+
+String operator+(const String &a, const String &b) {
+  String result(a);
+  result.concat(b);
+  return result;
+}
+
+String operator+(const String &a, const char *b) {
+  String result(a);
+  result.concat(b);
+  return result;
+}
+
+String operator+(const char *a, const String &b) {
+  String result(a);
+  result.concat(b);
+  return result;
+}
+
+String operator+(const String &a, char b) {
+  String result(a);
+  result.concat(b);
+  return result;
+}
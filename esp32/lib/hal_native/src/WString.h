@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// String из Arduino поверх std::string: ровно то, чем пользуется прошивка
+class String {
+public:
+  String(const char *text = "") : _s(text ? text : "") {}
+  String(const char *text, size_t length) : _s(text, length) {}
+  String(const std::string &text) : _s(text) {}
+  explicit String(char c) : _s(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10) : String((unsigned long)value, base) {}
+  explicit String(int value, unsigned char base = 10) : String((long)value, base) {}
+  explicit String(unsigned int value, unsigned char base = 10) : String((unsigned long)value, base) {}
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2) : String((double)value, decimalPlaces) {}
+  explicit String(double value, unsigned int decimalPlaces = 2);
+
+  // Как в Arduino: строка копируется в уже выделенный буфер
+  String &operator=(const char *text) { _s.assign(text ? text : ""); return *this; }
+
+  const char *c_str() const { return _s.c_str(); }
+  unsigned int length() const { return _s.length(); }
+  bool isEmpty() const { return _s.empty(); }
+  bool reserve(unsigned int size) { _s.reserve(size); return true; }
+  char charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  bool concat(const String &other) { _s += other._s; return true; }
+  bool concat(const char *text) { if (text) _s += text; return true; }
+  bool concat(const char *text, unsigned int length) { _s.append(text, length); return true; }
+  bool concat(char c) { _s += c; return true; }
+  template <typename T> bool concat(T value) { return concat(String(value)); }
+
+  template <typename T> String &operator+=(const T &value) { concat(value); return *this; }
+  String &operator+=(const char *text) { concat(text); return *this; }
+
+  bool equals(const String &other) const { return _s == other._s; }
+  bool equals(const char *text) const { return _s == (text ? text : ""); }
+  bool operator==(const String &other) const { return equals(other); }
+  bool operator==(const char *text) const { return equals(text); }
+  bool operator!=(const String &other) const { return !equals(other); }
+  bool operator!=(const char *text) const { return !equals(text); }
+  bool operator<(const String &other) const { return _s < other._s; }
+  bool equalsIgnoreCase(const String &other) const;
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &text, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  bool startsWith(const String &prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+  bool endsWith(const String &suffix) const;
+  String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const;
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+  long toInt() const;
+  float toFloat() const;
+
+  const std::string &std() const { return _s; }
+
+private:
+  std::string _s;
+};
+
+String operator+(const String &a, const String &b);
+String operator+(const String &a, const char *b);
+String operator+(const char *a, const String &b);
+String operator+(const String &a, char b);
@@ -0,0 +1,295 @@
+#include "WiFi.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "lwip/sockets.h"
+
+// ---- WiFiClient ----
+
+struct WiFiClient::Socket {
+  explicit Socket(int fd) : fd(fd) {}
+  ~Socket() {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  int fd;
+};
+
+WiFiClient::WiFiClient(int fd) : _socket(std::make_shared<Socket>(fd)) {}
+
+int WiFiClient::fd() const {
+  return _socket ? _socket->fd : -1;
+}
+
+uint8_t WiFiClient::connected() {
+  int socketFd = fd();
+  if (socketFd < 0) {
+    return 0;
+  }
+  if (available() > 0) {
+    return 1;
+  }
+  // Соединение живо, пока recv без ожидания не вернёт 0 (FIN)
+  char c;
+  ssize_t result = recv(socketFd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (result == 0) {
+    return 0;
+  }
+  if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    return 0;
+  }
+  return 1;
+}
+
+void WiFiClient::stop() {
+  _socket.reset();
+}
+
+int WiFiClient::available() {
+  int socketFd = fd();
+  if (socketFd < 0) {
+    return 0;
+  }
+  int count = 0;
+  if (ioctl(socketFd, FIONREAD, &count) < 0) {
+    return 0;
+  }
+  return count;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size) {
+  int socketFd = fd();
+  if (socketFd < 0) {
+    return -1;
+  }
+  ssize_t result = recv(socketFd, buffer, size, MSG_DONTWAIT);
+  return result < 0 ? -1 : (int)result;
+}
+
+int WiFiClient::peek() {
+  int socketFd = fd();
+  uint8_t c;
+  if (socketFd < 0 || recv(socketFd, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+size_t WiFiClient::write(const uint8_t *data, size_t length) {
+  int socketFd = fd();
+  size_t sent = 0;
+  while (socketFd >= 0 && sent < length) {
+    ssize_t result = send(socketFd, data + sent, length - sent, MSG_NOSIGNAL);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    sent += result;
+  }
+  return sent;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+  int value = noDelay ? 1 : 0;
+  if (fd() >= 0) {
+    setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+  }
+}
+
+// ---- WiFiServer ----
+
+void WiFiServer::begin(uint16_t port) {
+  if (port) {
+    _port = port;
+  }
+  const char *override = getenv("GONG_HTTP_PORT");
+  if (override && *override) {
+    _port = (uint16_t)atoi(override);
+  }
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (_fd < 0) {
+    return;
+  }
+  int reuse = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(_port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(_fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(_fd, 8) < 0) {
+    fprintf(stderr, "[wifi] порт %u занят: %s\n", _port, strerror(errno));
+    ::close(_fd);
+    _fd = -1;
+    return;
+  }
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+bool WiFiServer::hasClient() {
+  if (_fd < 0) {
+    return false;
+  }
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  FD_SET(_fd, &readSet);
+  struct timeval tv = {0, 0};
+  return select(_fd + 1, &readSet, NULL, NULL, &tv) > 0;
+}
+
+WiFiClient WiFiServer::available() {
+  if (_fd < 0) {
+    return WiFiClient();
+  }
+  int client = ::accept(_fd, NULL, NULL);
+  if (client < 0) {
+    return WiFiClient();
+  }
+  WiFiClient result(client);
+  if (_noDelay) {
+    result.setNoDelay(true);
+  }
+  return result;
+}
+
+void WiFiServer::close() {
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+// ---- WiFiClass ----
+
+WiFiClass WiFi;
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb callback) {
+  for (int i = 0; i < 8; i++) {
+    if (!_callbacks[i]) {
+      _callbacks[i] = callback;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+void WiFiClass::emit(WiFiEvent_t event) {
+  for (int i = 0; i < 8; i++) {
+    if (_callbacks[i]) {
+      _callbacks[i](event);
+    }
+  }
+}
+
+// Сеть из GONG_WIFI_NETWORKS; без переменной доступна любая
+bool WiFiClass::networkKnown(const char *ssid, const char *pass) {
+  const char *networks = getenv("GONG_WIFI_NETWORKS");
+  if (!networks) {
+    return true;
+  }
+  size_t ssidLength = strlen(ssid);
+  size_t passLength = strlen(pass);
+  const char *entry = networks;
+  while (*entry) {
+    const char *end = strchr(entry, ',');
+    size_t length = end ? (size_t)(end - entry) : strlen(entry);
+    if (length == ssidLength + 1 + passLength && strncmp(entry, ssid, ssidLength) == 0 &&
+        entry[ssidLength] == ':' && strncmp(entry + ssidLength + 1, pass, passLength) == 0) {
+      return true;
+    }
+    if (!end) {
+      break;
+    }
+    entry = end + 1;
+  }
+  return false;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *pass, int32_t channel, const uint8_t *bssid,
+                             bool connect) {
+  _ssid = ssid ? ssid : "";
+  if (bssid) {
+    memcpy(_bssid, bssid, 6);
+  }
+  if (!connect) {
+    return _status;
+  }
+  const char *mode = getenv("GONG_WIFI");
+  bool fail = (mode && strcmp(mode, "fail") == 0) || !networkKnown(_ssid.c_str(), pass ? pass : "");
+  // С известной точкой доступа поиск по каналам не нужен
+  const char *scan = getenv("GONG_WIFI_SCAN_MS");
+  uint32_t scanMs = scan ? (uint32_t)atoi(scan) : 150;
+  uint32_t associateMs = (channel > 0 && bssid ? 0 : scanMs) + 50;
+  uint32_t attempt = ++_attempt;
+  // События приходят из задачи WiFi, а не из вызова begin()
+  std::thread([this, fail, attempt, associateMs]() {
+    delay(associateMs);
+    if (attempt != _attempt) {
+      return;
+    }
+    if (fail) {
+      _status = WL_DISCONNECTED;
+      emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+      return;
+    }
+    _status = WL_CONNECTED;
+    emit(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    delay(50);
+    if (attempt == _attempt) {
+      emit(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    }
+  }).detach();
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+  (void)dns1;
+  (void)dns2;
+  _static = (uint32_t)local != 0;
+  _ip = local;
+  _gateway = gateway;
+  _subnet = subnet;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+  (void)eraseAp;
+  _attempt++;
+  bool wasConnected = _status == WL_CONNECTED;
+  _status = WL_DISCONNECTED;
+  if (wifiOff) {
+    _mode = WIFI_OFF;
+  }
+  if (wasConnected) {
+    emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  }
+  return true;
+}
+
+bool WiFiClass::reconnect() {
+  begin(_ssid.c_str());
+  return true;
+}
+
+IPAddress WiFiClass::localIP() const {
+  if (_status != WL_CONNECTED) {
+    return IPAddress();
+  }
+  // Статический адрес из настроек показывается, но слушаем все интерфейсы
+  return _static ? _ip : IPAddress(127, 0, 0, 1);
+}
+
+uint8_t *WiFiClass::BSSID() {
+  return _status == WL_CONNECTED ? _bssid : nullptr;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+// Станция WiFi на хосте: begin() через короткую паузу «подключается»
+// и присылает события CONNECTED и GOT_IP; адрес — 127.0.0.1.
+// GONG_WIFI=fail — точка доступа не отвечает (проверка переподключения).
+// GONG_WIFI_NETWORKS="ssid:pass,..." — доступные сети: с другими SSID
+// или паролем подключение не состоится. GONG_WIFI_SCAN_MS — поиск
+// точки доступа без известных BSSID/канала (150 мс), ассоциация — ещё 50.
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3,
+} wifi_mode_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_READY = 0,
+  ARDUINO_EVENT_WIFI_STA_START = 2,
+  ARDUINO_EVENT_WIFI_STA_STOP = 3,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP = 9,
+} arduino_event_id_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef void (*WiFiEventCb)(WiFiEvent_t event);
+typedef int wifi_event_id_t;
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t mode) { _mode = mode; return true; }
+  void persistent(bool) {}
+  bool setAutoReconnect(bool) { return true; }
+  bool setSleep(bool) { return true; }
+  bool setHostname(const char *) { return true; }
+  wifi_event_id_t onEvent(WiFiEventCb callback);
+
+  wl_status_t begin(const char *ssid, const char *pass = nullptr, int32_t channel = 0,
+                    const uint8_t *bssid = nullptr, bool connect = true);
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet,
+              IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  bool reconnect();
+
+  wl_status_t status() const { return _status; }
+  bool isConnected() const { return _status == WL_CONNECTED; }
+  IPAddress localIP() const;
+  IPAddress gatewayIP() const { return _gateway; }
+  IPAddress subnetMask() const { return _subnet; }
+  String SSID() const { return _ssid; }
+  int8_t RSSI() const { return _status == WL_CONNECTED ? -55 : 0; }
+  uint8_t *BSSID();
+  int32_t channel() const { return _status == WL_CONNECTED ? 6 : 0; }
+  String macAddress() const { return "02:00:00:00:00:01"; }
+
+private:
+  void emit(WiFiEvent_t event);
+  static bool networkKnown(const char *ssid, const char *pass);
+
+  wifi_mode_t _mode = WIFI_OFF;
+  std::atomic<wl_status_t> _status{WL_DISCONNECTED};
+  String _ssid;
+  bool _static = false;
+  IPAddress _ip;
+  IPAddress _gateway;
+  IPAddress _subnet;
+  uint8_t _bssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+  WiFiEventCb _callbacks[8] = {nullptr};
+  std::atomic<uint32_t> _attempt{0};
+};
+
+extern WiFiClass WiFi;
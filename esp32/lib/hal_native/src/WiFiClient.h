@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+
+#include "Print.h"
+
+// TCP-клиент поверх дескриптора сокета; копии разделяют сокет,
+// последняя закрывает его
+class WiFiClient : public Stream {
+public:
+  WiFiClient() {}
+  explicit WiFiClient(int fd);
+
+  int fd() const;
+  uint8_t connected();
+  explicit operator bool() const { return fd() >= 0; }
+  void stop();
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  int read(uint8_t *buffer, size_t size);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t length) override;
+  using Print::write;
+  void setNoDelay(bool noDelay);
+
+private:
+  struct Socket;
+  std::shared_ptr<Socket> _socket;
+};
+
+class WiFiServer {
+public:
+  // Порт можно переопределить переменной GONG_HTTP_PORT (80 требует root)
+  explicit WiFiServer(uint16_t port = 80) : _port(port) {}
+  ~WiFiServer() { close(); }
+
+  void begin(uint16_t port = 0);
+  bool hasClient();
+  WiFiClient available();
+  WiFiClient accept() { return available(); }
+  void close();
+  void stop() { close(); }
+  void setNoDelay(bool noDelay) { _noDelay = noDelay; }
+  int fd() const { return _fd; }
+  uint16_t port() const { return _port; }
+
+private:
+  uint16_t _port;
+  int _fd = -1;
+  bool _noDelay = false;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Часы RTC: на устройстве идут через программный сброс. На хосте —
+// CLOCK_BOOTTIME, который не сбрасывается при перезапуске процесса.
+inline uint64_t esp_clk_rtc_time() {
+  struct timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
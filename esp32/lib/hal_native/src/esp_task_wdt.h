@@ -0,0 +1,10 @@
+#pragma once
+
+#include "esp_system.h"
+#include "freertos/task.h"
+
+// Сторожевой таймер задач: на хосте не срабатывает
+inline esp_err_t esp_task_wdt_init(uint32_t, bool) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
@@ -0,0 +1,309 @@
+#include "fake_uart.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+#include "Arduino.h"
+
+// Кадр DFPlayer: 7E FF 06 cmd fb paramHi paramLo sumHi sumLo EF
+static const size_t kFrameSize = 10;
+
+static FakeUart *ports[3] = {nullptr, nullptr, nullptr};
+static std::mutex portsMutex;
+
+FakeUart *FakeUart::forPort(int uartNr) {
+  if (uartNr < 1 || uartNr > 2) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(portsMutex);
+  if (!ports[uartNr]) {
+    ports[uartNr] = new FakeUart();
+  }
+  return ports[uartNr];
+}
+
+static uint32_t envMs(const char *name, uint32_t fallback) {
+  const char *value = getenv(name);
+  return value ? strtoul(value, nullptr, 10) : fallback;
+}
+
+// Время по часам хоста: по нему сравниваются удары нескольких процессов
+static void logStamp() {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  fprintf(stderr, "[fake_uart] %lld.%06ld", (long long)now.tv_sec, now.tv_nsec / 1000);
+}
+
+static void encode(uint8_t command, uint16_t param, uint8_t *out) {
+  out[0] = 0x7E;
+  out[1] = 0xFF;
+  out[2] = 0x06;
+  out[3] = command;
+  out[4] = 0x00;
+  out[5] = (uint8_t)(param >> 8);
+  out[6] = (uint8_t)param;
+  uint16_t sum = 0;
+  for (int i = 1; i < 7; i++) {
+    sum += out[i];
+  }
+  sum = -sum;
+  out[7] = (uint8_t)(sum >> 8);
+  out[8] = (uint8_t)sum;
+  out[9] = 0xEF;
+}
+
+FakeUart::FakeUart() {
+  const char *mode = getenv("GONG_DFPLAYER");
+  _present = !(mode && strcmp(mode, "none") == 0);
+  _trackMs = envMs("GONG_DFPLAYER_TRACK_MS", _trackMs);
+  _startMs = envMs("GONG_DFPLAYER_START_MS", _startMs);
+  _startJitterMs = envMs("GONG_DFPLAYER_START_JITTER_MS", _startJitterMs);
+  _resumeMs = envMs("GONG_DFPLAYER_RESUME_MS", _resumeMs);
+  const char *log = getenv("GONG_DFPLAYER_LOG");
+  _log = log && *log && strcmp(log, "0") != 0;
+  if (_present) {
+    // Плеер сообщает о готовности примерно через полсекунды после питания
+    reply(0x3F, 0x0002, 500);
+  }
+  const char *script = getenv("GONG_DFPLAYER_SCRIPT");
+  if (script) {
+    loadScript(script);
+  }
+  _thread = std::thread(&FakeUart::run, this);
+  _thread.detach();
+}
+
+void FakeUart::loadScript(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "[fake_uart] не удалось открыть %s\n", path);
+    return;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#') {
+      continue;
+    }
+    char *cursor = line;
+    char *end = nullptr;
+    unsigned long delayMs = strtoul(cursor, &end, 10);
+    if (end == cursor) {
+      continue;
+    }
+    cursor = end;
+    std::vector<uint8_t> bytes;
+    while (true) {
+      unsigned long value = strtoul(cursor, &end, 16);
+      if (end == cursor) {
+        break;
+      }
+      bytes.push_back((uint8_t)value);
+      cursor = end;
+    }
+    if (!bytes.empty()) {
+      schedule(delayMs, bytes);
+    }
+  }
+  fclose(file);
+}
+
+void FakeUart::schedule(uint32_t delayMs, const std::vector<uint8_t> &bytes) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _pending.push_back({(uint64_t)millis() + delayMs, bytes});
+  _wake.notify_one();
+}
+
+void FakeUart::reply(uint8_t command, uint16_t param, uint32_t delayMs) {
+  uint8_t frame[kFrameSize];
+  encode(command, param, frame);
+  schedule(delayMs, std::vector<uint8_t>(frame, frame + kFrameSize));
+}
+
+void FakeUart::onReceive(OnReceiveCb callback) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _callback = callback;
+}
+
+int FakeUart::available() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _rx.size();
+}
+
+int FakeUart::read() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_rx.empty()) {
+    return -1;
+  }
+  uint8_t c = _rx.front();
+  _rx.pop_front();
+  return c;
+}
+
+int FakeUart::peek() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _rx.empty() ? -1 : _rx.front();
+}
+
+void FakeUart::write(const uint8_t *data, size_t length) {
+  std::vector<uint8_t> frames;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tx.insert(_tx.end(), data, data + length);
+    // Ищем целые кадры; мусор до 0x7E отбрасываем
+    while (!_tx.empty()) {
+      if (_tx[0] != 0x7E) {
+        _tx.erase(_tx.begin());
+        continue;
+      }
+      if (_tx.size() < kFrameSize) {
+        break;
+      }
+      frames.insert(frames.end(), _tx.begin(), _tx.begin() + kFrameSize);
+      _tx.erase(_tx.begin(), _tx.begin() + kFrameSize);
+    }
+  }
+  for (size_t i = 0; i + kFrameSize <= frames.size(); i += kFrameSize) {
+    if (_log) {
+      logStamp();
+      fprintf(stderr, " tx");
+      for (size_t j = 0; j < kFrameSize; j++) {
+        fprintf(stderr, " %02X", frames[i + j]);
+      }
+      fprintf(stderr, "\n");
+    }
+    if (_present) {
+      handleFrame(&frames[i]);
+    }
+  }
+}
+
+void FakeUart::handleFrame(const uint8_t *frame) {
+  uint8_t command = frame[3];
+  uint16_t param = ((uint16_t)frame[5] << 8) | frame[6];
+  uint64_t now = millis();
+  std::lock_guard<std::mutex> lock(_mutex);
+  advance(now);
+  switch (command) {
+    case 0x03: // play track: запуск с начала
+      _track = param;
+      _state = State::Starting;
+      _positionMs = 0;
+      _startAtMs = now + _startMs + (_startJitterMs ? _random() % (_startJitterMs + 1) : 0);
+      break;
+    case 0x06:
+      _volume = param > 30 ? 30 : param;
+      break;
+    case 0x0C: { // reset: после перезапуска снова «готов»
+      _state = State::Stopped;
+      uint8_t frameOut[kFrameSize];
+      encode(0x3F, 0x0002, frameOut);
+      _pending.push_back({now + 500, std::vector<uint8_t>(frameOut, frameOut + kFrameSize)});
+      break;
+    }
+    case 0x0D: // start: после паузы — продолжение, после стопа — трек заново
+      if (_state == State::Paused) {
+        _state = State::Starting;
+        _startAtMs = now + _resumeMs;
+      } else if (_state == State::Stopped && _track) {
+        _state = State::Starting;
+        _positionMs = 0;
+        _startAtMs = now + _startMs + (_startJitterMs ? _random() % (_startJitterMs + 1) : 0);
+      }
+      break;
+    case 0x0E: // pause; во время запуска теряется
+      if (_state == State::Playing) {
+        _positionMs += now - _playingSinceMs;
+        _state = State::Paused;
+      }
+      break;
+    case 0x16: // stop
+      _state = State::Stopped;
+      break;
+    case 0x42: {
+      uint16_t status = _state == State::Playing ? 1 : (_state == State::Paused ? 2 : 0);
+      uint8_t frameOut[kFrameSize];
+      encode(0x42, (uint16_t)(0x0200 | status), frameOut);
+      _pending.push_back({now + 10, std::vector<uint8_t>(frameOut, frameOut + kFrameSize)});
+      break;
+    }
+    case 0x43: {
+      uint8_t frameOut[kFrameSize];
+      encode(0x43, _volume, frameOut);
+      _pending.push_back({now + 10, std::vector<uint8_t>(frameOut, frameOut + kFrameSize)});
+      break;
+    }
+    default:
+      break;
+  }
+  updateSound();
+  _wake.notify_one();
+}
+
+void FakeUart::advance(uint64_t nowMs) {
+  if (_state == State::Starting && nowMs >= _startAtMs) {
+    _state = State::Playing;
+    _playingSinceMs = _startAtMs;
+  }
+  if (_state == State::Playing && _playingSinceMs + _trackMs - _positionMs <= nowMs) {
+    _state = State::Stopped;
+    uint8_t frame[kFrameSize];
+    encode(0x3D, _track, frame);
+    _pending.push_back({nowMs, std::vector<uint8_t>(frame, frame + kFrameSize)});
+  }
+  updateSound();
+}
+
+void FakeUart::updateSound() {
+  bool audible = _state == State::Playing && _volume > 0;
+  if (audible == _audible) {
+    return;
+  }
+  _audible = audible;
+  if (audible) {
+    _soundTrack = _track;
+  }
+  if (_log) {
+    logStamp();
+    fprintf(stderr, " sound %s track %u\n", audible ? "on" : "off", _soundTrack);
+  }
+}
+
+void FakeUart::run() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    uint64_t now = millis();
+    advance(now);
+    bool delivered = false;
+    uint64_t nextMs = now + 1000;
+    for (size_t i = 0; i < _pending.size();) {
+      if (_pending[i].dueMs <= now) {
+        _rx.insert(_rx.end(), _pending[i].bytes.begin(), _pending[i].bytes.end());
+        _pending.erase(_pending.begin() + i);
+        delivered = true;
+        continue;
+      }
+      if (_pending[i].dueMs < nextMs) {
+        nextMs = _pending[i].dueMs;
+      }
+      i++;
+    }
+    if (_state == State::Starting && _startAtMs < nextMs) {
+      nextMs = _startAtMs;
+    }
+    if (_state == State::Playing && _playingSinceMs + _trackMs - _positionMs < nextMs) {
+      nextMs = _playingSinceMs + _trackMs - _positionMs;
+    }
+    if (delivered && _callback) {
+      // Как и драйвер UART, колбэк вызывается вне его блокировки
+      OnReceiveCb callback = _callback;
+      lock.unlock();
+      callback();
+      lock.lock();
+      continue;
+    }
+    _wake.wait_for(lock, std::chrono::milliseconds(nextMs > now ? nextMs - now : 0));
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Поддельное устройство на UART. Для UART2 — плеер DFPlayer Mini,
+// отвечающий кадрами протокола (см. src/dfplayer.h):
+//   GONG_DFPLAYER=none            плеер не подключён (тишина на линии);
+//   GONG_DFPLAYER_TRACK_MS=5000   длительность любого трека;
+//   GONG_DFPLAYER_SCRIPT=файл     дополнительные кадры по расписанию,
+//                                 строки «<задержка_мс> <hex-байты>»;
+//   GONG_DFPLAYER_LOG=1           печатать отправленные прошивкой кадры
+//                                 и начало/конец звука.
+// Модель времени плеера:
+//   GONG_DFPLAYER_START_MS=150    запуск трека: поиск файла и декодер;
+//   GONG_DFPLAYER_START_JITTER_MS=100  случайная добавка к запуску;
+//   GONG_DFPLAYER_RESUME_MS=15    продолжение после паузы.
+// Пауза, пришедшая во время запуска трека, теряется: трек начинает
+// играть — прошивка должна дождаться начала воспроизведения.
+// Состояние (ответ 0x42, как и линия BUSY) — «играет» только после
+// запуска; звук слышен, когда трек играет при ненулевой громкости.
+class FakeUart {
+public:
+  typedef std::function<void(void)> OnReceiveCb;
+
+  static FakeUart *forPort(int uartNr);
+
+  void onReceive(OnReceiveCb callback);
+  int available();
+  int read();
+  int peek();
+  void write(const uint8_t *data, size_t length);
+
+private:
+  FakeUart();
+
+  void run();
+  void handleFrame(const uint8_t *frame);
+  void reply(uint8_t command, uint16_t param, uint32_t delayMs = 10);
+  void schedule(uint32_t delayMs, const std::vector<uint8_t> &bytes);
+  void loadScript(const char *path);
+  // Переходы по времени и журнал звука; под _mutex
+  void advance(uint64_t nowMs);
+  void updateSound();
+
+  struct Pending {
+    uint64_t dueMs;
+    std::vector<uint8_t> bytes;
+  };
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::deque<uint8_t> _rx;
+  std::vector<Pending> _pending;
+  std::vector<uint8_t> _tx;
+  OnReceiveCb _callback;
+  std::thread _thread;
+
+  bool _present = true;
+  bool _log = false;
+  uint32_t _trackMs = 5000;
+  uint32_t _startMs = 150;
+  uint32_t _startJitterMs = 100;
+  uint32_t _resumeMs = 15;
+  std::minstd_rand _random;
+
+  enum class State : uint8_t { Stopped, Starting, Playing, Paused };
+  State _state = State::Stopped;
+  uint8_t _volume = 20;
+  uint16_t _track = 0;
+  // Starting -> Playing
+  uint64_t _startAtMs = 0;
+  // Сыграно от начала трека к моменту _playingSinceMs
+  uint64_t _positionMs = 0;
+  uint64_t _playingSinceMs = 0;
+  bool _audible = false;
+  uint16_t _soundTrack = 0;
+};
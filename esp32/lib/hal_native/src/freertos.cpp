@@ -0,0 +1,300 @@
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+struct NativeTask {
+  std::string name;
+  uint32_t stackDepth = 8192;
+  BaseType_t core = 0;
+  std::mutex mutex;
+  std::condition_variable notified;
+  // Значение уведомления: счётчик для Give/Take, биты для Notify/Wait
+  uint32_t notifyCount = 0;
+  bool notifyPending = false;
+};
+
+// Поток main() — задача Arduino loopTask
+static NativeTask *mainTask() {
+  static NativeTask *task = []() {
+    NativeTask *created = new NativeTask();
+    created->name = "loopTask";
+    created->core = 1;
+    return created;
+  }();
+  return task;
+}
+
+static thread_local NativeTask *currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *created,
+                                   BaseType_t coreId) {
+  (void)priority;
+  NativeTask *task = new NativeTask();
+  task->name = name ? name : "";
+  task->stackDepth = stackDepth;
+  task->core = coreId == tskNO_AFFINITY ? 0 : coreId;
+  if (created) {
+    *created = task;
+  }
+  std::thread([task, function, parameters]() {
+    currentTask = task;
+    function(parameters);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *created) {
+  return xTaskCreatePinnedToCore(function, name, stackDepth, parameters, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // Удалить можно только себя: поток завершается, дескриптор остаётся
+  // (на него могут ссылаться другие задачи)
+  if (task == nullptr || task == currentTask) {
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::hours(24));
+    }
+  }
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks ? ticks : 0));
+  if (!ticks) {
+    std::this_thread::yield();
+  }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return currentTask ? currentTask : mainTask();
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)millis();
+}
+
+BaseType_t xPortGetCoreID() {
+  return xTaskGetCurrentTaskHandle()->core;
+}
+
+BaseType_t xPortInIsrContext() {
+  return pdFALSE;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+  return (task ? task : xTaskGetCurrentTaskHandle())->name.c_str();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  NativeTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->mutex);
+  if (ticksToWait == portMAX_DELAY) {
+    task->notified.wait(lock, [task]() { return task->notifyCount > 0; });
+  } else {
+    task->notified.wait_for(lock, std::chrono::milliseconds(ticksToWait),
+                            [task]() { return task->notifyCount > 0; });
+  }
+  uint32_t count = task->notifyCount;
+  if (count) {
+    task->notifyCount = clearOnExit ? 0 : count - 1;
+    task->notifyPending = false;
+  }
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  return xTaskNotify(task, 0, eIncrement);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+  if (!task) {
+    return pdFAIL;
+  }
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    switch (action) {
+      case eSetBits:               task->notifyCount |= value; break;
+      case eIncrement:             task->notifyCount++; break;
+      case eSetValueWithOverwrite: task->notifyCount = value; break;
+      case eNoAction:              break;
+    }
+    task->notifyPending = true;
+  }
+  task->notified.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit, uint32_t *notificationValue,
+                           TickType_t ticksToWait) {
+  NativeTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->mutex);
+  if (!task->notifyPending) {
+    task->notifyCount &= ~bitsToClearOnEntry;
+  }
+  if (ticksToWait == portMAX_DELAY) {
+    task->notified.wait(lock, [task]() { return task->notifyPending; });
+  } else {
+    task->notified.wait_for(lock, std::chrono::milliseconds(ticksToWait), [task]() { return task->notifyPending; });
+  }
+  if (notificationValue) {
+    *notificationValue = task->notifyCount;
+  }
+  if (!task->notifyPending) {
+    return pdFALSE;
+  }
+  task->notifyCount &= ~bitsToClearOnExit;
+  task->notifyPending = false;
+  return pdTRUE;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken) {
+  xTaskNotifyGive(task);
+  if (higherPriorityTaskWoken) {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return (task ? task : xTaskGetCurrentTaskHandle())->stackDepth;
+}
+
+// ---- семафоры ----
+
+struct NativeSemaphore {
+  std::timed_mutex mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new NativeSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+  if (ticksToWait == portMAX_DELAY) {
+    semaphore->mutex.lock();
+    return pdTRUE;
+  }
+  return semaphore->mutex.try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  semaphore->mutex.unlock();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete semaphore;
+}
+
+// ---- esp_timer: одна служебная задача на все таймеры ----
+
+struct NativeTimer {
+  esp_timer_cb_t callback;
+  void *arg;
+  int64_t dueUs = 0;
+  uint64_t periodUs = 0;
+  bool armed = false;
+};
+
+static std::mutex timerMutex;
+static std::condition_variable timerWake;
+static std::map<NativeTimer *, bool> timers;
+
+static void timerService() {
+  std::unique_lock<std::mutex> lock(timerMutex);
+  while (true) {
+    int64_t now = esp_timer_get_time();
+    NativeTimer *due = nullptr;
+    int64_t nextUs = now + 1000000;
+    for (auto &entry : timers) {
+      NativeTimer *timer = entry.first;
+      if (!timer->armed) {
+        continue;
+      }
+      if (timer->dueUs <= now) {
+        due = timer;
+        break;
+      }
+      if (timer->dueUs < nextUs) {
+        nextUs = timer->dueUs;
+      }
+    }
+    if (due) {
+      if (due->periodUs) {
+        due->dueUs += due->periodUs;
+      } else {
+        due->armed = false;
+      }
+      esp_timer_cb_t callback = due->callback;
+      void *arg = due->arg;
+      lock.unlock();
+      callback(arg);
+      lock.lock();
+      continue;
+    }
+    timerWake.wait_for(lock, std::chrono::microseconds(nextUs - now));
+  }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+  if (!args || !args->callback || !out) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  static std::once_flag started;
+  std::call_once(started, []() { std::thread(timerService).detach(); });
+  NativeTimer *timer = new NativeTimer();
+  timer->callback = args->callback;
+  timer->arg = args->arg;
+  std::lock_guard<std::mutex> lock(timerMutex);
+  timers[timer] = true;
+  *out = timer;
+  return ESP_OK;
+}
+
+static esp_err_t armTimer(esp_timer_handle_t timer, uint64_t timeoutUs, uint64_t periodUs) {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  if (timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->dueUs = esp_timer_get_time() + timeoutUs;
+  timer->periodUs = periodUs;
+  timer->armed = true;
+  timerWake.notify_one();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+  return armTimer(timer, timeoutUs, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  return armTimer(timer, periodUs, periodUs);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  if (!timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->armed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> lock(timerMutex);
+  if (timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timers.erase(timer);
+  delete timer;
+  return ESP_OK;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// FreeRTOS на потоках POSIX: задача — std::thread, уведомления —
+// счётчик под condition_variable, критическая секция — рекурсивный
+// мьютекс. Тик — 1 мс. Приоритеты не моделируются, привязку к ядру
+// только сообщает xPortGetCoreID().
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define portMAX_DELAY        ((TickType_t)0xFFFFFFFF)
+#define configTICK_RATE_HZ   1000
+#define portTICK_PERIOD_MS   1
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(ms))
+#define tskNO_AFFINITY       0x7FFFFFFF
+
+struct portMUX_TYPE {
+  std::recursive_mutex mutex;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+#define portENTER_CRITICAL(mux)     ((mux)->mutex.lock())
+#define portEXIT_CRITICAL(mux)      ((mux)->mutex.unlock())
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)  portEXIT_CRITICAL(mux)
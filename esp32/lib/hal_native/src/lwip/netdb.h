@@ -0,0 +1,4 @@
+#pragma once
+
+// getaddrinfo() lwIP повторяет POSIX
+#include <netdb.h>
@@ -0,0 +1,11 @@
+#pragma once
+
+// Сокеты lwIP на ESP32 повторяют BSD API
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
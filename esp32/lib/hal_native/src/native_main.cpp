@@ -0,0 +1,18 @@
+#include <signal.h>
+
+#include "Arduino.h"
+
+// Точка входа процесса: как у Arduino-ESP32, setup() и бесконечный
+// loop() в задаче loopTask (здесь — главный поток)
+void setup();
+void loop();
+
+int main(int argc, char **argv) {
+  nativeSetArgs(argc, argv);
+  // Запись в закрытый клиентом сокет не должна завершать процесс
+  signal(SIGPIPE, SIG_IGN);
+  setup();
+  while (true) {
+    loop();
+  }
+}
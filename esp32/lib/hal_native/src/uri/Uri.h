@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+#include "WString.h"
+
+// Шаблон пути маршрута; точное совпадение
+class Uri {
+public:
+  Uri(const char *uri) : _uri(uri) {}
+  Uri(const String &uri) : _uri(uri) {}
+  virtual ~Uri() {}
+
+  virtual Uri *clone() const { return new Uri(_uri); }
+  virtual bool canHandle(const String &requestUri, std::vector<String> &pathArgs) {
+    (void)pathArgs;
+    return _uri == requestUri;
+  }
+
+protected:
+  String _uri;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Uri.h"
+
+// Путь с параметрами: "{}" совпадает с сегментом до следующего "/"
+class UriBraces : public Uri {
+public:
+  explicit UriBraces(const char *uri) : Uri(uri) {}
+  explicit UriBraces(const String &uri) : Uri(uri) {}
+
+  Uri *clone() const override { return new UriBraces(_uri); }
+
+  bool canHandle(const String &requestUri, std::vector<String> &pathArgs) override {
+    pathArgs.clear();
+    const char *pattern = _uri.c_str();
+    const char *path = requestUri.c_str();
+    while (*pattern) {
+      if (pattern[0] == '{' && pattern[1] == '}') {
+        const char *end = path;
+        while (*end && *end != '/') {
+          end++;
+        }
+        pathArgs.push_back(requestUri.substring(path - requestUri.c_str(), end - requestUri.c_str()));
+        path = end;
+        pattern += 2;
+        continue;
+      }
+      if (*pattern != *path) {
+        return false;
+      }
+      pattern++;
+      path++;
+    }
+    return *path == '\0';
+  }
+};
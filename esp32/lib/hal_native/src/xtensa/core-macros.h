@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Счётчик тактов ядра Xtensa. На хосте такт — наносекунда
+// CLOCK_MONOTONIC (ESP.getCpuFreqMHz() == 1000), 32 бита, как CCOUNT.
+inline uint32_t nativeCycleCount() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+#define XTHAL_GET_CCOUNT() nativeCycleCount()
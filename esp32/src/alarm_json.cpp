@@ -0,0 +1,180 @@
+#include "alarm_json.h"
+
+#include <ArduinoJson.h>
+
+// Как в backend: True, 1, "1", "true", "True"
+static bool jsonTruthy(JsonVariantConst value) {
+  if (value.is<bool>()) {
+    return value.as<bool>();
+  }
+  if (value.is<int>()) {
+    return value.as<int>() == 1;
+  }
+  if (value.is<const char *>()) {
+    const char *text = value.as<const char *>();
+    return strcmp(text, "1") == 0 || strcmp(text, "true") == 0 || strcmp(text, "True") == 0;
+  }
+  return false;
+}
+
+bool alarmFromJson(const char *body, size_t length, AlarmEntry &alarm, bool partial, const char *&error) {
+  StaticJsonDocument<512> doc;
+  if (deserializeJson(doc, body, length) != DeserializationError::Ok || !doc.is<JsonObject>()) {
+    error = "invalid json";
+    return false;
+  }
+  return alarmFromJson(doc.as<JsonObjectConst>(), alarm, partial, error);
+}
+
+bool alarmFromJson(JsonObjectConst doc, AlarmEntry &alarm, bool partial, const char *&error) {
+  bool hasTime = doc.containsKey("time");
+  bool hasDuration = doc.containsKey("duration");
+  if (!partial && (!hasTime || !hasDuration)) {
+    error = "time and positive duration are required";
+    return false;
+  }
+  if (partial && !hasTime && !hasDuration && !doc.containsKey("days") &&
+      !doc.containsKey("active") && !doc.containsKey("track")) {
+    error = "no fields to update";
+    return false;
+  }
+
+  if (hasTime) {
+    uint16_t minuteOfDay;
+    if (!AlarmScheduler::parseTime(doc["time"] | "", minuteOfDay)) {
+      error = "invalid time";
+      return false;
+    }
+    alarm.minuteOfDay = minuteOfDay;
+  }
+  if (hasDuration) {
+    long duration = doc["duration"] | 0L;
+    if (duration <= 0 || duration > 0xFFFF) {
+      error = "time and positive duration are required";
+      return false;
+    }
+    alarm.duration = (uint16_t)duration;
+  }
+  if (doc.containsKey("days")) {
+    uint8_t days = 0;
+    for (JsonVariantConst day : doc["days"].as<JsonArrayConst>()) {
+      int value = day.as<int>();
+      if (value >= 0 && value < 7) {
+        days |= 1 << value;
+      }
+    }
+    alarm.days = days;
+  }
+  if (doc.containsKey("active")) {
+    alarm.active = jsonTruthy(doc["active"]) ? 1 : 0;
+  } else if (!partial) {
+    alarm.active = 0;
+  }
+  if (doc.containsKey("track")) {
+    long track = doc["track"] | 0L;
+    if (track < 1 || track > 255) {
+      error = "invalid track number";
+      return false;
+    }
+    alarm.track = (uint8_t)track;
+  } else if (!partial) {
+    alarm.track = 1;
+  }
+  return true;
+}
+
+// Пакет из ALARM_MAX_COUNT будильников со всеми днями недели и столько же
+// удалений; строки времени копируются в документ, одинаковые — один раз
+#define ALARM_SYNC_JSON_CAPACITY                                              \
+  (JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(ALARM_MAX_COUNT) * 2 +               \
+   ALARM_MAX_COUNT * (JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(7) + 6) + 128)
+
+const char kAlarmSyncTooLarge[] = "alarm sync too large";
+
+bool alarmSyncFromJson(const char *body, size_t length, AlarmSyncBatch &batch, const char *&error) {
+  static StaticJsonDocument<ALARM_SYNC_JSON_CAPACITY> doc;
+  if (length > ALARM_SYNC_BODY_MAX) {
+    error = kAlarmSyncTooLarge;
+    return false;
+  }
+  DeserializationError parsed = deserializeJson(doc, body, length);
+  if (parsed == DeserializationError::NoMemory) {
+    error = kAlarmSyncTooLarge;
+    return false;
+  }
+  if (parsed != DeserializationError::Ok || !doc.is<JsonObject>()) {
+    error = "invalid json";
+    return false;
+  }
+  batch.full = doc["full"] | false;
+  if (!batch.full && !doc["base"].is<uint32_t>()) {
+    error = "base version required";
+    return false;
+  }
+  batch.base = doc["base"] | 0UL;
+
+  JsonArrayConst upserts = doc["upserts"].as<JsonArrayConst>();
+  JsonArrayConst deletes = doc["deletes"].as<JsonArrayConst>();
+  if (upserts.size() > ALARM_MAX_COUNT || deletes.size() > ALARM_MAX_COUNT) {
+    error = "alarm table is full";
+    return false;
+  }
+
+  batch.upsertCount = 0;
+  for (JsonVariantConst item : upserts) {
+    AlarmEntry alarm = {};
+    long id = item["id"] | 0L;
+    if (id < 1 || id > 0xFFFF) {
+      error = "invalid id";
+      return false;
+    }
+    if (!item.is<JsonObjectConst>() || !alarmFromJson(item.as<JsonObjectConst>(), alarm, false, error)) {
+      return false;
+    }
+    alarm.id = (uint16_t)id;
+    batch.upserts[batch.upsertCount++] = alarm;
+  }
+
+  batch.deleteCount = 0;
+  if (!batch.full) {
+    for (JsonVariantConst item : deletes) {
+      long id = item | 0L;
+      if (id < 1 || id > 0xFFFF) {
+        error = "invalid id";
+        return false;
+      }
+      batch.deletes[batch.deleteCount++] = (uint16_t)id;
+    }
+  }
+  return true;
+}
+
+void alarmToJson(const AlarmEntry &alarm, JsonWriter &json) {
+  char time[6];
+  AlarmScheduler::formatTime(alarm.minuteOfDay, time);
+  json.beginObject();
+  json.number("id", alarm.id);
+  json.string("time", time);
+  json.beginArray("days");
+  for (uint8_t day = 0; day < 7; day++) {
+    if (alarm.days & (1 << day)) {
+      json.number(nullptr, day);
+    }
+  }
+  json.endArray();
+  json.number("duration", alarm.duration);
+  json.boolean("active", alarm.active);
+  json.number("track", alarm.track);
+  json.endObject();
+}
+
+void occurrenceToJson(const Occurrence &occurrence, JsonWriter &json) {
+  char time[6];
+  AlarmScheduler::formatTime(occurrence.minuteOfDay, time);
+  json.beginObject();
+  json.number("id", occurrence.alarmId);
+  json.string("time", time);
+  json.number("duration", occurrence.duration);
+  json.number("track", occurrence.track);
+  json.endObject();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "alarm_scheduler.h"
+#include "json_writer.h"
+#include "occurrence_cache.h"
+
+// JSON-представление будильника — тот же формат, что у backend/app.py:
+// {"id":1,"time":"07:00","days":[0,1,2],"duration":30,"active":true}
+
+// Заполняет alarm из тела запроса. При partial == true меняются только
+// присутствующие поля (PUT/PATCH), иначе time и duration обязательны.
+// При ошибке возвращает false и текст ошибки в error.
+bool alarmFromJson(const char *body, size_t length, AlarmEntry &alarm, bool partial, const char *&error);
+bool alarmFromJson(JsonObjectConst doc, AlarmEntry &alarm, bool partial, const char *&error);
+
+// Пакет синхронизации с backend (POST /api/alarms/sync):
+// {"base":12,"upserts":[{"id":3,"time":"07:00",...}],"deletes":[5,6]}
+// base — версия набора, которую backend видел последней. При "full":true
+// upserts — весь набор целиком, base и deletes не используются.
+// Массивы upserts/deletes выделяет вызывающий, по ALARM_MAX_COUNT.
+struct AlarmSyncBatch {
+  uint32_t base;
+  bool full;
+  AlarmEntry *upserts;
+  size_t upsertCount;
+  uint16_t *deletes;
+  size_t deleteCount;
+};
+
+// Разбор — в статический документ на ALARM_MAX_COUNT будильников без
+// кучи, поэтому вызывается только из одной задачи (веб-сервера). Тело
+// длиннее ALARM_SYNC_BODY_MAX или не помещающееся в документ — ошибка
+// kAlarmSyncTooLarge (413).
+#ifndef ALARM_SYNC_BODY_MAX
+#define ALARM_SYNC_BODY_MAX 24576
+#endif
+
+extern const char kAlarmSyncTooLarge[];
+
+bool alarmSyncFromJson(const char *body, size_t length, AlarmSyncBatch &batch, const char *&error);
+
+void alarmToJson(const AlarmEntry &alarm, JsonWriter &json);
+
+// Срабатывание в расписании дня: {"id":1,"time":"07:00","duration":30,"track":1}
+void occurrenceToJson(const Occurrence &occurrence, JsonWriter &json);
@@ -0,0 +1,187 @@
+#include "alarm_scheduler.h"
+
+#include <algorithm>
+
+#include "civil_time.h"
+
+#define US_PER_WEEK (7 * US_PER_DAY)
+
+static inline uint16_t indexMinute(uint32_t key) {
+  return (uint16_t)(key >> 8);
+}
+
+static inline uint8_t indexSlot(uint32_t key) {
+  return (uint8_t)(key & 0xFF);
+}
+
+bool AlarmScheduler::upsert(const AlarmEntry &alarm) {
+  if (alarm.minuteOfDay >= MINUTES_PER_DAY) {
+    return false;
+  }
+  for (size_t i = 0; i < _count; i++) {
+    if (_alarms[i].id == alarm.id) {
+      _alarms[i] = alarm;
+      rebuildIndex();
+      return true;
+    }
+  }
+  if (_count >= ALARM_MAX_COUNT) {
+    return false;
+  }
+  _alarms[_count++] = alarm;
+  rebuildIndex();
+  return true;
+}
+
+bool AlarmScheduler::remove(uint16_t id) {
+  for (size_t i = 0; i < _count; i++) {
+    if (_alarms[i].id == id) {
+      _alarms[i] = _alarms[--_count];
+      rebuildIndex();
+      return true;
+    }
+  }
+  return false;
+}
+
+void AlarmScheduler::clear() {
+  _count = 0;
+  _indexSize = 0;
+}
+
+const AlarmEntry *AlarmScheduler::find(uint16_t id) const {
+  for (size_t i = 0; i < _count; i++) {
+    if (_alarms[i].id == id) {
+      return &_alarms[i];
+    }
+  }
+  return nullptr;
+}
+
+uint16_t AlarmScheduler::nextId() const {
+  uint16_t maxId = 0;
+  for (size_t i = 0; i < _count; i++) {
+    if (_alarms[i].id > maxId) {
+      maxId = _alarms[i].id;
+    }
+  }
+  return maxId + 1;
+}
+
+void AlarmScheduler::rebuildIndex() {
+  _indexSize = 0;
+  for (size_t slot = 0; slot < _count; slot++) {
+    const AlarmEntry &alarm = _alarms[slot];
+    if (!alarm.active) {
+      continue;
+    }
+    for (uint8_t day = 0; day < 7; day++) {
+      if (alarm.days & (1 << day)) {
+        uint32_t minute = day * MINUTES_PER_DAY + alarm.minuteOfDay;
+        _index[_indexSize++] = (minute << 8) | slot;
+      }
+    }
+  }
+  std::sort(_index, _index + _indexSize);
+}
+
+size_t AlarmScheduler::lowerBound(uint16_t minuteOfWeek) const {
+  const uint32_t key = (uint32_t)minuteOfWeek << 8;
+  return std::lower_bound(_index, _index + _indexSize, key) - _index;
+}
+
+bool AlarmScheduler::nextFire(int64_t fromUs, AlarmFire &out) const {
+  if (_indexSize == 0) {
+    return false;
+  }
+  int32_t days = (int32_t)floorDiv(fromUs, US_PER_DAY);
+  int64_t weekStartUs = (int64_t)(days - weekdayFromDays(days)) * US_PER_DAY;
+  // Первая целая минута не раньше fromUs
+  int64_t minute = (fromUs - weekStartUs + US_PER_MINUTE - 1) / US_PER_MINUTE;
+
+  size_t pos = minute < MINUTES_PER_WEEK ? lowerBound((uint16_t)minute) : _indexSize;
+  if (pos == _indexSize) {
+    pos = 0;
+    weekStartUs += US_PER_WEEK;
+  }
+  out.atUs = weekStartUs + indexMinute(_index[pos]) * US_PER_MINUTE;
+  out.alarm = _alarms[indexSlot(_index[pos])];
+  return true;
+}
+
+size_t AlarmScheduler::collect(int64_t fromUs, int64_t toUs, FireCallback callback, void *ctx) const {
+  AlarmFire first;
+  if (toUs <= fromUs || !nextFire(fromUs, first)) {
+    return 0;
+  }
+  int32_t days = (int32_t)floorDiv(first.atUs, US_PER_DAY);
+  int64_t weekStartUs = (int64_t)(days - weekdayFromDays(days)) * US_PER_DAY;
+  size_t pos = lowerBound((uint16_t)((first.atUs - weekStartUs) / US_PER_MINUTE));
+
+  size_t found = 0;
+  for (;;) {
+    if (pos == _indexSize) {
+      pos = 0;
+      weekStartUs += US_PER_WEEK;
+    }
+    AlarmFire fire;
+    fire.atUs = weekStartUs + indexMinute(_index[pos]) * US_PER_MINUTE;
+    if (fire.atUs >= toUs) {
+      break;
+    }
+    fire.alarm = _alarms[indexSlot(_index[pos])];
+    callback(fire, ctx);
+    found++;
+    pos++;
+  }
+  return found;
+}
+
+size_t AlarmScheduler::forEachOnWeekday(uint8_t weekday, DayCallback callback, void *ctx) const {
+  size_t pos = lowerBound(weekday * MINUTES_PER_DAY);
+  const uint16_t endMinute = (weekday + 1) * MINUTES_PER_DAY;
+  size_t found = 0;
+  for (; pos < _indexSize && indexMinute(_index[pos]) < endMinute; pos++) {
+    callback(_alarms[indexSlot(_index[pos])], ctx);
+    found++;
+  }
+  return found;
+}
+
+bool AlarmScheduler::parseTime(const char *text, uint16_t &minuteOfDay) {
+  if (text == nullptr) {
+    return false;
+  }
+  int hours = 0;
+  int minutes = 0;
+  const char *p = text;
+  int digits = 0;
+  for (; *p >= '0' && *p <= '9' && digits < 2; p++, digits++) {
+    hours = hours * 10 + (*p - '0');
+  }
+  if (digits == 0 || *p != ':') {
+    return false;
+  }
+  p++;
+  digits = 0;
+  for (; *p >= '0' && *p <= '9' && digits < 2; p++, digits++) {
+    minutes = minutes * 10 + (*p - '0');
+  }
+  // Секунды ("HH:MM:SS" от <input type=time>) отбрасываются
+  if (digits != 2 || (*p != '\0' && *p != ':') || hours > 23 || minutes > 59) {
+    return false;
+  }
+  minuteOfDay = (uint16_t)(hours * 60 + minutes);
+  return true;
+}
+
+void AlarmScheduler::formatTime(uint16_t minuteOfDay, char out[6]) {
+  uint16_t hours = minuteOfDay / 60;
+  uint16_t minutes = minuteOfDay % 60;
+  out[0] = '0' + hours / 10;
+  out[1] = '0' + hours % 10;
+  out[2] = ':';
+  out[3] = '0' + minutes / 10;
+  out[4] = '0' + minutes % 10;
+  out[5] = '\0';
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Планировщик будильников.
+// Будильники хранятся в компактной таблице (8 байт на запись), по ней
+// строится отсортированный индекс срабатываний в минутах от начала
+// недели. Поиск следующего срабатывания — двоичный поиск по индексу.
+// Время везде — локальное, в мкс от 1970-01-01 00:00 (без пояса).
+
+#define ALARM_MAX_COUNT   256
+#define MINUTES_PER_DAY   1440
+#define MINUTES_PER_WEEK  10080
+#define ALARM_ALL_DAYS    0x7F
+
+struct AlarmEntry {
+  uint16_t id;
+  uint16_t duration;          // сек
+  uint32_t minuteOfDay : 11;  // 0..1439
+  uint32_t days        : 7;   // бит 0 = Пн ... бит 6 = Вс
+  uint32_t active      : 1;
+  uint32_t track       : 8;   // номер трека на SD
+  uint32_t reserved    : 5;
+};
+
+// Ближайшее срабатывание
+struct AlarmFire {
+  int64_t atUs;
+  AlarmEntry alarm;
+};
+
+class AlarmScheduler {
+public:
+  // Добавляет будильник или заменяет существующий с тем же id
+  bool upsert(const AlarmEntry &alarm);
+  bool remove(uint16_t id);
+  void clear();
+
+  const AlarmEntry *find(uint16_t id) const;
+  size_t size() const { return _count; }
+  const AlarmEntry &at(size_t i) const { return _alarms[i]; }
+  uint16_t nextId() const;
+
+  // Ближайшее срабатывание в момент fromUs или позже
+  bool nextFire(int64_t fromUs, AlarmFire &out) const;
+
+  // Все срабатывания в [fromUs, toUs): вызывает callback для каждого
+  // в порядке времени, возвращает их число
+  typedef void (*FireCallback)(const AlarmFire &fire, void *ctx);
+  size_t collect(int64_t fromUs, int64_t toUs, FireCallback callback, void *ctx) const;
+
+  // Срабатывания одного дня недели (0 = Пн) по индексу, без обхода таблицы
+  typedef void (*DayCallback)(const AlarmEntry &alarm, void *ctx);
+  size_t forEachOnWeekday(uint8_t weekday, DayCallback callback, void *ctx) const;
+
+  // Таблица целиком (для сохранения во flash)
+  const AlarmEntry *data() const { return _alarms; }
+
+  // "HH:MM" <-> минуты от начала суток
+  static bool parseTime(const char *text, uint16_t &minuteOfDay);
+  static void formatTime(uint16_t minuteOfDay, char out[6]);
+
+private:
+  void rebuildIndex();
+  size_t lowerBound(uint16_t minuteOfWeek) const;
+
+  AlarmEntry _alarms[ALARM_MAX_COUNT];
+  size_t _count = 0;
+
+  // Индекс: (минута недели << 8) | номер записи, по возрастанию
+  uint32_t _index[ALARM_MAX_COUNT * 7];
+  size_t _indexSize = 0;
+};
+
+// Курсор задачи ударов: всё, что раньше position(), уже сработало.
+// Скачок часов дальше graceUs — первая синхронизация, перевод часов,
+// смена пояса — переносит курсор на текущее время: старые срабатывания
+// не догоняются, пропущенные в пределах graceUs — догоняются.
+class FireCursor {
+public:
+  // true — курсор перенесён, ближайшее срабатывание нужно перечитать
+  bool follow(int64_t nowUs, int64_t graceUs) {
+    if (_cursorUs >= nowUs - graceUs && _cursorUs <= nowUs + graceUs) {
+      return false;
+    }
+    _cursorUs = nowUs;
+    return true;
+  }
+
+  // fire наступило и ещё не сыграно: курсор переходит за него
+  bool take(const AlarmFire &fire, int64_t nowUs) {
+    if (fire.atUs < _cursorUs || fire.atUs > nowUs) {
+      return false;
+    }
+    _cursorUs = fire.atUs + 1;
+    return true;
+  }
+
+  // fire ещё не сыграно: к нему нужен таймер
+  bool pending(const AlarmFire &fire) const { return fire.atUs >= _cursorUs; }
+  int64_t position() const { return _cursorUs; }
+
+private:
+  int64_t _cursorUs = -1;
+};
@@ -0,0 +1,87 @@
+#include "alarm_store.h"
+
+#include <string.h>
+
+#include "config_store.h"
+
+static const size_t kCrcOffset = offsetof(AlarmStoreHeader, crc);
+// Записи читаются порциями, без буфера на всю таблицу
+static const size_t kChunk = 32;
+
+bool AlarmStore::checkSlot(uint8_t slot, AlarmStoreHeader &header) {
+  if (_storage.read(slot, 0, (uint8_t *)&header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  if (header.magic != ALARM_STORE_MAGIC || header.version != ALARM_STORE_VERSION ||
+      header.count > ALARM_MAX_COUNT) {
+    return false;
+  }
+  uint32_t crc = crc32(0, (const uint8_t *)&header, kCrcOffset);
+  AlarmEntry chunk[kChunk];
+  for (size_t done = 0; done < header.count;) {
+    size_t count = header.count - done < kChunk ? header.count - done : kChunk;
+    size_t bytes = count * sizeof(AlarmEntry);
+    if (_storage.read(slot, sizeof(header) + done * sizeof(AlarmEntry), (uint8_t *)chunk, bytes) != bytes) {
+      return false;
+    }
+    crc = crc32(crc, (const uint8_t *)chunk, bytes);
+    done += count;
+  }
+  return crc == header.crc;
+}
+
+bool AlarmStore::load(AlarmScheduler &scheduler, uint32_t &setVersion) {
+  int8_t best = -1;
+  AlarmStoreHeader bestHeader = {};
+  for (uint8_t slot = 0; slot < 2; slot++) {
+    AlarmStoreHeader header;
+    if (!checkSlot(slot, header)) {
+      continue;
+    }
+    if (best < 0 || (int32_t)(header.setVersion - bestHeader.setVersion) > 0) {
+      best = slot;
+      bestHeader = header;
+    }
+  }
+  if (best < 0) {
+    return false;
+  }
+
+  scheduler.clear();
+  AlarmEntry chunk[kChunk];
+  for (size_t done = 0; done < bestHeader.count;) {
+    size_t count = bestHeader.count - done < kChunk ? bestHeader.count - done : kChunk;
+    size_t bytes = count * sizeof(AlarmEntry);
+    _storage.read(best, sizeof(bestHeader) + done * sizeof(AlarmEntry), (uint8_t *)chunk, bytes);
+    for (size_t i = 0; i < count; i++) {
+      scheduler.upsert(chunk[i]);
+    }
+    done += count;
+  }
+  _activeSlot = best;
+  setVersion = bestHeader.setVersion;
+  return true;
+}
+
+bool AlarmStore::commit(const AlarmScheduler &scheduler, uint32_t setVersion) {
+  AlarmStoreHeader header;
+  header.magic = ALARM_STORE_MAGIC;
+  header.version = ALARM_STORE_VERSION;
+  header.count = (uint16_t)scheduler.size();
+  header.setVersion = setVersion;
+  size_t bytes = scheduler.size() * sizeof(AlarmEntry);
+  uint32_t crc = crc32(0, (const uint8_t *)&header, kCrcOffset);
+  header.crc = crc32(crc, (const uint8_t *)scheduler.data(), bytes);
+
+  // Текущую копию не трогаем, пока новая не проверена чтением
+  uint8_t slot = _activeSlot == 0 ? 1 : 0;
+  if (!_storage.write(slot, (const uint8_t *)&header, sizeof(header), (const uint8_t *)scheduler.data(), bytes)) {
+    return false;
+  }
+  AlarmStoreHeader check;
+  if (!checkSlot(slot, check) || check.setVersion != setVersion) {
+    return false;
+  }
+  _activeSlot = slot;
+  return true;
+}
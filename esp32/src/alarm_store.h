@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alarm_scheduler.h"
+
+// Набор будильников во flash — как настройки (src/config_store.h): две
+// копии с CRC32, новая пишется на место не текущей и проверяется
+// чтением. Обрыв питания во время записи оставляет прежнюю копию
+// целой. Номер копии — версия набора (alarmsVersion): при загрузке
+// берётся корректная копия с большей версией.
+//
+// Файл /alarms.bin прежних прошивок (без CRC) переносится в слоты при
+// первой загрузке — см. loadAlarms() в main.cpp.
+
+#define ALARM_STORE_MAGIC   0x4D4C4147 // "GALM"
+#define ALARM_STORE_VERSION 3
+
+struct AlarmStoreHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t setVersion;
+  uint32_t crc;        // CRC32 заголовка до crc и записей
+};
+
+static_assert(sizeof(AlarmStoreHeader) == 16, "формат AlarmStoreHeader во flash изменился");
+
+// Два слота (файлы SPIFFS на устройстве, память в тестах)
+class AlarmStorage {
+public:
+  virtual ~AlarmStorage() {}
+  // Возвращает число прочитанных байт; меньше length — слот кончился
+  // или его нет
+  virtual size_t read(uint8_t slot, size_t offset, uint8_t *data, size_t length) = 0;
+  // Заменяет содержимое слота: заголовок, за ним записи
+  virtual bool write(uint8_t slot, const uint8_t *header, size_t headerLength, const uint8_t *alarms,
+                     size_t alarmsLength) = 0;
+};
+
+class AlarmStore {
+public:
+  explicit AlarmStore(AlarmStorage &storage) : _storage(storage) {}
+
+  // Заменяет будильники scheduler сохранёнными. false — корректной
+  // копии нет, scheduler не тронут.
+  bool load(AlarmScheduler &scheduler, uint32_t &setVersion);
+  // Пишет набор с версией setVersion; true — копия записана и прочитана
+  bool commit(const AlarmScheduler &scheduler, uint32_t setVersion);
+
+private:
+  bool checkSlot(uint8_t slot, AlarmStoreHeader &header);
+
+  AlarmStorage &_storage;
+  int8_t _activeSlot = -1;
+};
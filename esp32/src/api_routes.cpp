@@ -0,0 +1,366 @@
+#include "api_routes.h"
+
+#include <string.h>
+#include <uri/UriBraces.h>
+
+#include "alarm_json.h"
+#include "web_templates.h"
+
+void JsonReply::write(const char *data, size_t length) {
+  if (!_streaming) {
+    _streaming = true;
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(_code, "application/json", "");
+  }
+  _server.sendContent(data, length);
+}
+
+void JsonReply::send() {
+  if (_streaming) {
+    _out.flush();
+    _server.sendContent("", 0);
+    return;
+  }
+  _server.send(_code, "application/json", _out.data(), _out.length());
+}
+
+char *JsonReply::allocate() {
+  char *buffer = (char *)_server.arena().alloc(_capacity);
+  if (buffer == nullptr) {
+    _capacity = sizeof(_fallback);
+    return _fallback;
+  }
+  return buffer;
+}
+
+void sendJsonError(GongWebServer &server, int code, const char *error) {
+  JsonReply reply(server, code);
+  reply.json().beginObject();
+  reply.json().string("error", error);
+  reply.json().endObject();
+  reply.send();
+}
+
+void sendTemplate(GongWebServer &server, int code, const WebTemplate &tpl, TemplateContext &ctx) {
+  char buffer[TEMPLATE_BUFFER_SIZE];
+  ServerChunkSink sink(server);
+  TemplateWriter out(buffer, sizeof(buffer), sink);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(code, "text/html; charset=utf-8", "");
+  renderTemplate(tpl, ctx, out);
+  out.flush();
+  server.sendContent("", 0);
+}
+
+WiFiNetwork networkFromConfig(const GongConfig &cfg) {
+  WiFiNetwork network = {};
+  memcpy(network.ssid, cfg.wifiSsid, sizeof(network.ssid));
+  memcpy(network.pass, cfg.wifiPass, sizeof(network.pass));
+  network.staticIp = cfg.staticIp;
+  memcpy(network.ip, cfg.ip, 4);
+  memcpy(network.gateway, cfg.gateway, 4);
+  memcpy(network.subnet, cfg.subnet, 4);
+  memcpy(network.dns, cfg.dns, 4);
+  return network;
+}
+
+void networkToConfig(const WiFiNetwork &network, GongConfig &cfg) {
+  memcpy(cfg.wifiSsid, network.ssid, sizeof(cfg.wifiSsid));
+  memcpy(cfg.wifiPass, network.pass, sizeof(cfg.wifiPass));
+  cfg.staticIp = network.staticIp;
+  memcpy(cfg.ip, network.ip, 4);
+  memcpy(cfg.gateway, network.gateway, 4);
+  memcpy(cfg.subnet, network.subnet, 4);
+  memcpy(cfg.dns, network.dns, 4);
+}
+
+// Страница без слотов
+class StaticPageContext : public TemplateContext {
+public:
+  void slot(uint8_t, TemplateWriter &) override {}
+};
+
+// Установить громкость: /api/audio/volume?value=20
+static void handleVolume(GongWebServer &server, ApiHost &host) {
+  if (!server.hasArg("value")) {
+    sendJsonError(server, 400, "volume required");
+    return;
+  }
+  int vol = server.arg("value").toInt();
+  vol = constrain(vol, 0, 30);
+  uint32_t id = host.submitVolume((uint8_t)vol);
+  if (id == 0) {
+    sendJsonError(server, 503, "audio queue full");
+    return;
+  }
+  if (host.config().volume != vol) {
+    GongConfig next = host.config();
+    next.volume = vol;
+    host.commitConfig(next);
+  }
+  JsonReply reply(server, 202);
+  reply.json().beginObject();
+  reply.json().string("status", "ok");
+  reply.json().number("volume", vol);
+  reply.json().number("id", id);
+  reply.json().endObject();
+  reply.send();
+}
+
+// Смена WiFi без перезагрузки: проба новой сети с возвратом к прежней
+// (итог — GET /api/wifi/status)
+static void handleWiFi(GongWebServer &server, ApiHost &host) {
+  StrView newSsid = server.arg("ssid");
+  StrView newPass = server.arg("pass");
+  if (newSsid.length == 0 || newPass.length == 0) {
+    server.send(400, "text/plain; charset=utf-8", "SSID и пароль обязательны");
+    return;
+  }
+  const GongConfig &config = host.config();
+  if (newSsid.length >= sizeof(config.wifiSsid) || newPass.length >= sizeof(config.wifiPass)) {
+    server.send(400, "text/plain; charset=utf-8", "SSID или пароль слишком длинные");
+    return;
+  }
+  WiFiNetwork network = networkFromConfig(config);
+  copyConfigString(network.ssid, sizeof(network.ssid), newSsid.data, newSsid.length);
+  copyConfigString(network.pass, sizeof(network.pass), newPass.data, newPass.length);
+  if (host.startWiFiTrial(network) == 0) {
+    server.send(409, "text/plain; charset=utf-8", "Смена сети уже идёт");
+    return;
+  }
+  StaticPageContext ctx;
+  sendTemplate(server, 202, kTemplate_wifi_saved, ctx);
+}
+
+// Список будильников
+static void handleAlarmList(GongWebServer &server, ApiHost &host) {
+  JsonReply reply(server, 200);
+  JsonWriter &json = reply.json();
+  json.beginObject();
+  json.beginArray("alarms");
+  host.lockAlarms();
+  AlarmScheduler &scheduler = host.scheduler();
+  for (size_t i = 0; i < scheduler.size(); i++) {
+    alarmToJson(scheduler.at(i), json);
+  }
+  json.endArray();
+  json.number("version", host.alarmsVersion());
+  host.unlockAlarms();
+  json.endObject();
+  reply.send();
+}
+
+// Добавить будильник
+static void handleAlarmCreate(GongWebServer &server, ApiHost &host) {
+  AlarmEntry alarm = {};
+  const char *error = NULL;
+  StrView body = server.arg("plain");
+  if (!alarmFromJson(body.data, body.length, alarm, false, error)) {
+    sendJsonError(server, 400, error);
+    return;
+  }
+  host.lockAlarms();
+  AlarmScheduler &scheduler = host.scheduler();
+  alarm.id = scheduler.nextId();
+  if (!scheduler.upsert(alarm)) {
+    host.unlockAlarms();
+    sendJsonError(server, 507, "alarm table is full");
+    return;
+  }
+  bool saved = host.saveAlarms();
+  if (saved) {
+    host.occurrences().onUpsert(alarm);
+  } else {
+    scheduler.remove(alarm.id);
+  }
+  host.unlockAlarms();
+  if (!saved) {
+    sendJsonError(server, 500, "failed to save alarms");
+    return;
+  }
+  host.scheduleChanged();
+  JsonReply reply(server, 201);
+  alarmToJson(alarm, reply.json());
+  reply.send();
+}
+
+// Изменить будильник: /api/alarms/{id}
+static void handleAlarmUpdate(GongWebServer &server, ApiHost &host) {
+  uint16_t id = server.pathArg(0).toInt();
+  host.lockAlarms();
+  const AlarmEntry *existing = host.scheduler().find(id);
+  AlarmEntry alarm = existing ? *existing : AlarmEntry();
+  host.unlockAlarms();
+  if (!existing) {
+    sendJsonError(server, 404, "not found");
+    return;
+  }
+  const char *error = NULL;
+  StrView body = server.arg("plain");
+  if (!alarmFromJson(body.data, body.length, alarm, true, error)) {
+    sendJsonError(server, 400, error);
+    return;
+  }
+  host.lockAlarms();
+  AlarmScheduler &scheduler = host.scheduler();
+  // Будильник могли удалить или изменить, пока разбирался запрос
+  existing = scheduler.find(id);
+  if (!existing) {
+    host.unlockAlarms();
+    sendJsonError(server, 404, "not found");
+    return;
+  }
+  AlarmEntry previous = *existing;
+  bool saved = scheduler.upsert(alarm) && host.saveAlarms();
+  if (saved) {
+    host.occurrences().onUpsert(alarm);
+  } else {
+    scheduler.upsert(previous);
+  }
+  host.unlockAlarms();
+  if (!saved) {
+    sendJsonError(server, 500, "failed to save alarms");
+    return;
+  }
+  host.scheduleChanged();
+  JsonReply reply(server, 200);
+  alarmToJson(alarm, reply.json());
+  reply.send();
+}
+
+// Удалить будильник: /api/alarms/{id}
+static void handleAlarmDelete(GongWebServer &server, ApiHost &host) {
+  uint16_t id = server.pathArg(0).toInt();
+  host.lockAlarms();
+  AlarmScheduler &scheduler = host.scheduler();
+  const AlarmEntry *existing = scheduler.find(id);
+  if (!existing) {
+    host.unlockAlarms();
+    sendJsonError(server, 404, "not found");
+    return;
+  }
+  AlarmEntry removed = *existing;
+  scheduler.remove(id);
+  bool saved = host.saveAlarms();
+  if (saved) {
+    host.occurrences().onRemove(id);
+  } else {
+    scheduler.upsert(removed);
+  }
+  host.unlockAlarms();
+  if (!saved) {
+    sendJsonError(server, 500, "failed to save alarms");
+    return;
+  }
+  host.scheduleChanged();
+  JsonReply reply(server, 200);
+  reply.json().beginObject();
+  reply.json().string("status", "deleted");
+  reply.json().number("id", id);
+  reply.json().endObject();
+  reply.send();
+}
+
+// Пакет изменений от backend: применяется целиком или не применяется.
+// Если base не совпадает с текущей версией (набор меняли на устройстве
+// или backend потерял состояние), ответ 409 с текущей версией —
+// backend присылает полный набор ("full":true).
+static void handleAlarmSync(GongWebServer &server, ApiHost &host) {
+  static AlarmEntry upserts[ALARM_MAX_COUNT];
+  static uint16_t deletes[ALARM_MAX_COUNT];
+  AlarmSyncBatch batch = {0, false, upserts, 0, deletes, 0};
+  const char *error = NULL;
+  StrView body = server.arg("plain");
+  if (!alarmSyncFromJson(body.data, body.length, batch, error)) {
+    sendJsonError(server, error == kAlarmSyncTooLarge ? 413 : 400, error);
+    return;
+  }
+
+  host.lockAlarms();
+  AlarmScheduler &scheduler = host.scheduler();
+  if (!batch.full && batch.base != host.alarmsVersion()) {
+    uint32_t current = host.alarmsVersion();
+    host.unlockAlarms();
+    JsonReply reply(server, 409);
+    reply.json().beginObject();
+    reply.json().string("error", "version mismatch");
+    reply.json().number("version", current);
+    reply.json().endObject();
+    reply.send();
+    return;
+  }
+  // Проверка места до изменений, чтобы не применить пакет наполовину
+  size_t size = batch.full ? 0 : scheduler.size();
+  for (size_t i = 0; i < batch.deleteCount; i++) {
+    if (scheduler.find(deletes[i]) != NULL) {
+      size--;
+    }
+  }
+  for (size_t i = 0; i < batch.upsertCount; i++) {
+    if (batch.full || scheduler.find(upserts[i].id) == NULL) {
+      size++;
+    }
+  }
+  if (size > ALARM_MAX_COUNT) {
+    host.unlockAlarms();
+    sendJsonError(server, 507, "alarm table is full");
+    return;
+  }
+
+  if (batch.full) {
+    scheduler.clear();
+  }
+  for (size_t i = 0; i < batch.deleteCount; i++) {
+    scheduler.remove(deletes[i]);
+  }
+  for (size_t i = 0; i < batch.upsertCount; i++) {
+    scheduler.upsert(upserts[i]);
+  }
+  // Пакет не записан — набор возвращается к сохранённому целиком
+  bool saved = host.saveAlarms();
+  if (!saved) {
+    host.restoreAlarms();
+  }
+  OccurrenceCache &occurrences = host.occurrences();
+  if (occurrences.valid()) {
+    occurrences.rebuild(occurrences.today(), scheduler);
+  }
+  uint32_t version = host.alarmsVersion();
+  host.unlockAlarms();
+  if (!saved) {
+    sendJsonError(server, 500, "failed to save alarms");
+    return;
+  }
+  host.scheduleChanged();
+  JsonReply reply(server, 200);
+  reply.json().beginObject();
+  reply.json().number("version", version);
+  reply.json().number("upserts", batch.upsertCount);
+  reply.json().number("deletes", batch.deleteCount);
+  reply.json().endObject();
+  reply.send();
+}
+
+void registerApiRoutes(GongWebServer &server, ApiHost &host) {
+  server.on("/api/audio/volume", HTTP_POST, host.route("POST /api/audio/volume", [&server, &host]() {
+    handleVolume(server, host);
+  }));
+  server.on("/api/wifi", HTTP_POST, host.route("POST /api/wifi", [&server, &host]() {
+    handleWiFi(server, host);
+  }));
+  server.on("/api/alarms", HTTP_GET, host.route("GET /api/alarms", [&server, &host]() {
+    handleAlarmList(server, host);
+  }));
+  server.on("/api/alarms", HTTP_POST, host.route("POST /api/alarms", [&server, &host]() {
+    handleAlarmCreate(server, host);
+  }));
+  server.on(UriBraces("/api/alarms/{}"), HTTP_PUT, host.route("PUT /api/alarms/{}", [&server, &host]() {
+    handleAlarmUpdate(server, host);
+  }));
+  server.on(UriBraces("/api/alarms/{}"), HTTP_DELETE, host.route("DELETE /api/alarms/{}", [&server, &host]() {
+    handleAlarmDelete(server, host);
+  }));
+  server.on("/api/alarms/sync", HTTP_POST, host.route("POST /api/alarms/sync", [&server, &host]() {
+    handleAlarmSync(server, host);
+  }));
+}
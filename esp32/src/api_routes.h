@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alarm_scheduler.h"
+#include "config_store.h"
+#include "gong_web_server.h"
+#include "json_writer.h"
+#include "occurrence_cache.h"
+#include "template_renderer.h"
+#include "wifi_manager.h"
+
+// Маршруты JSON API, которые отвечают без кучи: громкость, смена WiFi,
+// будильники и пакет синхронизации с backend. Состояние прошивки они
+// видят через ApiHost: в прошивке это глобальные объекты main.cpp, в
+// test_web_server — объекты в памяти, и тест считает выделения в тех
+// же обработчиках, что работают на устройстве.
+
+// Размер буфера ответа JSON в арене запроса
+#define JSON_REPLY_BUFFER_SIZE 512
+// Размер буфера, через который шаблонные страницы уходят чанками
+#define TEMPLATE_BUFFER_SIZE 512
+
+// Ответ JSON: поместился в буфер — уходит с Content-Length, нет —
+// чанками по мере заполнения буфера. Память — только арена запроса.
+//
+//   JsonReply reply(server, 202);
+//   reply.json().beginObject(); ...; reply.json().endObject();
+//   reply.send();
+class JsonReply : public ChunkSink {
+public:
+  JsonReply(GongWebServer &server, int code) : _server(server), _code(code) {}
+
+  JsonWriter &json() { return _json; }
+
+  void write(const char *data, size_t length) override;
+  void send();
+
+private:
+  // Арена переполнена — ответ уходит мелкими чанками через _fallback
+  char *allocate();
+
+  GongWebServer &_server;
+  int _code;
+  bool _streaming = false;
+  char _fallback[64];
+  size_t _capacity = JSON_REPLY_BUFFER_SIZE;
+  char *_buffer = allocate();
+  TemplateWriter _out{_buffer, _capacity, *this};
+  JsonWriter _json{_out};
+};
+
+void sendJsonError(GongWebServer &server, int code, const char *error);
+
+// Чанки ответа прямо в соединение
+class ServerChunkSink : public ChunkSink {
+public:
+  explicit ServerChunkSink(GongWebServer &server) : _server(server) {}
+  void write(const char *data, size_t length) override { _server.sendContent(data, length); }
+
+private:
+  GongWebServer &_server;
+};
+
+// Страница по шаблону: chunked transfer encoding, в памяти не больше
+// одного буфера независимо от размера страницы
+void sendTemplate(GongWebServer &server, int code, const WebTemplate &tpl, TemplateContext &ctx);
+
+// Сеть из настроек и обратно
+WiFiNetwork networkFromConfig(const GongConfig &cfg);
+void networkToConfig(const WiFiNetwork &network, GongConfig &cfg);
+
+// Всё вызывается из задачи веб-сервера
+class ApiHost {
+public:
+  virtual ~ApiHost() {}
+
+  // Обёртка обработчика маршрута (замер времени в прошивке)
+  virtual GongWebServer::THandlerFunction route(const char *name, GongWebServer::THandlerFunction handler) {
+    (void)name;
+    return handler;
+  }
+
+  virtual const GongConfig &config() = 0;
+  // Записать и опубликовать настройки; false — запись не удалась
+  virtual bool commitConfig(const GongConfig &next) = 0;
+  // Команда громкости плееру; 0 — очередь заполнена
+  virtual uint32_t submitVolume(uint8_t volume) = 0;
+  // Проба новой сети; 0 — проба уже идёт
+  virtual uint32_t startWiFiTrial(const WiFiNetwork &network) = 0;
+
+  // Набор будильников: scheduler(), occurrences(), alarmsVersion(),
+  // saveAlarms() и restoreAlarms() — только между lockAlarms() и
+  // unlockAlarms()
+  virtual void lockAlarms() = 0;
+  virtual void unlockAlarms() = 0;
+  virtual AlarmScheduler &scheduler() = 0;
+  virtual OccurrenceCache &occurrences() = 0;
+  virtual uint32_t alarmsVersion() = 0;
+  // Записать набор (версия растёт); false — во flash прежний набор
+  virtual bool saveAlarms() = 0;
+  // Вернуть набор к сохранённому после неудачной записи
+  virtual void restoreAlarms() = 0;
+  // Набор изменился (вне блокировки): пересчёт расписания, событие
+  virtual void scheduleChanged() = 0;
+};
+
+void registerApiRoutes(GongWebServer &server, ApiHost &host);
@@ -0,0 +1,109 @@
+#include "audio_commands.h"
+
+bool runAudioCommand(AudioBackend &backend, const AudioCommand &command) {
+  switch (command.op) {
+    case AudioOp::Play:
+      return backend.start();
+    case AudioOp::Stop:
+      return backend.stop();
+    case AudioOp::Volume:
+      return backend.volume((uint8_t)command.arg);
+    case AudioOp::Track:
+      return backend.play(command.arg);
+    case AudioOp::Prestage:
+    case AudioOp::Strike:
+      break;
+  }
+  return false;
+}
+
+const char *audioCommandStatusName(AudioCommandStatus status) {
+  switch (status) {
+    case AudioCommandStatus::Queued:    return "queued";
+    case AudioCommandStatus::Done:      return "done";
+    case AudioCommandStatus::Failed:    return "failed";
+    case AudioCommandStatus::Coalesced: return "coalesced";
+    case AudioCommandStatus::Unknown:   break;
+  }
+  return "unknown";
+}
+
+uint32_t AudioCommandLog::issue() {
+  uint32_t id;
+  do {
+    id = _nextId.fetch_add(1, std::memory_order_relaxed) & kIdMask;
+  } while (id == 0);
+  set(id, AudioCommandStatus::Queued);
+  return id;
+}
+
+void AudioCommandLog::set(uint32_t id, AudioCommandStatus status) {
+  _slots[id % kHistory].store((id << 3) | (uint32_t)status, std::memory_order_release);
+}
+
+AudioCommandStatus AudioCommandLog::status(uint32_t id) const {
+  uint32_t slot = _slots[id % kHistory].load(std::memory_order_acquire);
+  if (id == 0 || (slot >> 3) != (id & kIdMask)) {
+    return AudioCommandStatus::Unknown;
+  }
+  return (AudioCommandStatus)(slot & 7);
+}
+
+void AudioCommandQueue::dropAt(size_t pos) {
+  _log.set(at(pos).id, AudioCommandStatus::Coalesced);
+  _coalesced.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = pos; i + 1 < _count; i++) {
+    at(i) = at(i + 1);
+  }
+  _count--;
+}
+
+bool AudioCommandQueue::push(const AudioCommand &command) {
+  AudioOp op = command.op;
+  // Команды, которые новая делает бессмысленными. Новая встаёт на место
+  // первой из них: громкость, поставленная до трека, остаётся до трека.
+  bool placed = false;
+  for (size_t pos = 0; pos < _count;) {
+    AudioOp pendingOp = at(pos).op;
+    bool startsTrack = op == AudioOp::Track || op == AudioOp::Strike;
+    bool superseded =
+      (op == AudioOp::Volume && pendingOp == AudioOp::Volume) ||
+      (startsTrack && (pendingOp == AudioOp::Track || pendingOp == AudioOp::Strike)) ||
+      (op == AudioOp::Prestage && pendingOp == AudioOp::Prestage) ||
+      (op == AudioOp::Stop && pendingOp != AudioOp::Volume);
+    if (!superseded) {
+      pos++;
+    } else if (!placed) {
+      _log.set(at(pos).id, AudioCommandStatus::Coalesced);
+      _coalesced.fetch_add(1, std::memory_order_relaxed);
+      at(pos) = command;
+      placed = true;
+      pos++;
+    } else {
+      dropAt(pos);
+    }
+  }
+  if (placed) {
+    return true;
+  }
+
+  if (_count == kCapacity) {
+    return false;
+  }
+  at(_count++) = command;
+  return true;
+}
+
+bool AudioCommandQueue::pop(AudioCommand &command) {
+  if (_count == 0) {
+    return false;
+  }
+  command = _ring[_head];
+  _head = (_head + 1) % kCapacity;
+  _count--;
+  return true;
+}
+
+void AudioCommandQueue::complete(uint32_t id, bool ok) {
+  _log.set(id, ok ? AudioCommandStatus::Done : AudioCommandStatus::Failed);
+}
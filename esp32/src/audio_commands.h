@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Команды DFPlayer. HTTP-обработчики и будильники получают id команды
+// сразу (AudioCommandLog), сама команда доходит до задачи аудио через
+// кольцо и ждёт отправки в её очереди (AudioCommandQueue).
+// Избыточные команды в очереди схлопываются:
+//  - новая громкость заменяет ещё не отправленную;
+//  - новый трек заменяет ещё не запущенный трек;
+//  - удар заменяет ещё не запущенные трек и удар;
+//  - новая подготовка заменяет ожидающую;
+//  - стоп отменяет ожидающие play/track/stop/подготовку/удар.
+// Новая команда занимает место первой заменённой, а не встаёт в конец:
+// порядок относительно остальных команд очереди не меняется.
+
+enum class AudioOp : uint8_t {
+  Play,     // продолжить/запустить текущий трек
+  Stop,
+  Volume,   // arg — громкость 0..30
+  Track,    // arg — номер трека
+  // Выполняются audioTask через StrikePrestage (strike_prestage.h)
+  Prestage, // arg — трек ближайшего удара: подготовить заранее
+  Strike,   // arg — трек удара будильника
+};
+
+enum class AudioCommandStatus : uint8_t {
+  Unknown,    // id не выдавался или вытеснен из истории
+  Queued,
+  Done,
+  Failed,
+  Coalesced,  // заменена более новой командой и не отправлялась
+};
+
+struct AudioCommand {
+  uint32_t id;
+  AudioOp op;
+  uint16_t arg;
+};
+
+// Исполнитель команд: DFPlayer на устройстве, подделка в тестах
+class AudioBackend {
+public:
+  virtual ~AudioBackend() {}
+  virtual bool start() = 0;
+  virtual bool stop() = 0;
+  virtual bool volume(uint8_t volume) = 0;
+  virtual bool play(uint16_t track) = 0;
+};
+
+bool runAudioCommand(AudioBackend &backend, const AudioCommand &command);
+
+const char *audioCommandStatusName(AudioCommandStatus status);
+
+// Выданные id и статусы последних kHistory команд. Без блокировок:
+// id выдаёт любая задача, статус пишет та, что владеет командой на
+// этом шаге, читает кто угодно. Слот хранит id и статус одним словом,
+// поэтому чтение не видит статус чужой команды.
+class AudioCommandLog {
+public:
+  static const size_t kHistory = 32;
+
+  // Новый id со статусом Queued; id никогда не равен 0
+  uint32_t issue();
+  void set(uint32_t id, AudioCommandStatus status);
+  AudioCommandStatus status(uint32_t id) const;
+
+private:
+  // Три младших бита слота — статус, остальные — id
+  static const uint32_t kIdMask = 0x1FFFFFFF;
+
+  std::atomic<uint32_t> _nextId{1};
+  std::atomic<uint32_t> _slots[kHistory] = {};
+};
+
+// Очередь команд задачи аудио. Не потокобезопасна: ею владеет одна
+// задача, остальные передают команды через кольцо. Статусы — в log.
+class AudioCommandQueue {
+public:
+  static const size_t kCapacity = 8;
+
+  explicit AudioCommandQueue(AudioCommandLog &log) : _log(log) {}
+
+  // Схлопывает ожидающие команды, которые новая делает бессмысленными.
+  // false — очередь заполнена, команда не принята (её можно повторить).
+  bool push(const AudioCommand &command);
+  bool pop(AudioCommand &command);
+  void complete(uint32_t id, bool ok);
+
+  size_t pending() const { return _count; }
+  // Из любой задачи
+  uint32_t coalescedCount() const { return _coalesced.load(std::memory_order_relaxed); }
+
+private:
+  void dropAt(size_t pos);
+  AudioCommand &at(size_t pos) { return _ring[(_head + pos) % kCapacity]; }
+
+  AudioCommandLog &_log;
+  AudioCommand _ring[kCapacity];
+  size_t _head = 0;
+  size_t _count = 0;
+  std::atomic<uint32_t> _coalesced{0};
+};
@@ -0,0 +1,75 @@
+#include "boot_pipeline.h"
+
+uint32_t BootPipeline::now() const {
+  int64_t us = _clockUs();
+  // 0 занят под «ещё нет»; отметки позже ~71 минуты не интересны
+  if (us < 1) {
+    return 1;
+  }
+  return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+bool BootPipeline::depsDone(size_t stage) const {
+  for (size_t dep = 0; dep < _count; dep++) {
+    if ((_stages[stage].deps & BOOT_STAGE_BIT(dep)) && !done(dep)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BootPipeline::pump() {
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (size_t stage = 0; stage < _count; stage++) {
+      if (started(stage) || !depsDone(stage)) {
+        continue;
+      }
+      _startUs[stage].store(now());
+      if (_stages[stage].run != nullptr) {
+        _stages[stage].run();
+      }
+      if (!_stages[stage].event) {
+        _endUs[stage].store(now());
+      }
+      progress = true;
+    }
+  }
+  updateReady(now());
+}
+
+void BootPipeline::complete(size_t stage) {
+  if (stage >= _count) {
+    return;
+  }
+  uint32_t expected = kNotYet;
+  uint32_t nowUs = now();
+  // Событие могло прийти раньше, чем pump() запустил стадию
+  _startUs[stage].compare_exchange_strong(expected, nowUs);
+  expected = kNotYet;
+  // Повторные события (переподключение WiFi) время не сдвигают
+  if (_endUs[stage].compare_exchange_strong(expected, nowUs)) {
+    updateReady(nowUs);
+  }
+}
+
+void BootPipeline::markFirstRequest() {
+  if (_firstRequestUs.load() == kNotYet) {
+    uint32_t expected = kNotYet;
+    _firstRequestUs.compare_exchange_strong(expected, now());
+  }
+}
+
+void BootPipeline::updateReady(uint32_t nowUs) {
+  if (_readyUs.load() != kNotYet) {
+    return;
+  }
+  for (size_t stage = 0; stage < _count; stage++) {
+    if (!done(stage)) {
+      return;
+    }
+  }
+  uint32_t expected = kNotYet;
+  _readyUs.compare_exchange_strong(expected, nowUs);
+}
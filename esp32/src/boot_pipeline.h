@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Загрузка как граф стадий. Стадия запускается, когда завершены все её
+// зависимости; синхронная завершается вместе со своей функцией, событийная
+// (подключение WiFi, ответ DFPlayer, синхронизация времени) — вызовом
+// complete() из обработчика события. Для каждой стадии запоминаются
+// время запуска и завершения (мкс от старта чипа).
+
+struct BootStage {
+  const char *name;
+  uint32_t deps;       // маска номеров стадий-зависимостей
+  void (*run)();       // может быть nullptr
+  bool event;          // завершается complete(), а не возвратом из run
+};
+
+#define BOOT_STAGE_BIT(stage) (1UL << (stage))
+
+class BootPipeline {
+public:
+  static const size_t kMaxStages = 16;
+  static const uint32_t kNotYet = 0;
+
+  // clockUs — мкс от старта чипа (esp_timer_get_time на устройстве)
+  BootPipeline(const BootStage *stages, size_t count, int64_t (*clockUs)())
+    : _stages(stages), _count(count < kMaxStages ? count : kMaxStages), _clockUs(clockUs) {}
+
+  // Запускает все стадии, которым хватает завершённых зависимостей.
+  // Вызывается из setup() и повторно после событий.
+  void pump();
+  // Завершение событийной стадии; можно вызывать из любой задачи
+  void complete(size_t stage);
+  // Первый обработанный HTTP-запрос
+  void markFirstRequest();
+
+  size_t count() const { return _count; }
+  const char *name(size_t stage) const { return _stages[stage].name; }
+  bool started(size_t stage) const { return _startUs[stage].load() != kNotYet; }
+  bool done(size_t stage) const { return _endUs[stage].load() != kNotYet; }
+  uint32_t startUs(size_t stage) const { return _startUs[stage].load(); }
+  uint32_t endUs(size_t stage) const { return _endUs[stage].load(); }
+  uint32_t firstRequestUs() const { return _firstRequestUs.load(); }
+  // Все стадии завершены; kNotYet — ещё нет
+  uint32_t readyUs() const { return _readyUs.load(); }
+
+private:
+  uint32_t now() const;
+  bool depsDone(size_t stage) const;
+  void updateReady(uint32_t nowUs);
+
+  const BootStage *_stages;
+  size_t _count;
+  int64_t (*_clockUs)();
+  std::atomic<uint32_t> _startUs[kMaxStages] = {};
+  std::atomic<uint32_t> _endUs[kMaxStages] = {};
+  std::atomic<uint32_t> _firstRequestUs{kNotYet};
+  std::atomic<uint32_t> _readyUs{kNotYet};
+};
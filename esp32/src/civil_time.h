@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+
+// Преобразования календарной даты без таблиц и без учёта часовых поясов
+// (алгоритм days_from_civil Говарда Хиннанта).
+
+#define SECONDS_PER_DAY 86400L
+#define US_PER_SECOND   1000000LL
+#define US_PER_MINUTE   (60LL * US_PER_SECOND)
+#define US_PER_DAY      (SECONDS_PER_DAY * US_PER_SECOND)
+
+// Дни от 1970-01-01 до даты (month 1..12, day 1..31)
+inline int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day) {
+  year -= month <= 2;
+  const int32_t era = (year >= 0 ? year : year - 399) / 400;
+  const uint32_t yoe = (uint32_t)(year - era * 400);
+  const uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+inline void civilFromDays(int32_t days, int32_t &year, uint32_t &month, uint32_t &day) {
+  days += 719468;
+  const int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const uint32_t doe = (uint32_t)(days - era * 146097);
+  const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const uint32_t mp = (5 * doy + 2) / 153;
+  day = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = (int32_t)yoe + era * 400 + (month <= 2);
+}
+
+// День недели: 0 = понедельник ... 6 = воскресенье (1970-01-01 — четверг)
+inline uint8_t weekdayFromDays(int32_t days) {
+  return (uint8_t)(days >= -3 ? (days + 3) % 7 : 6 - (-days - 4) % 7);
+}
+
+inline uint8_t daysInMonth(int32_t year, uint32_t month) {
+  static const uint8_t kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+  return (month == 2 && leap) ? 29 : kDays[month - 1];
+}
+
+// Целочисленное деление с округлением вниз (для отрицательных времён)
+inline int64_t floorDiv(int64_t value, int64_t divisor) {
+  int64_t q = value / divisor;
+  return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? q - 1 : q;
+}
+
+// "YYYY-MM-DD" -> дни от 1970-01-01
+inline bool parseIsoDate(const char *text, int32_t &days) {
+  int32_t year = 0;
+  uint32_t month = 0;
+  uint32_t day = 0;
+  for (int i = 0; i < 10; i++) {
+    char c = text[i];
+    if (i == 4 || i == 7) {
+      if (c != '-') return false;
+      continue;
+    }
+    if (c < '0' || c > '9') return false;
+    if (i < 4) year = year * 10 + (c - '0');
+    else if (i < 7) month = month * 10 + (c - '0');
+    else day = day * 10 + (c - '0');
+  }
+  if (text[10] != '\0' || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+    return false;
+  }
+  days = daysFromCivil(year, month, day);
+  return true;
+}
+
+// "YYYY-MM" -> год и месяц
+inline bool parseIsoMonth(const char *text, int32_t &year, uint32_t &month) {
+  year = 0;
+  month = 0;
+  for (int i = 0; i < 7; i++) {
+    char c = text[i];
+    if (i == 4) {
+      if (c != '-') return false;
+      continue;
+    }
+    if (c < '0' || c > '9') return false;
+    if (i < 4) year = year * 10 + (c - '0');
+    else month = month * 10 + (c - '0');
+  }
+  return text[7] == '\0' && month >= 1 && month <= 12;
+}
+
+// Дни от 1970-01-01 -> "YYYY-MM-DD"
+inline void formatIsoDate(int32_t days, char out[11]) {
+  int32_t year;
+  uint32_t month;
+  uint32_t day;
+  civilFromDays(days, year, month, day);
+  out[0] = '0' + (year / 1000) % 10;
+  out[1] = '0' + (year / 100) % 10;
+  out[2] = '0' + (year / 10) % 10;
+  out[3] = '0' + year % 10;
+  out[4] = '-';
+  out[5] = '0' + month / 10;
+  out[6] = '0' + month % 10;
+  out[7] = '-';
+  out[8] = '0' + day / 10;
+  out[9] = '0' + day % 10;
+  out[10] = '\0';
+}
@@ -0,0 +1,130 @@
+#include "config_store.h"
+
+#include <string.h>
+
+static const size_t kCrcOffset = offsetof(ConfigRecordHeader, crc);
+
+uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+void copyConfigString(char *field, size_t size, const char *value, size_t length) {
+  if (length >= size) {
+    length = size - 1;
+  }
+  memcpy(field, value, length);
+  field[length] = '\0';
+}
+
+bool applyLegacyConfigLine(const char *line, size_t length, GongConfig &config) {
+  // Пробелы и \r по краям, как String::trim()
+  while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t')) {
+    length--;
+  }
+  while (length > 0 && (*line == ' ' || *line == '\t')) {
+    line++;
+    length--;
+  }
+
+  static const char kSsid[] = "wifi_ssid=";
+  static const char kPass[] = "wifi_pass=";
+  if (length >= sizeof(kSsid) - 1 && memcmp(line, kSsid, sizeof(kSsid) - 1) == 0) {
+    copyConfigString(config.wifiSsid, sizeof(config.wifiSsid),
+      line + sizeof(kSsid) - 1, length - (sizeof(kSsid) - 1));
+    return true;
+  }
+  if (length >= sizeof(kPass) - 1 && memcmp(line, kPass, sizeof(kPass) - 1) == 0) {
+    copyConfigString(config.wifiPass, sizeof(config.wifiPass),
+      line + sizeof(kPass) - 1, length - (sizeof(kPass) - 1));
+    return true;
+  }
+  return false;
+}
+
+static uint32_t recordCrc(const uint8_t *record, size_t length) {
+  uint32_t crc = crc32(0, record, kCrcOffset);
+  return crc32(crc, record + sizeof(ConfigRecordHeader), length);
+}
+
+bool ConfigStore::readSlot(uint8_t slot, ConfigRecordHeader &header) {
+  size_t size = _storage.read(slot, _buffer, sizeof(_buffer));
+  if (size < sizeof(ConfigRecordHeader)) {
+    return false;
+  }
+  memcpy(&header, _buffer, sizeof(header));
+  if (header.magic != CONFIG_MAGIC || header.version == 0 ||
+      header.length > size - sizeof(ConfigRecordHeader)) {
+    return false;
+  }
+  return header.crc == recordCrc(_buffer, header.length);
+}
+
+bool ConfigStore::load(GongConfig &config) {
+  int8_t best = -1;
+  ConfigRecordHeader bestHeader = {};
+  for (uint8_t slot = 0; slot < 2; slot++) {
+    ConfigRecordHeader header;
+    if (!readSlot(slot, header)) {
+      continue;
+    }
+    if (best < 0 || (int32_t)(header.sequence - bestHeader.sequence) > 0) {
+      best = slot;
+      bestHeader = header;
+    }
+  }
+  if (best < 0) {
+    return false;
+  }
+  // Буфер мог быть перезаписан чтением второго слота
+  if (best == 0 && !readSlot(0, bestHeader)) {
+    return false;
+  }
+
+  size_t length = bestHeader.length < sizeof(GongConfig) ? bestHeader.length : sizeof(GongConfig);
+  memcpy(&config, _buffer + sizeof(ConfigRecordHeader), length);
+  // Строки из чужой или повреждённой версии не должны выйти за поле
+  config.wifiSsid[sizeof(config.wifiSsid) - 1] = '\0';
+  config.wifiPass[sizeof(config.wifiPass) - 1] = '\0';
+  config.timezone[sizeof(config.timezone) - 1] = '\0';
+  config.ntpServer[sizeof(config.ntpServer) - 1] = '\0';
+  config.triggerKey[sizeof(config.triggerKey) - 1] = '\0';
+
+  _activeSlot = best;
+  _sequence = bestHeader.sequence;
+  _loadedVersion = bestHeader.version;
+  return true;
+}
+
+bool ConfigStore::commit(const GongConfig &config) {
+  ConfigRecordHeader header;
+  header.magic = CONFIG_MAGIC;
+  header.version = CONFIG_VERSION;
+  header.length = sizeof(GongConfig);
+  header.sequence = _sequence + 1;
+  header.crc = 0;
+  memcpy(_buffer, &header, sizeof(header));
+  memcpy(_buffer + sizeof(header), &config, sizeof(config));
+  header.crc = recordCrc(_buffer, sizeof(config));
+  memcpy(_buffer + kCrcOffset, &header.crc, sizeof(header.crc));
+
+  // Текущую копию не трогаем, пока новая не проверена чтением
+  uint8_t slot = _activeSlot == 0 ? 1 : 0;
+  if (!_storage.write(slot, _buffer, sizeof(header) + sizeof(config))) {
+    return false;
+  }
+  ConfigRecordHeader check;
+  if (!readSlot(slot, check) || check.sequence != header.sequence) {
+    return false;
+  }
+  _activeSlot = slot;
+  _sequence = header.sequence;
+  _loadedVersion = CONFIG_VERSION;
+  return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Настройки устройства во flash: запись фиксированного формата с
+// версией и CRC32, две копии (слоты). Новая запись пишется в слот,
+// где лежит не текущая копия, поэтому обрыв питания во время записи
+// оставляет прежнюю копию целой. При загрузке берётся корректная копия
+// с большим номером.
+//
+// Новые поля только дописываются в конец GongConfig с увеличением
+// CONFIG_VERSION: запись старой версии короче, недостающие поля
+// остаются значениями по умолчанию.
+
+#define CONFIG_MAGIC   0x47464347 // "GCFG"
+#define CONFIG_VERSION 2
+
+struct GongConfig {
+  char wifiSsid[33];
+  char wifiPass[65];
+  uint8_t volume;            // 0-30
+  uint8_t staticIp;          // 1 — адреса ниже вместо DHCP
+  uint8_t ip[4];
+  uint8_t gateway[4];
+  uint8_t subnet[4];
+  uint8_t dns[4];
+  char timezone[32];         // POSIX TZ
+  char ntpServer[48];
+  uint16_t missedGraceSec;   // пропущенные дольше срабатывания не играются
+  // Версия 2
+  char triggerKey[33];       // ключ HMAC групповых ударов; пусто — приём выключен
+};
+
+static_assert(sizeof(GongConfig) == 232, "формат GongConfig во flash изменился");
+
+struct ConfigRecordHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t length;     // байт GongConfig после заголовка
+  uint32_t sequence;
+  uint32_t crc;        // CRC32 заголовка до crc и данных
+};
+
+// Хранилище двух слотов (файлы SPIFFS на устройстве, память в тестах)
+class ConfigStorage {
+public:
+  virtual ~ConfigStorage() {}
+  // Возвращает число прочитанных байт; 0 — слота нет
+  virtual size_t read(uint8_t slot, uint8_t *data, size_t capacity) = 0;
+  virtual bool write(uint8_t slot, const uint8_t *data, size_t length) = 0;
+};
+
+uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length);
+
+// Копирует строку с обрезкой по размеру поля, всегда с завершающим нулём
+void copyConfigString(char *field, size_t size, const char *value, size_t length);
+
+// Строка старого config.txt ("wifi_ssid=..."); false — ключ неизвестен
+bool applyLegacyConfigLine(const char *line, size_t length, GongConfig &config);
+
+class ConfigStore {
+public:
+  static const size_t kMaxRecord = 512;
+
+  explicit ConfigStore(ConfigStorage &storage) : _storage(storage) {}
+
+  // config должен быть заполнен значениями по умолчанию; поверх них
+  // копируется сохранённая запись. false — корректной записи нет.
+  bool load(GongConfig &config);
+  bool commit(const GongConfig &config);
+
+  uint32_t sequence() const { return _sequence; }
+  uint16_t loadedVersion() const { return _loadedVersion; }
+
+private:
+  bool readSlot(uint8_t slot, ConfigRecordHeader &header);
+
+  ConfigStorage &_storage;
+  uint8_t _buffer[kMaxRecord];
+  uint32_t _sequence = 0;
+  int8_t _activeSlot = -1;
+  uint16_t _loadedVersion = 0;
+};
@@ -0,0 +1,183 @@
+#include "dfplayer.h"
+
+#include <string.h>
+
+namespace dfplayer {
+
+static const uint8_t kStart = 0x7E;
+static const uint8_t kVersion = 0xFF;
+static const uint8_t kLength = 0x06;
+static const uint8_t kEnd = 0xEF;
+
+static uint16_t checksum(const uint8_t *frame) {
+  uint16_t sum = 0;
+  for (size_t i = 1; i < 7; i++) {
+    sum += frame[i];
+  }
+  return (uint16_t)(0 - sum);
+}
+
+void encodeFrame(uint8_t command, uint16_t param, bool feedback, uint8_t out[DFPLAYER_FRAME_SIZE]) {
+  out[0] = kStart;
+  out[1] = kVersion;
+  out[2] = kLength;
+  out[3] = command;
+  out[4] = feedback ? 1 : 0;
+  out[5] = (uint8_t)(param >> 8);
+  out[6] = (uint8_t)param;
+  uint16_t sum = checksum(out);
+  out[7] = (uint8_t)(sum >> 8);
+  out[8] = (uint8_t)sum;
+  out[9] = kEnd;
+}
+
+bool FrameParser::feed(uint8_t byte) {
+  if (_pos == 0) {
+    if (byte == kStart) {
+      _frame[_pos++] = byte;
+    }
+    return false;
+  }
+
+  _frame[_pos++] = byte;
+  bool bad =
+    (_pos == 2 && byte != kVersion) ||
+    (_pos == 3 && byte != kLength);
+  if (!bad && _pos < DFPLAYER_FRAME_SIZE) {
+    return false;
+  }
+  if (!bad) {
+    uint16_t sum = (uint16_t)(_frame[7] << 8) | _frame[8];
+    bad = byte != kEnd || sum != checksum(_frame);
+  }
+  size_t length = _pos;
+  _pos = 0;
+  if (bad) {
+    _errors++;
+    // Следующий кадр мог начаться внутри отброшенного (плеер перезапустился
+    // посреди ответа, потерян байт): байты после первого разбираются
+    // заново. Их меньше кадра, поэтому кадр здесь не собирается.
+    uint8_t rest[DFPLAYER_FRAME_SIZE];
+    memcpy(rest, _frame + 1, length - 1);
+    for (size_t i = 0; i + 1 < length; i++) {
+      feed(rest[i]);
+    }
+    return false;
+  }
+  return true;
+}
+
+}  // namespace dfplayer
+
+using namespace dfplayer;
+
+void DFPlayer::send(uint8_t command, uint16_t param) {
+  encodeFrame(command, param, false, _tx);
+  _port.write(_tx, DFPLAYER_FRAME_SIZE);
+  _lastTxMs = _nowMs;
+}
+
+uint32_t DFPlayer::msUntilReady(uint32_t nowMs) const {
+  uint32_t elapsed = nowMs - _lastTxMs;
+  return elapsed >= kCommandIntervalMs ? 0 : kCommandIntervalMs - elapsed;
+}
+
+void DFPlayer::begin(uint32_t nowMs) {
+  _nowMs = nowMs;
+  // Чтобы первая команда не ждала интервала
+  _lastTxMs = nowMs - kCommandIntervalMs;
+  queryStatus();
+}
+
+void DFPlayer::queryStatus() {
+  send(QUERY_STATUS, 0);
+}
+
+bool DFPlayer::start() {
+  send(CMD_START, 0);
+  _playing.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+bool DFPlayer::stop() {
+  send(CMD_STOP, 0);
+  _playing.store(false, std::memory_order_relaxed);
+  return true;
+}
+
+bool DFPlayer::pause() {
+  send(CMD_PAUSE, 0);
+  _playing.store(false, std::memory_order_relaxed);
+  return true;
+}
+
+bool DFPlayer::volume(uint8_t volume) {
+  if (volume > 30) {
+    return false;
+  }
+  send(CMD_VOLUME, volume);
+  _volume.store(volume, std::memory_order_relaxed);
+  return true;
+}
+
+bool DFPlayer::play(uint16_t track) {
+  if (track == 0) {
+    return false;
+  }
+  send(CMD_PLAY_TRACK, track);
+  _track.store(track, std::memory_order_relaxed);
+  _playing.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+void DFPlayer::poll(uint32_t nowMs) {
+  _nowMs = nowMs;
+  while (_port.available() > 0) {
+    int byte = _port.read();
+    if (byte < 0) {
+      break;
+    }
+    if (_parser.feed((uint8_t)byte)) {
+      handleFrame(_parser.command(), _parser.param(), nowMs);
+    }
+  }
+}
+
+void DFPlayer::handleFrame(uint8_t command, uint16_t param, uint32_t nowMs) {
+  _framesRx.fetch_add(1, std::memory_order_relaxed);
+  _lastRxMs.store(nowMs, std::memory_order_relaxed);
+  _online.store(true, std::memory_order_relaxed);
+
+  switch (command) {
+    case EVT_INIT:
+      _sdPresent.store((param & DEVICE_SD) != 0, std::memory_order_relaxed);
+      _playing.store(false, std::memory_order_relaxed);
+      break;
+    case EVT_MEDIA_INSERT:
+      _sdPresent.store(true, std::memory_order_relaxed);
+      break;
+    case EVT_MEDIA_REMOVE:
+      _sdPresent.store(false, std::memory_order_relaxed);
+      _playing.store(false, std::memory_order_relaxed);
+      break;
+    case EVT_TRACK_DONE:
+      _playing.store(false, std::memory_order_relaxed);
+      break;
+    case EVT_ERROR:
+      _lastError.store((uint8_t)param, std::memory_order_relaxed);
+      _errorsRx.fetch_add(1, std::memory_order_relaxed);
+      _playing.store(false, std::memory_order_relaxed);
+      break;
+    case QUERY_STATUS:
+      // Старший байт — носитель, младший — 0 стоп, 1 играет, 2 пауза
+      _sdPresent.store(((param >> 8) & DEVICE_SD) != 0, std::memory_order_relaxed);
+      _playing.store((param & 0xFF) == 1, std::memory_order_relaxed);
+      _statusRx.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case QUERY_VOLUME:
+      _volume.store((uint8_t)param, std::memory_order_relaxed);
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "audio_commands.h"
+
+// Драйвер DFPlayer Mini: кадры протокола по 10 байт
+//   7E FF 06 CMD FB PH PL CH CL EF
+// где FB — запрос подтверждения, PH:PL — параметр, CH:CL — дополнение
+// до нуля суммы байтов FF..PL. Буферы статические, ответы устройства
+// разбираются по мере прихода байтов, состояние плеера кэшируется —
+// чтение состояния не обращается к UART.
+
+#define DFPLAYER_FRAME_SIZE 10
+
+// Байтовый порт (UART на устройстве, подделка в тестах)
+class UartPort {
+public:
+  virtual ~UartPort() {}
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual size_t write(const uint8_t *data, size_t length) = 0;
+};
+
+namespace dfplayer {
+
+enum Command : uint8_t {
+  CMD_PLAY_TRACK    = 0x03,
+  CMD_VOLUME        = 0x06,
+  CMD_RESET         = 0x0C,
+  CMD_START         = 0x0D,
+  CMD_PAUSE         = 0x0E,
+  CMD_STOP          = 0x16,
+  // Сообщения от плеера
+  EVT_MEDIA_INSERT  = 0x3A,
+  EVT_MEDIA_REMOVE  = 0x3B,
+  EVT_TRACK_DONE    = 0x3D,
+  EVT_INIT          = 0x3F,
+  EVT_ERROR         = 0x40,
+  EVT_ACK           = 0x41,
+  QUERY_STATUS      = 0x42,
+  QUERY_VOLUME      = 0x43,
+};
+
+// Бит носителя SD в параметре EVT_INIT и в старшем байте QUERY_STATUS
+const uint8_t DEVICE_SD = 0x02;
+
+void encodeFrame(uint8_t command, uint16_t param, bool feedback, uint8_t out[DFPLAYER_FRAME_SIZE]);
+
+// Разбор входящего потока байт: кадр с неверной контрольной суммой или
+// разметкой отбрасывается, синхронизация — по байту 0x7E, в том числе
+// внутри отброшенного кадра
+class FrameParser {
+public:
+  // true, когда собран корректный кадр (command()/param())
+  bool feed(uint8_t byte);
+  uint8_t command() const { return _frame[3]; }
+  uint16_t param() const { return (uint16_t)(_frame[5] << 8) | _frame[6]; }
+  uint32_t errors() const { return _errors; }
+
+private:
+  uint8_t _frame[DFPLAYER_FRAME_SIZE] = {0};
+  size_t _pos = 0;
+  uint32_t _errors = 0;
+};
+
+}  // namespace dfplayer
+
+class DFPlayer : public AudioBackend {
+public:
+  // Минимальный интервал между командами: плеер теряет команды,
+  // пришедшие слишком часто
+  static const uint32_t kCommandIntervalMs = 30;
+
+  explicit DFPlayer(UartPort &port) : _port(port) {}
+
+  // Запрос состояния; ответ (или сообщение об инициализации после
+  // включения питания) переводит плеер в online
+  void begin(uint32_t nowMs);
+
+  // AudioBackend: команды без ожидания ответа
+  bool start() override;
+  bool stop() override;
+  bool volume(uint8_t volume) override;
+  bool play(uint16_t track) override;
+  bool pause();
+  void queryStatus();
+
+  // Разбирает всё, что пришло по UART; вызывается по событию приёма
+  void poll(uint32_t nowMs);
+
+  // Сколько ждать до следующей команды
+  uint32_t msUntilReady(uint32_t nowMs) const;
+
+  // Кэшированное состояние; читается из любой задачи
+  bool online() const { return _online.load(std::memory_order_relaxed); }
+  bool sdPresent() const { return _sdPresent.load(std::memory_order_relaxed); }
+  bool playing() const { return _playing.load(std::memory_order_relaxed); }
+  uint16_t track() const { return _track.load(std::memory_order_relaxed); }
+  uint8_t currentVolume() const { return _volume.load(std::memory_order_relaxed); }
+  uint8_t lastError() const { return _lastError.load(std::memory_order_relaxed); }
+  // Сообщений об ошибке от плеера (файл не найден, нет носителя...)
+  uint32_t errorReports() const { return _errorsRx.load(std::memory_order_relaxed); }
+  uint32_t lastRxMs() const { return _lastRxMs.load(std::memory_order_relaxed); }
+  uint32_t framesReceived() const { return _framesRx.load(std::memory_order_relaxed); }
+  // Ответы на queryStatus(): после нового ответа playing() — состояние
+  // самого плеера, а не ожидаемое по отправленным командам
+  uint32_t statusReplies() const { return _statusRx.load(std::memory_order_relaxed); }
+  uint32_t rxErrors() const { return _parser.errors(); }
+
+private:
+  void send(uint8_t command, uint16_t param);
+  void handleFrame(uint8_t command, uint16_t param, uint32_t nowMs);
+
+  UartPort &_port;
+  dfplayer::FrameParser _parser;
+  uint8_t _tx[DFPLAYER_FRAME_SIZE];
+  uint32_t _lastTxMs = 0;
+  uint32_t _nowMs = 0;
+
+  std::atomic<bool> _online{false};
+  std::atomic<bool> _sdPresent{false};
+  std::atomic<bool> _playing{false};
+  std::atomic<uint16_t> _track{0};
+  std::atomic<uint8_t> _volume{0};
+  std::atomic<uint8_t> _lastError{0};
+  std::atomic<uint32_t> _errorsRx{0};
+  std::atomic<uint32_t> _lastRxMs{0};
+  std::atomic<uint32_t> _framesRx{0};
+  std::atomic<uint32_t> _statusRx{0};
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include "esp32_trace.h"
+
+// Линия BUSY DFPlayer Mini: низкий уровень — идёт воспроизведение.
+// Фронты ловит прерывание GPIO с отметкой esp_timer, поэтому начало
+// звука известно точнее, чем по ответу на запрос состояния по UART.
+// Фронты копятся в кольце и разбираются audioTask.
+class BusyPin {
+public:
+  struct Edge {
+    bool playing;
+    int64_t atUs;
+  };
+  static const size_t kEdges = 8;
+
+  // notify — задача, которую будит каждый фронт
+  void begin(uint8_t pin, TaskHandle_t *notify) {
+    _pin = pin;
+    _notify = notify;
+    pinMode(pin, INPUT_PULLUP);
+    attachInterruptArg(pin, onEdge, this, CHANGE);
+  }
+
+  // false — новых фронтов нет; при переполнении теряются старые
+  bool take(Edge &edge) {
+    portENTER_CRITICAL(&_mux);
+    bool found = _count > 0;
+    if (found) {
+      edge = _edges[_head];
+      _head = (_head + 1) % kEdges;
+      _count--;
+    }
+    portEXIT_CRITICAL(&_mux);
+    return found;
+  }
+
+private:
+  static void IRAM_ATTR onEdge(void *arg) {
+    BusyPin *self = (BusyPin *)arg;
+    Edge edge = {digitalRead(self->_pin) == LOW, esp_timer_get_time()};
+    TRACE_INSTANT("busy_edge", edge.playing);
+    portENTER_CRITICAL_ISR(&self->_mux);
+    if (self->_count == kEdges) {
+      self->_head = (self->_head + 1) % kEdges;
+      self->_count--;
+    }
+    self->_edges[(self->_head + self->_count) % kEdges] = edge;
+    self->_count++;
+    portEXIT_CRITICAL_ISR(&self->_mux);
+    if (self->_notify != NULL && *self->_notify != NULL) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(*self->_notify, &woken);
+      if (woken) {
+        portYIELD_FROM_ISR();
+      }
+    }
+  }
+
+  uint8_t _pin = 0;
+  TaskHandle_t *_notify = NULL;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  Edge _edges[kEdges];
+  size_t _head = 0;
+  size_t _count = 0;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <WiFiClient.h>
+#include <lwip/sockets.h>
+
+#include "event_hub.h"
+
+// Подписчик EventHub на соединении веб-сервера. Запись без ожидания:
+// кадр, не поместившийся в буфер отправки целиком, отключает клиента —
+// медленная страница не задерживает остальных.
+class WiFiEventStream : public EventStream {
+public:
+  explicit WiFiEventStream(const WiFiClient &client) : _client(client) {}
+  ~WiFiEventStream() override { _client.stop(); }
+
+  bool write(const char *data, size_t length) override {
+    int fd = _client.fd();
+    if (fd < 0) {
+      return false;
+    }
+    return ::send(fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t)length;
+  }
+
+private:
+  WiFiClient _client;
+};
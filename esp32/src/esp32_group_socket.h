@@ -0,0 +1,82 @@
+#pragma once
+
+#include <IPAddress.h>
+#include <lwip/sockets.h>
+#include <string.h>
+
+// Сокет multicast-группы групповых ударов поверх сокетов lwIP.
+// Интерфейс задаётся адресом станции: на хосте это 127.0.0.1, и
+// несколько процессов на одном порту получают одни и те же пакеты.
+class GroupSocket {
+public:
+  ~GroupSocket() { close(); }
+
+  // join = false — сокет только для отправки
+  bool open(const IPAddress &localIp, const char *group, uint16_t port, bool join) {
+    close();
+    memset(&_group, 0, sizeof(_group));
+    _group.sin_family = AF_INET;
+    _group.sin_port = htons(port);
+    if (inet_aton(group, &_group.sin_addr) == 0) {
+      return false;
+    }
+    _fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (_fd < 0) {
+      return false;
+    }
+    struct in_addr local;
+    local.s_addr = htonl(((uint32_t)localIp[0] << 24) | ((uint32_t)localIp[1] << 16) |
+                         ((uint32_t)localIp[2] << 8) | localIp[3]);
+    int yes = 1;
+    uint8_t loop = 1;
+    struct sockaddr_in bindAddress = {};
+    bindAddress.sin_family = AF_INET;
+    bindAddress.sin_port = htons(port);
+    bindAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    struct ip_mreq membership = {};
+    membership.imr_multiaddr = _group.sin_addr;
+    membership.imr_interface = local;
+    // Своё устройство тоже получает отправленный пакет (IP_MULTICAST_LOOP)
+    // и ставит удар тем же путём, что и остальные
+    if ((join && (setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) != 0 ||
+                  bind(_fd, (struct sockaddr *)&bindAddress, sizeof(bindAddress)) != 0 ||
+                  setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0)) ||
+        setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) != 0 ||
+        setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (_fd >= 0) {
+      ::close(_fd);
+      _fd = -1;
+    }
+  }
+
+  bool isOpen() const { return _fd >= 0; }
+
+  // Пакет длиной до capacity; 0 — ничего не пришло за timeoutMs, -1 — ошибка
+  int receive(uint8_t *data, size_t capacity, uint32_t timeoutMs) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(_fd, &readSet);
+    struct timeval timeout = {(time_t)(timeoutMs / 1000), (suseconds_t)((timeoutMs % 1000) * 1000)};
+    int ready = select(_fd + 1, &readSet, NULL, NULL, &timeout);
+    if (ready <= 0) {
+      return ready;
+    }
+    int length = recv(_fd, data, capacity, 0);
+    return length < 0 ? -1 : length;
+  }
+
+  bool send(const uint8_t *data, size_t length) {
+    return sendto(_fd, data, length, 0, (struct sockaddr *)&_group, sizeof(_group)) == (int)length;
+  }
+
+private:
+  int _fd = -1;
+  struct sockaddr_in _group;
+};
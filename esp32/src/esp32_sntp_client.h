@@ -0,0 +1,78 @@
+#pragma once
+
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+#include <string.h>
+
+#include "sntp_packet.h"
+#include "time_service.h"
+
+// Один обмен SNTP по UDP: запрос, ожидание ответа на него до timeoutMs.
+// Метки t1/t4 — esp_timer (монотонные мкс), поэтому результат не зависит
+// от системных часов. server — имя или адрес, можно "host:port".
+// Блокирует вызывающую задачу (DNS и ожидание ответа).
+inline bool sntpExchange(const char *server, uint32_t timeoutMs, TimeSample &sample) {
+  char host[64];
+  const char *port = "123";
+  const char *colon = strrchr(server, ':');
+  size_t hostLength = colon ? (size_t)(colon - server) : strlen(server);
+  if (hostLength == 0 || hostLength >= sizeof(host)) {
+    return false;
+  }
+  memcpy(host, server, hostLength);
+  host[hostLength] = '\0';
+  if (colon) {
+    port = colon + 1;
+  }
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  struct addrinfo *address = NULL;
+  if (getaddrinfo(host, port, &hints, &address) != 0 || address == NULL) {
+    return false;
+  }
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd < 0) {
+    freeaddrinfo(address);
+    return false;
+  }
+  // connect() у UDP: ответы с других адресов стек отбрасывает сам
+  bool ok = connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+  freeaddrinfo(address);
+
+  uint64_t nonce = ((uint64_t)esp_random() << 32) | esp_random();
+  uint8_t packet[SNTP_PACKET_SIZE];
+  sntpEncodeRequest(nonce, packet);
+  int64_t t1 = esp_timer_get_time();
+  ok = ok && send(fd, packet, sizeof(packet), 0) == (int)sizeof(packet);
+
+  // Опоздавшие ответы на прошлые запросы не совпадут по nonce — ждём дальше
+  int64_t deadline = t1 + (int64_t)timeoutMs * 1000;
+  bool done = false;
+  while (ok && !done) {
+    int64_t left = deadline - esp_timer_get_time();
+    if (left <= 0) {
+      break;
+    }
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(fd, &readSet);
+    struct timeval timeout = {(time_t)(left / 1000000), (suseconds_t)(left % 1000000)};
+    if (select(fd + 1, &readSet, NULL, NULL, &timeout) <= 0) {
+      break;
+    }
+    uint8_t response[SNTP_PACKET_SIZE + 20]; // + ключ и MAC (NTPv4)
+    int length = recv(fd, response, sizeof(response), 0);
+    int64_t t4 = esp_timer_get_time();
+    int64_t t2;
+    int64_t t3;
+    if (length > 0 && sntpParseResponse(response, (size_t)length, nonce, t2, t3)) {
+      done = TimeService::sampleFromExchange(t1, t2, t3, t4, sample);
+    }
+  }
+  close(fd);
+  return done;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <xtensa/core-macros.h>
+
+#include "trace_buffer.h"
+
+// Точки трассировки прошивки (кольца — src/trace_buffer.h):
+//
+//   TRACE_SCOPE("uart_write", length);  // begin здесь, end в конце блока
+//   TRACE_INSTANT("wifi_event", event);  // мгновенное событие
+//
+// Имя — строковый литерал. Событие — счётчик тактов, номер ядра и
+// задачи и запись в кольцо: несколько десятков тактов, можно держать
+// включённым в рабочей сборке. Из прерываний — тоже (IRAM, без
+// блокировок). С -DGONG_TRACE=0 точки и /api/trace исчезают из сборки.
+
+#ifndef GONG_TRACE
+#define GONG_TRACE 1
+#endif
+
+#if GONG_TRACE
+
+extern TraceBuffer traceBuffer;
+
+static inline void IRAM_ATTR traceEvent(TracePhase phase, const char *name, uint32_t arg) {
+  const void *task = xPortInIsrContext() ? nullptr : (const void *)xTaskGetCurrentTaskHandle();
+  traceBuffer.record((uint8_t)xPortGetCoreID(), phase, name, task, XTHAL_GET_CCOUNT(), arg);
+}
+
+// Метка часов ядра; зовёт задача, которая просыпается хотя бы раз в
+// TRACE_CLOCK_INTERVAL_MS
+static inline void traceClock() {
+  static const uint32_t kIntervalCycles = TRACE_CLOCK_INTERVAL_MS * 1000 * ESP.getCpuFreqMHz();
+  traceBuffer.clock((uint8_t)xPortGetCoreID(), XTHAL_GET_CCOUNT(), esp_timer_get_time(), kIntervalCycles);
+}
+
+class TraceScope {
+public:
+  explicit TraceScope(const char *name, uint32_t arg = 0) : _name(name) {
+    traceEvent(TracePhase::Begin, name, arg);
+  }
+  ~TraceScope() {
+    traceEvent(TracePhase::End, _name, 0);
+  }
+
+private:
+  const char *_name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#define TRACE_INSTANT(name, arg) traceEvent(TracePhase::Instant, (name), (arg))
+#define TRACE_CLOCK() traceClock()
+
+#else
+
+#define TRACE_SCOPE(...) do {} while (0)
+#define TRACE_INSTANT(name, arg) do {} while (0)
+#define TRACE_CLOCK() do {} while (0)
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <WiFi.h>
+#include <esp_system.h>
+#include <string.h>
+
+#include "esp32_trace.h"
+#include "wifi_manager.h"
+
+// Драйвер WiFiManager поверх WiFi из Arduino-ESP32
+class Esp32WiFiDriver : public WiFiDriver {
+public:
+  void begin(const WiFiNetwork &network, int32_t channel, const uint8_t *bssid) override {
+    TRACE_SCOPE("wifi_begin", (uint32_t)channel);
+    // Нулевые адреса возвращают DHCP
+    if (network.staticIp) {
+      WiFi.config(IPAddress(network.ip), IPAddress(network.gateway), IPAddress(network.subnet),
+                  IPAddress(network.dns));
+    } else {
+      WiFi.config(IPAddress(), IPAddress(), IPAddress());
+    }
+    WiFi.begin(network.ssid, network.pass, channel, bssid);
+  }
+
+  void disconnect() override {
+    TRACE_SCOPE("wifi_disconnect");
+    WiFi.disconnect(false, false);
+  }
+
+  bool currentAp(uint8_t bssid[6], int32_t &channel) override {
+    uint8_t *current = WiFi.BSSID();
+    if (current == NULL) {
+      return false;
+    }
+    memcpy(bssid, current, 6);
+    channel = WiFi.channel();
+    return channel > 0;
+  }
+
+  uint32_t random() override {
+    return esp_random();
+  }
+};
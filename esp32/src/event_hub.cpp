@@ -0,0 +1,86 @@
+#include "event_hub.h"
+
+#include <string.h>
+
+const char *eventTypeName(EventType type) {
+  switch (type) {
+    case EVENT_TIME:     return "time";
+    case EVENT_PLAYER:   return "player";
+    case EVENT_ALARM:    return "alarm";
+    case EVENT_SCHEDULE: return "schedule";
+    default:             return "unknown";
+  }
+}
+
+EventHub::~EventHub() {
+  for (size_t i = 0; i < _count; i++) {
+    delete _streams[i];
+  }
+}
+
+bool EventHub::subscribe(EventStream *stream) {
+  if (_count == EVENT_HUB_MAX_CLIENTS) {
+    delete stream;
+    return false;
+  }
+  size_t index = _count++;
+  _streams[index] = stream;
+  _clients.store(_count);
+  for (size_t type = 0; type < EVENT_TYPE_COUNT; type++) {
+    if (_frameLengths[type] > 0 && !send(index, _frames[type], _frameLengths[type])) {
+      remove(index);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EventHub::publish(EventType type, const char *data, size_t length, bool changedOnly) {
+  char frame[EVENT_FRAME_MAX];
+  const char *name = eventTypeName(type);
+  size_t nameLength = strlen(name);
+  size_t frameLength = 7 + nameLength + 7 + length + 2;
+  if (frameLength > sizeof(frame)) {
+    return false;
+  }
+  char *p = frame;
+  memcpy(p, "event: ", 7);
+  p += 7;
+  memcpy(p, name, nameLength);
+  p += nameLength;
+  memcpy(p, "\ndata: ", 7);
+  p += 7;
+  memcpy(p, data, length);
+  p += length;
+  memcpy(p, "\n\n", 2);
+
+  if (changedOnly && _frameLengths[type] == frameLength && memcmp(_frames[type], frame, frameLength) == 0) {
+    return true;
+  }
+  memcpy(_frames[type], frame, frameLength);
+  _frameLengths[type] = frameLength;
+  _published++;
+  // Отключённый клиент заменяется последним — индекс не сдвигается
+  size_t i = 0;
+  while (i < _count) {
+    if (send(i, frame, frameLength)) {
+      i++;
+    } else {
+      remove(i);
+    }
+  }
+  return true;
+}
+
+bool EventHub::send(size_t index, const char *frame, size_t length) {
+  _writes++;
+  return _streams[index]->write(frame, length);
+}
+
+void EventHub::remove(size_t index) {
+  delete _streams[index];
+  _streams[index] = _streams[--_count];
+  _streams[_count] = nullptr;
+  _clients.store(_count);
+  _dropped++;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Push-канал для страниц (Server-Sent Events): событие сериализуется
+// в кадр SSE один раз и тот же буфер пишется всем подписчикам, поэтому
+// нагрузка на устройство почти не растёт с числом открытых страниц.
+// Последний кадр каждого типа хранится и отдаётся новому подписчику сразу.
+// Не потокобезопасен: вызывающий код держит блокировку; счётчики
+// и clients() читаются без неё.
+
+#ifndef EVENT_HUB_MAX_CLIENTS
+#define EVENT_HUB_MAX_CLIENTS 8
+#endif
+// Кадр целиком: "event: <тип>\ndata: <json>\n\n"
+#define EVENT_FRAME_MAX 512
+
+enum EventType : uint8_t {
+  EVENT_TIME,      // раз в секунду
+  EVENT_PLAYER,    // состояние DFPlayer изменилось
+  EVENT_ALARM,     // удар по расписанию или групповой
+  EVENT_SCHEDULE,  // изменился набор будильников
+  EVENT_TYPE_COUNT
+};
+
+const char *eventTypeName(EventType type);
+
+// Соединение подписчика. write() не блокируется: false — клиент
+// закрыл соединение или не успевает читать, и он отключается.
+class EventStream {
+public:
+  virtual ~EventStream() {}
+  virtual bool write(const char *data, size_t length) = 0;
+};
+
+class EventHub {
+public:
+  ~EventHub();
+
+  // Забирает stream во владение; false — все места заняты или
+  // клиент отвалился на сохранённых кадрах (stream уже удалён)
+  bool subscribe(EventStream *stream);
+  // data — JSON без переводов строк. Если changedOnly и кадр совпадает
+  // с сохранённым, ничего не отправляется. false — кадр не поместился.
+  bool publish(EventType type, const char *data, size_t length, bool changedOnly = false);
+
+  size_t clients() const { return _clients.load(); }
+  bool full() const { return _count == EVENT_HUB_MAX_CLIENTS; }
+
+  uint32_t published() const { return _published.load(); }
+  uint32_t writes() const { return _writes.load(); }
+  uint32_t dropped() const { return _dropped.load(); }
+
+private:
+  bool send(size_t index, const char *frame, size_t length);
+  void remove(size_t index);
+
+  EventStream *_streams[EVENT_HUB_MAX_CLIENTS] = {};
+  size_t _count = 0;
+  std::atomic<uint32_t> _clients{0};
+  char _frames[EVENT_TYPE_COUNT][EVENT_FRAME_MAX];
+  size_t _frameLengths[EVENT_TYPE_COUNT] = {};
+  std::atomic<uint32_t> _published{0};
+  std::atomic<uint32_t> _writes{0};
+  std::atomic<uint32_t> _dropped{0};
+};
@@ -0,0 +1,241 @@
+#include "event_journal.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "config_store.h"
+
+// Записей за одно чтение при запросе
+static const size_t kReadChunk = 16;
+
+static const char *const kEventNames[] = {
+  "boot", "alarm", "alarm_skipped", "group", "audio_failed", "player_offline",
+  "wifi_up", "wifi_down", "time_sync", "task_stall", "wifi_change",
+};
+
+static_assert(sizeof(kEventNames) / sizeof(kEventNames[0]) == (size_t)JournalEvent::Count - 1,
+              "имена событий журнала");
+
+const char *journalEventName(uint8_t type) {
+  if (type == 0 || type >= (uint8_t)JournalEvent::Count) {
+    return nullptr;
+  }
+  return kEventNames[type - 1];
+}
+
+static uint32_t recordCrc(const JournalRecord &record) {
+  return crc32(0, (const uint8_t *)&record, offsetof(JournalRecord, crc));
+}
+
+static uint32_t headerCrc(const JournalSegmentHeader &header) {
+  return crc32(0, (const uint8_t *)&header, offsetof(JournalSegmentHeader, crc));
+}
+
+static size_t recordOffset(size_t index) {
+  return sizeof(JournalSegmentHeader) + index * sizeof(JournalRecord);
+}
+
+bool JournalQueue::push(const JournalRecord &record) {
+  if (_count == EVENT_JOURNAL_QUEUE) {
+    _dropped++;
+    return false;
+  }
+  _records[(_head + _count) % EVENT_JOURNAL_QUEUE] = record;
+  _count++;
+  return true;
+}
+
+bool JournalQueue::pop(JournalRecord &record) {
+  if (_count == 0) {
+    return false;
+  }
+  record = _records[_head];
+  _head = (_head + 1) % EVENT_JOURNAL_QUEUE;
+  _count--;
+  return true;
+}
+
+bool EventJournal::readRecord(uint8_t segment, size_t index, JournalRecord &record) {
+  return _storage.read(segment, recordOffset(index), (uint8_t *)&record, sizeof(record)) == sizeof(record) &&
+         record.crc == recordCrc(record);
+}
+
+// Заголовок, последняя целая запись и первая: три чтения на сегмент
+void EventJournal::scanSegment(uint8_t index) {
+  Segment &segment = _segments[index];
+  segment = {};
+  size_t length = _storage.length(index);
+  JournalSegmentHeader header;
+  if (length < sizeof(header) ||
+      _storage.read(index, 0, (uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+      header.magic != JOURNAL_SEGMENT_MAGIC || header.crc != headerCrc(header)) {
+    return;
+  }
+  segment.valid = true;
+  segment.epoch = header.epoch;
+  size_t stored = (length - sizeof(header)) / sizeof(JournalRecord);
+  if (stored > kRecordsPerSegment) {
+    stored = kRecordsPerSegment;
+  }
+  // Неполная запись в конце — обрыв питания во время записи
+  segment.sealed = (length - sizeof(header)) % sizeof(JournalRecord) != 0;
+  JournalRecord last;
+  while (stored > 0 && !readRecord(index, stored - 1, last)) {
+    stored--;
+    segment.sealed = true;
+  }
+  if (segment.sealed) {
+    _torn++;
+  }
+  segment.count = (uint16_t)stored;
+  if (stored == 0) {
+    return;
+  }
+  JournalRecord first = last;
+  if (stored > 1 && !readRecord(index, 0, first)) {
+    // Испорченная первая запись: номер восстанавливается по последней
+    first.sequence = last.sequence - (uint32_t)(stored - 1);
+    first.time = 0;
+  }
+  segment.firstSequence = first.sequence;
+  segment.firstTime = first.time;
+  segment.lastTime = last.time;
+  if (last.sequence >= _nextSequence) {
+    _nextSequence = last.sequence + 1;
+  }
+}
+
+void EventJournal::recover() {
+  _head = -1;
+  _nextSequence = 1;
+  _torn = 0;
+  uint32_t records = 0;
+  for (uint8_t i = 0; i < EVENT_JOURNAL_SEGMENTS; i++) {
+    scanSegment(i);
+    if (_segments[i].valid && (_head < 0 || _segments[i].epoch > _segments[_head].epoch)) {
+      _head = i;
+    }
+    if (_segments[i].valid) {
+      records += _segments[i].count;
+    }
+  }
+  _records = records;
+}
+
+// Следующий сегмент по кругу стирается и получает заголовок. Пустой
+// сегмент с оборванной первой записью начинается заново на месте, чтобы
+// не стирать ради него самый старый сегмент с целыми записями.
+bool EventJournal::startSegment() {
+  uint8_t index = _head < 0 ? 0 : (uint8_t)((_head + 1) % EVENT_JOURNAL_SEGMENTS);
+  if (_head >= 0 && _segments[_head].valid && _segments[_head].count == 0) {
+    index = (uint8_t)_head;
+  }
+  uint32_t epoch = _head < 0 ? 1 : _segments[_head].epoch + 1;
+  Segment &segment = _segments[index];
+  if (segment.valid) {
+    _records -= segment.count;
+  }
+  segment = {};
+  JournalSegmentHeader header = {JOURNAL_SEGMENT_MAGIC, epoch, 0, 0};
+  header.crc = headerCrc(header);
+  // Заголовок не записан — сегмент пропускается до следующего оборота
+  _head = index;
+  if (!_storage.erase(index) || !_storage.append(index, (const uint8_t *)&header, sizeof(header))) {
+    _writeErrors++;
+    segment.epoch = epoch;
+    segment.sealed = true;
+    return false;
+  }
+  segment.valid = true;
+  segment.epoch = epoch;
+  return true;
+}
+
+bool EventJournal::append(JournalRecord &record) {
+  if (_head < 0 || _segments[_head].sealed || _segments[_head].count >= kRecordsPerSegment) {
+    if (!startSegment()) {
+      return false;
+    }
+  }
+  Segment &segment = _segments[_head];
+  record.sequence = _nextSequence;
+  record.reserved = 0;
+  record.crc = recordCrc(record);
+  if (!_storage.append((uint8_t)_head, (const uint8_t *)&record, sizeof(record))) {
+    _writeErrors++;
+    segment.sealed = true;
+    return false;
+  }
+  if (segment.count == 0) {
+    segment.firstSequence = record.sequence;
+    segment.firstTime = record.time;
+  }
+  segment.count++;
+  _records++;
+  segment.lastTime = record.time;
+  _nextSequence++;
+  _appended++;
+  return true;
+}
+
+// Границы по первой и последней записи: время ударов растёт вместе с
+// номером. Запись без времени (0) не сужает интервал сегмента.
+bool EventJournal::overlaps(const Segment &segment, uint32_t from, uint32_t to) const {
+  uint32_t last = segment.lastTime != 0 ? segment.lastTime : UINT32_MAX;
+  return segment.firstTime <= to && last >= from;
+}
+
+size_t EventJournal::query(uint32_t from, uint32_t to, uint32_t after, JournalRecord *out, size_t max,
+                           bool &more) {
+  more = false;
+  // Сегменты по возрастанию эпохи: от старых к новым
+  uint8_t order[EVENT_JOURNAL_SEGMENTS];
+  size_t segments = 0;
+  for (uint8_t i = 0; i < EVENT_JOURNAL_SEGMENTS; i++) {
+    if (!_segments[i].valid || _segments[i].count == 0) {
+      continue;
+    }
+    size_t at = segments++;
+    while (at > 0 && _segments[order[at - 1]].epoch > _segments[i].epoch) {
+      order[at] = order[at - 1];
+      at--;
+    }
+    order[at] = i;
+  }
+
+  size_t found = 0;
+  JournalRecord chunk[kReadChunk];
+  for (size_t s = 0; s < segments && found < max; s++) {
+    const Segment &segment = _segments[order[s]];
+    uint32_t lastSequence = segment.firstSequence + segment.count - 1;
+    if (lastSequence <= after || !overlaps(segment, from, to)) {
+      continue;
+    }
+    _segmentReads++;
+    size_t index = after >= segment.firstSequence ? after - segment.firstSequence + 1 : 0;
+    while (index < segment.count && found < max) {
+      size_t count = segment.count - index;
+      if (count > kReadChunk) {
+        count = kReadChunk;
+      }
+      size_t bytes = _storage.read(order[s], recordOffset(index), (uint8_t *)chunk, count * sizeof(JournalRecord));
+      count = bytes / sizeof(JournalRecord);
+      if (count == 0) {
+        break;
+      }
+      for (size_t i = 0; i < count && found < max; i++) {
+        const JournalRecord &record = chunk[i];
+        // Испорченная запись посреди сегмента пропускается
+        if (record.crc != recordCrc(record) || record.sequence <= after) {
+          continue;
+        }
+        if (record.time >= from && record.time <= to) {
+          out[found++] = record;
+        }
+      }
+      index += count;
+    }
+  }
+  more = found == max;
+  return found;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Журнал событий во flash: записи фиксированного размера с CRC32 в
+// кольце сегментов. Запись только дописывается в конец текущего
+// сегмента; заполненный сегмент закрывается, и журнал переходит к
+// следующему по кругу, стирая самый старый — каждый сегмент
+// перезаписывается раз за оборот, износ распределён равномерно.
+//
+// Обрыв питания портит не больше одной записи в конце сегмента или
+// заголовок только что начатого сегмента: при загрузке recover() читает
+// заголовок, первую и последнюю запись каждого сегмента, отбрасывает
+// оборванный хвост и продолжает с нового сегмента. Для запросов по
+// времени в памяти хранятся границы сегментов, и читаются только
+// сегменты, которые пересекаются с интервалом.
+//
+// EventJournal не потокобезопасен: им владеет задача журнала, запросы
+// идут под той же блокировкой; счётчики и recordCount() читаются без
+// неё. Производители событий пишут в JournalQueue — копия записи в
+// памяти, без обращения к flash.
+//
+// Формат (little-endian) читает и tools/journal_recovery.py.
+
+#ifndef EVENT_JOURNAL_SEGMENTS
+#define EVENT_JOURNAL_SEGMENTS 16
+#endif
+#ifndef EVENT_JOURNAL_SEGMENT_SIZE
+#define EVENT_JOURNAL_SEGMENT_SIZE 4096
+#endif
+// Событий в памяти до записи во flash
+#ifndef EVENT_JOURNAL_QUEUE
+#define EVENT_JOURNAL_QUEUE 32
+#endif
+
+#define JOURNAL_SEGMENT_MAGIC 0x4E524A47 // "GJRN"
+
+enum class JournalEvent : uint8_t {
+  Boot = 1,     // code — причина сброса
+  Alarm,        // удар по расписанию: alarm_id, track, опоздание
+  AlarmSkipped, // удар не отправлен: очередь аудио заполнена
+  Group,        // групповой удар: track, опоздание
+  AudioFailed,  // команда плеера не выполнена: code — ошибка DFPlayer
+  PlayerOffline,
+  WiFiUp,
+  WiFiDown,
+  TimeSync,     // latency — поправка часов
+  TaskStall,    // code — слот taskHealth
+  WiFiChange,   // смена сети: code 1 — подключена, 0 — возврат к прежней; latency — простой связи
+  Count
+};
+
+// "alarm", "wifi_down", ...; nullptr — неизвестный тип
+const char *journalEventName(uint8_t type);
+
+struct JournalRecord {
+  uint32_t sequence;   // растёт на 1 с каждой записью, с 1
+  uint32_t time;       // UTC, секунды; 0 — время не было известно
+  uint8_t type;        // JournalEvent
+  uint8_t reserved;
+  uint16_t code;
+  uint16_t alarmId;
+  uint16_t track;
+  int32_t latencyUs;
+  uint32_t crc;        // CRC32 записи до crc
+};
+
+static_assert(sizeof(JournalRecord) == 24, "формат JournalRecord во flash изменился");
+
+struct JournalSegmentHeader {
+  uint32_t magic;
+  uint32_t epoch;      // номер сегмента с начала журнала: порядок чтения
+  uint32_t reserved;
+  uint32_t crc;        // CRC32 заголовка до crc
+};
+
+static_assert(sizeof(JournalSegmentHeader) == 16, "формат JournalSegmentHeader во flash изменился");
+
+// Сегменты журнала (файлы SPIFFS на устройстве, память в бенчмарках)
+class JournalStorage {
+public:
+  virtual ~JournalStorage() {}
+  // Записано байт в сегменте; 0 — сегмент пуст
+  virtual size_t length(uint8_t segment) = 0;
+  // Возвращает число прочитанных байт
+  virtual size_t read(uint8_t segment, size_t offset, uint8_t *data, size_t length) = 0;
+  // Дописывает в конец сегмента
+  virtual bool append(uint8_t segment, const uint8_t *data, size_t length) = 0;
+  // После стирания сегмент пуст
+  virtual bool erase(uint8_t segment) = 0;
+};
+
+// События, ждущие записи во flash. Не потокобезопасна: производители и
+// задача журнала держат одну критическую секцию, которая длится одно
+// копирование записи; droppedCount() читается без неё.
+class JournalQueue {
+public:
+  // false — очередь заполнена, событие потеряно (droppedCount())
+  bool push(const JournalRecord &record);
+  bool pop(JournalRecord &record);
+
+  size_t size() const { return _count; }
+  uint32_t droppedCount() const { return _dropped.load(); }
+
+private:
+  JournalRecord _records[EVENT_JOURNAL_QUEUE];
+  size_t _head = 0;
+  size_t _count = 0;
+  std::atomic<uint32_t> _dropped{0};
+};
+
+class EventJournal {
+public:
+  static const size_t kRecordsPerSegment =
+    (EVENT_JOURNAL_SEGMENT_SIZE - sizeof(JournalSegmentHeader)) / sizeof(JournalRecord);
+
+  explicit EventJournal(JournalStorage &storage) : _storage(storage) {}
+
+  // При загрузке, до первой записи
+  void recover();
+  // Присваивает record номер и CRC и дописывает во flash. false —
+  // ошибка записи: сегмент закрывается, следующая запись — в новый.
+  bool append(JournalRecord &record);
+  // Записи с номером больше after и временем в [from, to] по
+  // возрастанию номера, не больше max. more — страница заполнена,
+  // продолжение — с after = номер последней записи.
+  size_t query(uint32_t from, uint32_t to, uint32_t after, JournalRecord *out, size_t max, bool &more);
+
+  uint32_t nextSequence() const { return _nextSequence; }
+  size_t recordCount() const { return _records.load(); }
+  uint32_t appendedCount() const { return _appended.load(); }
+  uint32_t writeErrorCount() const { return _writeErrors.load(); }
+  // Чтений сегментов запросами: проверка, что читаются только нужные
+  uint32_t segmentReadCount() const { return _segmentReads.load(); }
+  // Сегментов с оборванным хвостом, найденных recover()
+  uint32_t tornCount() const { return _torn.load(); }
+
+private:
+  struct Segment {
+    bool valid;        // заголовок прочитан или записан
+    bool sealed;       // дописывать нельзя: оборванный хвост или ошибка
+    uint16_t count;    // записей до первой оборванной
+    uint32_t epoch;
+    uint32_t firstSequence;
+    uint32_t firstTime;
+    uint32_t lastTime;
+  };
+
+  bool readRecord(uint8_t segment, size_t index, JournalRecord &record);
+  void scanSegment(uint8_t segment);
+  bool startSegment();
+  bool overlaps(const Segment &segment, uint32_t from, uint32_t to) const;
+
+  JournalStorage &_storage;
+  Segment _segments[EVENT_JOURNAL_SEGMENTS] = {};
+  int _head = -1;
+  uint32_t _nextSequence = 1;
+  // Сумма count по действительным сегментам
+  std::atomic<uint32_t> _records{0};
+  std::atomic<uint32_t> _appended{0};
+  std::atomic<uint32_t> _writeErrors{0};
+  std::atomic<uint32_t> _segmentReads{0};
+  std::atomic<uint32_t> _torn{0};
+};
@@ -0,0 +1,885 @@
+#include "gong_web_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <lwip/sockets.h>
+
+
+static const char *reasonPhrase(int code) {
+  switch (code) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default:  return "";
+  }
+}
+
+static bool tokenIs(const char *data, size_t length, const char *token) {
+  return strlen(token) == length && strncasecmp(data, token, length) == 0;
+}
+
+// Есть ли token в списке значений заголовка ("keep-alive, Upgrade")
+static bool listContains(const char *data, size_t length, const char *token) {
+  size_t tokenLength = strlen(token);
+  for (size_t i = 0; i + tokenLength <= length; i++) {
+    if (strncasecmp(data + i, token, tokenLength) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static HTTPMethod parseMethod(const char *data, size_t length) {
+  if (tokenIs(data, length, "GET")) return HTTP_GET;
+  if (tokenIs(data, length, "HEAD")) return HTTP_HEAD;
+  if (tokenIs(data, length, "POST")) return HTTP_POST;
+  if (tokenIs(data, length, "PUT")) return HTTP_PUT;
+  if (tokenIs(data, length, "PATCH")) return HTTP_PATCH;
+  if (tokenIs(data, length, "DELETE")) return HTTP_DELETE;
+  if (tokenIs(data, length, "OPTIONS")) return HTTP_OPTIONS;
+  return HTTP_ANY;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Декодирует на месте и ставит ноль после результата: он не длиннее
+// исходного, так что ноль попадает не дальше text[length] — разделителя
+// или запасного байта после тела. Возвращает новую длину.
+static size_t urlDecodeInPlace(char *text, size_t length) {
+  size_t out = 0;
+  for (size_t i = 0; i < length; i++) {
+    char c = text[i];
+    if (c == '+') {
+      c = ' ';
+    } else if (c == '%' && i + 2 < length && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0) {
+      c = (char)(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+      i += 2;
+    }
+    text[out++] = c;
+  }
+  text[out] = '\0';
+  return out;
+}
+
+// Конец заголовков: позиция после пустой строки или 0
+static size_t findHeadEnd(const char *data, size_t length) {
+  for (size_t i = 3; i < length; i++) {
+    if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r') {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+static bool wouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+GongWebServer::GongWebServer(uint16_t port) : _arena(_arenaBuffer, sizeof(_arenaBuffer)), _port(port) {}
+
+GongWebServer::~GongWebServer() {
+  close();
+}
+
+bool GongWebServer::begin() {
+  close();
+  const char *override = getenv("GONG_HTTP_PORT");
+  if (override && *override) {
+    _port = (uint16_t)atoi(override);
+  }
+  _listenFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (_listenFd < 0) {
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(_port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(_listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(_listenFd, HTTP_MAX_CONNECTIONS) != 0) {
+    ::close(_listenFd);
+    _listenFd = -1;
+    return false;
+  }
+  // Порт 0 — любой свободный: узнаём, какой выдала система
+  socklen_t addressLength = sizeof(address);
+  if (_port == 0 && getsockname(_listenFd, (struct sockaddr *)&address, &addressLength) == 0) {
+    _port = ntohs(address.sin_port);
+  }
+  fcntl(_listenFd, F_SETFL, fcntl(_listenFd, F_GETFL, 0) | O_NONBLOCK);
+  return true;
+}
+
+void GongWebServer::close() {
+  for (size_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    if (_connections[i].fd >= 0) {
+      release(_connections[i], true);
+    }
+  }
+  if (_listenFd >= 0) {
+    ::close(_listenFd);
+    _listenFd = -1;
+  }
+}
+
+void GongWebServer::on(const Uri &uri, HTTPMethod method, THandlerFunction handler) {
+  Route route;
+  route.uri.reset(uri.clone());
+  route.method = method;
+  route.handler = handler;
+  _routes.push_back(std::move(route));
+}
+
+void GongWebServer::handleClient() {
+  uint32_t nowMs = millis();
+  accept(nowMs);
+  for (size_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    if (_connections[i].fd >= 0) {
+      service(_connections[i], nowMs);
+    }
+  }
+}
+
+void GongWebServer::waitForActivity(uint32_t timeoutMs) {
+  fd_set readSet;
+  fd_set writeSet;
+  FD_ZERO(&readSet);
+  FD_ZERO(&writeSet);
+  int maxFd = -1;
+  uint32_t nowMs = millis();
+  uint32_t waitMs = timeoutMs;
+  bool idle = false;
+  for (size_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    const Connection &c = _connections[i];
+    if (c.fd < 0) {
+      continue;
+    }
+    uint32_t deadlineMs;
+    if (c.sending()) {
+      FD_SET(c.fd, &writeSet);
+      deadlineMs = c.lastProgressMs + HTTP_SEND_TIMEOUT_MS;
+    } else {
+      if (!c.peerClosed) {
+        FD_SET(c.fd, &readSet);
+      }
+      idle = idle || c.inLength == 0;
+      deadlineMs = c.inLength > 0 ? c.requestStartMs + HTTP_REQUEST_TIMEOUT_MS : c.lastActivityMs + HTTP_IDLE_TIMEOUT_MS;
+    }
+    int32_t leftMs = (int32_t)(deadlineMs - nowMs);
+    if (leftMs <= 0) {
+      waitMs = 0;
+    } else if ((uint32_t)leftMs < waitMs) {
+      waitMs = (uint32_t)leftMs;
+    }
+    if (c.fd > maxFd) {
+      maxFd = c.fd;
+    }
+  }
+  // Новый клиент ждёт в очереди, пока все соединения заняты запросами
+  if (_listenFd >= 0 && (_connectionCount < HTTP_MAX_CONNECTIONS || idle)) {
+    FD_SET(_listenFd, &readSet);
+    if (_listenFd > maxFd) {
+      maxFd = _listenFd;
+    }
+  }
+  if (maxFd < 0) {
+    delay(waitMs);
+    return;
+  }
+  struct timeval tv;
+  tv.tv_sec = waitMs / 1000;
+  tv.tv_usec = (waitMs % 1000) * 1000;
+  select(maxFd + 1, &readSet, &writeSet, NULL, &tv);
+}
+
+void GongWebServer::accept(uint32_t nowMs) {
+  while (_listenFd >= 0) {
+    if (_connectionCount == HTTP_MAX_CONNECTIONS) {
+      // Простаивающий keep-alive уступает место, только если кто-то ждёт
+      fd_set readSet;
+      FD_ZERO(&readSet);
+      FD_SET(_listenFd, &readSet);
+      struct timeval tv = {0, 0};
+      if (select(_listenFd + 1, &readSet, NULL, NULL, &tv) <= 0 || !evictIdle()) {
+        return;
+      }
+    }
+    int fd = ::accept(_listenFd, NULL, NULL);
+    if (fd < 0) {
+      return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    for (size_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+      Connection &c = _connections[i];
+      if (c.fd < 0) {
+        c.fd = fd;
+        c.lastActivityMs = nowMs;
+        c.lastProgressMs = nowMs;
+        break;
+      }
+    }
+    _connectionCount++;
+    _accepted++;
+  }
+}
+
+bool GongWebServer::evictIdle() {
+  Connection *oldest = nullptr;
+  for (size_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    Connection &c = _connections[i];
+    if (c.fd >= 0 && c.inLength == 0 && !c.sending() &&
+        (oldest == nullptr || (int32_t)(c.lastActivityMs - oldest->lastActivityMs) < 0)) {
+      oldest = &c;
+    }
+  }
+  if (oldest == nullptr) {
+    return false;
+  }
+  release(*oldest, true);
+  _evicted++;
+  return true;
+}
+
+void GongWebServer::service(Connection &c, uint32_t nowMs) {
+  if (!flush(c, nowMs)) {
+    return;
+  }
+  if (!c.sending() && !c.peerClosed && !receive(c, nowMs)) {
+    release(c, true);
+    return;
+  }
+  // Конвейер: следующий запрос — когда ответ на предыдущий ушёл целиком
+  while (!c.sending() && processRequest(c, nowMs)) {
+    if (c.fd < 0 || !flush(c, nowMs)) {
+      return;
+    }
+  }
+  if (c.sending()) {
+    if (nowMs - c.lastProgressMs > HTTP_SEND_TIMEOUT_MS) {
+      _timeouts++;
+      release(c, true);
+    }
+  } else if (c.peerClosed) {
+    // Клиент закрыл соединение; недописанный запрос уже не придёт
+    release(c, true);
+  } else if (c.inLength > 0) {
+    if (nowMs - c.requestStartMs > HTTP_REQUEST_TIMEOUT_MS) {
+      _timeouts++;
+      release(c, true);
+    }
+  } else if (nowMs - c.lastActivityMs > HTTP_IDLE_TIMEOUT_MS) {
+    release(c, true);
+  }
+}
+
+bool GongWebServer::receive(Connection &c, uint32_t nowMs) {
+  if (c.in == nullptr) {
+    c.in = inStatic(c);
+    c.inCapacity = HTTP_IN_STATIC;
+  }
+  for (;;) {
+    if (c.inLength == HTTP_REQUEST_MAX) {
+      return true; // разбор ответит 413 или 431
+    }
+    if (c.inLength + 1 == c.inCapacity) {
+      // Запрос больше буфера соединения: растёт в куче вдвое
+      size_t capacity = c.inCapacity * 2;
+      if (capacity > HTTP_REQUEST_MAX + 1) {
+        capacity = HTTP_REQUEST_MAX + 1;
+      }
+      bool fromStatic = c.in == inStatic(c);
+      char *grown = (char *)(fromStatic ? malloc(capacity) : realloc(c.in, capacity));
+      if (grown == nullptr) {
+        return false;
+      }
+      if (fromStatic) {
+        memcpy(grown, c.in, c.inLength);
+        _heapBuffers++;
+      }
+      c.in = grown;
+      c.inCapacity = capacity;
+    }
+    ssize_t count = recv(c.fd, c.in + c.inLength, c.inCapacity - 1 - c.inLength, MSG_DONTWAIT);
+    if (count == 0) {
+      c.peerClosed = true;
+      return true;
+    }
+    if (count < 0) {
+      return wouldBlock() || errno == EINTR;
+    }
+    if (c.inLength == 0) {
+      c.requestStartMs = nowMs;
+    }
+    c.inLength += (size_t)count;
+    c.lastActivityMs = nowMs;
+  }
+}
+
+bool GongWebServer::flush(Connection &c, uint32_t nowMs) {
+  if (!c.sending()) {
+    return true;
+  }
+  while (c.outSent < c.outLength || c.tailSent < c.tailLength) {
+    bool fromOut = c.outSent < c.outLength;
+    const char *data = fromOut ? c.out + c.outSent : c.tail + c.tailSent;
+    size_t length = fromOut ? c.outLength - c.outSent : c.tailLength - c.tailSent;
+    ssize_t sent = ::send(c.fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (wouldBlock()) {
+        return true;
+      }
+      release(c, true);
+      return false;
+    }
+    if (fromOut) {
+      c.outSent += (size_t)sent;
+    } else {
+      c.tailSent += (size_t)sent;
+    }
+    c.lastProgressMs = nowMs;
+  }
+  // Ответ ушёл: буфер освобождается до следующего
+  releaseOut(c);
+  c.tail = nullptr;
+  c.tailLength = 0;
+  c.tailSent = 0;
+  c.lastActivityMs = nowMs;
+  if (!c.keepAlive) {
+    release(c, true);
+    return false;
+  }
+  return true;
+}
+
+// Разбирает первый запрос в буфере и вызывает обработчик.
+// false — запрос пришёл не целиком.
+bool GongWebServer::processRequest(Connection &c, uint32_t nowMs) {
+  size_t searchLength = c.inLength < HTTP_HEAD_MAX ? c.inLength : HTTP_HEAD_MAX;
+  size_t headLength = findHeadEnd(c.in, searchLength);
+  if (headLength == 0) {
+    if (c.inLength >= HTTP_HEAD_MAX) {
+      reject(c, 431);
+      return true;
+    }
+    return false;
+  }
+
+  // Строка запроса: METHOD target HTTP/1.x
+  const char *line = c.in;
+  const char *lineEnd = (const char *)memchr(line, '\r', headLength);
+  const char *methodEnd = (const char *)memchr(line, ' ', lineEnd - line);
+  const char *targetEnd = methodEnd ? (const char *)memchr(methodEnd + 1, ' ', lineEnd - methodEnd - 1) : nullptr;
+  if (targetEnd == nullptr || targetEnd == methodEnd + 1 || lineEnd - targetEnd - 1 != 8 ||
+      strncmp(targetEnd + 1, "HTTP/1.", 7) != 0) {
+    reject(c, 400);
+    return true;
+  }
+  HTTPMethod method = parseMethod(line, methodEnd - line);
+  bool keepAlive = targetEnd[8] == '1';
+
+  size_t contentLength = 0;
+  bool formBody = false;
+  bool expectContinue = false;
+  // Нули в буфер — только когда запрос пришёл целиком: до того его
+  // разбирают заново при каждом приходе байтов
+  _arena.reset();
+  _argCount = 0;
+  _argCapacity = 0;
+  _headerCount = 0;
+  _headers = _arena.allocArray<Arg>(_collect.size());
+  const char *end = c.in + headLength - 2;
+  for (const char *p = lineEnd + 2; p < end;) {
+    const char *next = (const char *)memchr(p, '\r', end - p);
+    if (next == nullptr) {
+      break;
+    }
+    const char *colon = (const char *)memchr(p, ':', next - p);
+    if (colon != nullptr) {
+      const char *value = colon + 1;
+      while (value < next && (*value == ' ' || *value == '\t')) {
+        value++;
+      }
+      const char *valueEnd = next;
+      while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+        valueEnd--;
+      }
+      size_t nameLength = colon - p;
+      size_t valueLength = valueEnd - value;
+      if (tokenIs(p, nameLength, "Content-Length")) {
+        char *digitsEnd;
+        unsigned long parsed = strtoul(value, &digitsEnd, 10);
+        if (digitsEnd != valueEnd || valueLength == 0) {
+          reject(c, 400);
+          return true;
+        }
+        contentLength = parsed;
+      } else if (tokenIs(p, nameLength, "Transfer-Encoding")) {
+        // Тело без длины (chunked) не принимается
+        reject(c, 411);
+        return true;
+      } else if (tokenIs(p, nameLength, "Connection")) {
+        if (listContains(value, valueLength, "close")) {
+          keepAlive = false;
+        } else if (listContains(value, valueLength, "keep-alive")) {
+          keepAlive = true;
+        }
+      } else if (tokenIs(p, nameLength, "Content-Type")) {
+        formBody = listContains(value, valueLength, "application/x-www-form-urlencoded");
+      } else if (tokenIs(p, nameLength, "Expect")) {
+        expectContinue = listContains(value, valueLength, "100-continue");
+      }
+      for (const String &key : _collect) {
+        if (_headers != nullptr && _headerCount < _collect.size() && tokenIs(p, nameLength, key.c_str())) {
+          _headers[_headerCount++] = {StrView(key.c_str(), key.length()), StrView(value, valueLength)};
+          break;
+        }
+      }
+    }
+    p = next + 2;
+  }
+
+  if (contentLength > HTTP_REQUEST_MAX - headLength) {
+    reject(c, 413);
+    return true;
+  }
+  if (c.inLength < headLength + contentLength) {
+    // curl и другие клиенты ждут «100 Continue» перед телом
+    if (expectContinue && !c.continueSent) {
+      static const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+      appendOut(c, kContinue, sizeof(kContinue) - 1);
+      c.continueSent = true;
+    }
+    return false;
+  }
+
+  // Запрос целиком: виды заголовков, пути и аргументов получают нули
+  // в конце прямо в буфере приёма
+  for (size_t i = 0; i < _headerCount; i++) {
+    ((char *)_headers[i].value.data)[_headers[i].value.length] = '\0';
+  }
+  char *target = (char *)methodEnd + 1;
+  char *query = (char *)memchr(target, '?', targetEnd - target);
+  char *body = c.in + headLength;
+  // Запасной байт после тела или первый байт следующего запроса
+  // конвейера: возвращается после обработчика
+  char afterBody = body[contentLength];
+  body[contentLength] = '\0';
+  size_t argCount = query != nullptr ? countArguments(query + 1, targetEnd - query - 1) : 0;
+  if (contentLength > 0) {
+    argCount += formBody ? countArguments(body, contentLength) : 1;
+  }
+  if (!reserveArgs(argCount)) {
+    reject(c, 431);
+    return true;
+  }
+  _currentMethod = method;
+  urlDecodeInPlace(target, (query ? query : targetEnd) - target);
+  // Присваивание в String из Arduino переиспользует его буфер
+  _currentUri = target;
+  _pathArgs.clear();
+  if (query != nullptr) {
+    parseArguments(query + 1, targetEnd - query - 1);
+  }
+  if (contentLength > 0) {
+    if (formBody) {
+      parseArguments(body, contentLength);
+    } else {
+      _args[_argCount++] = {StrView("plain", 5), StrView(body, contentLength)};
+    }
+  }
+  c.keepAlive = keepAlive;
+  c.continueSent = false;
+
+  _current = &c;
+  dispatch();
+  _requests++;
+  _arena.reset();
+  _argCount = 0;
+  _headerCount = 0;
+  if (_current == nullptr) {
+    return true; // соединение забрал обработчик
+  }
+  _current = nullptr;
+  body[contentLength] = afterBody;
+  consume(c, headLength + contentLength);
+  c.lastActivityMs = nowMs;
+  c.lastProgressMs = nowMs;
+  c.requestStartMs = nowMs;
+  return true;
+}
+
+void GongWebServer::dispatch() {
+  _responseHeadersLength = 0;
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  _chunked = false;
+  _headSent = false;
+  bool handled = false;
+  for (Route &route : _routes) {
+    // HEAD обслуживается маршрутом GET, тело не отправляется
+    bool head = _currentMethod == HTTP_HEAD && route.method == HTTP_GET;
+    if (route.method != HTTP_ANY && route.method != _currentMethod && !head) {
+      continue;
+    }
+    if (route.uri->canHandle(_currentUri, _pathArgs)) {
+      route.handler();
+      handled = true;
+      break;
+    }
+  }
+  if (!handled) {
+    if (_notFound) {
+      _notFound();
+    } else {
+      send(404, "text/plain", String("Not found: ") + _currentUri);
+    }
+  }
+  if (_current == nullptr) {
+    return;
+  }
+  if (!_headSent) {
+    send(500, "text/plain", "Handler did not send");
+  }
+  if (_chunked) {
+    sendContent("", 0);
+  }
+}
+
+// Ответ без обработчика; соединение закрывается, непрочитанное отбрасывается
+void GongWebServer::reject(Connection &c, int code) {
+  _rejected++;
+  c.keepAlive = false;
+  c.inLength = 0;
+  releaseIn(c);
+  char head[96];
+  int length = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+                        code, reasonPhrase(code));
+  c.outLength = 0;
+  c.outSent = 0;
+  appendOut(c, head, (size_t)length);
+}
+
+void GongWebServer::consume(Connection &c, size_t length) {
+  c.inLength -= length;
+  if (c.inLength > 0) {
+    memmove(c.in, c.in + length, c.inLength);
+    return;
+  }
+  // Между запросами keep-alive соединение не держит буфер в куче
+  releaseIn(c);
+}
+
+void GongWebServer::releaseIn(Connection &c) {
+  if (c.in != inStatic(c)) {
+    free(c.in);
+  }
+  c.in = nullptr;
+  c.inCapacity = 0;
+}
+
+void GongWebServer::releaseOut(Connection &c) {
+  if (c.out != outStatic(c)) {
+    free(c.out);
+  }
+  c.out = nullptr;
+  c.outLength = 0;
+  c.outCapacity = 0;
+  c.outSent = 0;
+}
+
+// Ответ дописывается в буфер соединения; не хватило — растёт в куче
+// вдвое. Без памяти ответ обрывается вместе с соединением.
+void GongWebServer::appendOut(Connection &c, const char *data, size_t length) {
+  if (c.out == nullptr) {
+    c.out = outStatic(c);
+    c.outCapacity = HTTP_OUT_STATIC;
+  }
+  if (length > c.outCapacity - c.outLength) {
+    drainOut(c);
+  }
+  if (length > c.outCapacity - c.outLength) {
+    size_t capacity = c.outCapacity * 2;
+    while (capacity - c.outLength < length) {
+      capacity *= 2;
+    }
+    bool fromStatic = c.out == outStatic(c);
+    char *grown = (char *)(fromStatic ? malloc(capacity) : realloc(c.out, capacity));
+    if (grown == nullptr) {
+      c.keepAlive = false;
+      return;
+    }
+    if (fromStatic) {
+      memcpy(grown, c.out, c.outLength);
+      _heapBuffers++;
+    }
+    c.out = grown;
+    c.outCapacity = capacity;
+  }
+  memcpy(c.out + c.outLength, data, length);
+  c.outLength += length;
+}
+
+// Буфер ответа полон посреди обработчика (чанки большого JSON):
+// отдаём сокету сколько возьмёт и сдвигаем остаток к началу — тогда
+// ответ часто укладывается в статический буфер без кучи. Ошибки сокета
+// разберёт flush().
+void GongWebServer::drainOut(Connection &c) {
+  if (c.tailLength > 0) {
+    return;
+  }
+  while (c.outSent < c.outLength) {
+    ssize_t sent = ::send(c.fd, c.out + c.outSent, c.outLength - c.outSent, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      break;
+    }
+    c.outSent += (size_t)sent;
+  }
+  memmove(c.out, c.out + c.outSent, c.outLength - c.outSent);
+  c.outLength -= c.outSent;
+  c.outSent = 0;
+}
+
+void GongWebServer::release(Connection &c, bool closeSocket) {
+  if (closeSocket) {
+    ::close(c.fd);
+  }
+  releaseIn(c);
+  releaseOut(c);
+  c = Connection();
+  _connectionCount--;
+}
+
+WiFiClient GongWebServer::detachClient() {
+  if (_current == nullptr) {
+    return WiFiClient();
+  }
+  WiFiClient client(_current->fd);
+  release(*_current, false);
+  _current = nullptr;
+  return client;
+}
+
+size_t GongWebServer::countArguments(const char *data, size_t length) {
+  size_t count = 0;
+  size_t pos = 0;
+  while (pos < length) {
+    const char *end = (const char *)memchr(data + pos, '&', length - pos);
+    size_t pairLength = end ? (size_t)(end - data - pos) : length - pos;
+    if (pairLength > 0) {
+      count++;
+    }
+    pos += pairLength + 1;
+  }
+  return count;
+}
+
+bool GongWebServer::reserveArgs(size_t count) {
+  _argCount = 0;
+  _argCapacity = 0;
+  _args = count > 0 ? _arena.allocArray<Arg>(count) : nullptr;
+  if (count > 0 && _args == nullptr) {
+    return false;
+  }
+  _argCapacity = count;
+  return true;
+}
+
+void GongWebServer::parseArguments(char *data, size_t length) {
+  size_t pos = 0;
+  while (pos < length && _argCount < _argCapacity) {
+    char *pair = data + pos;
+    char *end = (char *)memchr(pair, '&', length - pos);
+    size_t pairLength = end ? (size_t)(end - pair) : length - pos;
+    if (pairLength > 0) {
+      char *equals = (char *)memchr(pair, '=', pairLength);
+      Arg &arg = _args[_argCount++];
+      if (equals == nullptr) {
+        arg.name = StrView(pair, urlDecodeInPlace(pair, pairLength));
+        arg.value = StrView();
+      } else {
+        char *value = equals + 1;
+        size_t valueLength = pair + pairLength - value;
+        arg.name = StrView(pair, urlDecodeInPlace(pair, equals - pair));
+        arg.value = StrView(value, urlDecodeInPlace(value, valueLength));
+      }
+    }
+    pos += pairLength + 1;
+  }
+}
+
+StrView GongWebServer::arg(const char *name) const {
+  for (size_t i = 0; i < _argCount; i++) {
+    if (_args[i].name.equals(name)) {
+      return _args[i].value;
+    }
+  }
+  return StrView();
+}
+
+StrView GongWebServer::arg(int index) const {
+  return index >= 0 && (size_t)index < _argCount ? _args[index].value : StrView();
+}
+
+StrView GongWebServer::argName(int index) const {
+  return index >= 0 && (size_t)index < _argCount ? _args[index].name : StrView();
+}
+
+bool GongWebServer::hasArg(const char *name) const {
+  for (size_t i = 0; i < _argCount; i++) {
+    if (_args[i].name.equals(name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+String GongWebServer::pathArg(unsigned int index) const {
+  return index < _pathArgs.size() ? _pathArgs[index] : String();
+}
+
+void GongWebServer::collectHeaders(const char *headerKeys[], size_t count) {
+  _collect.clear();
+  for (size_t i = 0; i < count; i++) {
+    _collect.push_back(String(headerKeys[i]));
+  }
+}
+
+StrView GongWebServer::header(const char *name) const {
+  for (size_t i = 0; i < _headerCount; i++) {
+    if (strcasecmp(_headers[i].name.c_str(), name) == 0) {
+      return _headers[i].value;
+    }
+  }
+  return StrView();
+}
+
+bool GongWebServer::hasHeader(const char *name) const {
+  for (size_t i = 0; i < _headerCount; i++) {
+    if (strcasecmp(_headers[i].name.c_str(), name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void GongWebServer::sendHeader(const char *name, const char *value, bool first) {
+  size_t nameLength = strlen(name);
+  size_t valueLength = strlen(value);
+  size_t length = nameLength + valueLength + 4;
+  if (length > sizeof(_responseHeaders) - _responseHeadersLength) {
+    return;
+  }
+  char *line = _responseHeaders + _responseHeadersLength;
+  if (first) {
+    memmove(_responseHeaders + length, _responseHeaders, _responseHeadersLength);
+    line = _responseHeaders;
+  }
+  memcpy(line, name, nameLength);
+  memcpy(line + nameLength, ": ", 2);
+  memcpy(line + nameLength + 2, value, valueLength);
+  memcpy(line + nameLength + 2 + valueLength, "\r\n", 2);
+  _responseHeadersLength += length;
+}
+
+void GongWebServer::append(const char *data, size_t length) {
+  if (_current != nullptr) {
+    appendOut(*_current, data, length);
+  }
+}
+
+void GongWebServer::writeHead(int code, const char *contentType, size_t contentLength) {
+  char line[64];
+  append(line, snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", code, reasonPhrase(code)));
+  if (contentType && *contentType) {
+    append("Content-Type: ");
+    append(contentType);
+    append("\r\n", 2);
+  }
+  if (contentLength == CONTENT_LENGTH_UNKNOWN) {
+    append("Transfer-Encoding: chunked\r\n");
+    _chunked = true;
+  } else {
+    append(line, snprintf(line, sizeof(line), "Content-Length: %lu\r\n", (unsigned long)contentLength));
+  }
+  append(_responseHeaders, _responseHeadersLength);
+  append(_current != nullptr && _current->keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+  _responseHeadersLength = 0;
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  _headSent = true;
+}
+
+void GongWebServer::send(int code, const char *contentType, const char *content) {
+  send(code, contentType, content, strlen(content));
+}
+
+void GongWebServer::send(int code, const char *contentType, const char *content, size_t length) {
+  size_t contentLength = _contentLength == CONTENT_LENGTH_NOT_SET ? length : _contentLength;
+  writeHead(code, contentType, contentLength);
+  if (_currentMethod != HTTP_HEAD && length > 0) {
+    sendContent(content, length);
+  }
+}
+
+void GongWebServer::send_P(int code, PGM_P contentType, PGM_P content, size_t length) {
+  writeHead(code, contentType, length);
+  if (_current != nullptr && _currentMethod != HTTP_HEAD) {
+    _current->tail = content;
+    _current->tailLength = length;
+    _current->tailSent = 0;
+  }
+}
+
+void GongWebServer::sendContent(const char *content, size_t length) {
+  if (_currentMethod == HTTP_HEAD) {
+    return;
+  }
+  if (!_chunked) {
+    append(content, length);
+    return;
+  }
+  char size[16];
+  int sizeLength = snprintf(size, sizeof(size), "%x\r\n", (unsigned)length);
+  append(size, sizeLength);
+  if (length == 0) {
+    append("\r\n", 2);
+    _chunked = false;
+    return;
+  }
+  append(content, length);
+  append("\r\n", 2);
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <uri/Uri.h>
+
+#include "request_arena.h"
+#include "str_view.h"
+
+// HTTP-сервер на неблокирующих сокетах (lwIP на плате, POSIX под Linux)
+// с тем же API маршрутов, что у WebServer из Arduino-ESP32. Один проход
+// handleClient() обслуживает все соединения: принимает новые, дочитывает
+// запросы, вызывает обработчики и дописывает ответы столько, сколько
+// берёт сокет, — медленный клиент не задерживает остальных.
+// HTTP/1.1 keep-alive и конвейер запросов: следующий запрос соединения
+// разбирается, когда ответ на предыдущий ушёл целиком. Обработчики
+// выполняются по одному в задаче сервера и пишут ответ в буфер соединения.
+//
+// Обработка запроса не трогает кучу, пока запрос и ответ помещаются в
+// буферы соединения внутри сервера: аргументы и заголовки — виды в
+// буфер приёма (URL-декодирование на месте), их массивы и временные
+// данные обработчиков — в арене запроса, которая сбрасывается, как
+// только ответ записан. Большие запросы и ответы растут в куче и
+// освобождают её, когда обработаны.
+
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS    6
+#endif
+// Строка запроса и заголовки; длиннее — 431
+#define HTTP_HEAD_MAX           2048
+// Запрос целиком с телом (POST /api/alarms/sync на 256 будильников); больше — 413
+#define HTTP_REQUEST_MAX        24576
+// Запрос должен прийти целиком за это время с первого байта
+#define HTTP_REQUEST_TIMEOUT_MS 5000
+// Соединение keep-alive без запросов закрывается
+#define HTTP_IDLE_TIMEOUT_MS    15000
+// Ответ, который клиент не забирает столько времени, обрывается
+#define HTTP_SEND_TIMEOUT_MS    5000
+// Буферы приёма и ответа каждого соединения внутри сервера
+#define HTTP_IN_STATIC          1024
+#define HTTP_OUT_STATIC         1024
+// Арена запроса: массивы аргументов и заголовков, ответы JSON
+#ifndef HTTP_ARENA_SIZE
+#define HTTP_ARENA_SIZE         2048
+#endif
+// Заголовки ответа от sendHeader(); не поместившиеся отбрасываются
+#define HTTP_RESPONSE_HEADERS_MAX 384
+
+#define CONTENT_LENGTH_UNKNOWN  ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET  ((size_t)-2)
+
+enum HTTPMethod : uint8_t {
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_HEAD,
+  HTTP_POST,
+  HTTP_PUT,
+  HTTP_PATCH,
+  HTTP_DELETE,
+  HTTP_OPTIONS,
+};
+
+class GongWebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  // Порт можно переопределить переменной окружения GONG_HTTP_PORT
+  // (есть только в сборке для Linux)
+  explicit GongWebServer(uint16_t port);
+  ~GongWebServer();
+
+  bool begin();
+  void close();
+
+  // Один проход без ожидания по всем соединениям
+  void handleClient();
+  // Блокируется до готовности любого сокета или ближайшего таймаута
+  // соединения, но не дольше timeoutMs
+  void waitForActivity(uint32_t timeoutMs);
+
+  void on(const Uri &uri, HTTPMethod method, THandlerFunction handler);
+  void on(const Uri &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void onNotFound(THandlerFunction handler) { _notFound = handler; }
+
+  // Текущий запрос — только из обработчика
+  const String &uri() const { return _currentUri; }
+  HTTPMethod method() const { return _currentMethod; }
+  // Аргументы и заголовки — виды в буфер приёма, до конца обработчика.
+  // "plain" — тело запроса, если оно не application/x-www-form-urlencoded
+  StrView arg(const char *name) const;
+  StrView arg(int index) const;
+  StrView argName(int index) const;
+  int args() const { return (int)_argCount; }
+  bool hasArg(const char *name) const;
+  String pathArg(unsigned int index) const;
+  // Сохраняются только перечисленные здесь заголовки
+  void collectHeaders(const char *headerKeys[], size_t count);
+  StrView header(const char *name) const;
+  bool hasHeader(const char *name) const;
+  // Память обработчика на время запроса
+  RequestArena &arena() { return _arena; }
+
+  void send(int code, const char *contentType = nullptr, const char *content = "");
+  void send(int code, const char *contentType, const String &content) { send(code, contentType, content.c_str(), content.length()); }
+  void send(int code, const char *contentType, const char *content, size_t length);
+  // Содержимое во flash не копируется в буфер соединения
+  void send_P(int code, PGM_P contentType, PGM_P content, size_t length);
+  void sendHeader(const char *name, const char *value, bool first = false);
+  void setContentLength(size_t length) { _contentLength = length; }
+  // При CONTENT_LENGTH_UNKNOWN — фрагменты chunked; пустой завершает ответ
+  void sendContent(const String &content) { sendContent(content.c_str(), content.length()); }
+  void sendContent(const char *content, size_t length);
+
+  // Забирает соединение текущего запроса: сервер его больше не читает
+  // и не закрывает. Ответ обработчик пишет в соединение сам.
+  WiFiClient detachClient();
+
+  // Порт после begin(): для port == 0 — выданный системой
+  uint16_t port() const { return _port; }
+  size_t connections() const { return _connectionCount; }
+  uint32_t acceptedCount() const { return _accepted; }
+  uint32_t requestCount() const { return _requests; }
+  // Закрыты по таймауту запроса или отправки
+  uint32_t timeoutCount() const { return _timeouts; }
+  // Ответы 400/413/431 с закрытием соединения
+  uint32_t rejectedCount() const { return _rejected; }
+  // Простаивающие keep-alive, закрытые ради нового клиента
+  uint32_t evictedCount() const { return _evicted; }
+  // Запросы и ответы, выросшие из буферов соединения в кучу
+  uint32_t heapBufferCount() const { return _heapBuffers; }
+
+protected:
+  struct Arg {
+    StrView name;
+    StrView value;
+  };
+
+  // Число пар name=value в строке аргументов
+  static size_t countArguments(const char *data, size_t length);
+  // Массив аргументов запроса в арене; false — не поместился
+  bool reserveArgs(size_t count);
+  // Декодирует пары на месте и добавляет их виды в _args
+  void parseArguments(char *data, size_t length);
+
+  alignas(8) char _arenaBuffer[HTTP_ARENA_SIZE];
+  RequestArena _arena;
+  Arg *_args = nullptr;
+  size_t _argCount = 0;
+  size_t _argCapacity = 0;
+
+private:
+  struct Connection {
+    int fd = -1;
+    // Принятые байты: текущий запрос и следующие за ним (конвейер).
+    // Буфер — в _inStatic или в куче, если запрос больше; последний
+    // байт всегда свободен под ноль после тела.
+    char *in = nullptr;
+    size_t inLength = 0;
+    size_t inCapacity = 0;
+    // Ответ: сначала out (в _outStatic или в куче), затем содержимое из flash
+    char *out = nullptr;
+    size_t outLength = 0;
+    size_t outCapacity = 0;
+    size_t outSent = 0;
+    const char *tail = nullptr;
+    size_t tailLength = 0;
+    size_t tailSent = 0;
+    bool keepAlive = true;
+    bool peerClosed = false;
+    bool continueSent = false;
+    uint32_t lastActivityMs = 0;
+    uint32_t requestStartMs = 0;
+    uint32_t lastProgressMs = 0;
+
+    bool sending() const { return outSent < outLength || tailSent < tailLength; }
+  };
+  struct Route {
+    std::unique_ptr<Uri> uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+  };
+
+  void accept(uint32_t nowMs);
+  bool evictIdle();
+  void service(Connection &c, uint32_t nowMs);
+  bool receive(Connection &c, uint32_t nowMs);
+  bool flush(Connection &c, uint32_t nowMs);
+  bool processRequest(Connection &c, uint32_t nowMs);
+  void dispatch();
+  void reject(Connection &c, int code);
+  void consume(Connection &c, size_t length);
+  void release(Connection &c, bool closeSocket);
+  char *inStatic(const Connection &c) { return _inStatic[&c - _connections]; }
+  char *outStatic(const Connection &c) { return _outStatic[&c - _connections]; }
+  void appendOut(Connection &c, const char *data, size_t length);
+  void drainOut(Connection &c);
+  void releaseIn(Connection &c);
+  void releaseOut(Connection &c);
+  void writeHead(int code, const char *contentType, size_t contentLength);
+  void append(const char *data, size_t length);
+  void append(const char *text) { append(text, strlen(text)); }
+
+  uint16_t _port;
+  int _listenFd = -1;
+  Connection _connections[HTTP_MAX_CONNECTIONS];
+  size_t _connectionCount = 0;
+  char _inStatic[HTTP_MAX_CONNECTIONS][HTTP_IN_STATIC];
+  char _outStatic[HTTP_MAX_CONNECTIONS][HTTP_OUT_STATIC];
+
+  // Текущий запрос
+  Connection *_current = nullptr;
+  HTTPMethod _currentMethod = HTTP_ANY;
+  String _currentUri;
+  std::vector<String> _pathArgs;
+  Arg *_headers = nullptr;
+  size_t _headerCount = 0;
+  std::vector<String> _collect;
+  char _responseHeaders[HTTP_RESPONSE_HEADERS_MAX];
+  size_t _responseHeadersLength = 0;
+  size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+  bool _chunked = false;
+  bool _headSent = false;
+
+  std::vector<Route> _routes;
+  THandlerFunction _notFound;
+
+  uint32_t _accepted = 0;
+  uint32_t _requests = 0;
+  uint32_t _timeouts = 0;
+  uint32_t _rejected = 0;
+  uint32_t _evicted = 0;
+  uint32_t _heapBuffers = 0;
+};
@@ -0,0 +1,129 @@
+#include "group_trigger.h"
+
+#include <string.h>
+
+#include "sha256.h"
+
+static void put32(uint8_t *p, uint32_t value) {
+  p[0] = (uint8_t)(value >> 24);
+  p[1] = (uint8_t)(value >> 16);
+  p[2] = (uint8_t)(value >> 8);
+  p[3] = (uint8_t)value;
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void encodeGroupTrigger(const GroupTrigger &trigger, const uint8_t *key, size_t keyLength,
+                        uint8_t out[GROUP_TRIGGER_PACKET_SIZE]) {
+  put32(out, GROUP_TRIGGER_MAGIC);
+  out[4] = GROUP_TRIGGER_VERSION;
+  out[5] = (uint8_t)trigger.op;
+  out[6] = (uint8_t)(trigger.track >> 8);
+  out[7] = (uint8_t)trigger.track;
+  put32(out + 8, trigger.sender);
+  put32(out + 12, trigger.sequence);
+  put32(out + 16, (uint32_t)((uint64_t)trigger.fireAtUs >> 32));
+  put32(out + 20, (uint32_t)trigger.fireAtUs);
+  uint8_t mac[SHA256_SIZE];
+  hmacSha256(key, keyLength, out, GROUP_TRIGGER_SIGNED_SIZE, mac);
+  memcpy(out + GROUP_TRIGGER_SIGNED_SIZE, mac, GROUP_TRIGGER_MAC_SIZE);
+}
+
+bool decodeGroupTrigger(const uint8_t *data, size_t length, const uint8_t *key, size_t keyLength,
+                        GroupTrigger &trigger) {
+  if (length != GROUP_TRIGGER_PACKET_SIZE || get32(data) != GROUP_TRIGGER_MAGIC ||
+      data[4] != GROUP_TRIGGER_VERSION) {
+    return false;
+  }
+  uint8_t mac[SHA256_SIZE];
+  hmacSha256(key, keyLength, data, GROUP_TRIGGER_SIGNED_SIZE, mac);
+  if (!constantTimeEqual(mac, data + GROUP_TRIGGER_SIGNED_SIZE, GROUP_TRIGGER_MAC_SIZE)) {
+    return false;
+  }
+  if (data[5] != (uint8_t)GroupTriggerOp::Play && data[5] != (uint8_t)GroupTriggerOp::Stop) {
+    return false;
+  }
+  trigger.op = (GroupTriggerOp)data[5];
+  trigger.track = (uint16_t)((data[6] << 8) | data[7]);
+  trigger.sender = get32(data + 8);
+  trigger.sequence = get32(data + 12);
+  trigger.fireAtUs = (int64_t)(((uint64_t)get32(data + 16) << 32) | get32(data + 20));
+  return true;
+}
+
+const char *groupTriggerResultName(GroupTriggerResult result) {
+  switch (result) {
+    case GroupTriggerResult::Scheduled: return "scheduled";
+    case GroupTriggerResult::Late:      return "late";
+    case GroupTriggerResult::Duplicate: return "duplicate";
+    case GroupTriggerResult::Expired:   return "expired";
+    case GroupTriggerResult::TooFar:    return "too_far";
+    case GroupTriggerResult::Full:      return "full";
+    case GroupTriggerResult::Unsynced:  return "unsynced";
+    default:                            return "unknown";
+  }
+}
+
+bool GroupTriggerSchedule::seen(uint32_t sender, uint32_t sequence) const {
+  for (size_t i = 0; i < _seenCount; i++) {
+    if (_seen[i].sender == sender && _seen[i].sequence == sequence) {
+      return true;
+    }
+  }
+  return false;
+}
+
+GroupTriggerResult GroupTriggerSchedule::accept(const GroupTrigger &trigger, int64_t nowUs, int64_t lateGraceUs,
+                                                int64_t horizonUs) {
+  GroupTriggerResult result;
+  if (nowUs < 0) {
+    _counts[(size_t)GroupTriggerResult::Unsynced].fetch_add(1, std::memory_order_relaxed);
+    return GroupTriggerResult::Unsynced;
+  }
+  if (seen(trigger.sender, trigger.sequence)) {
+    result = GroupTriggerResult::Duplicate;
+  } else if (trigger.fireAtUs < nowUs - lateGraceUs) {
+    result = GroupTriggerResult::Expired;
+  } else if (trigger.fireAtUs > nowUs + horizonUs) {
+    result = GroupTriggerResult::TooFar;
+  } else if (_pendingCount == kPending) {
+    result = GroupTriggerResult::Full;
+  } else {
+    result = trigger.fireAtUs <= nowUs ? GroupTriggerResult::Late : GroupTriggerResult::Scheduled;
+    // По возрастанию момента: popDue и nextAtUs смотрят в начало
+    size_t at = _pendingCount;
+    while (at > 0 && _pending[at - 1].fireAtUs > trigger.fireAtUs) {
+      _pending[at] = _pending[at - 1];
+      at--;
+    }
+    _pending[at] = trigger;
+    _pendingCount++;
+  }
+  // Копии пакета, пришедшие позже, отсекаются и после Expired/TooFar
+  if (result != GroupTriggerResult::Duplicate) {
+    _seen[_seenNext].sender = trigger.sender;
+    _seen[_seenNext].sequence = trigger.sequence;
+    _seenNext = (_seenNext + 1) % kSeen;
+    if (_seenCount < kSeen) {
+      _seenCount++;
+    }
+  }
+  _counts[(size_t)result].fetch_add(1, std::memory_order_relaxed);
+  return result;
+}
+
+bool GroupTriggerSchedule::popDue(int64_t nowUs, GroupTrigger &trigger) {
+  if (_pendingCount == 0 || _pending[0].fireAtUs > nowUs) {
+    return false;
+  }
+  trigger = _pending[0];
+  _pendingCount--;
+  memmove(_pending, _pending + 1, _pendingCount * sizeof(GroupTrigger));
+  return true;
+}
+
+int64_t GroupTriggerSchedule::nextAtUs() const {
+  return _pendingCount > 0 ? _pending[0].fireAtUs : -1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Групповой удар: один подписанный UDP-пакет на multicast-группу
+// «сыграть трек N в момент T (UTC)». Каждое устройство ставит удар
+// на свой синхронизированный таймер, поэтому разброс между устройствами
+// определяется точностью часов, а не доставкой пакета.
+//
+// Пакет (big-endian), 40 байт:
+//   0  magic "GONG"      8  sender (случайный id отправителя)
+//   4  version = 1      12  sequence (растёт у отправителя)
+//   5  op               16  fireAtUs (UTC, мкс от 1970-01-01)
+//   6  track            24  HMAC-SHA256(key, байты 0..23), первые 16 байт
+// Отправитель шлёт пакет несколько раз; копии отсекаются по (sender, sequence).
+
+#define GROUP_TRIGGER_MAGIC       0x474F4E47 // "GONG"
+#define GROUP_TRIGGER_VERSION     1
+#define GROUP_TRIGGER_SIGNED_SIZE 24
+#define GROUP_TRIGGER_MAC_SIZE    16
+#define GROUP_TRIGGER_PACKET_SIZE (GROUP_TRIGGER_SIGNED_SIZE + GROUP_TRIGGER_MAC_SIZE)
+
+enum class GroupTriggerOp : uint8_t {
+  Play = 1,  // трек track
+  Stop = 2,
+};
+
+struct GroupTrigger {
+  GroupTriggerOp op;
+  uint16_t track;
+  uint32_t sender;
+  uint32_t sequence;
+  int64_t fireAtUs;
+};
+
+void encodeGroupTrigger(const GroupTrigger &trigger, const uint8_t *key, size_t keyLength,
+                        uint8_t out[GROUP_TRIGGER_PACKET_SIZE]);
+// false — не наш пакет, чужая версия или подпись не сошлась
+bool decodeGroupTrigger(const uint8_t *data, size_t length, const uint8_t *key, size_t keyLength,
+                        GroupTrigger &trigger);
+
+enum class GroupTriggerResult : uint8_t {
+  Scheduled,  // поставлен на свой момент
+  Late,       // момент прошёл недавно — играется сразу
+  Duplicate,  // копия уже принятого пакета
+  Expired,    // опоздал больше допуска — не играется
+  TooFar,     // момент дальше горизонта планирования
+  Full,       // все слоты ожидания заняты
+  Unsynced,   // время устройства неизвестно
+  Count
+};
+
+const char *groupTriggerResultName(GroupTriggerResult result);
+
+// Ожидающие удары и недавно принятые пакеты. Не потокобезопасен:
+// расписанием владеет одна задача; счётчики читаются из любых.
+class GroupTriggerSchedule {
+public:
+  static const size_t kPending = 4;
+  static const size_t kSeen = 16;
+
+  // nowUs — текущее UTC или -1, пока время неизвестно
+  GroupTriggerResult accept(const GroupTrigger &trigger, int64_t nowUs, int64_t lateGraceUs, int64_t horizonUs);
+  // Удар, момент которого наступил к nowUs; false — таких нет
+  bool popDue(int64_t nowUs, GroupTrigger &trigger);
+  // Ближайший момент или -1
+  int64_t nextAtUs() const;
+
+  uint32_t count(GroupTriggerResult result) const {
+    return _counts[(size_t)result].load(std::memory_order_relaxed);
+  }
+
+private:
+  bool seen(uint32_t sender, uint32_t sequence) const;
+
+  GroupTrigger _pending[kPending];
+  size_t _pendingCount = 0;
+  struct Seen {
+    uint32_t sender;
+    uint32_t sequence;
+  };
+  Seen _seen[kSeen] = {};
+  size_t _seenCount = 0;
+  size_t _seenNext = 0;
+  std::atomic<uint32_t> _counts[(size_t)GroupTriggerResult::Count] = {};
+};
@@ -0,0 +1,144 @@
+#include "json_writer.h"
+
+#include <string.h>
+
+// Десятичные цифры magnitude вплотную перед end; возвращает начало
+static char *formatDigits(uint64_t magnitude, char *end) {
+  do {
+    *--end = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  return end;
+}
+
+static uint64_t magnitudeOf(int64_t value) {
+  return value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+}
+
+// Ключи — литералы из кода, экранирование им не нужно
+void JsonWriter::separator(const char *key) {
+  uint32_t bit = 1UL << (_depth & 31);
+  bool comma = _depth > 0 && (_hasItems & bit);
+  _hasItems |= bit;
+  if (key == nullptr) {
+    if (comma) {
+      _out.raw(",", 1);
+    }
+    return;
+  }
+  _out.raw(comma ? ",\"" : "\"", comma ? 2 : 1);
+  _out.raw(key, strlen(key));
+  _out.raw("\":", 2);
+}
+
+// Кавычки, обратная косая и управляющие символы; остальное (и UTF-8)
+// уходит кусками как есть
+void JsonWriter::escaped(const char *text, size_t length) {
+  static const char kHex[] = "0123456789abcdef";
+  size_t start = 0;
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = (unsigned char)text[i];
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    _out.raw(text + start, i - start);
+    start = i + 1;
+    switch (c) {
+      case '"':  _out.raw("\\\"", 2); break;
+      case '\\': _out.raw("\\\\", 2); break;
+      case '\n': _out.raw("\\n", 2); break;
+      case '\r': _out.raw("\\r", 2); break;
+      case '\t': _out.raw("\\t", 2); break;
+      default: {
+        char code[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+        _out.raw(code, sizeof(code));
+        break;
+      }
+    }
+  }
+  _out.raw(text + start, length - start);
+}
+
+void JsonWriter::beginObject(const char *key) {
+  separator(key);
+  _out.raw("{", 1);
+  _depth++;
+  _hasItems &= ~(1UL << (_depth & 31));
+}
+
+void JsonWriter::endObject() {
+  _depth--;
+  _out.raw("}", 1);
+}
+
+void JsonWriter::beginArray(const char *key) {
+  separator(key);
+  _out.raw("[", 1);
+  _depth++;
+  _hasItems &= ~(1UL << (_depth & 31));
+}
+
+void JsonWriter::endArray() {
+  _depth--;
+  _out.raw("]", 1);
+}
+
+void JsonWriter::string(const char *key, const char *text) {
+  string(key, text, strlen(text));
+}
+
+void JsonWriter::string(const char *key, const char *text, size_t length) {
+  separator(key);
+  _out.raw("\"", 1);
+  escaped(text, length);
+  _out.raw("\"", 1);
+}
+
+// Цифры вручную: snprintf на каждое число заметен в /api/alarms
+void JsonWriter::number(const char *key, int64_t value) {
+  char digits[21];
+  char *end = digits + sizeof(digits);
+  char *start = formatDigits(magnitudeOf(value), end);
+  if (value < 0) {
+    *--start = '-';
+  }
+  separator(key);
+  _out.raw(start, end - start);
+}
+
+void JsonWriter::boolean(const char *key, bool value) {
+  separator(key);
+  if (value) {
+    _out.raw("true", 4);
+  } else {
+    _out.raw("false", 5);
+  }
+}
+
+void JsonWriter::decimal(const char *key, int64_t value, uint8_t decimals) {
+  if (decimals > 18) {
+    decimals = 18;
+  }
+  uint64_t magnitude = magnitudeOf(value);
+  char digits[42];
+  char *end = digits + sizeof(digits);
+  char *start = end;
+  for (uint8_t i = 0; i < decimals; i++) {
+    *--start = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  }
+  if (decimals > 0) {
+    *--start = '.';
+  }
+  start = formatDigits(magnitude, start);
+  if (value < 0) {
+    *--start = '-';
+  }
+  separator(key);
+  _out.raw(start, end - start);
+}
+
+void JsonWriter::raw(const char *key, const char *json, size_t length) {
+  separator(key);
+  _out.raw(json, length);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "template_renderer.h"
+
+// JSON поверх TemplateWriter: запятые, кавычки и экранирование строк
+// расставляет сам, числа пишет без плавающей точки. Память — только
+// буфер TemplateWriter: в фиксированном буфере ответ целиком, с
+// приёмником — чанками. key == nullptr — элемент массива.
+//
+//   json.beginObject();
+//   json.string("status", "ok");
+//   json.number("id", id);
+//   json.endObject();
+
+class JsonWriter {
+public:
+  explicit JsonWriter(TemplateWriter &out) : _out(out) {}
+
+  void beginObject(const char *key = nullptr);
+  void endObject();
+  void beginArray(const char *key = nullptr);
+  void endArray();
+
+  void string(const char *key, const char *text);
+  void string(const char *key, const char *text, size_t length);
+  void number(const char *key, int64_t value);
+  void boolean(const char *key, bool value);
+  // value / 10^decimals: decimal("latency_ms", 123, 1) — 12.3
+  void decimal(const char *key, int64_t value, uint8_t decimals);
+  // Готовое значение JSON как есть
+  void raw(const char *key, const char *json, size_t length);
+
+private:
+  void separator(const char *key);
+  void escaped(const char *text, size_t length);
+
+  TemplateWriter &_out;
+  // Бит уровня вложенности: на нём уже есть элементы
+  uint32_t _hasItems = 0;
+  uint8_t _depth = 0;
+};
@@ -1,383 +1,2714 @@
 #include <Arduino.h>
 #include <SPIFFS.h>
 #include <WiFi.h>
-#include <WebServer.h>
 #include <WiFiClient.h>
 
-#include <DFRobotDFPlayerMini.h>
+#include <esp_heap_caps.h>
 #include <esp_task_wdt.h>
-// #include <NTPClient.h>
-// #include <WiFiUdp.h>
+#include <esp_timer.h>
+#include <esp32/clk.h>
+#include <sys/time.h>
+#include <time.h>
+#include <uri/UriBraces.h>
+#include <atomic>
+
+#include "alarm_json.h"
+#include "alarm_scheduler.h"
+#include "api_routes.h"
+#include "audio_commands.h"
+#include "boot_pipeline.h"
+#include "civil_time.h"
+#include "config_store.h"
+#include "dfplayer.h"
+#include "event_hub.h"
+#include "event_journal.h"
+#include "esp32_event_stream.h"
+#include "esp32_group_socket.h"
+#include "esp32_sntp_client.h"
+#include "esp32_trace.h"
+#include "esp32_wifi_driver.h"
+#include "occurrence_cache.h"
+#include "gong_web_server.h"
+#include "group_trigger.h"
+#include "json_writer.h"
+#include "metrics_writer.h"
+#include "playback_session.h"
+#include "route_stats.h"
+#include "spiffs_alarm_storage.h"
+#include "spiffs_config_storage.h"
+#include "spiffs_journal_storage.h"
+#include "spsc_ring.h"
+#include "strike_prestage.h"
+#include "task_health.h"
+#include "template_renderer.h"
+#include "time_service.h"
+#include "web_assets.h"
+#include "web_templates.h"
+#include "wifi_manager.h"
+#ifdef DFPLAYER_BUSY_PIN
+#include "esp32_busy_pin.h"
+#endif
 
 // Объявление Serial для ESP32
 extern HardwareSerial Serial;
 
-#define DEFAULT_WIFI_SSID     "ASUS"
-#define DEFAULT_WIFI_PASSWORD "password"
+#define DEFAULT_WIFI_SSID     "ASUS"
+#define DEFAULT_WIFI_PASSWORD "password"
+
+// Часовой пояс (POSIX TZ) и серверы NTP
+#define GONG_TIMEZONE "MSK-3"
+#define NTP_SERVER_1  "pool.ntp.org"
+#define NTP_SERVER_2  "time.google.com"
+
+// Таблица будильников прежних прошивок: переносится в alarmStore
+#define ALARMS_LEGACY_FILE  "/alarms.bin"
+
+// Подключение DFPlayer Mini:
+// ESP32 GPIO16 (RX2) -> DFPlayer Mini TX
+// ESP32 GPIO17 (TX2) -> DFPlayer Mini RX
+HardwareSerial dfSerial(2); // UART2: RX=16, TX=17
+
+class HardwareUartPort : public UartPort {
+public:
+  explicit HardwareUartPort(HardwareSerial &serial) : _serial(serial) {}
+  int available() override { return _serial.available(); }
+  int read() override { return _serial.read(); }
+  size_t write(const uint8_t *data, size_t length) override {
+    TRACE_SCOPE("uart_write", length);
+    return _serial.write(data, length);
+  }
+
+private:
+  HardwareSerial &_serial;
+};
+HardwareUartPort dfUart(dfSerial);
+// Плеером владеет audioTask: команды, разбор ответов, состояние.
+// Остальные задачи видят только снимок playerStatus.
+DFPlayer dfPlayer(dfUart);
+
+// Снимок состояния плеера: пишет audioTask, читают страницы, события
+// и метрики
+struct PlayerStatus {
+  // online | sd << 1 | playing << 2 | volume << 3 | track << 8
+  std::atomic<uint32_t> state;
+  std::atomic<uint32_t> frames;
+  std::atomic<uint32_t> rxErrors;
+  std::atomic<uint32_t> lastError;
+};
+PlayerStatus playerStatus;
+
+// Период сверки кэша с плеером (запрос состояния), мс
+#define DFPLAYER_STATUS_INTERVAL_MS 10000
+// Плеер считается отключённым, если столько не отвечал, мс
+#define DFPLAYER_OFFLINE_MS (3 * DFPLAYER_STATUS_INTERVAL_MS)
+
+// Команды DFPlayer: id выдаёт audioLog, сами команды идут от TimingTask
+// к audioTask по audioRing и ждут отправки в audioQueue (только audioTask)
+AudioCommandLog audioLog;
+SpscRing<AudioCommand, 16> audioRing;
+AudioCommandQueue audioQueue(audioLog);
+
+// Подготовка удара: за AUDIO_PRESTAGE_LEAD_MS до будильника трек
+// запускается беззвучно и ставится на паузу (strike_prestage.h);
+// 0 — удар всегда холодным стартом
+#ifndef AUDIO_PRESTAGE_LEAD_MS
+#define AUDIO_PRESTAGE_LEAD_MS 3000
+#endif
+// Линия BUSY плеера необязательна: build_flags = -DDFPLAYER_BUSY_PIN=4.
+// Без неё подготовка и замер задержки — по ответам на запрос состояния.
+#ifdef DFPLAYER_BUSY_PIN
+BusyPin dfBusyPin;
+StrikePrestage strikePrestage(true);
+#else
+StrikePrestage strikePrestage(false);
+#endif
+// Задержка от команды удара до начала звука: с подготовкой и без
+RouteStats strikeLatencyStats;
+RouteStat *strikeLatencyPrestaged = NULL;
+RouteStat *strikeLatencyCold = NULL;
+
+// Сеанс воспроизведения: остановка по длительности и шаги громкости
+// (playback_session.h) на одноразовом таймере; сеансом владеет TimingTask
+PlaybackSession playback;
+esp_timer_handle_t playbackTimer = NULL;
+// Громкость ударов и сеансов (только TimingTask): приходит командой
+// Volume по controlRing
+uint8_t baseVolume = 20;
+// Затухание в конце удара будильника, мс
+#ifndef PLAYBACK_ALARM_FADE_OUT_MS
+#define PLAYBACK_ALARM_FADE_OUT_MS 2000
+#endif
+// Пределы параметров сеанса из API, мс (как у длительности будильника)
+#define PLAYBACK_MAX_DURATION_MS 600000
+#define PLAYBACK_MAX_FADE_MS     60000
+// Насколько позже расписания таймер отправил последнюю остановку, мкс
+volatile int32_t playbackStopLateUs = 0;
+
+// Настройки устройства; меняются только обработчиками веб-сервера и
+// применяются сразу. Запись в config — под configMux (publishConfig),
+// другие задачи копируют нужные поля под той же секцией.
+SpiffsConfigStorage configStorage;
+ConfigStore configStore(configStorage);
+GongConfig config;
+portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+// Старый текстовый конфиг: переносится в configStore один раз
+#define LEGACY_CONFIG_FILE "/config.txt"
+GongWebServer server(80);
+
+// Задержки обработки по маршрутам
+RouteStats routeStats;
+
+#if GONG_TRACE
+// Кольца трассировки по ядрам: GET /api/trace
+TraceBuffer traceBuffer;
+#endif
+
+// Подключение к WiFi без блокирующих ожиданий
+Esp32WiFiDriver wifiDriver;
+WiFiManager wifiManager(wifiDriver);
+
+// Смена сети без перезагрузки (POST /api/wifi, адреса в POST /api/config):
+// веб-сервер кладёт сеть в wifiTrialRing, loop() пробует её через
+// WIFI_TRIAL_DELAY_MS — ответ успевает уйти по прежней сети. Итог
+// loop() публикует в wifiTrialStatus ((id << 8) | TrialState), в
+// конфиг сеть записывает веб-сервер, только когда она подключилась.
+#ifndef WIFI_TRIAL_DELAY_MS
+#define WIFI_TRIAL_DELAY_MS 500
+#endif
+struct WiFiTrialRequest {
+  uint32_t id;
+  uint32_t startAtMs;
+  WiFiNetwork network;
+};
+SpscRing<WiFiTrialRequest, 2> wifiTrialRing;
+std::atomic<uint32_t> wifiTrialStatus{0};
+std::atomic<uint32_t> wifiTrialDowntimeMs{0};
+// Проба, ждущая итога (только webServerTask); id == 0 — нет
+WiFiTrialRequest wifiTrialPending = {};
+uint32_t wifiTrialSequence = 0;
+
+// Максимальный сон loop() между проверками WiFi, мс
+#define LOOP_MAX_WAIT_MS 1000
+
+// Будильники: таблица и индекс срабатываний, доступ под alarmsMutex
+AlarmScheduler scheduler;
+// Расписание по дням на 10 дней вперёд и текущий месяц
+OccurrenceCache occurrences;
+SemaphoreHandle_t alarmsMutex = NULL;
+// Две копии набора с CRC во flash
+SpiffsAlarmStorage alarmStorage;
+AlarmStore alarmStore(alarmStorage);
+// Версия набора будильников: растёт при каждом изменении, по ней
+// backend отправляет только изменения (POST /api/alarms/sync)
+uint32_t alarmsVersion = 0;
+// Одноразовый таймер до ближайшего срабатывания
+esp_timer_handle_t alarmTimer = NULL;
+
+// TimingTask: будильники, групповые удары и сеансы воспроизведения.
+// Таймеры и другие задачи только будят её битами уведомления, удар
+// выполняется в ней без ожидания блокировок.
+#define TIMING_ALARM    (1UL << 0) // таймер будильника
+#define TIMING_GROUP    (1UL << 1) // таймер группового удара
+#define TIMING_PLAYBACK (1UL << 2) // таймер сеанса воспроизведения
+#define TIMING_SCHEDULE (1UL << 3) // изменился набор будильников
+#define TIMING_TIME     (1UL << 4) // синхронизация времени
+#define TIMING_CONTROL  (1UL << 5) // команда в controlRing
+#define TIMING_PACKET   (1UL << 6) // групповой удар в groupRing
+#define TIMING_ZONE     (1UL << 7) // сменился config.timezone
+// Максимальный сон TimingTask, мс
+#define TIMING_TASK_MAX_WAIT_MS 1000
+// Повтор, если таблицу будильников держит другая задача, мс
+#define TIMING_RETRY_MS 2
+
+// Команда плеера из API для TimingTask (кольцо controlRing): сеанс
+// ведёт TimingTask, id команды выдаётся сразу
+struct ControlCommand {
+  uint32_t id;
+  AudioOp op;         // Play, Track, Stop или Volume
+  uint16_t arg;
+  PlaybackPlan plan;  // громкость сеанса подставляет TimingTask
+};
+SpscRing<ControlCommand, 8> controlRing;
+
+// Опоздание ударов относительно расписанного момента
+RouteStats fireLateStats;
+RouteStat *fireLateAlarm = NULL;
+RouteStat *fireLateGroup = NULL;
+
+// Пульс задач (task_health.h): loop() кормит сторожевой таймер, только
+// пока все задачи отмечаются
+#ifndef TASK_HEARTBEAT_MAX_MS
+#define TASK_HEARTBEAT_MAX_MS 3000
+#endif
+enum HealthSlot : uint8_t {
+  HEALTH_TIMING,
+  HEALTH_AUDIO,
+  HEALTH_WEB,
+  HEALTH_GROUP,
+  HEALTH_EVENT,
+  HEALTH_JOURNAL,
+  HEALTH_SLOT_COUNT
+};
+TaskHealth taskHealth;
+
+// Task handles
+TaskHandle_t timingTaskHandle = NULL;
+TaskHandle_t webServerTaskHandle = NULL;
+TaskHandle_t audioTaskHandle = NULL;
+TaskHandle_t timeTaskHandle = NULL;
+TaskHandle_t groupTaskHandle = NULL;
+TaskHandle_t eventTaskHandle = NULL;
+TaskHandle_t journalTaskHandle = NULL;
+// Задача loop(): будится событиями WiFi
+TaskHandle_t loopTaskHandle = NULL;
+
+// Максимальное ожидание сокета за один проход, мс
+#define WEB_SERVER_WAIT_MS 50
+
+// Буфер ответа /api/metrics (обслуживается только webServerTask)
+#define METRICS_BUFFER_SIZE 1460
+char metricsBuffer[METRICS_BUFFER_SIZE];
+
+// Счётчики перезагрузок в RTC-памяти: переживают программный сброс,
+// обнуляются при включении питания
+#define RESET_COUNTERS_MAGIC 0x52535443 // "RSTC"
+struct ResetCounters {
+  uint32_t magic;
+  uint32_t boots;
+  uint32_t watchdogResets;
+  // Слот taskHealth, из-за которого перестал кормиться watchdog; -1 — нет
+  int32_t stalledTask;
+};
+RTC_NOINIT_ATTR ResetCounters resetCounters;
+// stalledTask предыдущей загрузки: /api/boot
+int32_t previousStalledTask = -1;
+
+// Время: собственный клиент SNTP и модель ухода кварца. Модель читается
+// из любых задач и обновляется timeTask, доступ под timeMux.
+TimeService timeService;
+portMUX_TYPE timeMux = portMUX_INITIALIZER_UNLOCKED;
+// Последняя синхронизация в RTC-памяти: после сброса будильники идут
+// по ней, не дожидаясь сети
+RTC_NOINIT_ATTR TimeAnchor timeAnchor;
+// Опрос сервера: чаще, пока уход не оценён, затем раз в 8.5 мин
+#define TIME_POLL_FAST_MS     16000
+#define TIME_POLL_MEDIUM_MS   64000
+#define TIME_POLL_SLOW_MS     512000
+#define TIME_RETRY_MS         8000
+#define TIME_SNTP_TIMEOUT_MS  2000
+// Насколько позже расчётного момента сработал последний будильник, мкс
+volatile int32_t lastFireLateUs = 0;
+
+// Групповые удары: подписанные multicast-пакеты «трек N в момент T»
+// (group_trigger.h). Расписанием владеет TimingTask, принятые пакеты
+// приходят к ней от groupTask по groupRing.
+#define GROUP_TRIGGER_ADDR       "239.255.71.71"
+#define GROUP_TRIGGER_PORT       4771
+// Опоздавший пакет играется сразу, если момент прошёл не больше чем на это
+#define GROUP_TRIGGER_LATE_MS    250
+#define GROUP_TRIGGER_HORIZON_MS (10UL * 60 * 1000)
+// Таймер может сработать чуть раньше момента (поправка на уход округляется)
+#define GROUP_TRIGGER_EARLY_US   200
+// Копий пакета при отправке: multicast в WiFi идёт без подтверждений
+#define GROUP_TRIGGER_COPIES     3
+// Запас до удара по умолчанию: станции в режиме сна получают multicast
+// только после DTIM-маяка
+#define GROUP_TRIGGER_LEAD_MS    500
+// Максимальное ожидание пакета за один проход groupTask, мс
+#define GROUP_TASK_WAIT_MS       1000
+GroupTriggerSchedule groupTriggers;
+SpscRing<GroupTrigger, 8> groupRing;
+esp_timer_handle_t groupTriggerTimer = NULL;
+// Отправитель: случайный id на загрузку и счётчик пакетов (только webServerTask)
+uint32_t groupSenderId = 0;
+uint32_t groupSequence = 0;
+volatile uint32_t groupBadPackets = 0;
+volatile int32_t groupFireLateUs = 0;
+
+// События для страниц (GET /api/events): производители ставят бит
+// в pendingEvents, eventTask сериализует событие один раз на всех
+// подписчиков. Подписчики — под eventsMutex, биты и удар — под eventMux.
+EventHub eventHub;
+SemaphoreHandle_t eventsMutex = NULL;
+portMUX_TYPE eventMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t pendingEvents = (1UL << EVENT_PLAYER) | (1UL << EVENT_SCHEDULE);
+// Последний удар; несколько ударов между пробуждениями eventTask
+// дают одно событие о последнем
+struct StrikeEvent {
+  bool group;
+  uint16_t alarmId;
+  uint16_t track;
+  int64_t atUs;
+  // От команды до начала звука; -1 — ещё не замерена
+  int32_t latencyUs;
+  bool prestaged;
+};
+StrikeEvent lastStrike = {false, 0, 0, 0, -1, false};
+// Максимальный сон eventTask (подкормка watchdog), мс
+#define EVENT_TASK_MAX_WAIT_MS 1000
+
+// Журнал событий во flash (event_journal.h): производители ставят
+// запись в journalQueue под journalMux, journalTask дописывает её во
+// flash. Запись и запросы /api/journal — под journalMutex, счётчики
+// для /api/metrics — атомарные, без неё.
+SpiffsJournalStorage journalStorage;
+EventJournal journal(journalStorage);
+JournalQueue journalQueue;
+portMUX_TYPE journalMux = portMUX_INITIALIZER_UNLOCKED;
+SemaphoreHandle_t journalMutex = NULL;
+// Максимальный сон journalTask (пульс), мс
+#define JOURNAL_TASK_MAX_WAIT_MS 1000
+// Записей на странице /api/journal: страница читается в арену запроса
+#define JOURNAL_PAGE_MAX 32
+
+// Сборка прошивки: сравнение времени загрузки между версиями
+#define FIRMWARE_BUILD __DATE__ " " __TIME__
+
+// Стадии загрузки в порядке запуска среди готовых (см. setup())
+enum BootStageId : uint8_t {
+  BOOT_FS,
+  BOOT_CONFIG,
+  BOOT_WIFI,
+  BOOT_ALARMS,
+  BOOT_AUDIO,
+  BOOT_JOURNAL,
+  BOOT_ROUTES,
+  BOOT_SERVER,
+  BOOT_TASKS,
+  // Завершаются событиями
+  BOOT_WIFI_CONNECTED,
+  BOOT_DFPLAYER_ONLINE,
+  BOOT_TIME_SYNCED,
+  BOOT_STAGE_COUNT
+};
+
+void bootFs();
+void bootConfig();
+void bootWiFi();
+void bootAlarms();
+void bootAudio();
+void bootJournal();
+void registerRoutes();
+void bootServer();
+void bootTasks();
+
+// WiFi стартует сразу после чтения настроек, DFPlayer и будильники
+// инициализируются, пока идёт подключение
+const BootStage kBootStages[BOOT_STAGE_COUNT] = {
+  {"fs",             0,                                   bootFs,         false},
+  {"config",         BOOT_STAGE_BIT(BOOT_FS),             bootConfig,     false},
+  {"wifi",           BOOT_STAGE_BIT(BOOT_CONFIG),         bootWiFi,       false},
+  {"alarms",         BOOT_STAGE_BIT(BOOT_CONFIG),         bootAlarms,     false},
+  {"audio",          BOOT_STAGE_BIT(BOOT_CONFIG),         bootAudio,      false},
+  {"journal",        BOOT_STAGE_BIT(BOOT_ALARMS),         bootJournal,    false},
+  {"routes",         0,                                   registerRoutes, false},
+  {"server",         BOOT_STAGE_BIT(BOOT_ROUTES),         bootServer,     false},
+  {"tasks",          BOOT_STAGE_BIT(BOOT_ALARMS) | BOOT_STAGE_BIT(BOOT_AUDIO) |
+                     BOOT_STAGE_BIT(BOOT_JOURNAL) | BOOT_STAGE_BIT(BOOT_SERVER),
+                                                          bootTasks,      false},
+  {"wifi_connected", BOOT_STAGE_BIT(BOOT_WIFI),           nullptr,        true},
+  {"dfplayer",       BOOT_STAGE_BIT(BOOT_AUDIO),          nullptr,        true},
+  {"time_synced",    BOOT_STAGE_BIT(BOOT_WIFI_CONNECTED), nullptr,        true},
+};
+BootPipeline bootPipeline(kBootStages, BOOT_STAGE_COUNT, esp_timer_get_time);
+
+// Обёртка обработчика: замеряет время выполнения маршрута
+GongWebServer::THandlerFunction timed(const char *route, GongWebServer::THandlerFunction handler) {
+  RouteStat *stat = routeStats.add(route);
+  return [route, stat, handler]() {
+    TRACE_SCOPE(route);
+    bootPipeline.markFirstRequest();
+    uint32_t start = micros();
+    handler();
+    routeStats.record(stat, micros() - start);
+  };
+}
+
+// Новые настройки видны другим задачам (только webServerTask)
+void publishConfig(const GongConfig &next) {
+  portENTER_CRITICAL(&configMux);
+  config = next;
+  portEXIT_CRITICAL(&configMux);
+}
+
+// Проба сети в loop() (только webServerTask); 0 — проба уже идёт
+uint32_t startWiFiTrial(const WiFiNetwork &network) {
+  if (wifiTrialPending.id != 0) {
+    return 0;
+  }
+  WiFiTrialRequest request = {++wifiTrialSequence, (uint32_t)(millis() + WIFI_TRIAL_DELAY_MS), network};
+  if (!wifiTrialRing.push(request)) {
+    return 0;
+  }
+  wifiTrialPending = request;
+  if (loopTaskHandle != NULL) {
+    xTaskNotifyGive(loopTaskHandle);
+  }
+  return request.id;
+}
+
+// Итог пробы (только webServerTask): подключившаяся сеть сохраняется,
+// при откате конфиг не меняется
+void finishWiFiTrial() {
+  if (wifiTrialPending.id == 0) {
+    return;
+  }
+  uint32_t status = wifiTrialStatus.load(std::memory_order_acquire);
+  uint8_t state = status & 0xFF;
+  if (status >> 8 != wifiTrialPending.id || state == WiFiManager::TRIAL_RUNNING) {
+    return;
+  }
+  if (state == WiFiManager::TRIAL_APPLIED) {
+    GongConfig next = config;
+    networkToConfig(wifiTrialPending.network, next);
+    if (configStore.commit(next)) {
+      publishConfig(next);
+    } else {
+      Serial.println("Сеть подключена, но не сохранена: ошибка записи конфигурации");
+    }
+  }
+  wifiTrialPending.id = 0;
+}
+
+// Web server task function
+void webServerTask(void *parameter) {
+  for(;;) {
+    taskHealth.beat(HEALTH_WEB, millis());
+    TRACE_CLOCK();
+    finishWiFiTrial();
+
+    // Все соединения за проход; ожидание — пока ни один сокет не готов
+    server.handleClient();
+    server.waitForActivity(WEB_SERVER_WAIT_MS);
+  }
+}
+
+// Системные часы раньше этой даты считаются не установленными
+#define TIME_VALID_AFTER 1704067200LL // 2024-01-01
+
+// UTC в мкс от 1970-01-01 или -1, пока время неизвестно. До первой
+// синхронизации — системные часы, если их уже кто-то установил
+// (на хосте они точные сразу).
+int64_t utcNowUs() {
+  int64_t monoUs = esp_timer_get_time();
+  portENTER_CRITICAL(&timeMux);
+  int64_t utcUs = timeService.utcUs(monoUs);
+  portEXIT_CRITICAL(&timeMux);
+  if (utcUs >= 0) {
+    return utcUs;
+  }
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  if (tv.tv_sec < TIME_VALID_AFTER) {
+    return -1;
+  }
+  return (int64_t)tv.tv_sec * US_PER_SECOND + tv.tv_usec;
+}
+
+// Локальное время в мкс от 1970-01-01 или -1, пока время неизвестно
+int64_t localNowUs() {
+  int64_t utcUs = utcNowUs();
+  if (utcUs < 0) {
+    return -1;
+  }
+  time_t utcSeconds = (time_t)(utcUs / US_PER_SECOND);
+  struct tm local;
+  localtime_r(&utcSeconds, &local);
+  int64_t days = daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+  int64_t seconds = days * SECONDS_PER_DAY + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+  return seconds * US_PER_SECOND + utcUs % US_PER_SECOND;
+}
+
+// Событие для страниц; вызывается из любых задач и колбэков esp_timer
+void raiseEvent(EventType type) {
+  portENTER_CRITICAL(&eventMux);
+  pendingEvents |= 1UL << type;
+  portEXIT_CRITICAL(&eventMux);
+  if (eventTaskHandle != NULL) {
+    xTaskNotifyGive(eventTaskHandle);
+  }
+}
+
+void recordStrike(bool group, uint16_t alarmId, uint16_t track, int64_t atUs) {
+  portENTER_CRITICAL(&eventMux);
+  lastStrike.group = group;
+  lastStrike.alarmId = alarmId;
+  lastStrike.track = track;
+  lastStrike.atUs = atUs;
+  lastStrike.latencyUs = -1;
+  lastStrike.prestaged = false;
+  portEXIT_CRITICAL(&eventMux);
+  raiseEvent(EVENT_ALARM);
+}
+
+// Замер задержки последнего удара (audioTask): повторное событие alarm
+void recordStrikeLatency(int32_t latencyUs, bool prestaged) {
+  RouteStat *stat = prestaged ? strikeLatencyPrestaged : strikeLatencyCold;
+  strikeLatencyStats.record(stat, (uint32_t)latencyUs);
+  portENTER_CRITICAL(&eventMux);
+  lastStrike.latencyUs = latencyUs;
+  lastStrike.prestaged = prestaged;
+  portEXIT_CRITICAL(&eventMux);
+  raiseEvent(EVENT_ALARM);
+  Serial.printf("Удар: звук через %d мкс (%s)\n", (int)latencyUs, prestaged ? "подготовлен" : "холодный старт");
+}
+
+// Событие в журнал из любой задачи: копия записи в journalQueue под
+// критической секцией, во flash её пишет journalTask
+void journalEvent(JournalEvent type, uint16_t code, uint16_t alarmId, uint16_t track, int64_t latencyUs) {
+  int64_t utcUs = utcNowUs();
+  JournalRecord record = {};
+  record.time = utcUs >= 0 ? (uint32_t)(utcUs / US_PER_SECOND) : 0;
+  record.type = (uint8_t)type;
+  record.code = code;
+  record.alarmId = alarmId;
+  record.track = track;
+  record.latencyUs = latencyUs > INT32_MAX ? INT32_MAX : latencyUs < INT32_MIN ? INT32_MIN : (int32_t)latencyUs;
+  portENTER_CRITICAL(&journalMux);
+  bool queued = journalQueue.push(record);
+  portEXIT_CRITICAL(&journalMux);
+  if (queued && journalTaskHandle != NULL) {
+    xTaskNotifyGive(journalTaskHandle);
+  }
+}
+
+// Будит TimingTask с причиной reason; из любых задач и колбэков esp_timer
+void notifyTiming(uint32_t reason) {
+  if (timingTaskHandle != NULL) {
+    xTaskNotify(timingTaskHandle, reason, eSetBits);
+  }
+}
+
+// Таймеры только будят TimingTask: в задаче esp_timer ни блокировок,
+// ни работы с расписанием
+void onAlarmTimer(void *arg) {
+  TRACE_INSTANT("alarm_timer", 0);
+  notifyTiming(TIMING_ALARM);
+}
+
+void onGroupTriggerTimer(void *arg) {
+  TRACE_INSTANT("group_timer", 0);
+  notifyTiming(TIMING_GROUP);
+}
+
+void onPlaybackTimer(void *arg) {
+  notifyTiming(TIMING_PLAYBACK);
+}
+
+// Расписание изменилось — TimingTask пересчитает ближайшее срабатывание
+void notifyScheduleChanged() {
+  notifyTiming(TIMING_SCHEDULE);
+  raiseEvent(EVENT_SCHEDULE);
+}
+
+// TZ из config.timezone; только TimingTask (до её запуска — setup),
+// чтобы местное время не менялось посреди её пересчёта расписания
+void applyTimezone() {
+  char timezone[sizeof(config.timezone)];
+  portENTER_CRITICAL(&configMux);
+  memcpy(timezone, config.timezone, sizeof(timezone));
+  portEXIT_CRITICAL(&configMux);
+  setenv("TZ", timezone, 1);
+  tzset();
+}
+
+// Команда плеера из API (только webServerTask, до его запуска — setup);
+// 0 — кольцо заполнено
+uint32_t submitControl(AudioOp op, uint16_t arg, const PlaybackPlan &plan) {
+  ControlCommand command = {audioLog.issue(), op, arg, plan};
+  if (!controlRing.push(command)) {
+    audioLog.set(command.id, AudioCommandStatus::Failed);
+    return 0;
+  }
+  notifyTiming(TIMING_CONTROL);
+  return command.id;
+}
+
+// Команда задаче аудио (только TimingTask); id == 0 — выдать новый.
+// false — кольцо заполнено, команда отмечена failed.
+bool sendAudio(uint32_t id, AudioOp op, uint16_t arg) {
+  AudioCommand command = {id != 0 ? id : audioLog.issue(), op, arg};
+  if (!audioRing.push(command)) {
+    audioLog.set(command.id, AudioCommandStatus::Failed);
+    return false;
+  }
+  if (audioTaskHandle != NULL) {
+    xTaskNotifyGive(audioTaskHandle);
+  }
+  return true;
+}
+
+// Состояние плеера по снимку audioTask
+bool playerOnline() {
+  return playerStatus.state.load(std::memory_order_acquire) & 1;
+}
+
+// Только audioTask
+bool dfPlayerOnline() {
+  return dfPlayer.online() && millis() - dfPlayer.lastRxMs() < DFPLAYER_OFFLINE_MS;
+}
+
+// Команда из очереди; false — отложена до следующей возможности
+// отправки (сначала нужно вернуть громкость после подготовки)
+bool executeAudioCommand(const AudioCommand &command) {
+  TRACE_SCOPE("audio_command", (uint32_t)command.op);
+  bool ok = true;
+  switch (command.op) {
+    case AudioOp::Prestage:
+      strikePrestage.prepare(command.arg, dfPlayer.currentVolume(), dfPlayer.playing(), esp_timer_get_time());
+      break;
+    case AudioOp::Strike:
+      strikePrestage.strike(command.arg, esp_timer_get_time());
+      break;
+    case AudioOp::Volume:
+      if (command.arg > 30) {
+        ok = false;
+      } else if (strikePrestage.setVolume((uint8_t)command.arg)) {
+        ok = runAudioCommand(dfPlayer, command);
+      }
+      break;
+    default:
+      if (strikePrestage.cancel()) {
+        return false;
+      }
+      ok = runAudioCommand(dfPlayer, command);
+      break;
+  }
+  audioQueue.complete(command.id, ok);
+  if (!ok) {
+    journalEvent(JournalEvent::AudioFailed, 0, 0, command.arg, 0);
+  }
+  return true;
+}
+
+// Задача аудио: единственная, кто обращается к UART DFPlayer.
+// Будится новой командой в audioRing, приёмом байтов с UART или фронтом
+// BUSY. Шаги подготовки и удара идут раньше команд из очереди, запросы
+// подтверждений — после.
+void audioTask(void *parameter) {
+  uint32_t lastQueryMs = millis();
+  uint32_t lastState = 0;
+  uint32_t seenReplies = dfPlayer.statusReplies();
+  uint32_t seenErrors = dfPlayer.errorReports();
+  AudioCommand held;
+  bool holding = false;
+  for(;;) {
+    taskHealth.beat(HEALTH_AUDIO, millis());
+    // Из кольца — в очередь, где схлопываются лишние команды; пока UART
+    // занят, новые команды копятся в кольце
+    while (const AudioCommand *next = audioRing.peek()) {
+      if (!audioQueue.push(*next)) {
+        break;
+      }
+      audioRing.drop();
+    }
+    dfPlayer.poll(millis());
+    if (dfPlayer.online()) {
+      bootPipeline.complete(BOOT_DFPLAYER_ONLINE);
+    }
+    uint32_t replies = dfPlayer.statusReplies();
+    if (replies != seenReplies) {
+      seenReplies = replies;
+      strikePrestage.observe(dfPlayer.playing(), esp_timer_get_time());
+    }
+#ifdef DFPLAYER_BUSY_PIN
+    BusyPin::Edge edge;
+    while (dfBusyPin.take(edge)) {
+      strikePrestage.observe(edge.playing, edge.atUs);
+    }
+#endif
+    int32_t latencyUs;
+    bool prestaged;
+    if (strikePrestage.takeLatency(latencyUs, prestaged)) {
+      recordStrikeLatency(latencyUs, prestaged);
+    }
+    // Страницам — только смена состояния, а не каждый принятый кадр;
+    // промежуточные шаги подготовки не показываются
+    playerStatus.frames.store(dfPlayer.framesReceived(), std::memory_order_relaxed);
+    playerStatus.rxErrors.store(dfPlayer.rxErrors(), std::memory_order_relaxed);
+    playerStatus.lastError.store(dfPlayer.lastError(), std::memory_order_relaxed);
+    uint32_t state = (dfPlayerOnline() ? 1 : 0) | (dfPlayer.sdPresent() ? 2 : 0) | (dfPlayer.playing() ? 4 : 0) |
+                     ((uint32_t)(dfPlayer.currentVolume() & 0x1F) << 3) | ((uint32_t)dfPlayer.track() << 8);
+    uint32_t errors = dfPlayer.errorReports();
+    if (errors != seenErrors) {
+      seenErrors = errors;
+      journalEvent(JournalEvent::AudioFailed, dfPlayer.lastError(), 0, dfPlayer.track(), 0);
+    }
+    if (state != lastState && !strikePrestage.busy()) {
+      if ((lastState & 1) && !(state & 1)) {
+        journalEvent(JournalEvent::PlayerOffline, 0, 0, 0, 0);
+      }
+      lastState = state;
+      playerStatus.state.store(state, std::memory_order_release);
+      raiseEvent(EVENT_PLAYER);
+    }
+
+    TickType_t wait = pdMS_TO_TICKS(strikePrestage.busy() ? DFPlayer::kCommandIntervalMs : 1000);
+    uint32_t pause = dfPlayer.msUntilReady(millis());
+    if (pause > 0) {
+      // Следующая команда — не раньше, чем через pause мс
+      wait = pdMS_TO_TICKS(pause) + 1;
+    } else {
+      uint16_t arg;
+      PrestageAction action = strikePrestage.next(esp_timer_get_time(), arg);
+      if (action != PrestageAction::None) {
+        TRACE_SCOPE("prestage", (uint32_t)action);
+        runPrestageAction(dfPlayer, action, arg);
+        continue;
+      }
+      AudioCommand command;
+      bool found = holding;
+      if (holding) {
+        command = held;
+        holding = false;
+      } else {
+        found = audioQueue.pop(command);
+      }
+      if (found) {
+        if (!executeAudioCommand(command)) {
+          held = command;
+          holding = true;
+        }
+        continue;
+      }
+      if (strikePrestage.query()) {
+        dfPlayer.queryStatus();
+        continue;
+      }
+      // Запрос состояния не должен занять интервал перед ударом
+      if (millis() - lastQueryMs >= DFPLAYER_STATUS_INTERVAL_MS && !strikePrestage.staged()) {
+        lastQueryMs = millis();
+        dfPlayer.queryStatus();
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
+  }
+}
+
+// Приём с UART DFPlayer (задача событий UART): разбор — в audioTask
+void onDfPlayerReceive() {
+  TRACE_INSTANT("uart_rx", 0);
+  if (audioTaskHandle != NULL) {
+    xTaskNotifyGive(audioTaskHandle);
+  }
+}
+
+// Далее до timingTask — только TimingTask: сеанс, расписание групповых
+// ударов и курсор будильников принадлежат ей, блокировки не нужны
+
+// Таймер на ближайшее событие сеанса воспроизведения
+void armPlaybackTimer() {
+  int64_t atUs = playback.nextAtUs();
+  esp_timer_stop(playbackTimer);
+  if (atUs < 0) {
+    return;
+  }
+  int64_t delayUs = atUs - esp_timer_get_time();
+  esp_timer_start_once(playbackTimer, delayUs > 0 ? delayUs : 1);
+}
+
+// События сеанса, наступившие к этому моменту
+void pollPlayback() {
+  int64_t nowUs = esp_timer_get_time();
+  for (;;) {
+    uint8_t volume;
+    int64_t atUs;
+    PlaybackAction action = playback.poll(nowUs, volume, atUs);
+    if (action == PlaybackAction::None) {
+      break;
+    }
+    if (action == PlaybackAction::Stop) {
+      playbackStopLateUs = (int32_t)(nowUs - atUs);
+      sendAudio(0, AudioOp::Stop, 0);
+    }
+    sendAudio(0, AudioOp::Volume, volume);
+  }
+}
+
+// Запуск трека (op: Track, Strike или Play) новым сеансом: прежний
+// вытесняется, громкость после его затухания возвращается до запуска.
+// id — команда из API или 0.
+bool startPlayback(uint32_t id, AudioOp op, uint16_t track, const PlaybackPlan &plan) {
+  int volume = playback.begin(plan, esp_timer_get_time());
+  if (volume >= 0) {
+    sendAudio(0, AudioOp::Volume, (uint16_t)volume);
+  }
+  if (!sendAudio(id, op, track)) {
+    // Кольцо заполнено: трек не запущен, сеанс не нужен
+    playback.end();
+    return false;
+  }
+  return true;
+}
+
+void stopPlayback(uint32_t id) {
+  int volume = playback.end();
+  sendAudio(id, AudioOp::Stop, 0);
+  if (volume >= 0) {
+    sendAudio(0, AudioOp::Volume, (uint16_t)volume);
+  }
+}
+
+void handleControl(const ControlCommand &command) {
+  PlaybackPlan plan = command.plan;
+  plan.volume = baseVolume;
+  switch (command.op) {
+    case AudioOp::Volume:
+      baseVolume = (uint8_t)command.arg;
+      playback.setVolume(baseVolume);
+      sendAudio(command.id, AudioOp::Volume, command.arg);
+      break;
+    case AudioOp::Stop:
+      stopPlayback(command.id);
+      break;
+    default:
+      startPlayback(command.id, command.op, command.arg, plan);
+      break;
+  }
+}
+
+// Опоздание в гистограмму; таймер группы может сработать чуть раньше
+void recordFireLate(RouteStat *stat, int64_t lateUs) {
+  fireLateStats.record(stat, lateUs > 0 ? (uint32_t)lateUs : 0);
+}
+
+// Лог — после команды: вывод в UART не задерживает удар
+void fireAlarm(const AlarmFire &fire, int64_t lateUs) {
+  TRACE_SCOPE("fire_alarm", fire.alarm.id);
+  lastFireLateUs = (int32_t)lateUs;
+  recordFireLate(fireLateAlarm, lateUs);
+  PlaybackPlan plan = {(uint32_t)fire.alarm.duration * 1000, 0, PLAYBACK_ALARM_FADE_OUT_MS, baseVolume};
+  if (!startPlayback(0, AudioOp::Strike, fire.alarm.track, plan)) {
+    journalEvent(JournalEvent::AlarmSkipped, 0, fire.alarm.id, fire.alarm.track, lateUs);
+    Serial.println("Очередь аудио заполнена, удар пропущен");
+    return;
+  }
+  recordStrike(false, fire.alarm.id, fire.alarm.track, utcNowUs());
+  journalEvent(JournalEvent::Alarm, 0, fire.alarm.id, fire.alarm.track, lateUs);
+  Serial.printf("Будильник #%u: трек %u\n", fire.alarm.id, fire.alarm.track);
+}
+
+void fireGroupTrigger(const GroupTrigger &trigger, int64_t nowUs) {
+  TRACE_SCOPE("fire_group", trigger.track);
+  groupFireLateUs = (int32_t)(nowUs - trigger.fireAtUs);
+  recordFireLate(fireLateGroup, nowUs - trigger.fireAtUs);
+  if (trigger.op == GroupTriggerOp::Play) {
+    // В пакете нет длительности: трек играет до конца
+    PlaybackPlan plan = {0, 0, 0, baseVolume};
+    startPlayback(0, AudioOp::Strike, trigger.track, plan);
+    recordStrike(true, 0, trigger.track, trigger.fireAtUs);
+    journalEvent(JournalEvent::Group, 0, 0, trigger.track, nowUs - trigger.fireAtUs);
+  } else {
+    stopPlayback(0);
+  }
+}
+
+// Ближайшее срабатывание не раньше fromUs. false — таблицу держит
+// другая задача: TimingTask не ждёт её, а повторяет через
+// TIMING_RETRY_MS, чтобы удар не встал за HTTP-запросом.
+bool queryAlarms(int64_t fromUs, AlarmFire &fire, bool &found) {
+  if (xSemaphoreTake(alarmsMutex, 0) != pdTRUE) {
+    return false;
+  }
+  found = scheduler.nextFire(fromUs, fire);
+  xSemaphoreGive(alarmsMutex);
+  return true;
+}
+
+// Таймер на ближайший групповой удар с поправкой на уход кварца
+void armGroupTriggerTimer() {
+  int64_t atUs = groupTriggers.nextAtUs();
+  esp_timer_stop(groupTriggerTimer);
+  int64_t nowUs = utcNowUs();
+  if (atUs < 0 || nowUs < 0) {
+    return;
+  }
+  portENTER_CRITICAL(&timeMux);
+  int64_t delayUs = timeService.monoDelayUs(atUs - nowUs);
+  portEXIT_CRITICAL(&timeMux);
+  esp_timer_start_once(groupTriggerTimer, delayUs > 0 ? delayUs : 1);
+}
+
+// Пакет из группы: дубликаты, опоздание — см. GroupTriggerSchedule
+void acceptGroupTrigger(const GroupTrigger &trigger) {
+  GroupTriggerResult result = groupTriggers.accept(trigger, utcNowUs(), (int64_t)GROUP_TRIGGER_LATE_MS * 1000,
+                                                   (int64_t)GROUP_TRIGGER_HORIZON_MS * 1000);
+  // Запаса обычно хватает на подготовку; не успеет — удар холодным стартом
+  if (result == GroupTriggerResult::Scheduled && trigger.op == GroupTriggerOp::Play &&
+      AUDIO_PRESTAGE_LEAD_MS > 0) {
+    sendAudio(0, AudioOp::Prestage, trigger.track);
+  }
+  if (result != GroupTriggerResult::Duplicate) {
+    Serial.printf("Групповой удар %08x/%u: %s\n", trigger.sender, trigger.sequence,
+                  groupTriggerResultName(result));
+  }
+}
+
+// Пакет с сокета (groupTask): подпись проверяется здесь, расписание
+// ведёт TimingTask
+void handleGroupPacket(const uint8_t *data, size_t length) {
+  char key[sizeof(config.triggerKey)];
+  portENTER_CRITICAL(&configMux);
+  memcpy(key, config.triggerKey, sizeof(key));
+  portEXIT_CRITICAL(&configMux);
+  size_t keyLength = strlen(key);
+  GroupTrigger trigger;
+  if (keyLength == 0 || !decodeGroupTrigger(data, length, (const uint8_t *)key, keyLength, trigger)) {
+    groupBadPackets++;
+    return;
+  }
+  // Переполнение считает кольцо: такой удар не прозвучит
+  if (groupRing.push(trigger)) {
+    notifyTiming(TIMING_PACKET);
+  }
+}
+
+// Приём групповых ударов; сокет переоткрывается при смене адреса
+void groupTask(void *parameter) {
+  GroupSocket socket;
+  IPAddress joinedIp;
+  for(;;) {
+    taskHealth.beat(HEALTH_GROUP, millis());
+
+    if (WiFi.status() != WL_CONNECTED) {
+      socket.close();
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GROUP_TASK_WAIT_MS));
+      continue;
+    }
+    IPAddress localIp = WiFi.localIP();
+    if (!socket.isOpen() || localIp != joinedIp) {
+      if (!socket.open(localIp, GROUP_TRIGGER_ADDR, GROUP_TRIGGER_PORT, true)) {
+        Serial.println("Не удалось открыть сокет групповых ударов");
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GROUP_TASK_WAIT_MS));
+        continue;
+      }
+      joinedIp = localIp;
+    }
+    uint8_t packet[GROUP_TRIGGER_PACKET_SIZE + 1]; // длиннее — не наш пакет
+    int length = socket.receive(packet, sizeof(packet), GROUP_TASK_WAIT_MS);
+    if (length < 0) {
+      socket.close();
+    } else if (length > 0) {
+      handleGroupPacket(packet, (size_t)length);
+    }
+  }
+}
+
+// Отправка группового удара через delayMs; этот же пакет по петле
+// multicast получает и само устройство. nullptr — отправлено.
+const char *sendGroupTrigger(GroupTriggerOp op, uint16_t track, uint32_t delayMs, GroupTrigger &trigger) {
+  size_t keyLength = strlen(config.triggerKey);
+  if (keyLength == 0) {
+    return "trigger key not configured";
+  }
+  int64_t nowUs = utcNowUs();
+  if (nowUs < 0) {
+    return "time not synced";
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    return "wifi not connected";
+  }
+  trigger.op = op;
+  trigger.track = track;
+  trigger.sender = groupSenderId;
+  trigger.sequence = ++groupSequence;
+  trigger.fireAtUs = nowUs + (int64_t)delayMs * 1000;
+  uint8_t packet[GROUP_TRIGGER_PACKET_SIZE];
+  encodeGroupTrigger(trigger, (const uint8_t *)config.triggerKey, keyLength, packet);
+  GroupSocket socket;
+  if (!socket.open(WiFi.localIP(), GROUP_TRIGGER_ADDR, GROUP_TRIGGER_PORT, false)) {
+    return "socket error";
+  }
+  bool sent = false;
+  for (int i = 0; i < GROUP_TRIGGER_COPIES; i++) {
+    sent = socket.send(packet, sizeof(packet)) || sent;
+  }
+  return sent ? nullptr : "send failed";
+}
+
+// Задача ударов: спит на одноразовых таймерах до ближайшего события.
+// После пробуждения сначала удары — по уже известному срабатыванию,
+// без alarmsMutex; затем команды из колец, перечитывание расписания
+// и перезапуск таймеров.
+void timingTask(void *parameter) {
+  FireCursor cursor;
+  // Ближайшее срабатывание по расписанию; requery — его нужно перечитать
+  AlarmFire fire;
+  bool found = false;
+  bool requery = true;
+  // Срабатывание, трек которого уже отправлен на подготовку
+  int64_t stagedAtUs = -1;
+  uint16_t stagedTrack = 0;
+  for(;;) {
+    taskHealth.beat(HEALTH_TIMING, millis());
+
+    int64_t utcUs = utcNowUs();
+    GroupTrigger trigger;
+    while (utcUs >= 0 && groupTriggers.popDue(utcUs + GROUP_TRIGGER_EARLY_US, trigger)) {
+      fireGroupTrigger(trigger, utcUs);
+    }
+    int64_t nowUs = localNowUs();
+    if (nowUs >= 0) {
+      // Первая синхронизация или скачок часов: не догоняем старые срабатывания
+      portENTER_CRITICAL(&configMux);
+      int64_t graceUs = (int64_t)config.missedGraceSec * US_PER_SECOND;
+      portEXIT_CRITICAL(&configMux);
+      if (cursor.follow(nowUs, graceUs)) {
+        requery = true;
+      }
+      // Одновременные будильники дают один удар; пропущенные в пределах
+      // missedGraceSec догоняются по перечитанному расписанию
+      for (;;) {
+        if (found && cursor.take(fire, nowUs)) {
+          fireAlarm(fire, nowUs - fire.atUs);
+          requery = true;
+        }
+        if (!requery || !queryAlarms(cursor.position(), fire, found)) {
+          break;
+        }
+        requery = false;
+        if (!found || fire.atUs > nowUs) {
+          break;
+        }
+      }
+    }
+    pollPlayback();
+
+    ControlCommand command;
+    while (controlRing.pop(command)) {
+      handleControl(command);
+    }
+    while (groupRing.pop(trigger)) {
+      acceptGroupTrigger(trigger);
+    }
+
+    bool retry = requery;
+    if (nowUs >= 0) {
+      // Смена дня: кэш расписания пересобирается целиком
+      int32_t today = (int32_t)(nowUs / US_PER_DAY);
+      if (!occurrences.valid() || occurrences.today() != today) {
+        if (xSemaphoreTake(alarmsMutex, 0) == pdTRUE) {
+          occurrences.rebuild(today, scheduler);
+          xSemaphoreGive(alarmsMutex);
+        } else {
+          retry = true;
+        }
+      }
+      // Интервал по UTC переводится в интервал esp_timer с поправкой
+      // на уход кварца: удар не опаздывает на часовых ожиданиях.
+      // Сначала таймер будит к подготовке трека, затем к удару.
+      esp_timer_stop(alarmTimer);
+      if (found && cursor.pending(fire)) {
+        int64_t wakeUs = fire.atUs;
+        if (AUDIO_PRESTAGE_LEAD_MS > 0 && (stagedAtUs != fire.atUs || stagedTrack != fire.alarm.track)) {
+          int64_t stageUs = fire.atUs - (int64_t)AUDIO_PRESTAGE_LEAD_MS * 1000;
+          if (nowUs >= stageUs) {
+            sendAudio(0, AudioOp::Prestage, fire.alarm.track);
+            stagedAtUs = fire.atUs;
+            stagedTrack = fire.alarm.track;
+          } else {
+            wakeUs = stageUs;
+          }
+        }
+        portENTER_CRITICAL(&timeMux);
+        int64_t delayUs = timeService.monoDelayUs(wakeUs - nowUs);
+        portEXIT_CRITICAL(&timeMux);
+        esp_timer_start_once(alarmTimer, delayUs > 0 ? delayUs : 1);
+      }
+    }
+    armGroupTriggerTimer();
+    armPlaybackTimer();
+
+    // Точка синхронизации в RTC-память: после сброса ошибка растёт
+    // только от хода RTC за время перезагрузки
+    portENTER_CRITICAL(&timeMux);
+    timeService.saveAnchor(esp_timer_get_time(), esp_clk_rtc_time(), timeAnchor);
+    portEXIT_CRITICAL(&timeMux);
+
+    // Без уведомлений расписание всё равно перечитывается раз в
+    // TIMING_TASK_MAX_WAIT_MS
+    uint32_t reasons = 0;
+    TickType_t wait = pdMS_TO_TICKS(retry ? TIMING_RETRY_MS : TIMING_TASK_MAX_WAIT_MS);
+    if (xTaskNotifyWait(0, 0xFFFFFFFF, &reasons, wait) != pdTRUE ||
+        (reasons & (TIMING_SCHEDULE | TIMING_TIME | TIMING_ZONE))) {
+      requery = true;
+    }
+    // Новый часовой пояс — до пересчёта; страницы перечитают расписание
+    // уже в новом местном времени
+    if (reasons & TIMING_ZONE) {
+      applyTimezone();
+      notifyScheduleChanged();
+    }
+    if (reasons != 0) {
+      TRACE_INSTANT("timing_wake", reasons);
+    }
+  }
+}
+
+// Кэшированное состояние плеера: /api/audio/status и событие player
+void playerToJson(JsonWriter &json) {
+  uint32_t state = playerStatus.state.load(std::memory_order_acquire);
+  json.beginObject();
+  json.boolean("online", state & 1);
+  json.boolean("sd", state & 2);
+  json.boolean("playing", state & 4);
+  json.number("track", state >> 8);
+  json.number("volume", (state >> 3) & 0x1F);
+  json.number("last_error", playerStatus.lastError.load(std::memory_order_relaxed));
+  json.number("frames", playerStatus.frames.load(std::memory_order_relaxed));
+  json.number("rx_errors", playerStatus.rxErrors.load(std::memory_order_relaxed));
+  json.endObject();
+}
+
+// Текущее время: /api/time и событие time
+// source: none, rtc (восстановлено после сброса), sntp, system
+// (системные часы до первой синхронизации)
+void timeToJson(JsonWriter &json) {
+  int64_t monoUs = esp_timer_get_time();
+  int64_t utcUs = utcNowUs();
+  portENTER_CRITICAL(&timeMux);
+  TimeService snapshot = timeService;
+  portEXIT_CRITICAL(&timeMux);
+  time_t now = utcUs >= 0 ? (time_t)(utcUs / US_PER_SECOND) : 0;
+  struct tm local;
+  localtime_r(&now, &local);
+  char clock[9];
+  char iso[20];
+  strftime(clock, sizeof(clock), "%H:%M:%S", &local);
+  strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%S", &local);
+  json.beginObject();
+  json.string("time", clock);
+  json.string("iso", iso);
+  json.boolean("synced", utcUs >= 0);
+  switch (snapshot.source()) {
+    case TimeSource::Sntp:     json.string("source", "sntp"); break;
+    case TimeSource::Restored: json.string("source", "rtc"); break;
+    case TimeSource::None:     json.string("source", utcUs >= 0 ? "system" : "none"); break;
+  }
+  if (snapshot.source() != TimeSource::None) {
+    json.decimal("offset_ms", snapshot.lastOffsetUs(), 3);
+    json.decimal("uncertainty_ms", snapshot.uncertaintyUs(monoUs), 3);
+    json.decimal("drift_ppm", snapshot.driftPpb(), 3);
+    json.number("syncs", snapshot.syncCount());
+  }
+  if (snapshot.lastSyncMonoUs() >= 0) {
+    json.number("last_sync_s", (monoUs - snapshot.lastSyncMonoUs()) / US_PER_SECOND);
+  }
+  json.endObject();
+}
+
+void strikeToJson(JsonWriter &json) {
+  portENTER_CRITICAL(&eventMux);
+  StrikeEvent strike = lastStrike;
+  portEXIT_CRITICAL(&eventMux);
+  json.beginObject();
+  json.string("source", strike.group ? "group" : "schedule");
+  if (!strike.group) {
+    json.number("id", strike.alarmId);
+  }
+  json.number("track", strike.track);
+  json.number("at_ms", strike.atUs / 1000);
+  if (strike.latencyUs >= 0) {
+    json.decimal("latency_ms", (strike.latencyUs + 50) / 100, 1);
+    json.boolean("prestaged", strike.prestaged);
+  }
+  json.endObject();
+}
+
+void scheduleVersionToJson(JsonWriter &json) {
+  xSemaphoreTake(alarmsMutex, portMAX_DELAY);
+  uint32_t version = alarmsVersion;
+  xSemaphoreGive(alarmsMutex);
+  json.beginObject();
+  json.number("version", version);
+  json.endObject();
+}
+
+// JSON события собирается в буфере на стеке eventTask
+#define EVENT_JSON_MAX 384
+
+void publishEvent(EventType type, void (*toJson)(JsonWriter &), bool changedOnly) {
+  char buffer[EVENT_JSON_MAX];
+  TemplateWriter out(buffer, sizeof(buffer));
+  JsonWriter json(out);
+  toJson(json);
+  if (out.overflowed()) {
+    return;
+  }
+  xSemaphoreTake(eventsMutex, portMAX_DELAY);
+  eventHub.publish(type, out.data(), out.length(), changedOnly);
+  xSemaphoreGive(eventsMutex);
+}
+
+// Рассылка событий страницам: время — на границе каждой секунды UTC,
+// пока есть подписчики; остальное — по битам pendingEvents. JSON
+// строится вне eventsMutex, чтобы не держать подписку новых клиентов.
+void eventTask(void *parameter) {
+  int64_t lastSecond = -1;
+  for(;;) {
+    taskHealth.beat(HEALTH_EVENT, millis());
+
+    portENTER_CRITICAL(&eventMux);
+    uint32_t pending = pendingEvents;
+    pendingEvents = 0;
+    portEXIT_CRITICAL(&eventMux);
+
+    if (pending & (1UL << EVENT_PLAYER)) {
+      publishEvent(EVENT_PLAYER, playerToJson, true);
+    }
+    if (pending & (1UL << EVENT_ALARM)) {
+      publishEvent(EVENT_ALARM, strikeToJson, false);
+    }
+    if (pending & (1UL << EVENT_SCHEDULE)) {
+      publishEvent(EVENT_SCHEDULE, scheduleVersionToJson, true);
+    }
+
+    int64_t utcUs = utcNowUs();
+    int64_t second = utcUs >= 0 ? utcUs / US_PER_SECOND : esp_timer_get_time() / US_PER_SECOND;
+    bool listening = eventHub.clients() > 0;
+    if (listening && (second != lastSecond || (pending & (1UL << EVENT_TIME)))) {
+      lastSecond = second;
+      publishEvent(EVENT_TIME, timeToJson, false);
+    }
+
+    uint32_t waitMs = EVENT_TASK_MAX_WAIT_MS;
+    if (utcUs >= 0) {
+      waitMs = (uint32_t)((US_PER_SECOND - utcUs % US_PER_SECOND) / 1000) + 1;
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+  }
+}
+
+// Запись журнала во flash: низший приоритет, запись в SPIFFS не
+// задерживает ни удары, ни HTTP. Событие уходит во flash сразу,
+// чтобы обрыв питания терял как можно меньше.
+void journalTask(void *parameter) {
+  for(;;) {
+    taskHealth.beat(HEALTH_JOURNAL, millis());
+
+    for (;;) {
+      JournalRecord record;
+      portENTER_CRITICAL(&journalMux);
+      bool found = journalQueue.pop(record);
+      portEXIT_CRITICAL(&journalMux);
+      if (!found) {
+        break;
+      }
+      TRACE_SCOPE("journal_append", record.type);
+      xSemaphoreTake(journalMutex, portMAX_DELAY);
+      journal.append(record);
+      xSemaphoreGive(journalMutex);
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(JOURNAL_TASK_MAX_WAIT_MS));
+  }
+}
+
+// Вызывается под alarmsMutex после каждого изменения набора. Версия
+// растёт, только когда новая копия записана и прочитана: при ошибке
+// во flash остаётся прежний набор с прежней версией.
+bool saveAlarms() {
+  if (!alarmStore.commit(scheduler, alarmsVersion + 1)) {
+    return false;
+  }
+  alarmsVersion++;
+  return true;
+}
+
+// Файл прежних прошивок: заголовок без CRC и записи; false — файла нет
+// или он повреждён
+bool loadLegacyAlarms() {
+  File file = SPIFFS.open(ALARMS_LEGACY_FILE, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  uint32_t magic = 0;
+  uint16_t version = 0;
+  uint16_t count = 0;
+  uint32_t setVersion = 0;
+  file.read((uint8_t *)&magic, sizeof(magic));
+  file.read((uint8_t *)&version, sizeof(version));
+  file.read((uint8_t *)&count, sizeof(count));
+  // Версия 1 — без номера версии набора
+  if (version >= 2) {
+    file.read((uint8_t *)&setVersion, sizeof(setVersion));
+  }
+  if (magic != ALARM_STORE_MAGIC || version < 1 || version > 2 || count > ALARM_MAX_COUNT) {
+    Serial.println("Файл будильников повреждён, игнорируется");
+    file.close();
+    return false;
+  }
+  alarmsVersion = setVersion;
+  scheduler.clear();
+  AlarmEntry alarm;
+  for (uint16_t i = 0; i < count; i++) {
+    if (file.read((uint8_t *)&alarm, sizeof(alarm)) != sizeof(alarm)) {
+      break;
+    }
+    scheduler.upsert(alarm);
+  }
+  file.close();
+  return true;
+}
+
+void loadAlarms() {
+  xSemaphoreTake(alarmsMutex, portMAX_DELAY);
+  if (!alarmStore.load(scheduler, alarmsVersion) && loadLegacyAlarms()) {
+    // Прежний файл удаляется, только когда набор лёг в слоты
+    if (saveAlarms()) {
+      SPIFFS.remove(ALARMS_LEGACY_FILE);
+      Serial.println("Будильники перенесены в новый формат");
+    }
+  }
+  xSemaphoreGive(alarmsMutex);
+  Serial.println("Загружено будильников: " + String(scheduler.size()));
+}
+
+// Возвращает набор к сохранённому во flash после неудачной записи.
+// Вызывается под alarmsMutex.
+void restoreAlarms() {
+  uint32_t version;
+  if (!alarmStore.load(scheduler, version) && !loadLegacyAlarms()) {
+    scheduler.clear();
+  }
+}
+
+void appendScheduledAlarm(const AlarmEntry &alarm, void *ctx) {
+  occurrenceToJson(OccurrenceCache::fromAlarm(alarm), *static_cast<JsonWriter *>(ctx));
+}
+
+// Расписание дня: из кэша, а вне его окна — из индекса планировщика
+// по дню недели. Вызывается под alarmsMutex.
+void dayScheduleToJson(int32_t day, JsonWriter &json) {
+  char date[11];
+  formatIsoDate(day, date);
+  uint8_t weekday = weekdayFromDays(day);
+  json.beginObject();
+  json.string("date", date);
+  json.number("weekday", weekday);
+  json.beginArray("alarms");
+  if (occurrences.covers(day)) {
+    OccurrenceList list = occurrences.day(day);
+    for (size_t i = 0; i < list.size(); i++) {
+      occurrenceToJson(list[i], json);
+    }
+  } else {
+    scheduler.forEachOnWeekday(weekday, appendScheduledAlarm, &json);
+  }
+  json.endArray();
+  json.endObject();
+}
+
+// Отдаёт встроенный ресурс прямо из flash. Повторный запрос с тем же
+// ETag получает 304 без тела.
+void sendWebAsset(const WebAsset &asset, int code) {
+  server.sendHeader("ETag", asset.etag);
+  server.sendHeader("Cache-Control", asset.immutable ? "public, max-age=31536000, immutable" : "no-cache");
+  if (code == 200 && server.header("If-None-Match").contains(asset.etag)) {
+    server.send(304);
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(code, asset.contentType, (PGM_P)asset.data, asset.length);
+}
 
-// Подключение DFPlayer Mini:
-// ESP32 GPIO16 (RX2) -> DFPlayer Mini TX
-// ESP32 GPIO17 (TX2) -> DFPlayer Mini RX
-HardwareSerial dfSerial(2); // UART2: RX=16, TX=17
-DFRobotDFPlayerMini dfPlayer;
+// Значения слотов страниц /status, /wifi, /audio
+class PageContext : public TemplateContext {
+public:
+  void slot(uint8_t slot, TemplateWriter &out) override {
+    switch (slot) {
+      case SLOT_WIFI_STATE:
+        out.text(WiFi.status() == WL_CONNECTED ? "Подключен" : "Отключен");
+        break;
+      case SLOT_IP: {
+        IPAddress ip = WiFi.localIP();
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        out.raw(text);
+        break;
+      }
+      case SLOT_SSID:
+        out.text(config.wifiSsid);
+        break;
+      case SLOT_PASS:
+        out.text(config.wifiPass);
+        break;
+      case SLOT_DFPLAYER_STATE: {
+        uint32_t state = playerStatus.state.load(std::memory_order_acquire);
+        if (!(state & 1)) {
+          out.text("Не найден");
+        } else if (!(state & 2)) {
+          out.text("Нет SD-карты");
+        } else if (state & 4) {
+          out.text("Играет трек ");
+          out.number(state >> 8);
+        } else {
+          out.text("Готов");
+        }
+        break;
+      }
+      case SLOT_VOLUME:
+        out.number(config.volume);
+        break;
+    }
+  }
 
-String wifi_ssid = DEFAULT_WIFI_SSID;
-String wifi_pass = DEFAULT_WIFI_PASSWORD;
-WebServer server(80);
+  bool section(uint8_t slot) override {
+    return slot == SLOT_WIFI_CONNECTED && WiFi.status() == WL_CONNECTED;
+  }
+};
 
-// Task handles for watchdog management
-TaskHandle_t mainTaskHandle = NULL;
-TaskHandle_t webServerTaskHandle = NULL;
+// {"status":status,"id":id} — команда принята в очередь
+void sendAccepted(const char *status, uint32_t id) {
+  JsonReply reply(server, 202);
+  reply.json().beginObject();
+  reply.json().string("status", status);
+  reply.json().number("id", id);
+  reply.json().endObject();
+  reply.send();
+}
 
-// Web server task function
-void webServerTask(void *parameter) {
-  for(;;) {
-    // Reset watchdog timer for this task
-    esp_task_wdt_reset();
-    
-    // Small delay to prevent watchdog from triggering
-    vTaskDelay(pdMS_TO_TICKS(1000));
+// Групповая команда отправлена; track == 0 — команда без трека (stop)
+void sendGroupAccepted(uint16_t track, const GroupTrigger &trigger) {
+  JsonReply reply(server, 202);
+  reply.json().beginObject();
+  reply.json().string("status", "sent");
+  if (track != 0) {
+    reply.json().number("track", track);
   }
+  reply.json().number("sequence", trigger.sequence);
+  reply.json().number("fire_at_ms", trigger.fireAtUs / 1000);
+  reply.json().endObject();
+  reply.send();
 }
 
-// Main application task function
-void mainTask(void *parameter) {
-  for(;;) {
-    // Reset watchdog timer for this task
-    esp_task_wdt_reset();
-    
-    // Main application logic can go here
-    // For now, just a delay
-    vTaskDelay(pdMS_TO_TICKS(1000));
+#if GONG_TRACE
+// Имя потока task в процессе-ядре core для Chrome trace
+void traceThreadName(JsonWriter &json, uint8_t core, const void *task, const char *name) {
+  json.beginObject();
+  json.string("name", "thread_name");
+  json.string("ph", "M");
+  json.number("pid", core);
+  json.number("tid", traceTaskId(task));
+  json.beginObject("args");
+  json.string("name", name);
+  json.endObject();
+  json.endObject();
+}
+#endif
+
+// Необязательный аргумент запроса из [0, max]; нет — value не меняется
+bool uintArg(const char *name, uint32_t max, uint32_t &value) {
+  if (!server.hasArg(name)) {
+    return true;
   }
+  long number;
+  if (!server.arg(name).toLong(number) || number < 0 || (unsigned long)number > max) {
+    return false;
+  }
+  value = (uint32_t)number;
+  return true;
+}
+
+// Необязательный аргумент запроса в мс из [0, max]
+bool msArg(const char *name, uint32_t max, uint32_t &value) {
+  return uintArg(name, max, value);
 }
 
-void readWiFiConfig() {
-  File configFile = SPIFFS.open("/config.txt", FILE_READ);
+// Сеанс из duration_ms, fade_in_ms и fade_out_ms запроса
+bool playbackPlanFromArgs(PlaybackPlan &plan) {
+  plan = {0, 0, 0, 0};
+  return msArg("duration_ms", PLAYBACK_MAX_DURATION_MS, plan.durationMs) &&
+         msArg("fade_in_ms", PLAYBACK_MAX_FADE_MS, plan.fadeInMs) &&
+         msArg("fade_out_ms", PLAYBACK_MAX_FADE_MS, plan.fadeOutMs);
+}
+
+void setDefaultConfig(GongConfig &cfg) {
+  memset(&cfg, 0, sizeof(cfg));
+  copyConfigString(cfg.wifiSsid, sizeof(cfg.wifiSsid), DEFAULT_WIFI_SSID, strlen(DEFAULT_WIFI_SSID));
+  copyConfigString(cfg.wifiPass, sizeof(cfg.wifiPass), DEFAULT_WIFI_PASSWORD, strlen(DEFAULT_WIFI_PASSWORD));
+  cfg.volume = 20;
+  copyConfigString(cfg.timezone, sizeof(cfg.timezone), GONG_TIMEZONE, strlen(GONG_TIMEZONE));
+  copyConfigString(cfg.ntpServer, sizeof(cfg.ntpServer), NTP_SERVER_1, strlen(NTP_SERVER_1));
+  cfg.missedGraceSec = 60;
+}
+
+// Перенос config.txt прежних прошивок в configStore
+bool migrateLegacyConfig() {
+  File configFile = SPIFFS.open(LEGACY_CONFIG_FILE, FILE_READ);
   if (!configFile) {
-    Serial.println("Не удалось открыть config.txt для чтения, используются значения по умолчанию");
-    return;
+    return false;
   }
+  char line[128];
   while (configFile.available()) {
-    String line = configFile.readStringUntil('\n');
-    line.trim();
-    if (line.startsWith("wifi_ssid=")) {
-      wifi_ssid = line.substring(String("wifi_ssid=").length());
-    } else if (line.startsWith("wifi_pass=")) {
-      wifi_pass = line.substring(String("wifi_pass=").length());
-    }
+    size_t length = configFile.readBytesUntil('\n', line, sizeof(line));
+    applyLegacyConfigLine(line, length, config);
   }
   configFile.close();
-  Serial.print("WiFi параметры из файла: SSID=");
-  Serial.print(wifi_ssid);
-  Serial.print(", PASS=");
-  Serial.println(wifi_pass);
+  if (!configStore.commit(config)) {
+    Serial.println("Не удалось сохранить перенесённый конфиг");
+    return false;
+  }
+  SPIFFS.remove(LEGACY_CONFIG_FILE);
+  Serial.println("config.txt перенесён в двоичный конфиг");
+  return true;
 }
 
-bool connectWiFi(int maxAttempts, int retryDelayMs) {
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(wifi_ssid.c_str(), wifi_pass.c_str());
-  Serial.print("Подключение к WiFi");
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < maxAttempts) {
-    delay(retryDelayMs);
-    Serial.print(".");
-    attempts++;
-  }
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println();
-    Serial.print("WiFi подключен. IP адрес: ");
-    Serial.println(WiFi.localIP());
-    return true;
-  } else {
-    Serial.println();
-    Serial.println("Ошибка подключения к WiFi");
-    return false;
+void loadConfig() {
+  setDefaultConfig(config);
+  if (configStore.load(config)) {
+    Serial.printf("Конфиг: версия %u, запись #%u\n", configStore.loadedVersion(), configStore.sequence());
+  } else if (!migrateLegacyConfig()) {
+    Serial.println("Конфиг не найден, используются значения по умолчанию");
   }
+  Serial.printf("WiFi SSID=%s\n", config.wifiSsid);
 }
 
-void setup() {
-  Serial.begin(115200);
-  delay(1000);
-  
-  // Initialize watchdog timer
-  esp_task_wdt_init(10, true); // 10 second timeout, panic on timeout
-  esp_task_wdt_add(NULL); // Add current task (setup task) to watchdog
-  
-  // Инициализация SPIFFS
+// События WiFi приходят из системной задачи: передаём их менеджеру
+// и будим loop(), где выполняются переходы
+void onWiFiEvent(WiFiEvent_t event) {
+  TRACE_INSTANT("wifi_event", (uint32_t)event);
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      wifiManager.onEvent(WiFiLinkEvent::Connected);
+      break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      wifiManager.onEvent(WiFiLinkEvent::GotIp);
+      bootPipeline.complete(BOOT_WIFI_CONNECTED);
+      if (timeTaskHandle != NULL) {
+        xTaskNotifyGive(timeTaskHandle);
+      }
+      if (groupTaskHandle != NULL) {
+        xTaskNotifyGive(groupTaskHandle);
+      }
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      wifiManager.onEvent(WiFiLinkEvent::Disconnected);
+      break;
+    default:
+      return;
+  }
+  if (loopTaskHandle != NULL) {
+    xTaskNotifyGive(loopTaskHandle);
+  }
+}
+
+void logWiFiState(WiFiManager::State state) {
+  switch (state) {
+    case WiFiManager::CONNECTING:
+      Serial.println(wifiManager.hasCachedAp()
+        ? "Подключение к WiFi (известная точка доступа)..."
+        : "Подключение к WiFi...");
+      break;
+    case WiFiManager::CONNECTED:
+      Serial.print("WiFi подключен. IP адрес: ");
+      Serial.println(WiFi.localIP());
+      break;
+    case WiFiManager::BACKOFF:
+      Serial.println("Ошибка подключения к WiFi, повтор попытки " + String(wifiManager.attempt()));
+      break;
+    case WiFiManager::IDLE:
+      break;
+  }
+}
+
+// Синхронизация времени: обмен SNTP, пока есть WiFi; между обменами и
+// без сети время идёт по модели ухода. Модель обновляется на копии,
+// чтобы МНК не считался внутри критической секции.
+// Не под watchdog: DNS и ожидание ответа дольше его периода.
+void timeTask(void *parameter) {
+  TickType_t wait = 0;
+  for(;;) {
+    ulTaskNotifyTake(pdTRUE, wait);
+    if (WiFi.status() != WL_CONNECTED) {
+      wait = portMAX_DELAY; // разбудит onWiFiEvent
+      continue;
+    }
+    char server[sizeof(config.ntpServer)];
+    portENTER_CRITICAL(&configMux);
+    memcpy(server, config.ntpServer, sizeof(server));
+    portEXIT_CRITICAL(&configMux);
+    TimeSample sample;
+    bool synced;
+    {
+      TRACE_SCOPE("sntp");
+      synced = sntpExchange(server, TIME_SNTP_TIMEOUT_MS, sample) ||
+               sntpExchange(NTP_SERVER_2, TIME_SNTP_TIMEOUT_MS, sample);
+    }
+    if (!synced) {
+      Serial.println("SNTP: нет ответа от серверов времени");
+      wait = pdMS_TO_TICKS(TIME_RETRY_MS);
+      continue;
+    }
+    portENTER_CRITICAL(&timeMux);
+    TimeService next = timeService;
+    portEXIT_CRITICAL(&timeMux);
+    if (!next.addSample(sample)) {
+      wait = pdMS_TO_TICKS(TIME_RETRY_MS);
+      continue;
+    }
+    portENTER_CRITICAL(&timeMux);
+    timeService = next;
+    portEXIT_CRITICAL(&timeMux);
+
+    Serial.printf("SNTP: поправка %lld мс, уход %.2f ppm, задержка %u мс\n",
+                  (long long)(next.lastOffsetUs() / 1000), next.driftPpb() / 1000.0, sample.delayUs / 1000);
+    bootPipeline.complete(BOOT_TIME_SYNCED);
+    journalEvent(JournalEvent::TimeSync, 0, 0, 0, next.lastOffsetUs());
+    notifyTiming(TIMING_TIME);
+    notifyScheduleChanged();
+    uint32_t syncs = next.syncCount();
+    wait = pdMS_TO_TICKS(syncs < 4 ? TIME_POLL_FAST_MS : syncs < 8 ? TIME_POLL_MEDIUM_MS : TIME_POLL_SLOW_MS);
+  }
+}
+
+void bootFs() {
   if (!SPIFFS.begin(true)) {
     Serial.println("Ошибка монтирования SPIFFS");
     while (1) delay(1000);
   } else {
     Serial.println("SPIFFS успешно смонтирован");
   }
+}
 
-  // Пример записи файла конфигурации (только если файла нет)
-  if (!SPIFFS.exists("/config.txt")) {
-    File configFile = SPIFFS.open("/config.txt", FILE_WRITE);
-    if (configFile) {
-      configFile.println("wifi_ssid=" DEFAULT_WIFI_SSID);
-      configFile.println("wifi_pass=" DEFAULT_WIFI_PASSWORD);
-      configFile.close();
-      Serial.println("Конфиг записан по умолчанию");
-    }
+// Настройки: одно чтение записи фиксированного размера
+void bootConfig() {
+  loadConfig();
+}
+
+// Подключение к WiFi в фоне: дальше загрузка не ждёт соединения.
+// Со статическим IP нет обмена DHCP, с известной точкой доступа —
+// сканирования каналов.
+void bootWiFi() {
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false); // переподключением управляет wifiManager
+  WiFi.onEvent(onWiFiEvent);
+  wifiManager.setNetwork(networkFromConfig(config));
+  wifiManager.start(millis());
+  logWiFiState(wifiManager.state());
+}
+
+// Будильники из flash; время — из RTC-памяти после сброса, по SNTP
+// в фоне после подключения
+void bootAlarms() {
+  alarmsMutex = xSemaphoreCreateMutex();
+  loadAlarms();
+  applyTimezone();
+  if (esp_reset_reason() != ESP_RST_POWERON &&
+      timeService.restoreAnchor(timeAnchor, esp_timer_get_time(), esp_clk_rtc_time())) {
+    Serial.printf("Время восстановлено из RTC-памяти, точность %u мс\n",
+                  timeService.uncertaintyUs(esp_timer_get_time()) / 1000);
+  }
+  esp_timer_create_args_t alarmTimerArgs = {};
+  alarmTimerArgs.callback = onAlarmTimer;
+  alarmTimerArgs.name = "alarm";
+  esp_timer_create(&alarmTimerArgs, &alarmTimer);
+  esp_timer_create_args_t groupTimerArgs = {};
+  groupTimerArgs.callback = onGroupTriggerTimer;
+  groupTimerArgs.name = "group";
+  esp_timer_create(&groupTimerArgs, &groupTriggerTimer);
+  esp_timer_create_args_t playbackTimerArgs = {};
+  playbackTimerArgs.callback = onPlaybackTimer;
+  playbackTimerArgs.name = "playback";
+  esp_timer_create(&playbackTimerArgs, &playbackTimer);
+  fireLateAlarm = fireLateStats.add("alarm");
+  fireLateGroup = fireLateStats.add("group");
+  groupSenderId = esp_random();
+}
+
+// Инициализация DFPlayer Mini
+// Без ожидания ответа: плеер появится в состоянии, когда ответит
+void bootAudio() {
+  dfSerial.begin(9600, SERIAL_8N1, 16, 17); // RX=16, TX=17
+  dfSerial.onReceive(onDfPlayerReceive);
+  dfPlayer.begin(millis());
+#ifdef DFPLAYER_BUSY_PIN
+  dfBusyPin.begin(DFPLAYER_BUSY_PIN, &audioTaskHandle);
+#endif
+  strikeLatencyPrestaged = strikeLatencyStats.add("prestaged");
+  strikeLatencyCold = strikeLatencyStats.add("cold");
+  // Громкость 0-30: TimingTask примет её первой командой
+  PlaybackPlan plan = {0, 0, 0, 0};
+  submitControl(AudioOp::Volume, config.volume, plan);
+}
+
+// Журнал: заголовок, первая и последняя запись каждого сегмента.
+// Время загрузки уже восстановлено из RTC-памяти, если оно было.
+void bootJournal() {
+  journalMutex = xSemaphoreCreateMutex();
+  journal.recover();
+  Serial.printf("Журнал: %u записей, следующая #%u\n", (unsigned)journal.recordCount(), journal.nextSequence());
+  if (journal.tornCount() > 0) {
+    Serial.printf("Журнал: сегментов с оборванным хвостом %u, запись — с нового сегмента\n", journal.tornCount());
   }
+  journalEvent(JournalEvent::Boot, (uint16_t)esp_reset_reason(), 0, 0, 0);
+}
 
-  // Чтение параметров WiFi из файла
-  readWiFiConfig();
+// Состояние прошивки для маршрутов api_routes.h (только webServerTask)
+class FirmwareApi : public ApiHost {
+public:
+  GongWebServer::THandlerFunction route(const char *name, GongWebServer::THandlerFunction handler) override {
+    return timed(name, handler);
+  }
 
-  // Подключение к WiFi с повторными попытками
-  int maxRetries = 5;
-  int retryDelay = 2000; // 2 секунды
-  int tries = 0;
-  while (!connectWiFi(10, 500) && tries < maxRetries) {
-    Serial.print("Повторная попытка подключения к WiFi (" + String(tries+1) + "/" + String(maxRetries) + ")\n");
-    tries++;
-    delay(3000);
+  const GongConfig &config() override { return ::config; }
+  bool commitConfig(const GongConfig &next) override {
+    if (!configStore.commit(next)) {
+      return false;
+    }
+    publishConfig(next);
+    return true;
   }
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("Не удалось подключиться к WiFi после нескольких попыток. Перезагрузка...");
-    delay(5000);
-    ESP.restart();
+  uint32_t submitVolume(uint8_t volume) override {
+    PlaybackPlan plan = {0, 0, 0, 0};
+    return submitControl(AudioOp::Volume, volume, plan);
   }
+  uint32_t startWiFiTrial(const WiFiNetwork &network) override { return ::startWiFiTrial(network); }
 
-  // Инициализация DFPlayer Mini
-  dfSerial.begin(9600, SERIAL_8N1, 16, 17); // RX=16, TX=17
-  if (!dfPlayer.begin(dfSerial)) {
-    Serial.println("DFPlayer Mini не найден!");
-  } else {
-    Serial.println("DFPlayer Mini готов!");
-    dfPlayer.volume(20); // Громкость 0-30
-    // dfPlayer.play(1);    // Воспроизвести первый трек на SD (убрано для ручного управления)
-  }
-
-  // Главная страница
-  server.on("/", HTTP_GET, [](){
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<meta charset='UTF-8'>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-    html += "<title>ESP32 Гонг Дуллабха</title>";
-    html += "</head><body>";
-    html += "<h1>ESP32 Гонг Дуллабха</h1>";
-    html += "<p>Добро пожаловать в систему управления гонгом!</p>";
-    html += "<ul>";
-    html += "<li><a href='/wifi'>Настройка WiFi</a></li>";
-    html += "<li><a href='/status'>Статус системы</a></li>";
-    html += "<li><a href='/audio'>Управление аудио</a></li>";
-    html += "</ul>";
-    html += "</body></html>";
-    server.send(200, "text/html; charset=utf-8", html);
-  });
+  void lockAlarms() override { xSemaphoreTake(alarmsMutex, portMAX_DELAY); }
+  void unlockAlarms() override { xSemaphoreGive(alarmsMutex); }
+  AlarmScheduler &scheduler() override { return ::scheduler; }
+  OccurrenceCache &occurrences() override { return ::occurrences; }
+  uint32_t alarmsVersion() override { return ::alarmsVersion; }
+  bool saveAlarms() override { return ::saveAlarms(); }
+  void restoreAlarms() override { ::restoreAlarms(); }
+  void scheduleChanged() override { notifyScheduleChanged(); }
+};
+FirmwareApi firmwareApi;
+
+void registerRoutes() {
+  // Статические страницы и скрипты, встроенные в прошивку (gzip)
+  const char *cachedHeaders[] = {"If-None-Match"};
+  server.collectHeaders(cachedHeaders, 1);
+  for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+    const WebAsset *asset = &kWebAssets[i];
+    server.on(asset->path, HTTP_GET, timed(asset->route, [asset](){
+      sendWebAsset(*asset, 200);
+    }));
+  }
 
   // Страница статуса системы
-  server.on("/status", HTTP_GET, [](){
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<meta charset='UTF-8'>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-    html += "<title>Статус системы</title>";
-    html += "</head><body>";
-    html += "<h2>Статус системы</h2>";
-    html += "<p><strong>WiFi:</strong> ";
-    html += (WiFi.status() == WL_CONNECTED ? "Подключен" : "Отключен");
-    html += "</p>";
-    if (WiFi.status() == WL_CONNECTED) {
-      html += "<p><strong>IP адрес:</strong> ";
-      html += WiFi.localIP().toString();
-      html += "</p>";
-      html += "<p><strong>SSID:</strong> ";
-      html += wifi_ssid;
-      html += "</p>";
-    }
-    html += "<p><strong>DFPlayer:</strong> ";
-    html += (dfPlayer.available() ? "Готов" : "Не найден");
-    html += "</p>";
-    html += "<p><a href='/'>Назад</a></p>";
-    html += "</body></html>";
-    server.send(200, "text/html; charset=utf-8", html);
-  });
+  server.on("/status", HTTP_GET, timed("GET /status", [](){
+    PageContext ctx;
+    sendTemplate(server, 200, kTemplate_status, ctx);
+  }));
 
   // Страница управления аудио
-  server.on("/audio", HTTP_GET, [](){
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<meta charset='UTF-8'>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-    html += "<title>Управление аудио</title>";
-    html += "</head><body>";
-    html += "<h2>Управление аудио</h2>";
-    html += "<h3>Воспроизведение</h3>";
-    html += "<button onclick='playAudio()'>Воспроизвести</button> ";
-    html += "<button onclick='stopAudio()'>Остановить</button><br><br>";
-    html += "<h3>Громкость</h3>";
-    html += "<input type='range' id='volume' min='0' max='30' value='20' onchange='setVolume(this.value)'> ";
-    html += "<span id='volValue'>20</span><br><br>";
-    html += "<h3>Выбор трека</h3>";
-    html += "<input type='number' id='track' min='1' max='100' value='1'> ";
-    html += "<button onclick='playTrack()'>Воспроизвести трек</button><br><br>";
-    html += "<p><a href='/'>Назад</a></p>";
-    html += "<script>";
-    html += "function playAudio() { fetch('/api/audio/play', {method:'POST'}).then(r=>r.json()).then(d=>alert(d.status)); }";
-    html += "function stopAudio() { fetch('/api/audio/stop', {method:'POST'}).then(r=>r.json()).then(d=>alert(d.status)); }";
-    html += "function setVolume(val) { document.getElementById('volValue').textContent = val; fetch('/api/audio/volume?value='+val, {method:'POST'}).then(r=>r.json()).then(d=>alert('Громкость: ' + d.volume)); }";
-    html += "function playTrack() { let track = document.getElementById('track').value; fetch('/api/audio/track?num='+track, {method:'POST'}).then(r=>r.json()).then(d=>alert(d.status + ' трек: ' + d.track)); }";
-    html += "</script>";
-    html += "</body></html>";
-    server.send(200, "text/html; charset=utf-8", html);
-  });
+  server.on("/audio", HTTP_GET, timed("GET /audio", [](){
+    PageContext ctx;
+    sendTemplate(server, 200, kTemplate_audio, ctx);
+  }));
 
   // Веб-форма для смены WiFi
-  server.on("/wifi", HTTP_GET, [](){
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<meta charset='UTF-8'>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-    html += "<title>Настройка WiFi</title>";
-    html += "</head><body>";
-    html += "<h2>Настройка WiFi</h2>";
-    html += "<form method='POST' action='/api/wifi'>";
-    html += "SSID: <input name='ssid' value='";
-    html += wifi_ssid;
-    html += "'><br>";
-    html += "Пароль: <input name='pass' type='password' value='";
-    html += wifi_pass;
-    html += "'><br>";
-    html += "<input type='submit' value='Сохранить'>";
-    html += "</form>";
-    html += "<p><a href='/'>Назад</a></p>";
-    html += "</body></html>";
-    server.send(200, "text/html; charset=utf-8", html);
-  });
-
-  // REST API для смены WiFi
-  server.on("/api/wifi", HTTP_POST, [](){
-    String newSsid = server.arg("ssid");
-    String newPass = server.arg("pass");
-    if (newSsid.length() > 0 && newPass.length() > 0) {
-      File configFile = SPIFFS.open("/config.txt", FILE_WRITE);
-      if (configFile) {
-        configFile.println("wifi_ssid=" + newSsid);
-        configFile.println("wifi_pass=" + newPass);
-        configFile.close();
-        String html = "<!DOCTYPE html><html><head>";
-        html += "<meta charset='UTF-8'>";
-        html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-        html += "<title>WiFi сохранен</title>";
-        html += "</head><body>";
-        html += "<h2>WiFi сохранен</h2>";
-        html += "<p>Настройки WiFi успешно сохранены. Устройство перезагружается...</p>";
-        html += "</body></html>";
-        server.send(200, "text/html; charset=utf-8", html);
-        delay(1000);
-        ESP.restart();
-      } else {
-        server.send(500, "text/plain; charset=utf-8", "Ошибка записи файла конфигурации");
-      }
-    } else {
-      server.send(400, "text/plain; charset=utf-8", "SSID и пароль обязательны");
+  server.on("/wifi", HTTP_GET, timed("GET /wifi", [](){
+    PageContext ctx;
+    sendTemplate(server, 200, kTemplate_wifi, ctx);
+  }));
+
+  // Последняя смена сети: {"id":1,"state":"running|applied|rolled_back",
+  // "downtime_ms":420}; до первой смены id = 0, state = "none"
+  server.on("/api/wifi/status", HTTP_GET, timed("GET /api/wifi/status", [](){
+    static const char *kStates[] = {"none", "running", "applied", "rolled_back"};
+    finishWiFiTrial();
+    uint32_t status = wifiTrialStatus.load(std::memory_order_acquire);
+    uint32_t id = status >> 8;
+    uint8_t state = status & 0xFF;
+    // Проба ещё не началась в loop()
+    if (wifiTrialPending.id != 0 && wifiTrialPending.id != id) {
+      id = wifiTrialPending.id;
+      state = WiFiManager::TRIAL_RUNNING;
     }
-  });
+    JsonReply reply(server, 200);
+    JsonWriter &json = reply.json();
+    json.beginObject();
+    json.number("id", id);
+    json.string("state", kStates[state < 4 ? state : 0]);
+    if (state != WiFiManager::TRIAL_RUNNING && id != 0) {
+      json.number("downtime_ms", wifiTrialDowntimeMs.load(std::memory_order_relaxed));
+    }
+    json.string("ssid", config.wifiSsid);
+    json.boolean("connected", WiFi.status() == WL_CONNECTED);
+    json.endObject();
+    reply.send();
+  }));
 
   // --- REST API для управления DFPlayer Mini ---
-  // Воспроизвести текущий трек
-  server.on("/api/audio/play", HTTP_POST, [](){
-    dfPlayer.start();
-    server.send(200, "application/json", "{\"status\":\"playing\"}");
-  });
+  // Команды уходят в TimingTask (сеанс) и дальше в audioTask, ответ —
+  // сразу, с id команды.
+  // Воспроизвести текущий трек: /api/audio/play?duration_ms=30000
+  // &fade_in_ms=1000&fade_out_ms=3000 (без duration_ms — до конца трека)
+  server.on("/api/audio/play", HTTP_POST, timed("POST /api/audio/play", [](){
+    PlaybackPlan plan;
+    if (!playbackPlanFromArgs(plan)) {
+      sendJsonError(server, 400, "invalid duration_ms, fade_in_ms or fade_out_ms");
+      return;
+    }
+    uint32_t id = submitControl(AudioOp::Play, 0, plan);
+    if (id == 0) {
+      sendJsonError(server, 503, "audio queue full");
+      return;
+    }
+    sendAccepted("playing", id);
+  }));
   // Остановить воспроизведение
-  server.on("/api/audio/stop", HTTP_POST, [](){
-    dfPlayer.stop();
-    server.send(200, "application/json", "{\"status\":\"stopped\"}");
-  });
-  // Установить громкость: /api/audio/volume?value=20
-  server.on("/api/audio/volume", HTTP_POST, [](){
-    if (server.hasArg("value")) {
-      int vol = server.arg("value").toInt();
-      vol = constrain(vol, 0, 30);
-      dfPlayer.volume(vol);
-      server.send(200, "application/json", "{\"status\":\"ok\",\"volume\":" + String(vol) + "}");
-    } else {
-      server.send(400, "application/json", "{\"error\":\"volume required\"}");
+  server.on("/api/audio/stop", HTTP_POST, timed("POST /api/audio/stop", [](){
+    PlaybackPlan plan = {0, 0, 0, 0};
+    uint32_t id = submitControl(AudioOp::Stop, 0, plan);
+    if (id == 0) {
+      sendJsonError(server, 503, "audio queue full");
+      return;
+    }
+    sendAccepted("stopped", id);
+  }));
+  // Воспроизвести определённый трек: /api/audio/track?num=1, с теми же
+  // duration_ms, fade_in_ms и fade_out_ms, что у /api/audio/play
+  server.on("/api/audio/track", HTTP_POST, timed("POST /api/audio/track", [](){
+    PlaybackPlan plan;
+    if (!playbackPlanFromArgs(plan)) {
+      sendJsonError(server, 400, "invalid duration_ms, fade_in_ms or fade_out_ms");
+      return;
     }
-  });
-  // Воспроизвести определённый трек: /api/audio/track?num=1
-  server.on("/api/audio/track", HTTP_POST, [](){
     if (server.hasArg("num")) {
       int num = server.arg("num").toInt();
       if (num > 0) {
-        dfPlayer.play(num);
-        server.send(200, "application/json", "{\"status\":\"playing\",\"track\":" + String(num) + "}");
+        uint32_t id = submitControl(AudioOp::Track, num, plan);
+        if (id == 0) {
+          sendJsonError(server, 503, "audio queue full");
+          return;
+        }
+        JsonReply reply(server, 202);
+        reply.json().beginObject();
+        reply.json().string("status", "playing");
+        reply.json().number("track", num);
+        reply.json().number("id", id);
+        reply.json().endObject();
+        reply.send();
       } else {
-        server.send(400, "application/json", "{\"error\":\"invalid track number\"}");
+        sendJsonError(server, 400, "invalid track number");
       }
     } else {
-      server.send(400, "application/json", "{\"error\":\"track number required\"}");
+      sendJsonError(server, 400, "track number required");
+    }
+  }));
+  // Групповой удар на всех устройствах группы: /api/group/play?num=3&delay_ms=500
+  // и /api/group/stop?delay_ms=500. Момент удара — сейчас + delay_ms по UTC.
+  server.on("/api/group/play", HTTP_POST, timed("POST /api/group/play", [](){
+    int num = server.arg("num").toInt();
+    if (num <= 0 || num > 0xFFFF) {
+      sendJsonError(server, 400, "invalid track number");
+      return;
+    }
+    uint32_t delayMs = GROUP_TRIGGER_LEAD_MS;
+    if (!msArg("delay_ms", GROUP_TRIGGER_HORIZON_MS, delayMs)) {
+      sendJsonError(server, 400, "invalid delay_ms");
+      return;
+    }
+    GroupTrigger trigger;
+    const char *error = sendGroupTrigger(GroupTriggerOp::Play, (uint16_t)num, delayMs, trigger);
+    if (error != nullptr) {
+      sendJsonError(server, 503, error);
+      return;
     }
-  });
+    sendGroupAccepted(num, trigger);
+  }));
+  server.on("/api/group/stop", HTTP_POST, timed("POST /api/group/stop", [](){
+    uint32_t delayMs = GROUP_TRIGGER_LEAD_MS;
+    if (!msArg("delay_ms", GROUP_TRIGGER_HORIZON_MS, delayMs)) {
+      sendJsonError(server, 400, "invalid delay_ms");
+      return;
+    }
+    GroupTrigger trigger;
+    const char *error = sendGroupTrigger(GroupTriggerOp::Stop, 0, delayMs, trigger);
+    if (error != nullptr) {
+      sendJsonError(server, 503, error);
+      return;
+    }
+    sendGroupAccepted(0, trigger);
+  }));
+  // Состояние команды: /api/audio/command?id=5
+  server.on("/api/audio/command", HTTP_GET, timed("GET /api/audio/command", [](){
+    uint32_t id = server.arg("id").toInt();
+    AudioCommandStatus status = audioLog.status(id);
+    JsonReply reply(server, status == AudioCommandStatus::Unknown ? 404 : 200);
+    reply.json().beginObject();
+    reply.json().number("id", id);
+    reply.json().string("status", audioCommandStatusName(status));
+    reply.json().endObject();
+    reply.send();
+  }));
+  // Кэшированное состояние плеера (без обмена с DFPlayer)
+  server.on("/api/audio/status", HTTP_GET, timed("GET /api/audio/status", [](){
+    JsonReply reply(server, 200);
+    playerToJson(reply.json());
+    reply.send();
+  }));
   // --- конец REST API DFPlayer ---
 
+  // --- REST API будильников (формат как в backend/app.py) ---
+  // Текущее локальное время и состояние синхронизации
+  server.on("/api/time", HTTP_GET, timed("GET /api/time", [](){
+    JsonReply reply(server, 200);
+    timeToJson(reply.json());
+    reply.send();
+  }));
+  // Поток событий для страниц (text/event-stream): time, player, alarm,
+  // schedule. Соединение остаётся открытым и переходит к eventTask.
+  server.on("/api/events", HTTP_GET, timed("GET /api/events", [](){
+    xSemaphoreTake(eventsMutex, portMAX_DELAY);
+    bool full = eventHub.full();
+    xSemaphoreGive(eventsMutex);
+    if (full) {
+      sendJsonError(server, 503, "too many event clients");
+      return;
+    }
+    static const char head[] =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/event-stream\r\n"
+      "Cache-Control: no-cache\r\n"
+      "Connection: keep-alive\r\n\r\n"
+      "retry: 3000\n\n";
+    WiFiClient client = server.detachClient();
+    client.setNoDelay(true);
+    client.write((const uint8_t *)head, sizeof(head) - 1);
+    xSemaphoreTake(eventsMutex, portMAX_DELAY);
+    bool first = eventHub.clients() == 0;
+    eventHub.subscribe(new WiFiEventStream(client));
+    xSemaphoreGive(eventsMutex);
+    // Без подписчиков время не рассылалось — сохранённый кадр устарел
+    if (first) {
+      raiseEvent(EVENT_TIME);
+    }
+  }));
+  // Громкость, смена WiFi и будильники (api_routes.h)
+  registerApiRoutes(server, firmwareApi);
+  // Расписание на день: /api/schedule?date=YYYY-MM-DD
+  server.on("/api/schedule", HTTP_GET, timed("GET /api/schedule", [](){
+    int32_t day;
+    if (!parseIsoDate(server.arg("date").c_str(), day)) {
+      sendJsonError(server, 400, "date must be YYYY-MM-DD");
+      return;
+    }
+    JsonReply reply(server, 200);
+    xSemaphoreTake(alarmsMutex, portMAX_DELAY);
+    dayScheduleToJson(day, reply.json());
+    xSemaphoreGive(alarmsMutex);
+    reply.send();
+  }));
+  // Расписание на месяц: /api/calendar?month=YYYY-MM
+  server.on("/api/calendar", HTTP_GET, timed("GET /api/calendar", [](){
+    int32_t year;
+    uint32_t month;
+    if (!parseIsoMonth(server.arg("month").c_str(), year, month)) {
+      sendJsonError(server, 400, "month must be YYYY-MM");
+      return;
+    }
+    int32_t first = daysFromCivil(year, month, 1);
+    uint8_t count = daysInMonth(year, month);
+    StrView monthArg = server.arg("month");
+    JsonReply reply(server, 200);
+    JsonWriter &json = reply.json();
+    json.beginObject();
+    json.string("month", monthArg.data, monthArg.length);
+    json.beginArray("days");
+    xSemaphoreTake(alarmsMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < count; i++) {
+      dayScheduleToJson(first + i, json);
+    }
+    xSemaphoreGive(alarmsMutex);
+    json.endArray();
+    json.endObject();
+    reply.send();
+  }));
+  // --- конец REST API будильников ---
+
+  // Настройки (без пароля WiFi)
+  server.on("/api/config", HTTP_GET, timed("GET /api/config", [](){
+    static const char *addressKeys[] = {"ip", "gateway", "subnet", "dns"};
+    const uint8_t *addresses[] = {config.ip, config.gateway, config.subnet, config.dns};
+    JsonReply reply(server, 200);
+    JsonWriter &json = reply.json();
+    json.beginObject();
+    json.number("sequence", configStore.sequence());
+    json.string("ssid", config.wifiSsid);
+    json.number("volume", config.volume);
+    json.boolean("static_ip", config.staticIp != 0);
+    for (size_t i = 0; i < 4; i++) {
+      char address[16];
+      snprintf(address, sizeof(address), "%u.%u.%u.%u",
+               addresses[i][0], addresses[i][1], addresses[i][2], addresses[i][3]);
+      json.string(addressKeys[i], address);
+    }
+    json.string("timezone", config.timezone);
+    json.string("ntp_server", config.ntpServer);
+    json.number("missed_grace_sec", config.missedGraceSec);
+    json.boolean("trigger_key_set", config.triggerKey[0] != '\0');
+    json.endObject();
+    reply.send();
+  }));
+  // Частичное обновление: static_ip=1&ip=...&gateway=...&subnet=...&dns=...
+  // &timezone=...&ntp_server=...&missed_grace_sec=...&trigger_key=...&volume=...
+  // Применяется сразу; новая адресация — пробой сети, как POST /api/wifi,
+  // и сохраняется, только когда устройство с ней подключилось.
+  server.on("/api/config", HTTP_POST, timed("POST /api/config", [](){
+    GongConfig next = config;
+    if (server.hasArg("volume")) {
+      long volume;
+      if (!server.arg("volume").toLong(volume) || volume < 0 || volume > 30) {
+        sendJsonError(server, 400, "invalid volume");
+        return;
+      }
+      next.volume = (uint8_t)volume;
+    }
+    if (server.hasArg("static_ip")) {
+      next.staticIp = server.arg("static_ip").toInt() != 0;
+    }
+    const char *addressArgs[] = {"ip", "gateway", "subnet", "dns"};
+    uint8_t *addresses[] = {next.ip, next.gateway, next.subnet, next.dns};
+    for (size_t i = 0; i < 4; i++) {
+      if (!server.hasArg(addressArgs[i])) {
+        continue;
+      }
+      IPAddress address;
+      if (!address.fromString(server.arg(addressArgs[i]).c_str())) {
+        sendJsonError(server, 400, "invalid address");
+        return;
+      }
+      for (int b = 0; b < 4; b++) {
+        addresses[i][b] = address[b];
+      }
+    }
+    if (server.hasArg("timezone")) {
+      StrView tz = server.arg("timezone");
+      if (tz.length == 0 || tz.length >= sizeof(next.timezone)) {
+        sendJsonError(server, 400, "invalid timezone");
+        return;
+      }
+      copyConfigString(next.timezone, sizeof(next.timezone), tz.data, tz.length);
+    }
+    if (server.hasArg("ntp_server")) {
+      StrView ntp = server.arg("ntp_server");
+      if (ntp.length == 0 || ntp.length >= sizeof(next.ntpServer)) {
+        sendJsonError(server, 400, "invalid ntp_server");
+        return;
+      }
+      copyConfigString(next.ntpServer, sizeof(next.ntpServer), ntp.data, ntp.length);
+    }
+    if (server.hasArg("missed_grace_sec")) {
+      long grace;
+      if (!server.arg("missed_grace_sec").toLong(grace) || grace < 0 || grace > 3600) {
+        sendJsonError(server, 400, "invalid missed_grace_sec");
+        return;
+      }
+      next.missedGraceSec = (uint16_t)grace;
+    }
+    // Общий ключ групповых ударов; пустая строка выключает приём
+    if (server.hasArg("trigger_key")) {
+      StrView key = server.arg("trigger_key");
+      if (key.length >= sizeof(next.triggerKey)) {
+        sendJsonError(server, 400, "invalid trigger_key");
+        return;
+      }
+      copyConfigString(next.triggerKey, sizeof(next.triggerKey), key.data, key.length);
+    }
+    // Адресация меняется только после подключения с ней
+    WiFiNetwork network = networkFromConfig(next);
+    WiFiNetwork current = networkFromConfig(config);
+    bool networkChanged = memcmp(&network, &current, sizeof(network)) != 0;
+    if (networkChanged && wifiTrialPending.id != 0) {
+      sendJsonError(server, 409, "wifi change in progress");
+      return;
+    }
+    networkToConfig(current, next);
+    if (!configStore.commit(next)) {
+      sendJsonError(server, 500, "config write failed");
+      return;
+    }
+    bool volumeChanged = next.volume != config.volume;
+    bool timezoneChanged = strcmp(next.timezone, config.timezone) != 0;
+    bool ntpChanged = strcmp(next.ntpServer, config.ntpServer) != 0;
+    publishConfig(next);
+    // Громкость уходит плееру только после записи, как новая сеть: при
+    // ошибке записи плеер не расходится с настройками. volume_id 0 —
+    // очередь заполнена: громкость сохранена, плеер получит её при
+    // загрузке или через /api/audio/volume
+    uint32_t volumeId = 0;
+    if (volumeChanged) {
+      PlaybackPlan plan = {0, 0, 0, 0};
+      volumeId = submitControl(AudioOp::Volume, next.volume, plan);
+    }
+    // Часовой пояс применяет TimingTask, затем пересчитывает расписание
+    if (timezoneChanged) {
+      notifyTiming(TIMING_ZONE);
+    }
+    if (ntpChanged && timeTaskHandle != NULL) {
+      xTaskNotifyGive(timeTaskHandle);
+    }
+    uint32_t trialId = networkChanged ? startWiFiTrial(network) : 0;
+    JsonReply reply(server, networkChanged ? 202 : 200);
+    reply.json().beginObject();
+    reply.json().string("status", "saved");
+    reply.json().number("sequence", configStore.sequence());
+    if (volumeChanged) {
+      reply.json().number("volume_id", volumeId);
+    }
+    if (networkChanged) {
+      reply.json().number("wifi_trial", trialId);
+    }
+    reply.json().endObject();
+    reply.send();
+  }));
+
+  // Задержки обработки по маршрутам: /api/stats/routes
+  server.on("/api/stats/routes", HTTP_GET, timed("GET /api/stats/routes", [](){
+    JsonReply reply(server, 200);
+    JsonWriter &json = reply.json();
+    json.beginObject();
+    json.beginArray("routes");
+    for (size_t i = 0; i < routeStats.size(); i++) {
+      const RouteStat &stat = routeStats.at(i);
+      uint32_t count = stat.count.load();
+      json.beginObject();
+      json.string("route", stat.route);
+      json.number("count", count);
+      json.number("avg_us", count ? (uint32_t)(stat.totalUs.load() / count) : 0);
+      json.number("p50_us", RouteStats::percentileUs(stat, 50));
+      json.number("p99_us", RouteStats::percentileUs(stat, 99));
+      json.number("max_us", stat.maxUs.load());
+      json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    reply.send();
+  }));
+
+  // Метрики для Prometheus: только чтение атомарных счётчиков, без блокировок
+  server.on("/api/metrics", HTTP_GET, timed("GET /api/metrics", [](){
+    ServerChunkSink sink(server);
+    TemplateWriter out(metricsBuffer, sizeof(metricsBuffer), sink);
+    MetricsWriter metrics(out);
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4; charset=utf-8", "");
+
+    metrics.family("gong_uptime_seconds", "gauge", "Time since boot");
+    metrics.sample("gong_uptime_seconds", esp_timer_get_time() / US_PER_SECOND);
+    metrics.family("gong_boots_total", "counter", "Boots since power-on");
+    metrics.sample("gong_boots_total", resetCounters.boots);
+    metrics.family("gong_watchdog_resets_total", "counter", "Watchdog resets since power-on");
+    metrics.sample("gong_watchdog_resets_total", resetCounters.watchdogResets);
+
+    metrics.family("gong_heap_free_bytes", "gauge", "Free heap");
+    metrics.sample("gong_heap_free_bytes", ESP.getFreeHeap());
+    metrics.family("gong_heap_min_free_bytes", "gauge", "Minimum free heap since boot");
+    metrics.sample("gong_heap_min_free_bytes", ESP.getMinFreeHeap());
+    metrics.family("gong_heap_largest_free_block_bytes", "gauge", "Largest allocatable heap block");
+    metrics.sample("gong_heap_largest_free_block_bytes", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+    metrics.family("gong_task_stack_free_min_bytes", "gauge", "Task stack high-water mark");
+    const char *taskNames[] = {"TimingTask", "WebServerTask", "AudioTask", "TimeTask", "GroupTask", "EventTask",
+                               "JournalTask", "loopTask"};
+    TaskHandle_t tasks[] = {timingTaskHandle, webServerTaskHandle, audioTaskHandle, timeTaskHandle, groupTaskHandle,
+                            eventTaskHandle, journalTaskHandle, loopTaskHandle};
+    for (size_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++) {
+      if (tasks[i] != NULL) {
+        metrics.sample("gong_task_stack_free_min_bytes", "task", taskNames[i], uxTaskGetStackHighWaterMark(tasks[i]));
+      }
+    }
+    metrics.family("gong_task_heartbeat_age_seconds", "gauge", "Time since the task last reported to the watchdog");
+    uint32_t nowMs = millis();
+    for (size_t slot = 0; slot < taskHealth.count(); slot++) {
+      metrics.sampleSeconds("gong_task_heartbeat_age_seconds", "task", taskHealth.name(slot),
+                            (int64_t)taskHealth.silenceMs(slot, nowMs) * 1000);
+    }
+    metrics.family("gong_ring_overflows_total", "counter", "Messages dropped because an inter-task ring was full");
+    metrics.sample("gong_ring_overflows_total", "ring", "control", controlRing.overflowCount());
+    metrics.sample("gong_ring_overflows_total", "ring", "group", groupRing.overflowCount());
+    metrics.sample("gong_ring_overflows_total", "ring", "audio", audioRing.overflowCount());
+
+    bool connected = WiFi.status() == WL_CONNECTED;
+    metrics.family("gong_wifi_connected", "gauge", "WiFi station has an IP address");
+    metrics.sample("gong_wifi_connected", connected ? 1 : 0);
+    if (connected) {
+      metrics.family("gong_wifi_rssi_dbm", "gauge", "WiFi signal strength");
+      metrics.sample("gong_wifi_rssi_dbm", WiFi.RSSI());
+    }
+    metrics.family("gong_wifi_reconnects_total", "counter", "WiFi link losses followed by reconnect");
+    metrics.sample("gong_wifi_reconnects_total", wifiManager.reconnectCount());
+    metrics.family("gong_wifi_changes_total", "counter", "Network changes without reboot by result");
+    metrics.sample("gong_wifi_changes_total", "result", "applied", wifiManager.appliedCount());
+    metrics.sample("gong_wifi_changes_total", "result", "rolled_back", wifiManager.rolledBackCount());
+
+    metrics.family("gong_dfplayer_online", "gauge", "DFPlayer answered recently");
+    metrics.sample("gong_dfplayer_online", playerOnline() ? 1 : 0);
+    metrics.family("gong_dfplayer_rx_errors_total", "counter", "Malformed frames from DFPlayer");
+    metrics.sample("gong_dfplayer_rx_errors_total", playerStatus.rxErrors.load(std::memory_order_relaxed));
+    metrics.family("gong_audio_commands_coalesced_total", "counter", "Audio commands replaced before sending");
+    metrics.sample("gong_audio_commands_coalesced_total", audioQueue.coalescedCount());
+
+    int64_t monoUs = esp_timer_get_time();
+    portENTER_CRITICAL(&timeMux);
+    TimeService snapshot = timeService;
+    portEXIT_CRITICAL(&timeMux);
+    metrics.family("gong_time_synced", "gauge", "Time source: 0 none, 1 restored from RTC memory, 2 SNTP");
+    metrics.sample("gong_time_synced", (int64_t)snapshot.source());
+    metrics.family("gong_time_syncs_total", "counter", "Accepted SNTP samples");
+    metrics.sample("gong_time_syncs_total", snapshot.syncCount());
+    metrics.family("gong_time_samples_rejected_total", "counter", "SNTP samples dropped as delay outliers");
+    metrics.sample("gong_time_samples_rejected_total", snapshot.rejectedCount());
+    if (snapshot.source() != TimeSource::None) {
+      metrics.family("gong_time_offset_seconds", "gauge", "Last SNTP sample minus model prediction");
+      metrics.sampleSeconds("gong_time_offset_seconds", snapshot.lastOffsetUs());
+      metrics.family("gong_time_uncertainty_seconds", "gauge", "Estimated error of the device clock");
+      metrics.sampleSeconds("gong_time_uncertainty_seconds", snapshot.uncertaintyUs(monoUs));
+      metrics.family("gong_time_drift_ppb", "gauge", "Estimated oscillator drift");
+      metrics.sample("gong_time_drift_ppb", snapshot.driftPpb());
+    }
+    metrics.family("gong_alarm_fire_late_seconds", "gauge", "Delay of the last alarm strike after its scheduled time");
+    metrics.sampleSeconds("gong_alarm_fire_late_seconds", lastFireLateUs);
+    metrics.family("gong_fire_late_seconds", "histogram", "Delay of strikes after their scheduled time");
+    for (size_t i = 0; i < fireLateStats.size(); i++) {
+      const RouteStat &stat = fireLateStats.at(i);
+      metrics.histogram("gong_fire_late_seconds", "source", stat.route, stat);
+    }
+    metrics.family("gong_strike_latency_seconds", "histogram",
+                   "From the strike command to the start of playback (BUSY line or status reply)");
+    for (size_t i = 0; i < strikeLatencyStats.size(); i++) {
+      const RouteStat &stat = strikeLatencyStats.at(i);
+      metrics.histogram("gong_strike_latency_seconds", "start", stat.route, stat);
+    }
+    portENTER_CRITICAL(&eventMux);
+    int32_t lastLatencyUs = lastStrike.latencyUs;
+    portEXIT_CRITICAL(&eventMux);
+    if (lastLatencyUs >= 0) {
+      metrics.family("gong_strike_last_latency_seconds", "gauge", "Start latency of the last strike");
+      metrics.sampleSeconds("gong_strike_last_latency_seconds", lastLatencyUs);
+    }
+    metrics.family("gong_strikes_unmeasured_total", "counter", "Strikes whose playback start was not confirmed");
+    metrics.sample("gong_strikes_unmeasured_total", strikePrestage.unmeasuredCount());
+    metrics.family("gong_strike_prestage_total", "counter", "Tracks staged ahead of a strike by outcome");
+    metrics.sample("gong_strike_prestage_total", "result", "ready", strikePrestage.preparedCount());
+    metrics.sample("gong_strike_prestage_total", "result", "failed", strikePrestage.failedCount());
+    metrics.sample("gong_strike_prestage_total", "result", "skipped", strikePrestage.skippedCount());
+    metrics.family("gong_playback_sessions_total", "counter", "Tracks started as playback sessions");
+    metrics.sample("gong_playback_sessions_total", playback.sessionCount());
+    metrics.family("gong_playback_preempted_total", "counter", "Sessions replaced by a new one before their end");
+    metrics.sample("gong_playback_preempted_total", playback.preemptedCount());
+    metrics.family("gong_playback_ramp_commands_total", "counter", "Volume commands sent by fade-in and fade-out");
+    metrics.sample("gong_playback_ramp_commands_total", playback.rampCommandCount());
+    metrics.family("gong_playback_stop_late_seconds", "gauge", "Delay of the last session stop after its scheduled time");
+    metrics.sampleSeconds("gong_playback_stop_late_seconds", playbackStopLateUs);
+
+    metrics.family("gong_group_triggers_total", "counter", "Group trigger packets by outcome");
+    for (size_t i = 0; i < (size_t)GroupTriggerResult::Count; i++) {
+      metrics.sample("gong_group_triggers_total", "result", groupTriggerResultName((GroupTriggerResult)i),
+                     groupTriggers.count((GroupTriggerResult)i));
+    }
+    metrics.family("gong_group_bad_packets_total", "counter", "Group packets with a wrong format or signature");
+    metrics.sample("gong_group_bad_packets_total", groupBadPackets);
+    metrics.family("gong_group_fire_late_seconds", "gauge", "Delay of the last group strike after its scheduled time");
+    metrics.sampleSeconds("gong_group_fire_late_seconds", groupFireLateUs);
+
+    metrics.family("gong_event_clients", "gauge", "Open /api/events connections");
+    metrics.sample("gong_event_clients", (int64_t)eventHub.clients());
+    metrics.family("gong_events_published_total", "counter", "Events serialized for /api/events");
+    metrics.sample("gong_events_published_total", eventHub.published());
+    metrics.family("gong_event_writes_total", "counter", "Event frames written to /api/events connections");
+    metrics.sample("gong_event_writes_total", eventHub.writes());
+    metrics.family("gong_event_clients_dropped_total", "counter", "Event connections closed or too slow to read");
+    metrics.sample("gong_event_clients_dropped_total", eventHub.dropped());
+
+    metrics.family("gong_journal_records", "gauge", "Events stored in the flash journal");
+    metrics.sample("gong_journal_records", (int64_t)journal.recordCount());
+    metrics.family("gong_journal_appends_total", "counter", "Events written to the flash journal");
+    metrics.sample("gong_journal_appends_total", journal.appendedCount());
+    metrics.family("gong_journal_dropped_total", "counter", "Events lost because the journal queue was full");
+    metrics.sample("gong_journal_dropped_total", journalQueue.droppedCount());
+    metrics.family("gong_journal_write_errors_total", "counter", "Failed journal writes to flash");
+    metrics.sample("gong_journal_write_errors_total", journal.writeErrorCount());
+    metrics.family("gong_journal_segment_reads_total", "counter", "Journal segments read by /api/journal");
+    metrics.sample("gong_journal_segment_reads_total", journal.segmentReadCount());
+    metrics.family("gong_journal_torn_segments", "gauge", "Journal segments with a torn tail found at boot");
+    metrics.sample("gong_journal_torn_segments", journal.tornCount());
+
+    metrics.family("gong_http_connections", "gauge", "Open HTTP connections");
+    metrics.sample("gong_http_connections", (int64_t)server.connections());
+    metrics.family("gong_http_connections_total", "counter", "Accepted HTTP connections");
+    metrics.sample("gong_http_connections_total", server.acceptedCount());
+    metrics.family("gong_http_requests_total", "counter", "HTTP requests handled");
+    metrics.sample("gong_http_requests_total", server.requestCount());
+    metrics.family("gong_http_connections_closed_total", "counter", "HTTP connections closed by the server");
+    metrics.sample("gong_http_connections_closed_total", "reason", "timeout", server.timeoutCount());
+    metrics.sample("gong_http_connections_closed_total", "reason", "rejected", server.rejectedCount());
+    metrics.sample("gong_http_connections_closed_total", "reason", "evicted", server.evictedCount());
+    metrics.family("gong_http_arena_high_water_bytes", "gauge", "Peak per-request arena usage");
+    metrics.sample("gong_http_arena_high_water_bytes", (int64_t)server.arena().highWater());
+    metrics.family("gong_http_arena_overflows_total", "counter", "Arena allocations that did not fit");
+    metrics.sample("gong_http_arena_overflows_total", server.arena().overflowCount());
+    metrics.family("gong_http_heap_buffers_total", "counter", "Connection buffers grown onto the heap");
+    metrics.sample("gong_http_heap_buffers_total", server.heapBufferCount());
+
+#if GONG_TRACE
+    metrics.family("gong_trace_events_total", "counter", "Trace events recorded by core, clock marks included");
+    metrics.sample("gong_trace_events_total", "core", "0", traceBuffer.recordedCount(0));
+    metrics.sample("gong_trace_events_total", "core", "1", traceBuffer.recordedCount(1));
+#endif
+
+    metrics.family("gong_http_request_duration_seconds", "histogram", "HTTP handler latency by route");
+    for (size_t i = 0; i < routeStats.size(); i++) {
+      const RouteStat &stat = routeStats.at(i);
+      metrics.histogram("gong_http_request_duration_seconds", "route", stat.route, stat);
+    }
+
+    out.flush();
+    server.sendContent("", 0);
+  }));
+
+  // Время стадий загрузки: /api/boot
+  server.on("/api/boot", HTTP_GET, timed("GET /api/boot", [](){
+    JsonReply reply(server, 200);
+    JsonWriter &json = reply.json();
+    json.beginObject();
+    json.string("firmware", FIRMWARE_BUILD);
+    json.number("reset_reason", (int)esp_reset_reason());
+    json.number("first_request_us", bootPipeline.firstRequestUs());
+    json.number("ready_us", bootPipeline.readyUs());
+    // Задача, из-за которой прошлая загрузка закончилась по watchdog
+    if (previousStalledTask >= 0 && (size_t)previousStalledTask < taskHealth.count()) {
+      json.string("stalled_task", taskHealth.name(previousStalledTask));
+    }
+    json.beginArray("stages");
+    for (size_t stage = 0; stage < bootPipeline.count(); stage++) {
+      json.beginObject();
+      json.string("name", bootPipeline.name(stage));
+      json.number("start_us", bootPipeline.startUs(stage));
+      json.number("end_us", bootPipeline.endUs(stage));
+      json.boolean("done", bootPipeline.done(stage));
+      json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    reply.send();
+  }));
+
+#if GONG_TRACE
+  // Трассировка в формате Chrome trace (chrome://tracing, Perfetto):
+  // последние TRACE_BUFFER_EVENTS событий каждого ядра
+  server.on("/api/trace", HTTP_GET, timed("GET /api/trace", [](){
+    TaskHandle_t tasks[] = {timingTaskHandle, webServerTaskHandle, audioTaskHandle, timeTaskHandle, groupTaskHandle,
+                            eventTaskHandle, journalTaskHandle, loopTaskHandle};
+    JsonReply reply(server, 200);
+    JsonWriter &json = reply.json();
+    json.beginObject();
+    json.beginArray("traceEvents");
+    for (uint8_t core = 0; core < TRACE_CORES; core++) {
+      char name[8];
+      snprintf(name, sizeof(name), "core %u", core);
+      json.beginObject();
+      json.string("name", "process_name");
+      json.string("ph", "M");
+      json.number("pid", core);
+      json.beginObject("args");
+      json.string("name", name);
+      json.endObject();
+      json.endObject();
+      // Задача может попасть на любое ядро: имена потоков — в обоих
+      for (size_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++) {
+        if (tasks[i] != NULL) {
+          traceThreadName(json, core, tasks[i], pcTaskGetName(tasks[i]));
+        }
+      }
+      traceThreadName(json, core, nullptr, "ISR");
+      traceBuffer.exportChrome(core, json, esp_timer_get_time(), ESP.getCpuFreqMHz());
+    }
+    json.endArray();
+    json.string("displayTimeUnit", "ms");
+    json.endObject();
+    reply.send();
+  }));
+#endif
+
+  // Журнал событий: /api/journal?from=&to=&after=&limit=
+  // from и to — UTC в секундах, after — номер последней полученной
+  // записи; next в ответе — after следующей страницы
+  server.on("/api/journal", HTTP_GET, timed("GET /api/journal", [](){
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    uint32_t after = 0;
+    uint32_t limit = JOURNAL_PAGE_MAX;
+    if (!uintArg("from", INT32_MAX, from) || !uintArg("to", INT32_MAX, to) || !uintArg("after", INT32_MAX, after) ||
+        !uintArg("limit", JOURNAL_PAGE_MAX, limit) || limit == 0 || from > to) {
+      sendJsonError(server, 400, "from, to, after must be non-negative, limit 1-32");
+      return;
+    }
+    JournalRecord *records = server.arena().allocArray<JournalRecord>(limit);
+    if (records == nullptr) {
+      sendJsonError(server, 503, "no memory");
+      return;
+    }
+    bool more;
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    size_t count = journal.query(from, to, after, records, limit, more);
+    xSemaphoreGive(journalMutex);
+
+    JsonReply reply(server, 200);
+    JsonWriter &json = reply.json();
+    json.beginObject();
+    json.beginArray("events");
+    for (size_t i = 0; i < count; i++) {
+      const JournalRecord &record = records[i];
+      const char *type = journalEventName(record.type);
+      json.beginObject();
+      json.number("sequence", record.sequence);
+      json.number("time", record.time);
+      json.string("type", type != nullptr ? type : "unknown");
+      json.number("code", record.code);
+      if (record.alarmId != 0) {
+        json.number("alarm_id", record.alarmId);
+      }
+      if (record.track != 0) {
+        json.number("track", record.track);
+      }
+      json.number("latency_us", record.latencyUs);
+      json.endObject();
+    }
+    json.endArray();
+    if (more) {
+      json.number("next", records[count - 1].sequence);
+    }
+    json.endObject();
+    reply.send();
+  }));
+
   // Обработчик для несуществующих страниц (404)
-  server.onNotFound([](){
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<meta charset='UTF-8'>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-    html += "<title>404 - Страница не найдена</title>";
-    html += "</head><body>";
-    html += "<h1>404 - Страница не найдена</h1>";
-    html += "<p>Запрашиваемая страница не существует.</p>";
-    html += "<p><a href='/'>Вернуться на главную</a></p>";
-    html += "</body></html>";
-    server.send(404, "text/html; charset=utf-8", html);
-  });
-
-  server.begin();
+  server.onNotFound(timed("404", [](){
+    sendWebAsset(*findWebAsset(kWebAssets, "/404.html"), 404);
+  }));
+}
+
+void bootServer() {
+  eventsMutex = xSemaphoreCreateMutex();
+  if (!server.begin()) {
+    Serial.println("Веб-сервер: не удалось открыть порт");
+    return;
+  }
   Serial.println("Веб-сервер запущен. Откройте /wifi для настройки WiFi.");
+}
+
+// Ядро 1 — удары и звук, ядро 0 — сеть, рядом со стеком lwIP.
+// TimingTask выше всех задач приложения: удар не ждёт ни HTTP, ни
+// UART; данные между задачами — через кольца SpscRing. На сторожевой
+// таймер подписан только loopTask, остальные отмечаются в taskHealth
+// (TimeTask — нет: DNS и ожидание SNTP дольше предела).
+void bootTasks() {
+  uint32_t nowMs = millis();
+  taskHealth.watch(HEALTH_TIMING, "TimingTask", TASK_HEARTBEAT_MAX_MS, nowMs);
+  taskHealth.watch(HEALTH_AUDIO, "AudioTask", TASK_HEARTBEAT_MAX_MS, nowMs);
+  taskHealth.watch(HEALTH_WEB, "WebServerTask", TASK_HEARTBEAT_MAX_MS, nowMs);
+  taskHealth.watch(HEALTH_GROUP, "GroupTask", TASK_HEARTBEAT_MAX_MS, nowMs);
+  taskHealth.watch(HEALTH_EVENT, "EventTask", TASK_HEARTBEAT_MAX_MS, nowMs);
+  taskHealth.watch(HEALTH_JOURNAL, "JournalTask", TASK_HEARTBEAT_MAX_MS, nowMs);
 
-  // Create tasks for watchdog management
+  // Аудио раньше TimingTask: её первые команды сразу будят audioTask
   xTaskCreatePinnedToCore(
-    mainTask,           // Task function
-    "MainTask",         // Task name
+    audioTask,          // Task function
+    "AudioTask",        // Task name
     4096,               // Stack size
     NULL,               // Task parameters
-    1,                  // Task priority
-    &mainTaskHandle,    // Task handle
+    4,                  // Task priority (UART DFPlayer)
+    &audioTaskHandle,   // Task handle
     1                   // Core to run on (Core 1)
   );
-  
+
+  xTaskCreatePinnedToCore(
+    timingTask,         // Task function
+    "TimingTask",       // Task name
+    4096,               // Stack size
+    NULL,               // Task parameters
+    5,                  // Task priority (будильники, группа, сеансы)
+    &timingTaskHandle,  // Task handle
+    1                   // Core to run on (Core 1)
+  );
+
+  xTaskCreatePinnedToCore(
+    groupTask,          // Task function
+    "GroupTask",        // Task name
+    4096,               // Stack size
+    NULL,               // Task parameters
+    3,                  // Task priority (пакет удара важнее HTTP)
+    &groupTaskHandle,   // Task handle
+    0                   // Core to run on (Core 0)
+  );
+
+  xTaskCreatePinnedToCore(
+    timeTask,           // Task function
+    "TimeTask",         // Task name
+    4096,               // Stack size
+    NULL,               // Task parameters
+    2,                  // Task priority
+    &timeTaskHandle,    // Task handle
+    0                   // Core to run on (Core 0)
+  );
+
   xTaskCreatePinnedToCore(
     webServerTask,      // Task function
     "WebServerTask",    // Task name
-    4096,               // Stack size
+    8192,               // Stack size (обработчики HTTP выполняются здесь)
     NULL,               // Task parameters
     1,                  // Task priority
     &webServerTaskHandle, // Task handle
     0                   // Core to run on (Core 0)
   );
-  
-  // Add tasks to watchdog timer
-  if (mainTaskHandle != NULL) {
-    esp_task_wdt_add(mainTaskHandle);
+
+  xTaskCreatePinnedToCore(
+    eventTask,          // Task function
+    "EventTask",        // Task name
+    4096,               // Stack size
+    NULL,               // Task parameters
+    1,                  // Task priority
+    &eventTaskHandle,   // Task handle
+    0                   // Core to run on (Core 0)
+  );
+
+  xTaskCreatePinnedToCore(
+    journalTask,        // Task function
+    "JournalTask",      // Task name
+    4096,               // Stack size
+    NULL,               // Task parameters
+    1,                  // Task priority (запись во flash — в последнюю очередь)
+    &journalTaskHandle, // Task handle
+    0                   // Core to run on (Core 0)
+  );
+
+  Serial.println("Задачи запущены, пульс — в taskHealth");
+}
+
+void countReset() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  if (resetCounters.magic != RESET_COUNTERS_MAGIC || reason == ESP_RST_POWERON) {
+    resetCounters.magic = RESET_COUNTERS_MAGIC;
+    resetCounters.boots = 0;
+    resetCounters.watchdogResets = 0;
+    resetCounters.stalledTask = -1;
   }
-  if (webServerTaskHandle != NULL) {
-    esp_task_wdt_add(webServerTaskHandle);
+  resetCounters.boots++;
+  if (reason == ESP_RST_TASK_WDT || reason == ESP_RST_INT_WDT || reason == ESP_RST_WDT) {
+    resetCounters.watchdogResets++;
+    // Прошивка до появления поля оставила в нём что угодно
+    if (resetCounters.stalledTask >= 0 && resetCounters.stalledTask < HEALTH_SLOT_COUNT) {
+      previousStalledTask = resetCounters.stalledTask;
+    }
   }
-  
-  Serial.println("Tasks created and added to watchdog timer");
+  resetCounters.stalledTask = -1;
+}
+
+// Сторожевой таймер кормится, только пока все задачи отмечаются:
+// застрявшая задача — в лог и в RTC-память, через период TWDT
+// устройство перезагрузится
+void superviseTasks() {
+  int stalled = taskHealth.stale(millis());
+  if (stalled < 0) {
+    if (resetCounters.stalledTask >= 0) {
+      Serial.printf("Задача %s снова отвечает\n", taskHealth.name(resetCounters.stalledTask));
+      resetCounters.stalledTask = -1;
+    }
+    esp_task_wdt_reset();
+    return;
+  }
+  if (resetCounters.stalledTask != stalled) {
+    resetCounters.stalledTask = stalled;
+    journalEvent(JournalEvent::TaskStall, (uint16_t)stalled, 0, 0, taskHealth.silenceMs(stalled, millis()) * 1000LL);
+    Serial.printf("Задача %s не отвечает %u мс, сторожевой таймер не кормится\n", taskHealth.name(stalled),
+                  taskHealth.silenceMs(stalled, millis()));
+  }
+}
+
+void logBootTimings() {
+  Serial.printf("Загрузка %s:\n", FIRMWARE_BUILD);
+  for (size_t stage = 0; stage < bootPipeline.count(); stage++) {
+    Serial.printf("  %-15s %7u мкс -> %7u мкс\n", bootPipeline.name(stage),
+      bootPipeline.startUs(stage), bootPipeline.endUs(stage));
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  // Initialize watchdog timer
+  esp_task_wdt_init(10, true); // 10 second timeout, panic on timeout
+  esp_task_wdt_add(NULL); // Add current task (setup task) to watchdog
+
+  countReset();
+
+  // Стадии с выполненными зависимостями; событийные завершатся позже
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  bootPipeline.pump();
 
   // Для LittleFS используйте #include <LittleFS.h> и LittleFS.begin() вместо SPIFFS
 }
 
 void loop() {
-  // Reset watchdog timer for the main loop task
-  esp_task_wdt_reset();
+  superviseTasks();
+
+  // Стадии, ждавшие событий; итоги загрузки — в лог один раз
+  static bool bootLogged = false;
+  if (!bootLogged) {
+    bootPipeline.pump();
+    if (bootPipeline.readyUs() != BootPipeline::kNotYet) {
+      logBootTimings();
+      bootLogged = true;
+    }
+  }
   
-  // Handle web server requests
-  server.handleClient();
+  // HTTP-запросы обслуживаются в webServerTask
   
-  // Basic application logic
-  // Check WiFi connection status
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi connection lost, attempting to reconnect...");
-    connectWiFi(10, 500);
+  // Смена сети из веб-сервера — когда ответ на запрос уже ушёл
+  static uint32_t trialId = 0;
+  uint32_t trialWaitMs = LOOP_MAX_WAIT_MS;
+  const WiFiTrialRequest *request = wifiTrialRing.peek();
+  if (request != nullptr) {
+    int32_t untilMs = (int32_t)(request->startAtMs - millis());
+    if (untilMs <= 0) {
+      trialId = request->id;
+      TRACE_INSTANT("wifi_trial", trialId);
+      Serial.printf("Проба сети %s\n", request->network.ssid);
+      wifiManager.tryNetwork(request->network, millis());
+      wifiTrialRing.drop();
+      wifiTrialStatus.store((trialId << 8) | WiFiManager::TRIAL_RUNNING, std::memory_order_release);
+    } else {
+      trialWaitMs = (uint32_t)untilMs;
+    }
   }
-  
-  // Small delay to prevent watchdog from triggering
-  delay(1000);
+
+  // Переходы состояния WiFi; сон до следующего события или тайм-аута
+  TRACE_CLOCK();
+  WiFiManager::State before = wifiManager.state();
+  WiFiManager::TrialState trialBefore = wifiManager.trialState();
+  uint32_t downtimeBefore = wifiManager.trialDowntimeMs();
+  uint32_t waitMs = wifiManager.tick(millis());
+  if (wifiManager.state() != before) {
+    TRACE_INSTANT("wifi_state", wifiManager.state());
+    logWiFiState(wifiManager.state());
+    if (wifiManager.state() == WiFiManager::CONNECTED) {
+      journalEvent(JournalEvent::WiFiUp, wifiManager.attempt(), 0, 0, 0);
+    } else if (before == WiFiManager::CONNECTED) {
+      journalEvent(JournalEvent::WiFiDown, 0, 0, 0, 0);
+    }
+  }
+  // Итог пробы: сразу; простой — когда связь вернулась
+  uint32_t downtimeMs = wifiManager.trialDowntimeMs();
+  if (trialId != 0 && (wifiManager.trialState() != trialBefore || downtimeMs != downtimeBefore)) {
+    WiFiManager::TrialState trial = wifiManager.trialState();
+    wifiTrialDowntimeMs.store(downtimeMs, std::memory_order_relaxed);
+    wifiTrialStatus.store((trialId << 8) | trial, std::memory_order_release);
+    if (trial != WiFiManager::TRIAL_RUNNING && downtimeMs != 0) {
+      Serial.printf("Смена сети: %s, без связи %u мс\n",
+                    trial == WiFiManager::TRIAL_APPLIED ? "подключена" : "возврат к прежней", downtimeMs);
+      journalEvent(JournalEvent::WiFiChange, trial == WiFiManager::TRIAL_APPLIED ? 1 : 0, 0, 0,
+                   (int64_t)downtimeMs * 1000);
+    }
+  }
+  if (waitMs > trialWaitMs) {
+    waitMs = trialWaitMs;
+  }
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 }
\ No newline at end of file
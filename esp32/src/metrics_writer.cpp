@@ -0,0 +1,107 @@
+#include "metrics_writer.h"
+
+#include <stdio.h>
+
+void MetricsWriter::family(const char *name, const char *type, const char *help) {
+  _out.raw("# HELP ");
+  _out.raw(name);
+  _out.raw(" ", 1);
+  _out.raw(help);
+  _out.raw("\n# TYPE ");
+  _out.raw(name);
+  _out.raw(" ", 1);
+  _out.raw(type);
+  _out.raw("\n", 1);
+}
+
+void MetricsWriter::value(int64_t value) {
+  char digits[24];
+  int length = snprintf(digits, sizeof(digits), " %lld\n", (long long)value);
+  _out.raw(digits, length);
+}
+
+void MetricsWriter::seconds(uint64_t us) {
+  char digits[32];
+  int length = snprintf(digits, sizeof(digits), "%llu.%06llu",
+    (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+  _out.raw(digits, length);
+}
+
+// {label="value",le="..."}; значение экранируется по правилам формата
+void MetricsWriter::labels(const char *label, const char *labelValue, const char *le) {
+  _out.raw("{", 1);
+  if (label != nullptr) {
+    _out.raw(label);
+    _out.raw("=\"", 2);
+    for (const char *c = labelValue; *c; c++) {
+      switch (*c) {
+        case '\\': _out.raw("\\\\", 2); break;
+        case '"':  _out.raw("\\\"", 2); break;
+        case '\n': _out.raw("\\n", 2); break;
+        default:   _out.raw(c, 1); break;
+      }
+    }
+    _out.raw("\"", 1);
+  }
+  if (le != nullptr) {
+    _out.raw(label != nullptr ? ",le=\"" : "le=\"");
+    _out.raw(le);
+    _out.raw("\"", 1);
+  }
+  _out.raw("}", 1);
+}
+
+void MetricsWriter::sample(const char *name, int64_t v) {
+  _out.raw(name);
+  value(v);
+}
+
+void MetricsWriter::sample(const char *name, const char *label, const char *labelValue, int64_t v) {
+  _out.raw(name);
+  labels(label, labelValue, nullptr);
+  value(v);
+}
+
+void MetricsWriter::sampleSeconds(const char *name, int64_t us) {
+  sampleSeconds(name, nullptr, nullptr, us);
+}
+
+void MetricsWriter::sampleSeconds(const char *name, const char *label, const char *labelValue, int64_t us) {
+  _out.raw(name);
+  if (label != nullptr) {
+    labels(label, labelValue, nullptr);
+  }
+  _out.raw(us < 0 ? " -" : " ", us < 0 ? 2 : 1);
+  seconds(us < 0 ? (uint64_t)-us : (uint64_t)us);
+  _out.raw("\n", 1);
+}
+
+void MetricsWriter::histogram(const char *name, const char *label, const char *labelValue, const RouteStat &stat) {
+  char metric[64];
+  char le[24];
+  uint64_t cumulative = 0;
+  snprintf(metric, sizeof(metric), "%s_bucket", name);
+  for (size_t i = 0; i <= ROUTE_STATS_BUCKETS; i++) {
+    cumulative += stat.buckets[i].load(std::memory_order_relaxed);
+    if (i < ROUTE_STATS_BUCKETS) {
+      uint32_t us = RouteStats::kBucketBoundsUs[i];
+      snprintf(le, sizeof(le), "%lu.%06lu", (unsigned long)(us / 1000000), (unsigned long)(us % 1000000));
+    } else {
+      snprintf(le, sizeof(le), "+Inf");
+    }
+    _out.raw(metric);
+    labels(label, labelValue, le);
+    value((int64_t)cumulative);
+  }
+
+  snprintf(metric, sizeof(metric), "%s_sum", name);
+  _out.raw(metric);
+  labels(label, labelValue, nullptr);
+  _out.raw(" ", 1);
+  seconds(stat.totalUs.load(std::memory_order_relaxed));
+  _out.raw("\n", 1);
+
+  // Счётчик совпадает с суммой корзин, даже если запрос записался между чтениями
+  snprintf(metric, sizeof(metric), "%s_count", name);
+  sample(metric, label, labelValue, (int64_t)cumulative);
+}
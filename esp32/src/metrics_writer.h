@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "route_stats.h"
+#include "template_renderer.h"
+
+// Метрики в текстовом формате Prometheus поверх TemplateWriter:
+// ответ собирается в буфере фиксированного размера и уходит чанками.
+
+class MetricsWriter {
+public:
+  explicit MetricsWriter(TemplateWriter &out) : _out(out) {}
+
+  // Строки # HELP и # TYPE (type: counter, gauge, histogram)
+  void family(const char *name, const char *type, const char *help);
+  void sample(const char *name, int64_t value);
+  void sample(const char *name, const char *label, const char *labelValue, int64_t value);
+  // Значение в секундах из микросекунд, без потери точности
+  void sampleSeconds(const char *name, int64_t us);
+  void sampleSeconds(const char *name, const char *label, const char *labelValue, int64_t us);
+  // Гистограмма задержек маршрута в секундах (корзины RouteStats)
+  void histogram(const char *name, const char *label, const char *labelValue, const RouteStat &stat);
+
+private:
+  void labels(const char *label, const char *labelValue, const char *le);
+  void value(int64_t value);
+  void seconds(uint64_t us);
+
+  TemplateWriter &_out;
+};
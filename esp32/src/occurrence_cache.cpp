@@ -0,0 +1,106 @@
+#include "occurrence_cache.h"
+
+#include <string.h>
+
+#include "civil_time.h"
+
+struct RebuildContext {
+  Occurrence *items;
+  uint16_t count;
+};
+
+static void appendOccurrence(const AlarmEntry &alarm, void *ctx) {
+  // Индекс планировщика уже отсортирован по времени внутри дня
+  RebuildContext *rebuild = static_cast<RebuildContext *>(ctx);
+  if (rebuild->count < OccurrenceCache::kCapacity) {
+    rebuild->items[rebuild->count++] = OccurrenceCache::fromAlarm(alarm);
+  }
+}
+
+Occurrence OccurrenceCache::fromAlarm(const AlarmEntry &alarm) {
+  Occurrence occurrence;
+  occurrence.alarmId = alarm.id;
+  occurrence.minuteOfDay = alarm.minuteOfDay;
+  occurrence.duration = alarm.duration;
+  occurrence.track = alarm.track;
+  return occurrence;
+}
+
+void OccurrenceCache::rebuild(int32_t today, const AlarmScheduler &scheduler) {
+  int32_t year;
+  uint32_t month;
+  uint32_t dayOfMonth;
+  civilFromDays(today, year, month, dayOfMonth);
+  int32_t monthStart = daysFromCivil(year, month, 1);
+  int32_t monthEnd = monthStart + daysInMonth(year, month);
+  int32_t windowEnd = today + kWindowDays;
+
+  _today = today;
+  _firstDay = monthStart;
+  _dayCount = (windowEnd > monthEnd ? windowEnd : monthEnd) - monthStart;
+
+  RebuildContext ctx = {_items, 0};
+  for (uint8_t weekday = 0; weekday < 7; weekday++) {
+    _start[weekday] = ctx.count;
+    scheduler.forEachOnWeekday(weekday, appendOccurrence, &ctx);
+  }
+  _start[7] = ctx.count;
+  _valid = true;
+}
+
+OccurrenceList OccurrenceCache::day(int32_t day) const {
+  uint8_t weekday = weekdayFromDays(day);
+  OccurrenceList list = {_items + _start[weekday], (size_t)(_start[weekday + 1] - _start[weekday])};
+  return list;
+}
+
+// Вставка с сохранением порядка по времени; хвост таблицы сдвигается
+void OccurrenceCache::insert(uint8_t weekday, const Occurrence &occurrence) {
+  if (_start[7] >= kCapacity) {
+    return;
+  }
+  uint16_t pos = _start[weekday];
+  while (pos < _start[weekday + 1] && _items[pos].minuteOfDay <= occurrence.minuteOfDay) {
+    pos++;
+  }
+  memmove(&_items[pos + 1], &_items[pos], (_start[7] - pos) * sizeof(Occurrence));
+  _items[pos] = occurrence;
+  for (uint8_t next = weekday + 1; next <= 7; next++) {
+    _start[next]++;
+  }
+}
+
+void OccurrenceCache::onUpsert(const AlarmEntry &alarm) {
+  if (!_valid) {
+    return;
+  }
+  onRemove(alarm.id);
+  if (!alarm.active) {
+    return;
+  }
+  Occurrence occurrence = fromAlarm(alarm);
+  for (uint8_t weekday = 0; weekday < 7; weekday++) {
+    if (alarm.days & (1 << weekday)) {
+      insert(weekday, occurrence);
+    }
+  }
+}
+
+// Один проход по таблице: оставшиеся записи сдвигаются к началу
+void OccurrenceCache::onRemove(uint16_t alarmId) {
+  if (!_valid) {
+    return;
+  }
+  uint16_t kept = 0;
+  uint16_t pos = 0;
+  for (uint8_t weekday = 0; weekday < 7; weekday++) {
+    uint16_t end = _start[weekday + 1];
+    _start[weekday] = kept;
+    for (; pos < end; pos++) {
+      if (_items[pos].alarmId != alarmId) {
+        _items[kept++] = _items[pos];
+      }
+    }
+  }
+  _start[7] = kept;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alarm_scheduler.h"
+
+// Срабатывание будильника в конкретный день
+struct Occurrence {
+  uint16_t alarmId;
+  uint16_t minuteOfDay;
+  uint16_t duration;
+  uint8_t track;
+};
+
+// Срабатывания одного дня: участок таблицы кэша
+struct OccurrenceList {
+  const Occurrence *items;
+  size_t count;
+
+  size_t size() const { return count; }
+  const Occurrence &operator[](size_t i) const { return items[i]; }
+};
+
+// Материализованные срабатывания по дням для скользящего окна
+// в 10 дней и текущего месяца. Полностью пересобирается только при
+// смене дня; изменения одного будильника применяются точечно.
+//
+// Дни с одинаковым днём недели совпадают, поэтому хранится по списку
+// на день недели — участки одной таблицы фиксированного размера
+// (каждый будильник — не больше одного раза в день). Куча не
+// используется, размер не зависит от числа будильников.
+class OccurrenceCache {
+public:
+  static const int32_t kWindowDays = 10;
+  static const size_t kCapacity = ALARM_MAX_COUNT * 7;
+
+  // Пересборка для дня today (дни от 1970-01-01) по индексу планировщика
+  void rebuild(int32_t today, const AlarmScheduler &scheduler);
+
+  // Будильник добавлен или изменён / удалён
+  void onUpsert(const AlarmEntry &alarm);
+  void onRemove(uint16_t alarmId);
+
+  bool valid() const { return _valid; }
+  int32_t today() const { return _today; }
+  bool covers(int32_t day) const {
+    return _valid && day >= _firstDay && day < _firstDay + _dayCount;
+  }
+
+  // Срабатывания дня по возрастанию времени; day должен входить в кэш
+  OccurrenceList day(int32_t day) const;
+
+  static Occurrence fromAlarm(const AlarmEntry &alarm);
+
+private:
+  void insert(uint8_t weekday, const Occurrence &occurrence);
+
+  bool _valid = false;
+  int32_t _today = 0;
+  int32_t _firstDay = 0;
+  int32_t _dayCount = 0;
+  // Срабатывания дня недели w (0 = Пн) — _items[_start[w]].._items[_start[w + 1]]
+  uint16_t _start[8] = {};
+  Occurrence _items[kCapacity];
+};
@@ -0,0 +1,125 @@
+#include "playback_session.h"
+
+uint32_t PlaybackSession::rampSteps(uint32_t rampMs, uint8_t volume) {
+  // Нарастание или затухание короче шага — скачком
+  uint32_t steps = rampMs / PLAYBACK_RAMP_STEP_MS;
+  return steps > volume ? volume : steps;
+}
+
+int PlaybackSession::begin(const PlaybackPlan &plan, int64_t startUs) {
+  if (_active) {
+    _preempted.fetch_add(1, std::memory_order_relaxed);
+  }
+  _sessions.fetch_add(1, std::memory_order_relaxed);
+  _plan = plan;
+  if (_plan.durationMs == 0) {
+    _plan.fadeOutMs = 0;
+  } else if (_plan.fadeInMs + (uint64_t)_plan.fadeOutMs > _plan.durationMs) {
+    // Нарастание и затухание не длиннее сеанса, в прежней пропорции
+    uint64_t total = (uint64_t)_plan.fadeInMs + _plan.fadeOutMs;
+    _plan.fadeInMs = (uint32_t)((uint64_t)_plan.fadeInMs * _plan.durationMs / total);
+    _plan.fadeOutMs = _plan.durationMs - _plan.fadeInMs;
+  }
+  _inSteps = rampSteps(_plan.fadeInMs, _plan.volume);
+  _outSteps = rampSteps(_plan.fadeOutMs, _plan.volume);
+  _startUs = startUs;
+  _active = true;
+  _phase = Phase::FadeIn;
+  _step = 1;
+  settle();
+
+  int initial = _inSteps > 0 ? 0 : _plan.volume;
+  if (_level == initial) {
+    return -1;
+  }
+  _level = initial;
+  return initial;
+}
+
+int PlaybackSession::end() {
+  if (!_active) {
+    return -1;
+  }
+  _active = false;
+  _phase = Phase::Done;
+  if (_level == _plan.volume) {
+    return -1;
+  }
+  _level = _plan.volume;
+  return _level;
+}
+
+void PlaybackSession::setVolume(uint8_t volume) {
+  _plan.volume = volume;
+  _level = volume;
+}
+
+void PlaybackSession::settle() {
+  if (_phase == Phase::FadeIn && _step > _inSteps) {
+    _phase = Phase::FadeOut;
+    _step = 1;
+  }
+  // Последний шаг затухания (до нуля) — сама остановка
+  if (_phase == Phase::FadeOut && _step >= _outSteps) {
+    _phase = _plan.durationMs > 0 ? Phase::Stop : Phase::Done;
+  }
+}
+
+int64_t PlaybackSession::eventAtUs() const {
+  int64_t stopUs = _startUs + (int64_t)_plan.durationMs * 1000;
+  switch (_phase) {
+    case Phase::FadeIn:
+      return _startUs + (int64_t)_plan.fadeInMs * 1000 * _step / _inSteps;
+    case Phase::FadeOut:
+      return stopUs - (int64_t)_plan.fadeOutMs * 1000 + (int64_t)_plan.fadeOutMs * 1000 * _step / _outSteps;
+    case Phase::Stop:
+      return stopUs;
+    case Phase::Done:
+      break;
+  }
+  return -1;
+}
+
+uint8_t PlaybackSession::eventLevel() const {
+  uint32_t volume = _plan.volume;
+  if (_phase == Phase::FadeIn) {
+    return (uint8_t)((volume * _step + _inSteps / 2) / _inSteps);
+  }
+  return (uint8_t)(volume - (volume * _step + _outSteps / 2) / _outSteps);
+}
+
+int64_t PlaybackSession::nextAtUs() const {
+  return _active ? eventAtUs() : -1;
+}
+
+int64_t PlaybackSession::stopAtUs() const {
+  return _active && _plan.durationMs > 0 ? _startUs + (int64_t)_plan.durationMs * 1000 : -1;
+}
+
+PlaybackAction PlaybackSession::poll(int64_t nowUs, uint8_t &volume, int64_t &atUs) {
+  while (_active && _phase != Phase::Done) {
+    int64_t at = eventAtUs();
+    if (at > nowUs) {
+      break;
+    }
+    if (_phase == Phase::Stop) {
+      _active = false;
+      _phase = Phase::Done;
+      _level = _plan.volume;
+      volume = _plan.volume;
+      atUs = at;
+      return PlaybackAction::Stop;
+    }
+    uint8_t level = eventLevel();
+    _step++;
+    settle();
+    if (level != _level) {
+      _level = level;
+      _rampCommands.fetch_add(1, std::memory_order_relaxed);
+      volume = level;
+      atUs = at;
+      return PlaybackAction::Volume;
+    }
+  }
+  return PlaybackAction::None;
+}
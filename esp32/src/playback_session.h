@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Сеанс воспроизведения: трек с длительностью, нарастанием и затуханием
+// громкости. Класс только считает расписание — когда какую громкость
+// поставить и когда остановить; команды ставит в очередь аудио
+// вызывающий код по одноразовому таймеру на nextAtUs(). Время —
+// монотонное, мкс, и передаётся снаружи, так что расписание можно
+// прогнать на модельных часах.
+//
+// Громкость меняется целыми шагами 0..30 не чаще раза в
+// PLAYBACK_RAMP_STEP_MS: на длинном затухании шаги реже, на коротком —
+// крупнее, и UART остаётся свободен для остальных команд.
+// Новый сеанс вытесняет текущий; после остановки громкость
+// возвращается к исходной. Не потокобезопасен: сеансом владеет одна
+// задача; счётчики читаются из любых.
+
+#ifndef PLAYBACK_RAMP_STEP_MS
+#define PLAYBACK_RAMP_STEP_MS 100
+#endif
+
+struct PlaybackPlan {
+  uint32_t durationMs;  // 0 — без остановки (и без затухания)
+  uint32_t fadeInMs;
+  uint32_t fadeOutMs;
+  uint8_t volume;       // громкость между нарастанием и затуханием
+};
+
+enum class PlaybackAction : uint8_t {
+  None,
+  Volume,  // поставить громкость volume
+  Stop,    // остановить, затем вернуть громкость volume
+};
+
+class PlaybackSession {
+public:
+  // Начинает сеанс в момент startUs. Возвращает громкость, которую нужно
+  // поставить до запуска трека (ноль для нарастания или исходная после
+  // прерванного затухания), или -1, если она уже такая.
+  int begin(const PlaybackPlan &plan, int64_t startUs);
+  // Сеанс снят: трек остановлен или запущен вне сеанса. Возвращает
+  // громкость, которую нужно вернуть, или -1.
+  int end();
+  // Громкость изменена пользователем: шаги дальше считаются от неё
+  void setVolume(uint8_t volume);
+
+  // Момент ближайшего события или -1
+  int64_t nextAtUs() const;
+  // Событие, наступившее к nowUs; шаги, не меняющие громкость,
+  // пропускаются. atUs — расписанный момент события.
+  PlaybackAction poll(int64_t nowUs, uint8_t &volume, int64_t &atUs);
+
+  bool active() const { return _active; }
+  // Момент остановки или -1
+  int64_t stopAtUs() const;
+
+  uint32_t sessionCount() const { return _sessions.load(std::memory_order_relaxed); }
+  uint32_t preemptedCount() const { return _preempted.load(std::memory_order_relaxed); }
+  uint32_t rampCommandCount() const { return _rampCommands.load(std::memory_order_relaxed); }
+
+private:
+  enum class Phase : uint8_t { FadeIn, FadeOut, Stop, Done };
+
+  static uint32_t rampSteps(uint32_t rampMs, uint8_t volume);
+  // Переход к следующей фазе с событиями
+  void settle();
+  int64_t eventAtUs() const;
+  uint8_t eventLevel() const;
+
+  PlaybackPlan _plan = {};
+  bool _active = false;
+  int64_t _startUs = 0;
+  Phase _phase = Phase::Done;
+  uint32_t _step = 0;       // номер шага в фазе, с 1
+  uint32_t _inSteps = 0;
+  uint32_t _outSteps = 0;
+  int _level = -1;          // последняя поставленная громкость, -1 — неизвестна
+
+  std::atomic<uint32_t> _sessions{0};
+  std::atomic<uint32_t> _preempted{0};
+  std::atomic<uint32_t> _rampCommands{0};
+};
@@ -0,0 +1,17 @@
+#include "request_arena.h"
+
+// Выравнивание любого выделения: хватает для указателей и int64_t
+static const size_t kAlign = 8;
+
+void *RequestArena::alloc(size_t size) {
+  size_t start = (_used + kAlign - 1) & ~(kAlign - 1);
+  if (start > _capacity || size > _capacity - start) {
+    _overflows++;
+    return nullptr;
+  }
+  _used = start + size;
+  if (_used > _highWater) {
+    _highWater = _used;
+  }
+  return _buffer + start;
+}
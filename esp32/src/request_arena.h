@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Память на время одного HTTP-запроса: выделение сдвигом указателя в
+// буфере фиксированного размера, освобождение — всё сразу через
+// reset(), когда ответ записан. Куча не участвует, поэтому обработка
+// запросов не дробит её за недели работы. Не потокобезопасна: арена
+// принадлежит задаче веб-сервера.
+class RequestArena {
+public:
+  RequestArena(void *buffer, size_t capacity) : _buffer((uint8_t *)buffer), _capacity(capacity) {}
+
+  // nullptr — места нет (считается в overflowCount())
+  void *alloc(size_t size);
+  template <typename T>
+  T *allocArray(size_t count) {
+    return count > (size_t)-1 / sizeof(T) ? nullptr : (T *)alloc(count * sizeof(T));
+  }
+  void reset() { _used = 0; }
+
+  size_t used() const { return _used; }
+  size_t capacity() const { return _capacity; }
+  // Наибольшее заполнение за время работы
+  size_t highWater() const { return _highWater; }
+  uint32_t overflowCount() const { return _overflows; }
+
+private:
+  uint8_t *_buffer;
+  size_t _capacity;
+  size_t _used = 0;
+  size_t _highWater = 0;
+  uint32_t _overflows = 0;
+};
@@ -0,0 +1,50 @@
+#include "route_stats.h"
+
+const uint32_t RouteStats::kBucketBoundsUs[ROUTE_STATS_BUCKETS] = {
+  250, 500, 1000, 2500, 5000, 10000,
+  25000, 50000, 100000, 250000, 500000, 1000000
+};
+
+RouteStat *RouteStats::add(const char *route) {
+  if (_count >= ROUTE_STATS_MAX_ROUTES) {
+    return nullptr;
+  }
+  RouteStat *stat = &_routes[_count++];
+  stat->route = route;
+  return stat;
+}
+
+void RouteStats::record(RouteStat *stat, uint32_t elapsedUs) {
+  if (stat == nullptr) {
+    return;
+  }
+  stat->count.fetch_add(1, std::memory_order_relaxed);
+  stat->totalUs.fetch_add(elapsedUs, std::memory_order_relaxed);
+
+  uint32_t prevMax = stat->maxUs.load(std::memory_order_relaxed);
+  while (elapsedUs > prevMax &&
+         !stat->maxUs.compare_exchange_weak(prevMax, elapsedUs, std::memory_order_relaxed)) {
+  }
+
+  size_t bucket = 0;
+  while (bucket < ROUTE_STATS_BUCKETS && elapsedUs > kBucketBoundsUs[bucket]) {
+    bucket++;
+  }
+  stat->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t RouteStats::percentileUs(const RouteStat &stat, uint8_t percent) {
+  uint32_t total = stat.count.load(std::memory_order_relaxed);
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t target = ((uint64_t)total * percent + 99) / 100;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < ROUTE_STATS_BUCKETS; i++) {
+    seen += stat.buckets[i].load(std::memory_order_relaxed);
+    if (seen >= target) {
+      return kBucketBoundsUs[i];
+    }
+  }
+  return stat.maxUs.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Статистика задержек HTTP-маршрутов.
+// Счётчики обновляются атомарно из задачи веб-сервера и читаются
+// из любых других задач без блокировок.
+
+#define ROUTE_STATS_MAX_ROUTES 40
+#define ROUTE_STATS_BUCKETS    12
+
+struct RouteStat {
+  const char *route;
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> maxUs;
+  std::atomic<uint64_t> totalUs;
+  // buckets[i] — число запросов с задержкой <= kBucketBoundsUs[i],
+  // последняя корзина — всё, что длиннее
+  std::atomic<uint32_t> buckets[ROUTE_STATS_BUCKETS + 1];
+};
+
+class RouteStats {
+public:
+  // Верхние границы корзин гистограммы, мкс
+  static const uint32_t kBucketBoundsUs[ROUTE_STATS_BUCKETS];
+
+  // Регистрирует маршрут (вызывается при старте, до обработки запросов).
+  // Возвращает nullptr, если таблица заполнена.
+  RouteStat *add(const char *route);
+
+  void record(RouteStat *stat, uint32_t elapsedUs);
+
+  size_t size() const { return _count; }
+  const RouteStat &at(size_t i) const { return _routes[i]; }
+
+  // Оценка перцентиля по гистограмме (верхняя граница корзины), мкс
+  static uint32_t percentileUs(const RouteStat &stat, uint8_t percent);
+
+private:
+  RouteStat _routes[ROUTE_STATS_MAX_ROUTES];
+  size_t _count = 0;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// SHA-256 (FIPS 180-4) и HMAC-SHA256 (RFC 2104) без внешних библиотек:
+// одинаково собираются на устройстве и под Linux.
+
+#define SHA256_SIZE       32
+#define SHA256_BLOCK_SIZE 64
+
+class Sha256 {
+public:
+  Sha256() { reset(); }
+  void reset();
+  void update(const uint8_t *data, size_t length);
+  void finish(uint8_t digest[SHA256_SIZE]);
+
+private:
+  void block(const uint8_t *data);
+
+  uint32_t _state[8];
+  uint8_t _buffer[SHA256_BLOCK_SIZE];
+  size_t _buffered;
+  uint64_t _length;
+};
+
+void hmacSha256(const uint8_t *key, size_t keyLength, const uint8_t *data, size_t length,
+                uint8_t mac[SHA256_SIZE]);
+
+// Сравнение за время, не зависящее от места первого различия
+bool constantTimeEqual(const uint8_t *a, const uint8_t *b, size_t length);
@@ -0,0 +1,66 @@
+#include "sntp_packet.h"
+
+#include <string.h>
+
+// Секунды между 1900-01-01 и 1970-01-01
+static const uint64_t kNtpUnixOffset = 2208988800ULL;
+
+static uint64_t readStamp(const uint8_t *p) {
+  uint64_t stamp = 0;
+  for (int i = 0; i < 8; i++) {
+    stamp = (stamp << 8) | p[i];
+  }
+  return stamp;
+}
+
+static void writeStamp(uint8_t *p, uint64_t stamp) {
+  for (int i = 7; i >= 0; i--) {
+    p[i] = (uint8_t)stamp;
+    stamp >>= 8;
+  }
+}
+
+int64_t ntpToUtcUs(uint64_t stamp) {
+  uint64_t seconds = stamp >> 32;
+  if (seconds < 0x80000000ULL) {
+    seconds += 0x100000000ULL;
+  }
+  uint64_t fractionUs = ((stamp & 0xFFFFFFFFULL) * 1000000ULL) >> 32;
+  return (int64_t)(seconds - kNtpUnixOffset) * 1000000LL + (int64_t)fractionUs;
+}
+
+uint64_t utcUsToNtp(int64_t utcUs) {
+  uint64_t seconds = (uint64_t)(utcUs / 1000000LL) + kNtpUnixOffset;
+  uint64_t fraction = ((uint64_t)(utcUs % 1000000LL) << 32) / 1000000ULL;
+  return ((seconds & 0xFFFFFFFFULL) << 32) | fraction;
+}
+
+void sntpEncodeRequest(uint64_t nonce, uint8_t out[SNTP_PACKET_SIZE]) {
+  memset(out, 0, SNTP_PACKET_SIZE);
+  out[0] = (0 << 6) | (4 << 3) | 3; // LI = 0, VN = 4, Mode = 3 (client)
+  writeStamp(out + 40, nonce);
+}
+
+bool sntpParseResponse(const uint8_t *data, size_t length, uint64_t nonce, int64_t &t2UtcUs, int64_t &t3UtcUs) {
+  if (length < SNTP_PACKET_SIZE) {
+    return false;
+  }
+  uint8_t leap = data[0] >> 6;
+  uint8_t version = (data[0] >> 3) & 0x07;
+  uint8_t mode = data[0] & 0x07;
+  uint8_t stratum = data[1];
+  if (mode != 4 || version < 3 || leap == 3 || stratum == 0 || stratum > 15) {
+    return false;
+  }
+  if (readStamp(data + 24) != nonce) {
+    return false;
+  }
+  uint64_t receive = readStamp(data + 32);
+  uint64_t transmit = readStamp(data + 40);
+  if (receive == 0 || transmit == 0) {
+    return false;
+  }
+  t2UtcUs = ntpToUtcUs(receive);
+  t3UtcUs = ntpToUtcUs(transmit);
+  return t3UtcUs >= t2UtcUs;
+}
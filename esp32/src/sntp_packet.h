@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Пакет SNTP (RFC 4330): 48 байт, метки времени — 64-битные числа
+// с фиксированной точкой (секунды от 1900-01-01 и доли секунды).
+
+#define SNTP_PACKET_SIZE 48
+#define SNTP_PORT        123
+
+// Метка NTP <-> мкс UTC от 1970-01-01. Эпоха NTP переполняется в 2036:
+// секунды меньше 2^31 считаются следующей эпохой.
+int64_t ntpToUtcUs(uint64_t stamp);
+uint64_t utcUsToNtp(int64_t utcUs);
+
+// Запрос клиента (версия 4, режим 3). В поле transmit — произвольная
+// метка nonce: сервер вернёт её в originate, по ней ответ сверяется
+// с запросом. Часы клиента в запрос не попадают.
+void sntpEncodeRequest(uint64_t nonce, uint8_t out[SNTP_PACKET_SIZE]);
+
+// Разбор ответа сервера: t2 — приём запроса, t3 — отправка ответа,
+// мкс UTC. false — не ответ на этот запрос, сервер не синхронизирован
+// (stratum 0/16, LI = 3, kiss-o'-death) или метки некорректны.
+bool sntpParseResponse(const uint8_t *data, size_t length, uint64_t nonce, int64_t &t2UtcUs, int64_t &t3UtcUs);
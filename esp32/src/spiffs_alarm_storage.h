@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SPIFFS.h>
+
+#include "alarm_store.h"
+
+// Слоты AlarmStore — два файла в SPIFFS
+class SpiffsAlarmStorage : public AlarmStorage {
+public:
+  size_t read(uint8_t slot, size_t offset, uint8_t *data, size_t length) override {
+    File file = SPIFFS.open(path(slot), FILE_READ);
+    if (!file) {
+      return 0;
+    }
+    size_t size = file.seek(offset) ? file.read(data, length) : 0;
+    file.close();
+    return size;
+  }
+
+  bool write(uint8_t slot, const uint8_t *header, size_t headerLength, const uint8_t *alarms,
+             size_t alarmsLength) override {
+    File file = SPIFFS.open(path(slot), FILE_WRITE);
+    if (!file) {
+      return false;
+    }
+    size_t written = file.write(header, headerLength);
+    written += file.write(alarms, alarmsLength);
+    file.close();
+    return written == headerLength + alarmsLength;
+  }
+
+private:
+  static const char *path(uint8_t slot) {
+    return slot == 0 ? "/alarms0.bin" : "/alarms1.bin";
+  }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <SPIFFS.h>
+
+#include "config_store.h"
+
+// Слоты ConfigStore — два файла в SPIFFS
+class SpiffsConfigStorage : public ConfigStorage {
+public:
+  size_t read(uint8_t slot, uint8_t *data, size_t capacity) override {
+    File file = SPIFFS.open(path(slot), FILE_READ);
+    if (!file) {
+      return 0;
+    }
+    size_t size = file.read(data, capacity);
+    file.close();
+    return size;
+  }
+
+  bool write(uint8_t slot, const uint8_t *data, size_t length) override {
+    File file = SPIFFS.open(path(slot), FILE_WRITE);
+    if (!file) {
+      return false;
+    }
+    size_t written = file.write(data, length);
+    file.close();
+    return written == length;
+  }
+
+private:
+  static const char *path(uint8_t slot) {
+    return slot == 0 ? "/config0.bin" : "/config1.bin";
+  }
+};
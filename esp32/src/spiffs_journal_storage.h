@@ -0,0 +1,56 @@
+#pragma once
+
+#include <SPIFFS.h>
+
+#include "event_journal.h"
+
+// Сегменты EventJournal — файлы /journalNN.bin в SPIFFS. Файл
+// дописывается в режиме append, стирание — удаление файла; износ
+// страниц flash под файлами выравнивает сам SPIFFS.
+class SpiffsJournalStorage : public JournalStorage {
+public:
+  size_t length(uint8_t segment) override {
+    char name[24];
+    File file = SPIFFS.open(path(segment, name), FILE_READ);
+    if (!file) {
+      return 0;
+    }
+    size_t size = file.size();
+    file.close();
+    return size;
+  }
+
+  size_t read(uint8_t segment, size_t offset, uint8_t *data, size_t length) override {
+    char name[24];
+    File file = SPIFFS.open(path(segment, name), FILE_READ);
+    if (!file) {
+      return 0;
+    }
+    size_t size = file.seek(offset) ? file.read(data, length) : 0;
+    file.close();
+    return size;
+  }
+
+  bool append(uint8_t segment, const uint8_t *data, size_t length) override {
+    char name[24];
+    File file = SPIFFS.open(path(segment, name), FILE_APPEND);
+    if (!file) {
+      return false;
+    }
+    size_t written = file.write(data, length);
+    file.close();
+    return written == length;
+  }
+
+  bool erase(uint8_t segment) override {
+    char name[24];
+    path(segment, name);
+    return !SPIFFS.exists(name) || SPIFFS.remove(name);
+  }
+
+private:
+  static const char *path(uint8_t segment, char *name) {
+    snprintf(name, 24, "/journal%02u.bin", segment);
+    return name;
+  }
+};
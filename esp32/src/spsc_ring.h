@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Кольцо фиксированного размера между двумя задачами: в него пишет
+// ровно одна задача, читает ровно одна, без блокировок и критических
+// секций — задачи на разных ядрах не ждут друг друга. Голова и хвост —
+// счётчики, которые двигает только их владелец; release при записи и
+// acquire при чтении гарантируют, что элемент виден целиком.
+// Размер — степень двойки. Пробуждение читателя — дело вызывающего
+// (xTaskNotify после push).
+//
+//   SpscRing<AudioCommand, 16> ring;
+//   ring.push(command);        // только задача-писатель
+//   while (ring.pop(command))  // только задача-читатель
+
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "размер кольца — степень двойки");
+
+public:
+  // false — кольцо заполнено, элемент не записан
+  bool push(const T &item) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == N) {
+      _overflows.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    _items[tail & (N - 1)] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Следующий элемент без извлечения; nullptr — кольцо пусто
+  const T *peek() const {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &_items[head & (N - 1)];
+  }
+
+  bool pop(T &item) {
+    const T *next = peek();
+    if (next == nullptr) {
+      return false;
+    }
+    item = *next;
+    drop();
+    return true;
+  }
+
+  // Извлекает элемент, прочитанный через peek()
+  void drop() {
+    _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Из любой задачи; приблизительно, пока кольцо меняется
+  size_t size() const {
+    uint32_t head = _head.load(std::memory_order_acquire);
+    return _tail.load(std::memory_order_acquire) - head;
+  }
+  static size_t capacity() { return N; }
+  uint32_t overflowCount() const { return _overflows.load(std::memory_order_relaxed); }
+
+private:
+  T _items[N];
+  std::atomic<uint32_t> _head{0};
+  std::atomic<uint32_t> _tail{0};
+  std::atomic<uint32_t> _overflows{0};
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+// Строка без владения: указатель и длина внутри чужого буфера. Живёт,
+// пока жив буфер. Аргументы и заголовки запроса GongWebServer — виды
+// в буфер приёма соединения, действительные до конца обработчика, и
+// всегда оканчиваются нулём, так что c_str() можно отдавать C-функциям.
+struct StrView {
+  const char *data = "";
+  size_t length = 0;
+
+  StrView() {}
+  StrView(const char *text, size_t textLength) : data(text), length(textLength) {}
+
+  const char *c_str() const { return data; }
+  bool isEmpty() const { return length == 0; }
+  bool equals(const char *text) const { return strlen(text) == length && memcmp(data, text, length) == 0; }
+  bool contains(const char *text) const { return strstr(data, text) != nullptr; }
+
+  // Целое целиком, со знаком; false — не число или вне long
+  bool toLong(long &value) const {
+    size_t i = 0;
+    bool negative = length > 0 && (data[0] == '-' || data[0] == '+');
+    if (negative) {
+      negative = data[0] == '-';
+      i = 1;
+    }
+    if (i == length) {
+      return false;
+    }
+    unsigned long magnitude = 0;
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+    for (; i < length; i++) {
+      unsigned digit = (unsigned)(data[i] - '0');
+      if (digit > 9 || magnitude > (limit - digit) / 10) {
+        return false;
+      }
+      magnitude = magnitude * 10 + digit;
+    }
+    value = negative ? (long)(0 - magnitude) : (long)magnitude;
+    return true;
+  }
+
+  // Как String::toInt() для чисел; не число — 0
+  long toInt() const {
+    long value;
+    return toLong(value) ? value : 0;
+  }
+};
@@ -0,0 +1,222 @@
+#include "strike_prestage.h"
+
+#include "dfplayer.h"
+
+bool runPrestageAction(DFPlayer &player, PrestageAction action, uint16_t arg) {
+  switch (action) {
+    case PrestageAction::Volume:
+      return player.volume((uint8_t)arg);
+    case PrestageAction::Play:
+      return player.play(arg);
+    case PrestageAction::Pause:
+      return player.pause();
+    case PrestageAction::Resume:
+      return player.start();
+    case PrestageAction::Stop:
+      return player.stop();
+    case PrestageAction::None:
+      break;
+  }
+  return false;
+}
+
+bool StrikePrestage::muted() const {
+  switch (_state) {
+    case State::Load:
+    case State::WaitPlaying:
+    case State::Pause:
+    case State::WaitPaused:
+    case State::Restore:
+    case State::Abort:
+    case State::Unmute:
+    case State::StrikeUnmute:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void StrikePrestage::enter(State state, int64_t nowUs) {
+  _state = state;
+  _stateSinceUs = nowUs;
+  _queried = false;
+}
+
+void StrikePrestage::fail(int64_t nowUs) {
+  _failed.fetch_add(1, std::memory_order_relaxed);
+  enter(State::Abort, nowUs);
+}
+
+void StrikePrestage::prepare(uint16_t track, uint8_t volume, bool playerBusy, int64_t nowUs) {
+  switch (_state) {
+    case State::Ready:
+      if (_track == track) {
+        return;
+      }
+      // fallthrough
+    case State::Idle:
+      if (playerBusy) {
+        _skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      _track = track;
+      _volume = volume;
+      enter(State::Mute, nowUs);
+      return;
+    case State::Mute:
+    case State::Load:
+    case State::WaitPlaying:
+    case State::Pause:
+    case State::WaitPaused:
+    case State::Restore:
+      // Другой трек поверх незавершённой подготовки: громкость уже
+      // приглушена (или будет) и сохранена в _volume
+      _track = track;
+      enter(_state == State::Mute ? State::Mute : State::Load, nowUs);
+      return;
+    default:
+      // Идёт удар или отмена — этот удар стартует холодным
+      _skipped.fetch_add(1, std::memory_order_relaxed);
+      return;
+  }
+}
+
+void StrikePrestage::strike(uint16_t track, int64_t nowUs) {
+  if (_state == State::Measure) {
+    _unmeasured.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (_state == State::Ready && _track == track) {
+    _strikePrestaged = true;
+    enter(State::StrikeResume, nowUs);
+    return;
+  }
+  bool restore = muted();
+  _track = track;
+  _strikePrestaged = false;
+  enter(restore ? State::StrikeUnmute : State::StrikePlay, nowUs);
+}
+
+bool StrikePrestage::cancel() {
+  if (_state == State::Measure) {
+    _unmeasured.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (muted()) {
+    _state = State::Unmute;
+    return true;
+  }
+  _state = State::Idle;
+  return false;
+}
+
+bool StrikePrestage::setVolume(uint8_t volume) {
+  _volume = volume;
+  return !muted();
+}
+
+PrestageAction StrikePrestage::next(int64_t nowUs, uint16_t &arg) {
+  arg = 0;
+  switch (_state) {
+    case State::Mute:
+      enter(State::Load, nowUs);
+      return PrestageAction::Volume;
+    case State::Load:
+      arg = _track;
+      enter(State::WaitPlaying, nowUs);
+      return PrestageAction::Play;
+    case State::Pause:
+      enter(State::WaitPaused, nowUs);
+      return PrestageAction::Pause;
+    case State::Restore:
+      arg = _volume;
+      _prepared.fetch_add(1, std::memory_order_relaxed);
+      enter(State::Ready, nowUs);
+      return PrestageAction::Volume;
+    case State::Abort:
+      enter(State::Unmute, nowUs);
+      return PrestageAction::Stop;
+    case State::Unmute:
+      arg = _volume;
+      enter(State::Idle, nowUs);
+      return PrestageAction::Volume;
+    case State::StrikeUnmute:
+      arg = _volume;
+      enter(State::StrikePlay, nowUs);
+      return PrestageAction::Volume;
+    case State::StrikePlay:
+      arg = _track;
+      _strikeSentUs = nowUs;
+      enter(State::Measure, nowUs);
+      return PrestageAction::Play;
+    case State::StrikeResume:
+      _strikeSentUs = nowUs;
+      enter(State::Measure, nowUs);
+      return PrestageAction::Resume;
+    case State::WaitPlaying:
+    case State::WaitPaused:
+      if (nowUs - _stateSinceUs > kConfirmTimeoutUs) {
+        // Плеер не подтвердил: трек мог остаться играть беззвучно
+        fail(nowUs);
+        return next(nowUs, arg);
+      }
+      break;
+    case State::Measure:
+      if (nowUs - _stateSinceUs > kStrikeTimeoutUs) {
+        _unmeasured.fetch_add(1, std::memory_order_relaxed);
+        enter(State::Idle, nowUs);
+        return PrestageAction::None;
+      }
+      break;
+    case State::Idle:
+    case State::Ready:
+      break;
+  }
+  return PrestageAction::None;
+}
+
+bool StrikePrestage::query() {
+  bool waiting = _state == State::WaitPlaying || _state == State::WaitPaused || _state == State::Measure;
+  if (_busyLine || !waiting) {
+    return false;
+  }
+  _queried = true;
+  return true;
+}
+
+void StrikePrestage::observe(bool playing, int64_t atUs) {
+  if (!_busyLine && !_queried) {
+    return;
+  }
+  switch (_state) {
+    case State::WaitPlaying:
+      if (playing) {
+        enter(State::Pause, atUs);
+      }
+      break;
+    case State::WaitPaused:
+      if (!playing) {
+        enter(State::Restore, atUs);
+      }
+      break;
+    case State::Measure:
+      if (playing) {
+        int64_t latencyUs = atUs - _strikeSentUs;
+        _latencyUs = latencyUs > 0 ? (int32_t)latencyUs : 0;
+        _latencyPrestaged = _strikePrestaged;
+        _hasLatency = true;
+        enter(State::Idle, atUs);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+bool StrikePrestage::takeLatency(int32_t &latencyUs, bool &prestaged) {
+  if (!_hasLatency) {
+    return false;
+  }
+  _hasLatency = false;
+  latencyUs = _latencyUs;
+  prestaged = _latencyPrestaged;
+  return true;
+}
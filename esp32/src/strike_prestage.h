@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+class DFPlayer;
+
+// Подготовка удара заранее. Холодный старт трека — это команда по UART,
+// поиск файла на SD и запуск декодера; всё это попадает между моментом
+// будильника и звуком. За несколько секунд до удара трек запускается
+// при нулевой громкости и ставится на паузу:
+//   громкость 0 -> трек N -> (играет) -> пауза -> (пауза) -> громкость
+// В момент удара остаётся одна команда — продолжить. Первые десятки
+// миллисекунд файла при этом проигрываются беззвучно во время подготовки.
+//
+// Переходы «играет»/«пауза» подтверждаются линией BUSY плеера или,
+// без неё, ответами на запрос состояния. Так же замеряется задержка
+// удара: от отправки команды до начала воспроизведения.
+//
+// Класс только решает, что отправить; команды шлёт audioTask
+// (runPrestageAction) с интервалом DFPlayer::kCommandIntervalMs.
+// Вызывается только из audioTask; счётчики читаются из любой задачи.
+
+enum class PrestageAction : uint8_t {
+  None,
+  Volume,   // громкость arg
+  Play,     // трек arg с начала
+  Pause,
+  Resume,
+  Stop,
+};
+
+bool runPrestageAction(DFPlayer &player, PrestageAction action, uint16_t arg);
+
+class StrikePrestage {
+public:
+  // Ожидание подтверждения от плеера до отказа от подготовки, мкс
+  static const int64_t kConfirmTimeoutUs = 1500000;
+  // Ожидание начала звука после удара, мкс
+  static const int64_t kStrikeTimeoutUs = 2000000;
+
+  // busyLine — переходы сообщает линия BUSY (observe() по фронтам),
+  // запросы состояния не нужны
+  explicit StrikePrestage(bool busyLine) : _busyLine(busyLine) {}
+
+  // Подготовить трек. volume — громкость, которую вернуть после паузы;
+  // playerBusy — плеер сейчас играет: подготовка прервала бы звук,
+  // удар пойдёт холодным стартом.
+  void prepare(uint16_t track, uint8_t volume, bool playerBusy, int64_t nowUs);
+  // Удар: продолжить подготовленный трек или запустить его с начала
+  void strike(uint16_t track, int64_t nowUs);
+  // Любая другая команда плеера отменяет подготовку. true — громкость
+  // ещё нулевая: команду нужно выполнить после next().
+  bool cancel();
+  // Новая громкость от пользователя; false — не отправлять сейчас
+  // (громкость приглушена подготовкой и будет восстановлена до новой)
+  bool setVolume(uint8_t volume);
+
+  // Следующая команда плееру; вызывается, когда плеер готов её принять.
+  // Идёт раньше команд из очереди.
+  PrestageAction next(int64_t nowUs, uint16_t &arg);
+  // Нужен запрос состояния (ждём подтверждения без линии BUSY).
+  // Спрашивается после очереди: запросы не задерживают удар.
+  bool query();
+  // Плеер играет/не играет: фронт BUSY или ответ на запрос состояния.
+  // Без линии BUSY задержка удара — оценка сверху: звук начался где-то
+  // между предыдущим запросом и ответом.
+  void observe(bool playing, int64_t atUs);
+
+  // Трек подготовлен и ждёт удара
+  bool staged() const { return _state == State::Ready; }
+  // Идут шаги подготовки, удара или замера
+  bool busy() const { return _state != State::Idle && _state != State::Ready; }
+  uint16_t track() const { return _track; }
+
+  // Замер последнего удара; true — появился новый с прошлого вызова
+  bool takeLatency(int32_t &latencyUs, bool &prestaged);
+
+  uint32_t preparedCount() const { return _prepared.load(std::memory_order_relaxed); }
+  uint32_t failedCount() const { return _failed.load(std::memory_order_relaxed); }
+  uint32_t skippedCount() const { return _skipped.load(std::memory_order_relaxed); }
+  // Удары без замера: плеер не подтвердил начало звука
+  uint32_t unmeasuredCount() const { return _unmeasured.load(std::memory_order_relaxed); }
+
+private:
+  enum class State : uint8_t {
+    Idle,
+    Mute,          // отправить громкость 0
+    Load,          // отправить трек
+    WaitPlaying,
+    Pause,
+    WaitPaused,
+    Restore,       // вернуть громкость -> Ready
+    Ready,
+    Abort,         // стоп после отказа -> Unmute
+    Unmute,        // вернуть громкость -> Idle
+    StrikeUnmute,  // вернуть громкость -> StrikePlay
+    StrikePlay,
+    StrikeResume,
+    Measure,       // ждём начала звука
+  };
+
+  bool muted() const;
+  void enter(State state, int64_t nowUs);
+  void fail(int64_t nowUs);
+
+  bool _busyLine;
+  State _state = State::Idle;
+  uint16_t _track = 0;
+  uint8_t _volume = 0;
+  int64_t _stateSinceUs = 0;
+  // В текущем состоянии уже был запрос: ответы на более ранние
+  // запросы не подтверждают переход
+  bool _queried = false;
+  int64_t _strikeSentUs = 0;
+  bool _strikePrestaged = false;
+
+  bool _hasLatency = false;
+  int32_t _latencyUs = 0;
+  bool _latencyPrestaged = false;
+
+  std::atomic<uint32_t> _prepared{0};
+  std::atomic<uint32_t> _failed{0};
+  std::atomic<uint32_t> _skipped{0};
+  std::atomic<uint32_t> _unmeasured{0};
+};
@@ -0,0 +1,31 @@
+#include "task_health.h"
+
+void TaskHealth::watch(size_t slot, const char *name, uint32_t maxSilenceMs, uint32_t nowMs) {
+  if (slot >= TASK_HEALTH_MAX_TASKS) {
+    return;
+  }
+  _slots[slot].name = name;
+  _slots[slot].maxSilenceMs = maxSilenceMs;
+  _slots[slot].lastBeatMs.store(nowMs, std::memory_order_relaxed);
+  if (slot >= _count) {
+    _count = slot + 1;
+  }
+}
+
+uint32_t TaskHealth::silenceMs(size_t slot, uint32_t nowMs) const {
+  if (slot >= _count || _slots[slot].name == nullptr) {
+    return 0;
+  }
+  // Отметка после чтения nowMs даёт отрицательную разницу — это не молчание
+  int32_t silence = (int32_t)(nowMs - _slots[slot].lastBeatMs.load(std::memory_order_relaxed));
+  return silence > 0 ? (uint32_t)silence : 0;
+}
+
+int TaskHealth::stale(uint32_t nowMs) const {
+  for (size_t slot = 0; slot < _count; slot++) {
+    if (_slots[slot].name != nullptr && silenceMs(slot, nowMs) > _slots[slot].maxSilenceMs) {
+      return (int)slot;
+    }
+  }
+  return -1;
+}
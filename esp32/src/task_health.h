@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Пульс задач для сторожевого таймера. Каждая задача отмечается в своём
+// слоте на каждом проходе цикла; супервизор кормит TWDT, только пока все
+// отметки свежие. Задача, застрявшая на блокировке или в бесконечном
+// цикле, перестаёт отмечаться — и устройство перезагружается, даже если
+// остальные задачи живы. Отметка — одна атомарная запись, без блокировок.
+//
+//   health.watch(SLOT_AUDIO, "AudioTask", 3000);
+//   health.beat(SLOT_AUDIO, millis());      // в цикле задачи
+//   if (health.stale(millis()) < 0) esp_task_wdt_reset();
+
+#define TASK_HEALTH_MAX_TASKS 8
+
+class TaskHealth {
+public:
+  // До запуска задачи: с этого момента слот считается живым
+  void watch(size_t slot, const char *name, uint32_t maxSilenceMs, uint32_t nowMs);
+  void beat(size_t slot, uint32_t nowMs) {
+    _slots[slot].lastBeatMs.store(nowMs, std::memory_order_relaxed);
+  }
+
+  // Первый слот, молчащий дольше своего предела, или -1
+  int stale(uint32_t nowMs) const;
+
+  size_t count() const { return _count; }
+  const char *name(size_t slot) const { return _slots[slot].name; }
+  // Время с последней отметки; 0 — слот не наблюдается
+  uint32_t silenceMs(size_t slot, uint32_t nowMs) const;
+
+private:
+  struct Slot {
+    const char *name;
+    uint32_t maxSilenceMs;
+    std::atomic<uint32_t> lastBeatMs;
+  };
+
+  Slot _slots[TASK_HEALTH_MAX_TASKS] = {};
+  size_t _count = 0;
+};
@@ -0,0 +1,72 @@
+#include "template_renderer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Не помещается в остаток буфера
+void TemplateWriter::rawSlow(const char *data, size_t length) {
+  if (_sink == nullptr) {
+    _overflowed = true;
+    return;
+  }
+  if (length >= _capacity) {
+    // Длинный литерал не копируем: сбрасываем буфер и пишем напрямую
+    flush();
+    _sink->write(data, length);
+    _total += length;
+    return;
+  }
+  flush();
+  memcpy(_buffer + _used, data, length);
+  _used += length;
+  _total += length;
+}
+
+void TemplateWriter::raw(const char *text) {
+  raw(text, strlen(text));
+}
+
+void TemplateWriter::text(const char *text) {
+  for (; *text; text++) {
+    switch (*text) {
+      case '&':  raw("&amp;", 5); break;
+      case '<':  raw("&lt;", 4); break;
+      case '>':  raw("&gt;", 4); break;
+      case '\'': raw("&#39;", 5); break;
+      case '"':  raw("&quot;", 6); break;
+      default:   put(*text); break;
+    }
+  }
+}
+
+void TemplateWriter::number(int32_t value) {
+  char digits[12];
+  int length = snprintf(digits, sizeof(digits), "%ld", (long)value);
+  raw(digits, length);
+}
+
+void TemplateWriter::flush() {
+  if (_used > 0 && _sink != nullptr) {
+    _sink->write(_buffer, _used);
+    _used = 0;
+  }
+}
+
+void renderTemplate(const WebTemplate &tpl, TemplateContext &ctx, TemplateWriter &out) {
+  for (size_t i = 0; i < tpl.count; i++) {
+    const TemplateSegment &segment = tpl.segments[i];
+    switch (segment.type) {
+      case TEMPLATE_LITERAL:
+        out.raw(segment.text, segment.length);
+        break;
+      case TEMPLATE_SLOT:
+        ctx.slot(segment.slot, out);
+        break;
+      case TEMPLATE_SECTION:
+        if (!ctx.section(segment.slot)) {
+          i += segment.length;
+        }
+        break;
+    }
+  }
+}
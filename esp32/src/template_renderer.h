@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Шаблоны HTML-страниц. Исходники лежат в templates/ и разбираются при
+// сборке (tools/compile_templates.py) в массивы сегментов: литералы,
+// именованные слоты {{name}} и условные секции {{#name}}...{{/name}}.
+// Вывод идёт через буфер фиксированного размера, поэтому память на
+// ответ не зависит от размера страницы.
+
+enum TemplateSegmentType : uint8_t {
+  TEMPLATE_LITERAL,
+  TEMPLATE_SLOT,
+  TEMPLATE_SECTION,   // length — число сегментов внутри секции
+};
+
+struct TemplateSegment {
+  TemplateSegmentType type;
+  uint8_t slot;
+  const char *text;
+  uint16_t length;
+};
+
+struct WebTemplate {
+  const TemplateSegment *segments;
+  size_t count;
+};
+
+// Куда уходят заполненные буферы (например, чанки HTTP-ответа)
+class ChunkSink {
+public:
+  virtual ~ChunkSink() {}
+  virtual void write(const char *data, size_t length) = 0;
+};
+
+class TemplateWriter {
+public:
+  TemplateWriter(char *buffer, size_t capacity, ChunkSink &sink)
+    : _buffer(buffer), _capacity(capacity), _sink(&sink) {}
+  // Без приёмника: текст целиком остаётся в buffer, не поместившееся
+  // отбрасывается и отмечается в overflowed()
+  TemplateWriter(char *buffer, size_t capacity)
+    : _buffer(buffer), _capacity(capacity), _sink(nullptr) {}
+
+  // Короткие куски — копия в буфер без вызова; JsonWriter пишет ими
+  void raw(const char *data, size_t length) {
+    if (length <= _capacity - _used) {
+      memcpy(_buffer + _used, data, length);
+      _used += length;
+      _total += length;
+      return;
+    }
+    rawSlow(data, length);
+  }
+  void raw(const char *text);
+  // Текст с экранированием HTML (&, <, >, ', ")
+  void text(const char *text);
+  void number(int32_t value);
+  void flush();
+
+  size_t bytesWritten() const { return _total; }
+  // Ещё не сброшенное в приёмник
+  const char *data() const { return _buffer; }
+  size_t length() const { return _used; }
+  bool overflowed() const { return _overflowed; }
+
+private:
+  void rawSlow(const char *data, size_t length);
+  void put(char c) {
+    if (_used == _capacity) {
+      if (_sink == nullptr) {
+        _overflowed = true;
+        return;
+      }
+      flush();
+    }
+    _buffer[_used++] = c;
+    _total++;
+  }
+
+  char *_buffer;
+  size_t _capacity;
+  size_t _used = 0;
+  size_t _total = 0;
+  bool _overflowed = false;
+  ChunkSink *_sink;
+};
+
+// Значения слотов и условия секций для конкретного ответа
+class TemplateContext {
+public:
+  virtual ~TemplateContext() {}
+  virtual void slot(uint8_t slot, TemplateWriter &out) = 0;
+  virtual bool section(uint8_t) { return false; }
+};
+
+void renderTemplate(const WebTemplate &tpl, TemplateContext &ctx, TemplateWriter &out);
@@ -0,0 +1,196 @@
+#include "time_service.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#include "config_store.h"
+
+// Неизвестный уход: допуск кварца плюс температура
+static const uint32_t kUnknownDriftErrorPpb = 50000;
+// Уход считается только по выборкам, разнесённым хотя бы на 30 с:
+// на меньшем интервале шум задержки больше самого ухода
+static const int64_t kMinDriftSpanUs = 30000000;
+// Джиттер планировщика и стека lwIP: нижняя граница ошибки выборки
+static const uint32_t kSampleFloorUs = 500;
+// Задержка больше 3 * минимальной + 5 мс — очередь в сети, выборка
+// отбрасывается (но не больше трёх раз подряд: сеть могла стать медленнее)
+static const uint32_t kOutlierMarginUs = 5000;
+static const uint8_t kMaxRejectedInRow = 3;
+// Ход RTC (RC-генератор 150 кГц после калибровки) — около 2%
+static const uint32_t kRtcErrorPermille = 20;
+static const int64_t kMaxAnchorGapUs = 86400LL * 1000000;
+
+bool TimeService::sampleFromExchange(int64_t t1MonoUs, int64_t t2UtcUs, int64_t t3UtcUs, int64_t t4MonoUs,
+                                     TimeSample &sample) {
+  int64_t roundTrip = t4MonoUs - t1MonoUs;
+  int64_t hold = t3UtcUs - t2UtcUs;
+  if (roundTrip < 0 || hold < 0 || hold > roundTrip) {
+    return false;
+  }
+  sample.monoUs = t1MonoUs + roundTrip / 2;
+  sample.utcUs = t2UtcUs + hold / 2;
+  sample.delayUs = (uint32_t)(roundTrip - hold);
+  return true;
+}
+
+bool TimeService::addSample(const TimeSample &sample) {
+  if (_count >= 3 && _rejectedInRow < kMaxRejectedInRow) {
+    uint32_t minDelay = _samples[0].delayUs;
+    for (size_t i = 1; i < _count; i++) {
+      if (_samples[i].delayUs < minDelay) minDelay = _samples[i].delayUs;
+    }
+    if (sample.delayUs > 3 * minDelay + kOutlierMarginUs) {
+      _rejectedInRow++;
+      _rejectedCount++;
+      return false;
+    }
+  }
+  _rejectedInRow = 0;
+
+  // Первая выборка после старта или восстановления, либо скачок
+  // времени: старые выборки к новой шкале не относятся, уход сохраняется
+  if (_source == TimeSource::Sntp) {
+    _lastOffsetUs = sample.utcUs - utcUs(sample.monoUs);
+    if (_lastOffsetUs > kStepUs || _lastOffsetUs < -kStepUs) {
+      _count = 0;
+      _next = 0;
+    }
+  } else {
+    _lastOffsetUs = _source == TimeSource::None ? 0 : sample.utcUs - utcUs(sample.monoUs);
+    _count = 0;
+    _next = 0;
+    if (_source == TimeSource::None) {
+      _driftErrorPpb = kUnknownDriftErrorPpb;
+    }
+  }
+
+  _samples[_next] = sample;
+  _next = (_next + 1) % kSamples;
+  if (_count < kSamples) {
+    _count++;
+  }
+  _source = TimeSource::Sntp;
+  _syncCount++;
+  fit();
+  return true;
+}
+
+// Взвешенный МНК для offset = utc - mono от mono. Вес выборки —
+// 1 / sigma^2, sigma = delay / 2: короткий обмен точнее. Отсчёт от
+// последней выборки, чтобы в double не терять микросекунды.
+void TimeService::fit() {
+  const TimeSample &newest = _samples[(_next + kSamples - 1) % kSamples];
+  const int64_t refOffset = newest.utcUs - newest.monoUs;
+
+  double sw = 0, swx = 0, swy = 0;
+  int64_t oldestMono = newest.monoUs;
+  for (size_t i = 0; i < _count; i++) {
+    const TimeSample &s = _samples[i];
+    double sigma = s.delayUs / 2.0 + kSampleFloorUs;
+    double w = 1.0 / (sigma * sigma);
+    double x = (double)(s.monoUs - newest.monoUs);
+    double y = (double)((s.utcUs - s.monoUs) - refOffset);
+    sw += w;
+    swx += w * x;
+    swy += w * y;
+    if (s.monoUs < oldestMono) oldestMono = s.monoUs;
+  }
+  double meanX = swx / sw;
+  double meanY = swy / sw;
+
+  double slope = _driftPpb / 1e9;
+  if (_count >= 2 && newest.monoUs - oldestMono >= kMinDriftSpanUs) {
+    double sxx = 0, sxy = 0;
+    for (size_t i = 0; i < _count; i++) {
+      const TimeSample &s = _samples[i];
+      double sigma = s.delayUs / 2.0 + kSampleFloorUs;
+      double w = 1.0 / (sigma * sigma);
+      double dx = (double)(s.monoUs - newest.monoUs) - meanX;
+      double dy = (double)((s.utcUs - s.monoUs) - refOffset) - meanY;
+      sxx += w * dx * dx;
+      sxy += w * dx * dy;
+    }
+    slope = sxy / sxx;
+    if (slope > kMaxDriftPpb / 1e9) slope = kMaxDriftPpb / 1e9;
+    if (slope < -kMaxDriftPpb / 1e9) slope = -kMaxDriftPpb / 1e9;
+    // Стандартная ошибка наклона, не меньше 0.1 ppm
+    double error = sqrt(1.0 / sxx) * 1e9;
+    _driftErrorPpb = error < 100 ? 100 : (error > kUnknownDriftErrorPpb ? kUnknownDriftErrorPpb : (uint32_t)error);
+  }
+  _driftPpb = (int32_t)lround(slope * 1e9);
+
+  // Смещение в момент последней выборки
+  double intercept = meanY - slope * meanX;
+  _baseMonoUs = newest.monoUs;
+  _baseUtcUs = newest.monoUs + refOffset + (int64_t)llround(intercept);
+
+  // Ошибка в момент base: лучшая из выборок с учётом ухода с тех пор
+  // плюс разброс остатков модели
+  double best = 1e12;
+  double residual = 0;
+  for (size_t i = 0; i < _count; i++) {
+    const TimeSample &s = _samples[i];
+    double x = (double)(s.monoUs - newest.monoUs);
+    double bound = s.delayUs / 2.0 + kSampleFloorUs - x * _driftErrorPpb / 1e9;
+    if (bound < best) best = bound;
+    double r = (double)((s.utcUs - s.monoUs) - refOffset) - (intercept + slope * x);
+    residual += r * r;
+  }
+  _baseUncertaintyUs = (uint32_t)(best + sqrt(residual / _count));
+}
+
+int64_t TimeService::utcUs(int64_t monoUs) const {
+  if (_source == TimeSource::None) {
+    return -1;
+  }
+  int64_t dt = monoUs - _baseMonoUs;
+  return _baseUtcUs + dt + dt * _driftPpb / 1000000000LL;
+}
+
+int64_t TimeService::monoDelayUs(int64_t utcDelayUs) const {
+  return utcDelayUs - utcDelayUs * _driftPpb / 1000000000LL;
+}
+
+uint32_t TimeService::uncertaintyUs(int64_t monoUs) const {
+  if (_source == TimeSource::None) {
+    return UINT32_MAX;
+  }
+  int64_t age = monoUs > _baseMonoUs ? monoUs - _baseMonoUs : _baseMonoUs - monoUs;
+  int64_t total = _baseUncertaintyUs + age * _driftErrorPpb / 1000000000LL;
+  return total > UINT32_MAX ? UINT32_MAX : (uint32_t)total;
+}
+
+void TimeService::saveAnchor(int64_t monoUs, int64_t rtcUs, TimeAnchor &anchor) const {
+  if (_source == TimeSource::None) {
+    anchor.magic = 0;
+    return;
+  }
+  anchor.magic = TIME_ANCHOR_MAGIC;
+  anchor.driftPpb = _driftPpb;
+  anchor.utcUs = utcUs(monoUs);
+  anchor.rtcUs = rtcUs;
+  anchor.uncertaintyUs = uncertaintyUs(monoUs);
+  anchor.driftErrorPpb = _driftErrorPpb;
+  anchor.crc = crc32(0, (const uint8_t *)&anchor, offsetof(TimeAnchor, crc));
+}
+
+bool TimeService::restoreAnchor(const TimeAnchor &anchor, int64_t monoUs, int64_t rtcUs) {
+  if (anchor.magic != TIME_ANCHOR_MAGIC ||
+      anchor.crc != crc32(0, (const uint8_t *)&anchor, offsetof(TimeAnchor, crc))) {
+    return false;
+  }
+  int64_t gap = rtcUs - anchor.rtcUs;
+  if (gap < 0 || gap > kMaxAnchorGapUs) {
+    return false;
+  }
+  _count = 0;
+  _next = 0;
+  _source = TimeSource::Restored;
+  _baseMonoUs = monoUs;
+  _baseUtcUs = anchor.utcUs + gap;
+  _driftPpb = anchor.driftPpb;
+  _driftErrorPpb = anchor.driftErrorPpb;
+  int64_t uncertainty = anchor.uncertaintyUs + gap * kRtcErrorPermille / 1000;
+  _baseUncertaintyUs = uncertainty > UINT32_MAX ? UINT32_MAX : (uint32_t)uncertainty;
+  return true;
+}
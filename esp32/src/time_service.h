@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Служба времени: UTC выводится из монотонных часов (esp_timer) по
+// модели utc = mono + offset + drift * (mono - base). Смещение и уход
+// кварца оцениваются взвешенным МНК по последним ответам SNTP, поэтому
+// между синхронизациями и при пропаже WiFi время продолжает идти
+// с поправкой на уход, а не по сырому кварцу. Системные часы
+// (settimeofday) не трогаются.
+
+// Одна синхронизация: момент по монотонным часам, UTC в этот момент
+// и задержка сети туда-обратно (ошибка UTC не больше delay / 2)
+struct TimeSample {
+  int64_t monoUs;
+  int64_t utcUs;
+  uint32_t delayUs;
+};
+
+// Точка синхронизации для RTC-памяти: переживает программный сброс
+// и срабатывание watchdog, чтобы будильники шли до ответа SNTP
+#define TIME_ANCHOR_MAGIC 0x54494D45 // "TIME"
+struct TimeAnchor {
+  uint32_t magic;
+  int32_t driftPpb;
+  int64_t utcUs;          // UTC в момент rtcUs
+  int64_t rtcUs;          // часы RTC (идут через сброс)
+  uint32_t uncertaintyUs;
+  uint32_t driftErrorPpb;
+  uint32_t crc;           // CRC32 полей до crc
+};
+
+enum class TimeSource : uint8_t {
+  None,      // время неизвестно
+  Restored,  // из RTC-памяти после сброса
+  Sntp,
+};
+
+class TimeService {
+public:
+  static const size_t kSamples = 8;
+  // Уход кварца ESP32 — единицы ppm; больше — ошибка оценки
+  static const int32_t kMaxDriftPpb = 500000;
+  // Расхождение с прогнозом больше секунды — скачок, история сбрасывается
+  static const int64_t kStepUs = 1000000;
+
+  // Обмен SNTP: t1/t4 — отправка запроса и приём ответа по монотонным
+  // часам, t2/t3 — приём и ответ на сервере (UTC). Момент выборки —
+  // середина обмена. false — метки противоречивы.
+  static bool sampleFromExchange(int64_t t1MonoUs, int64_t t2UtcUs, int64_t t3UtcUs, int64_t t4MonoUs,
+                                 TimeSample &sample);
+
+  // Новая выборка; false — отброшена (задержка много больше обычной)
+  bool addSample(const TimeSample &sample);
+
+  // UTC в момент mono; -1 — время неизвестно
+  int64_t utcUs(int64_t monoUs) const;
+  // Интервал по монотонным часам, соответствующий utcDelayUs по UTC
+  int64_t monoDelayUs(int64_t utcDelayUs) const;
+  // Оценка ошибки utcUs(mono): растёт со временем без синхронизации
+  uint32_t uncertaintyUs(int64_t monoUs) const;
+
+  TimeSource source() const { return _source; }
+  int32_t driftPpb() const { return _driftPpb; }
+  // Расхождение последней выборки с прогнозом модели (UTC - прогноз)
+  int64_t lastOffsetUs() const { return _lastOffsetUs; }
+  int64_t lastSyncMonoUs() const { return _source == TimeSource::Sntp ? _baseMonoUs : -1; }
+  uint32_t syncCount() const { return _syncCount; }
+  uint32_t rejectedCount() const { return _rejectedCount; }
+
+  // Сохранение и восстановление точки синхронизации; rtcUs — часы,
+  // идущие через сброс. Восстановление отвергает повреждённую запись
+  // и разрыв больше суток.
+  void saveAnchor(int64_t monoUs, int64_t rtcUs, TimeAnchor &anchor) const;
+  bool restoreAnchor(const TimeAnchor &anchor, int64_t monoUs, int64_t rtcUs);
+
+private:
+  void fit();
+
+  TimeSample _samples[kSamples];
+  size_t _count = 0;
+  size_t _next = 0;
+
+  TimeSource _source = TimeSource::None;
+  int64_t _baseMonoUs = 0;
+  int64_t _baseUtcUs = 0;
+  int32_t _driftPpb = 0;
+  uint32_t _driftErrorPpb = 0;
+  uint32_t _baseUncertaintyUs = 0;
+  int64_t _lastOffsetUs = 0;
+  uint32_t _syncCount = 0;
+  uint32_t _rejectedCount = 0;
+  uint8_t _rejectedInRow = 0;
+};
@@ -0,0 +1,69 @@
+#include "trace_buffer.h"
+
+// Полные мкс метки часов по младшим 32 битам: метка не старше ~71 мин
+static int64_t clockUs(uint32_t lowUs, int64_t nowUs) {
+  return nowUs - (int64_t)(uint32_t)((uint32_t)nowUs - lowUs);
+}
+
+bool TraceBuffer::read(const Ring &ring, uint32_t index, TraceEvent &event) const {
+  const Slot &slot = ring.slots[index & (TRACE_BUFFER_EVENTS - 1)];
+  if (slot.stamp.load(std::memory_order_acquire) != index + 1) {
+    return false;
+  }
+  event = slot.event;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.stamp.load(std::memory_order_relaxed) == index + 1;
+}
+
+// Время события — от ближайшей предыдущей метки часов, разница тактов
+// со знаком; события до первой метки в кольце — от неё же
+size_t TraceBuffer::exportChrome(uint8_t core, JsonWriter &json, int64_t nowUs, uint32_t cyclesPerUs) const {
+  const Ring &ring = _rings[core & (TRACE_CORES - 1)];
+  uint32_t end = ring.next.load(std::memory_order_acquire);
+  uint32_t begin = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0;
+  TraceEvent event;
+  bool anchored = false;
+  uint32_t anchorCycles = 0;
+  int64_t anchorUs = 0;
+  for (uint32_t i = begin; i != end && !anchored; i++) {
+    if (read(ring, i, event) && event.phase == (uint8_t)TracePhase::Clock) {
+      anchored = true;
+      anchorCycles = event.cycles;
+      anchorUs = clockUs(event.arg, nowUs);
+    }
+  }
+  if (!anchored || cyclesPerUs == 0) {
+    return 0;
+  }
+
+  size_t written = 0;
+  for (uint32_t i = begin; i != end; i++) {
+    if (!read(ring, i, event)) {
+      continue;
+    }
+    if (event.phase == (uint8_t)TracePhase::Clock) {
+      anchorCycles = event.cycles;
+      anchorUs = clockUs(event.arg, nowUs);
+      continue;
+    }
+    int64_t deltaNs = (int64_t)(int32_t)(event.cycles - anchorCycles) * 1000 / cyclesPerUs;
+    char phase[2] = {(char)event.phase, '\0'};
+    json.beginObject();
+    json.string("name", event.name);
+    json.string("ph", phase);
+    json.decimal("ts", anchorUs * 1000 + deltaNs, 3);
+    json.number("pid", core);
+    json.number("tid", traceTaskId(event.task));
+    if (event.phase == (uint8_t)TracePhase::Instant) {
+      json.string("s", "t");
+    }
+    if (event.arg != 0) {
+      json.beginObject("args");
+      json.number("arg", event.arg);
+      json.endObject();
+    }
+    json.endObject();
+    written++;
+  }
+  return written;
+}
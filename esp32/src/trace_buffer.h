@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "json_writer.h"
+
+// Трассировка: точки begin/end и мгновенные события из любой задачи и
+// прерывания пишутся в кольцо своего ядра. Запись — захват номера
+// атомарным инкрементом и копия 20 байт, без блокировок: задачи на
+// разных ядрах не делят ни кольцо, ни счётчик. Кольцо перезаписывает
+// самые старые события; читатель проверяет номер в слоте (seqlock) и
+// пропускает недописанные и перезаписанные во время чтения.
+//
+// Время — счётчик тактов ядра (32 бита, переполняется за ~18 с при
+// 240 МГц). Чтобы перевести его в общее время esp_timer, задачи каждого
+// ядра раз в TRACE_CLOCK_INTERVAL_MS пишут метку часов (clock()): пара
+// «такты — мкс». Соседние события ядра не должны отстоять больше чем
+// на 2^31 тактов — метки часов это обеспечивают.
+//
+// Точки трассировки и их отключение при сборке — src/esp32_trace.h.
+
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS 128 // на ядро, степень двойки
+#endif
+#ifndef TRACE_CLOCK_INTERVAL_MS
+#define TRACE_CLOCK_INTERVAL_MS 1000
+#endif
+#define TRACE_CORES 2
+
+enum class TracePhase : uint8_t {
+  Begin = 'B',
+  End = 'E',
+  Instant = 'i',
+  Clock = 'c', // метка часов, в экспорт не попадает
+};
+
+struct TraceEvent {
+  const char *name;   // строка со статическим временем жизни
+  const void *task;   // nullptr — прерывание
+  uint32_t cycles;
+  uint32_t arg;       // для Clock — младшие 32 бита мкс esp_timer
+  uint8_t phase;      // TracePhase
+};
+
+// Номер потока в Chrome trace: по адресу задачи, 0 — прерывание
+inline uint32_t traceTaskId(const void *task) {
+  return (uint32_t)(uintptr_t)task;
+}
+
+class TraceBuffer {
+  static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0, "размер кольца — степень двойки");
+
+public:
+  // Из любой задачи и прерывания ядра core
+  void record(uint8_t core, TracePhase phase, const char *name, const void *task, uint32_t cycles,
+              uint32_t arg) {
+    Ring &ring = _rings[core & (TRACE_CORES - 1)];
+    uint32_t index = ring.next.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = ring.slots[index & (TRACE_BUFFER_EVENTS - 1)];
+    slot.stamp.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event.name = name;
+    slot.event.task = task;
+    slot.event.cycles = cycles;
+    slot.event.arg = arg;
+    slot.event.phase = (uint8_t)phase;
+    slot.stamp.store(index + 1, std::memory_order_release);
+  }
+
+  // Метка часов, если с прошлой на этом ядре прошло intervalCycles
+  // тактов. Зовёт одна задача ядра (loop(), webServerTask).
+  void clock(uint8_t core, uint32_t cycles, int64_t nowUs, uint32_t intervalCycles) {
+    Ring &ring = _rings[core & (TRACE_CORES - 1)];
+    if (ring.clocked && cycles - ring.lastClockCycles < intervalCycles) {
+      return;
+    }
+    ring.clocked = true;
+    ring.lastClockCycles = cycles;
+    record(core, TracePhase::Clock, nullptr, nullptr, cycles, (uint32_t)nowUs);
+  }
+
+  // События ядра в формате Chrome trace — элементы массива traceEvents,
+  // от старых к новым; pid — ядро, tid — traceTaskId(). nowUs — время
+  // esp_timer при экспорте, cyclesPerUs — частота счётчика тактов.
+  // Возвращает число записанных событий.
+  size_t exportChrome(uint8_t core, JsonWriter &json, int64_t nowUs, uint32_t cyclesPerUs) const;
+
+  // Записано событий на ядре с загрузки, включая метки часов
+  uint32_t recordedCount(uint8_t core) const {
+    return _rings[core & (TRACE_CORES - 1)].next.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Slot {
+    TraceEvent event;
+    std::atomic<uint32_t> stamp{0}; // номер записи + 1; 0 — пишется
+  };
+  struct Ring {
+    Slot slots[TRACE_BUFFER_EVENTS];
+    std::atomic<uint32_t> next{0};
+    // Только задача, которая пишет метки часов
+    bool clocked = false;
+    uint32_t lastClockCycles = 0;
+  };
+
+  bool read(const Ring &ring, uint32_t index, TraceEvent &event) const;
+
+  Ring _rings[TRACE_CORES];
+};
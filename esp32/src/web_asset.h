@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Статический веб-ресурс, встроенный в прошивку (см. tools/embed_assets.py).
+// Данные уже сжаты gzip и лежат во flash.
+struct WebAsset {
+  const char *path;
+  const char *route;        // имя для статистики маршрутов
+  const char *contentType;
+  const char *etag;         // в кавычках, как в заголовке
+  const uint8_t *data;
+  size_t length;
+  bool immutable;           // адрес содержит хэш — можно кэшировать бессрочно
+};
+
+template <size_t N>
+const WebAsset *findWebAsset(const WebAsset (&assets)[N], const char *path) {
+  for (size_t i = 0; i < N; i++) {
+    if (strcmp(assets[i].path, path) == 0) {
+      return &assets[i];
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,180 @@
+#include "wifi_manager.h"
+
+#include <string.h>
+
+bool WiFiManager::sameAp(const WiFiNetwork &a, const WiFiNetwork &b) {
+  return strncmp(a.ssid, b.ssid, sizeof(a.ssid)) == 0 && strncmp(a.pass, b.pass, sizeof(a.pass)) == 0;
+}
+
+void WiFiManager::setNetwork(const WiFiNetwork &network) {
+  if (!sameAp(network, _network)) {
+    _apCached = false;
+  }
+  _network = network;
+  _network.ssid[sizeof(_network.ssid) - 1] = '\0';
+  _network.pass[sizeof(_network.pass) - 1] = '\0';
+}
+
+void WiFiManager::start(uint32_t nowMs) {
+  _attempt = 0;
+  _gotIpEvents.store(0);
+  _lostEvents.store(0);
+  beginAttempt(nowMs);
+}
+
+void WiFiManager::stop() {
+  _state = IDLE;
+  _selfDisconnects = 0;
+  _driver.disconnect();
+}
+
+void WiFiManager::tryNetwork(const WiFiNetwork &network, uint32_t nowMs) {
+  _previous = _network;
+  memcpy(_previousBssid, _bssid, sizeof(_bssid));
+  _previousChannel = _channel;
+  _previousApCached = _apCached;
+  // Смена только адресации — та же точка доступа, без сканирования
+  setNetwork(network);
+  if (_state == CONNECTED) {
+    _driver.disconnect();
+    _selfDisconnects++;
+  }
+  _trial = TRIAL_RUNNING;
+  _trialLinkDown = true;
+  _trialStartMs = nowMs;
+  _trialDowntimeMs = 0;
+  _attempt = 0;
+  beginAttempt(nowMs);
+}
+
+void WiFiManager::onEvent(WiFiLinkEvent event) {
+  _lastEvent.store((uint8_t)event);
+  if (event == WiFiLinkEvent::GotIp) {
+    _gotIpEvents.fetch_add(1);
+  } else if (event == WiFiLinkEvent::Disconnected) {
+    _lostEvents.fetch_add(1);
+  }
+}
+
+void WiFiManager::beginAttempt(uint32_t nowMs) {
+  _usingCachedAp = _apCached;
+  if (_usingCachedAp) {
+    _driver.begin(_network, _channel, _bssid);
+    _deadlineMs = nowMs + kFastConnectTimeoutMs;
+  } else {
+    _driver.begin(_network, 0, nullptr);
+    _deadlineMs = nowMs + kConnectTimeoutMs;
+  }
+  _state = CONNECTING;
+}
+
+void WiFiManager::scheduleRetry(uint32_t nowMs, bool timedOut) {
+  // По тайм-ауту драйвер ещё пытается подключиться — останавливаем его
+  if (timedOut) {
+    _driver.disconnect();
+    _selfDisconnects++;
+  }
+
+  // Быстрое подключение не удалось — точка доступа могла сменить канал
+  // или BSSID: сразу пробуем с полным сканированием
+  if (_usingCachedAp) {
+    _apCached = false;
+    beginAttempt(nowMs);
+    return;
+  }
+
+  // Экспонента с "равным" джиттером: половина фиксирована, половина случайна
+  uint32_t shift = _attempt < 16 ? _attempt : 16;
+  uint64_t delayMs = (uint64_t)kBackoffBaseMs << shift;
+  if (delayMs > kBackoffMaxMs) {
+    delayMs = kBackoffMaxMs;
+  }
+  uint32_t half = (uint32_t)delayMs / 2;
+  _deadlineMs = nowMs + half + _driver.random() % (half + 1);
+  _attempt++;
+  _state = BACKOFF;
+}
+
+// Новая сеть не подключилась: прежняя сеть и точка доступа, сразу
+void WiFiManager::rollBack(uint32_t nowMs, bool timedOut) {
+  if (timedOut) {
+    _driver.disconnect();
+    _selfDisconnects++;
+  }
+  _network = _previous;
+  memcpy(_bssid, _previousBssid, sizeof(_bssid));
+  _channel = _previousChannel;
+  _apCached = _previousApCached;
+  _trial = TRIAL_ROLLED_BACK;
+  _rolledBack++;
+  _attempt = 0;
+  beginAttempt(nowMs);
+}
+
+uint32_t WiFiManager::tick(uint32_t nowMs) {
+  bool gotIp = _gotIpEvents.exchange(0) > 0;
+  uint32_t lostCount = _lostEvents.exchange(0);
+  uint32_t own = lostCount < _selfDisconnects ? lostCount : _selfDisconnects;
+  _selfDisconnects -= own;
+  bool lost = lostCount > own;
+  // Если пришло и то, и другое, решает последнее событие
+  if (gotIp && lost) {
+    if (_lastEvent.load() == (uint8_t)WiFiLinkEvent::GotIp) {
+      lost = false;
+    } else {
+      gotIp = false;
+    }
+  }
+
+  switch (_state) {
+    case IDLE:
+      break;
+
+    case CONNECTING:
+      if (gotIp) {
+        _apCached = _driver.currentAp(_bssid, _channel);
+        _attempt = 0;
+        // События наших отключений приходят раньше адреса; если драйвер
+        // не прислал их (disconnect() во время сканирования), они не
+        // должны поглотить настоящую потерю связи
+        _selfDisconnects = 0;
+        _state = CONNECTED;
+        if (_trial == TRIAL_RUNNING) {
+          _trial = TRIAL_APPLIED;
+          _applied++;
+        }
+        if (_trialLinkDown) {
+          _trialLinkDown = false;
+          _trialDowntimeMs = nowMs - _trialStartMs;
+        }
+      } else if (lost || reached(nowMs, _deadlineMs)) {
+        if (_trial == TRIAL_RUNNING) {
+          rollBack(nowMs, !lost);
+        } else {
+          scheduleRetry(nowMs, !lost);
+        }
+      }
+      break;
+
+    case CONNECTED:
+      if (lost) {
+        // Точка доступа пропала на мгновение — переподключаемся сразу
+        // по сохранённым BSSID/каналу, без сканирования
+        _reconnects++;
+        _attempt = 0;
+        beginAttempt(nowMs);
+      }
+      break;
+
+    case BACKOFF:
+      if (reached(nowMs, _deadlineMs)) {
+        beginAttempt(nowMs);
+      }
+      break;
+  }
+
+  if (_state == CONNECTING || _state == BACKOFF) {
+    return reached(nowMs, _deadlineMs) ? 0 : _deadlineMs - nowMs;
+  }
+  return kNoDeadline;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Событие канального уровня WiFi (из обработчика событий драйвера)
+enum class WiFiLinkEvent : uint8_t {
+  Connected,
+  GotIp,
+  Disconnected,
+};
+
+// Сеть станции: точка доступа и адресация
+struct WiFiNetwork {
+  char ssid[33];
+  char pass[65];
+  uint8_t staticIp;          // 1 — адреса ниже вместо DHCP
+  uint8_t ip[4];
+  uint8_t gateway[4];
+  uint8_t subnet[4];
+  uint8_t dns[4];
+};
+
+// Драйвер WiFi. На устройстве — обёртка над WiFi из Arduino,
+// на хосте — симулятор.
+class WiFiDriver {
+public:
+  virtual ~WiFiDriver() {}
+  // Неблокирующий старт подключения с адресацией сети. bssid == nullptr /
+  // channel == 0 — полное сканирование.
+  virtual void begin(const WiFiNetwork &network, int32_t channel, const uint8_t *bssid) = 0;
+  virtual void disconnect() = 0;
+  // BSSID и канал точки доступа, к которой подключены сейчас
+  virtual bool currentAp(uint8_t bssid[6], int32_t &channel) = 0;
+  virtual uint32_t random() = 0;
+};
+
+// Менеджер подключения к WiFi: конечный автомат без блокирующих
+// ожиданий. События драйвера принимаются из любой задачи через
+// onEvent(), переходы выполняются в tick().
+//
+// Смена сети на ходу — проба (tryNetwork): станция ESP32 держит одну
+// ассоциацию, поэтому прежняя сеть и её точка доступа (BSSID/канал)
+// запоминаются, и к новой делается одна попытка. Удалась — сеть
+// остаётся; нет (отказ или тайм-аут) — возврат к прежней с быстрым
+// подключением по сохранённой точке доступа, без паузы.
+class WiFiManager {
+public:
+  enum State : uint8_t {
+    IDLE,
+    CONNECTING,
+    CONNECTED,
+    BACKOFF,
+  };
+
+  // Тайм-аут попытки с известными BSSID/каналом и с полным сканированием
+  static const uint32_t kFastConnectTimeoutMs = 4000;
+  static const uint32_t kConnectTimeoutMs     = 15000;
+  // Экспоненциальная задержка между попытками
+  static const uint32_t kBackoffBaseMs        = 500;
+  static const uint32_t kBackoffMaxMs         = 60000;
+  // Значение tick(), когда ничего не запланировано
+  static const uint32_t kNoDeadline           = 0xFFFFFFFF;
+
+  enum TrialState : uint8_t {
+    TRIAL_NONE,
+    TRIAL_RUNNING,      // подключение к новой сети
+    TRIAL_APPLIED,      // новая сеть подключена
+    TRIAL_ROLLED_BACK,  // новая сеть не ответила, вернулись к прежней
+  };
+
+  explicit WiFiManager(WiFiDriver &driver) : _driver(driver) {}
+
+  // Другие SSID или пароль сбрасывают кэш точки доступа
+  void setNetwork(const WiFiNetwork &network);
+  void start(uint32_t nowMs);
+  void stop();
+
+  // Проба новой сети вместо текущей; итог — trialState()
+  void tryNetwork(const WiFiNetwork &network, uint32_t nowMs);
+
+  // Потокобезопасно: только выставляет флаг события
+  void onEvent(WiFiLinkEvent event);
+
+  // Обрабатывает события и тайм-ауты. Возвращает, через сколько мс
+  // нужно вызвать снова (или kNoDeadline).
+  uint32_t tick(uint32_t nowMs);
+
+  State state() const { return _state; }
+  bool connected() const { return _state == CONNECTED; }
+  uint32_t reconnectCount() const { return _reconnects; }
+  uint32_t attempt() const { return _attempt; }
+  bool hasCachedAp() const { return _apCached; }
+  const WiFiNetwork &network() const { return _network; }
+
+  TrialState trialState() const { return _trial; }
+  // Простой связи в последней пробе: от её начала до адреса в новой
+  // сети или снова в прежней; 0 — связь ещё не вернулась
+  uint32_t trialDowntimeMs() const { return _trialDowntimeMs; }
+  uint32_t appliedCount() const { return _applied; }
+  uint32_t rolledBackCount() const { return _rolledBack; }
+
+private:
+  void beginAttempt(uint32_t nowMs);
+  void scheduleRetry(uint32_t nowMs, bool timedOut);
+  void rollBack(uint32_t nowMs, bool timedOut);
+  static bool sameAp(const WiFiNetwork &a, const WiFiNetwork &b);
+  static bool reached(uint32_t nowMs, uint32_t deadlineMs) {
+    return (int32_t)(nowMs - deadlineMs) >= 0;
+  }
+
+  WiFiDriver &_driver;
+  State _state = IDLE;
+  WiFiNetwork _network = {};
+
+  uint8_t _bssid[6] = {0};
+  int32_t _channel = 0;
+  bool _apCached = false;
+  bool _usingCachedAp = false;
+
+  // Прежняя сеть и её точка доступа на время пробы
+  WiFiNetwork _previous = {};
+  uint8_t _previousBssid[6] = {0};
+  int32_t _previousChannel = 0;
+  bool _previousApCached = false;
+  TrialState _trial = TRIAL_NONE;
+  bool _trialLinkDown = false;
+  uint32_t _trialStartMs = 0;
+  uint32_t _trialDowntimeMs = 0;
+  uint32_t _applied = 0;
+  uint32_t _rolledBack = 0;
+
+  uint32_t _deadlineMs = 0;
+  uint32_t _attempt = 0;
+  uint32_t _reconnects = 0;
+
+  // Отключения, вызванные нами самими (по тайм-ауту): их события
+  // не должны считаться потерей связи в следующей попытке
+  uint32_t _selfDisconnects = 0;
+
+  // Счётчики необработанных событий и последнее пришедшее событие
+  std::atomic<uint32_t> _gotIpEvents{0};
+  std::atomic<uint32_t> _lostEvents{0};
+  std::atomic<uint8_t> _lastEvent{0};
+};
@@ -0,0 +1,530 @@
+// Планировщик будильников, курсор задачи ударов и хранение набора на
+// искусственных часах: время — локальные мкс, как в timingTask.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+
+#include <vector>
+
+#include "alarm_scheduler.h"
+#include "alarm_store.h"
+#include "civil_time.h"
+#include "occurrence_cache.h"
+
+// Понедельник 2026-10-12 00:00
+static const int64_t kMondayUs = (int64_t)daysFromCivil(2026, 10, 12) * US_PER_DAY;
+
+static int64_t at(int day, int hour, int minute) {
+  return kMondayUs + day * US_PER_DAY + (hour * 60 + minute) * US_PER_MINUTE;
+}
+
+static AlarmEntry alarm(uint16_t id, int hour, int minute, uint8_t days = ALARM_ALL_DAYS, uint8_t track = 1) {
+  AlarmEntry entry = {};
+  entry.id = id;
+  entry.duration = 10;
+  entry.minuteOfDay = hour * 60 + minute;
+  entry.days = days;
+  entry.active = 1;
+  entry.track = track;
+  return entry;
+}
+
+static AlarmScheduler scheduler;
+
+void setUp() {
+  scheduler.clear();
+}
+
+void tearDown() {}
+
+// ---- nextFire ----
+
+void test_next_fire_same_minute_is_inclusive() {
+  scheduler.upsert(alarm(1, 7, 0));
+  AlarmFire fire;
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(0, 7, 0), fire));
+  TEST_ASSERT_EQUAL_INT64(at(0, 7, 0), fire.atUs);
+  // Микросекунда позже — уже завтра
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(0, 7, 0) + 1, fire));
+  TEST_ASSERT_EQUAL_INT64(at(1, 7, 0), fire.atUs);
+}
+
+void test_next_fire_wraps_to_next_week() {
+  scheduler.upsert(alarm(1, 7, 0, 1 << 0)); // только понедельник
+  AlarmFire fire;
+  // Воскресенье 23:59 -> понедельник следующей недели
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(6, 23, 59), fire));
+  TEST_ASSERT_EQUAL_INT64(at(7, 7, 0), fire.atUs);
+  TEST_ASSERT_EQUAL_UINT16(1, fire.alarm.id);
+  // Понедельник после срабатывания -> через неделю
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(0, 7, 1), fire));
+  TEST_ASSERT_EQUAL_INT64(at(7, 7, 0), fire.atUs);
+}
+
+void test_next_fire_skips_inactive_and_empty() {
+  AlarmFire fire;
+  TEST_ASSERT_FALSE(scheduler.nextFire(at(0, 0, 0), fire));
+  AlarmEntry off = alarm(1, 6, 0);
+  off.active = 0;
+  scheduler.upsert(off);
+  TEST_ASSERT_FALSE(scheduler.nextFire(at(0, 0, 0), fire));
+  scheduler.upsert(alarm(2, 8, 0, 1 << 3)); // четверг
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(0, 0, 0), fire));
+  TEST_ASSERT_EQUAL_INT64(at(3, 8, 0), fire.atUs);
+  TEST_ASSERT_EQUAL_UINT16(2, fire.alarm.id);
+}
+
+void test_next_fire_before_epoch() {
+  scheduler.upsert(alarm(1, 0, 0, 1 << 3)); // 1970-01-01 — четверг
+  AlarmFire fire;
+  TEST_ASSERT_TRUE(scheduler.nextFire(-US_PER_MINUTE, fire));
+  TEST_ASSERT_EQUAL_INT64(0, fire.atUs);
+}
+
+// ---- collect ----
+
+struct Collected {
+  std::vector<int64_t> times;
+  std::vector<uint16_t> ids;
+};
+
+static void collectFire(const AlarmFire &fire, void *ctx) {
+  Collected *out = static_cast<Collected *>(ctx);
+  out->times.push_back(fire.atUs);
+  out->ids.push_back(fire.alarm.id);
+}
+
+void test_collect_in_time_order_across_week_end() {
+  scheduler.upsert(alarm(1, 20, 0, (1 << 6) | (1 << 0))); // Вс и Пн
+  scheduler.upsert(alarm(2, 6, 30, 1 << 0));              // Пн
+  scheduler.upsert(alarm(3, 23, 59, 1 << 6));             // Вс
+  Collected out;
+  // Воскресенье 12:00 — вторник 00:00 следующей недели
+  size_t count = scheduler.collect(at(6, 12, 0), at(8, 0, 0), collectFire, &out);
+  TEST_ASSERT_EQUAL(4, count);
+  const int64_t times[] = {at(6, 20, 0), at(6, 23, 59), at(7, 6, 30), at(7, 20, 0)};
+  const uint16_t ids[] = {1, 3, 2, 1};
+  for (size_t i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_INT64(times[i], out.times[i]);
+    TEST_ASSERT_EQUAL_UINT16(ids[i], out.ids[i]);
+  }
+}
+
+void test_collect_half_open_interval() {
+  scheduler.upsert(alarm(1, 7, 0));
+  Collected out;
+  TEST_ASSERT_EQUAL(1, scheduler.collect(at(0, 7, 0), at(1, 7, 0), collectFire, &out));
+  TEST_ASSERT_EQUAL(0, scheduler.collect(at(0, 8, 0), at(0, 8, 0), collectFire, &out));
+  // Две недели подряд: 14 срабатываний
+  TEST_ASSERT_EQUAL(14, scheduler.collect(at(0, 0, 0), at(14, 0, 0), collectFire, &out));
+}
+
+// ---- upsert / remove ----
+
+void test_upsert_replaces_and_reindexes() {
+  scheduler.upsert(alarm(1, 7, 0));
+  scheduler.upsert(alarm(1, 9, 0));
+  TEST_ASSERT_EQUAL(1, scheduler.size());
+  AlarmFire fire;
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(0, 6, 0), fire));
+  TEST_ASSERT_EQUAL_INT64(at(0, 9, 0), fire.atUs);
+  TEST_ASSERT_EQUAL(1, scheduler.forEachOnWeekday(0, [](const AlarmEntry &, void *) {}, nullptr));
+}
+
+void test_remove_keeps_index_of_moved_alarm() {
+  scheduler.upsert(alarm(1, 6, 0, ALARM_ALL_DAYS, 1));
+  scheduler.upsert(alarm(2, 7, 0, ALARM_ALL_DAYS, 2));
+  scheduler.upsert(alarm(3, 8, 0, ALARM_ALL_DAYS, 3));
+  // Последняя запись переезжает на место удалённой
+  TEST_ASSERT_TRUE(scheduler.remove(1));
+  TEST_ASSERT_FALSE(scheduler.remove(1));
+  TEST_ASSERT_EQUAL(2, scheduler.size());
+  AlarmFire fire;
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(0, 5, 0), fire));
+  TEST_ASSERT_EQUAL_INT64(at(0, 7, 0), fire.atUs);
+  TEST_ASSERT_EQUAL_UINT16(2, fire.alarm.id);
+  TEST_ASSERT_TRUE(scheduler.nextFire(at(0, 7, 1), fire));
+  TEST_ASSERT_EQUAL_UINT16(3, fire.alarm.id);
+  TEST_ASSERT_EQUAL_UINT8(3, fire.alarm.track);
+  TEST_ASSERT_EQUAL_UINT16(4, scheduler.nextId());
+}
+
+void test_upsert_rejects_bad_minute_and_full_table() {
+  AlarmEntry bad = alarm(1, 0, 0);
+  bad.minuteOfDay = MINUTES_PER_DAY;
+  TEST_ASSERT_FALSE(scheduler.upsert(bad));
+  for (uint16_t id = 1; id <= ALARM_MAX_COUNT; id++) {
+    TEST_ASSERT_TRUE(scheduler.upsert(alarm(id, id % 24, id % 60)));
+  }
+  TEST_ASSERT_FALSE(scheduler.upsert(alarm(ALARM_MAX_COUNT + 1, 12, 0)));
+  // Замена в полной таблице — не новая запись
+  TEST_ASSERT_TRUE(scheduler.upsert(alarm(5, 12, 0)));
+  TEST_ASSERT_EQUAL(ALARM_MAX_COUNT, scheduler.size());
+}
+
+// ---- курсор и таймер задачи ударов ----
+
+// Проход timingTask на местных часах nowUs: удары, которые наступили,
+// затем задержка таймера до ближайшего; -1 — таймер не нужен
+struct TimingSim {
+  FireCursor cursor;
+  AlarmFire fire;
+  bool found = false;
+  bool requery = true;
+  std::vector<AlarmFire> fired;
+
+  int64_t pass(int64_t nowUs, int64_t graceUs = 60 * US_PER_SECOND) {
+    if (cursor.follow(nowUs, graceUs)) {
+      requery = true;
+    }
+    for (;;) {
+      if (found && cursor.take(fire, nowUs)) {
+        fired.push_back(fire);
+        requery = true;
+      }
+      if (!requery) {
+        break;
+      }
+      found = scheduler.nextFire(cursor.position(), fire);
+      requery = false;
+      if (!found || fire.atUs > nowUs) {
+        break;
+      }
+    }
+    return found && cursor.pending(fire) ? fire.atUs - nowUs : -1;
+  }
+};
+
+void test_timer_fires_once_and_rearms() {
+  scheduler.upsert(alarm(1, 7, 0));
+  TimingSim sim;
+  TEST_ASSERT_EQUAL_INT64(60 * US_PER_MINUTE, sim.pass(at(0, 6, 0)));
+  // Таймер сработал: удар и таймер на завтра
+  TEST_ASSERT_EQUAL_INT64(US_PER_DAY, sim.pass(at(0, 7, 0)));
+  TEST_ASSERT_EQUAL(1, sim.fired.size());
+  // Лишнее пробуждение той же минуты не повторяет удар
+  TEST_ASSERT_EQUAL_INT64(US_PER_DAY - US_PER_SECOND, sim.pass(at(0, 7, 0) + US_PER_SECOND));
+  TEST_ASSERT_EQUAL(1, sim.fired.size());
+}
+
+void test_first_sync_does_not_replay_history() {
+  scheduler.upsert(alarm(1, 7, 0));
+  scheduler.upsert(alarm(2, 12, 0));
+  TimingSim sim;
+  // Курсор с -1: первая синхронизация часов в 13:00
+  TEST_ASSERT_EQUAL_INT64(18 * 60 * US_PER_MINUTE, sim.pass(at(3, 13, 0)));
+  TEST_ASSERT_EQUAL(0, sim.fired.size());
+}
+
+void test_clock_step_forward_past_alarm_skips_it() {
+  scheduler.upsert(alarm(1, 7, 0));
+  scheduler.upsert(alarm(2, 9, 0));
+  TimingSim sim;
+  TEST_ASSERT_EQUAL_INT64(60 * US_PER_MINUTE, sim.pass(at(0, 6, 0)));
+  // Часы прыгнули на 8:30 (перевод часов, смена пояса): 7:00 не
+  // играется, таймер перезапущен на 9:00
+  TEST_ASSERT_EQUAL_INT64(30 * US_PER_MINUTE, sim.pass(at(0, 8, 30)));
+  TEST_ASSERT_EQUAL(0, sim.fired.size());
+  TEST_ASSERT_EQUAL_INT64(0, sim.pass(at(0, 9, 0)) - US_PER_DAY + 2 * 60 * US_PER_MINUTE);
+  TEST_ASSERT_EQUAL(1, sim.fired.size());
+  TEST_ASSERT_EQUAL_UINT16(2, sim.fired[0].alarm.id);
+}
+
+void test_small_step_forward_catches_up() {
+  scheduler.upsert(alarm(1, 7, 0));
+  TimingSim sim;
+  sim.pass(at(0, 6, 59) + 50 * US_PER_SECOND);
+  // Поправка SNTP +20 с перескочила 7:00: в пределах допуска удар
+  // догоняется с опозданием
+  int64_t nowUs = at(0, 7, 0) + 10 * US_PER_SECOND;
+  TEST_ASSERT_EQUAL_INT64(US_PER_DAY - 10 * US_PER_SECOND, sim.pass(nowUs));
+  TEST_ASSERT_EQUAL(1, sim.fired.size());
+  TEST_ASSERT_EQUAL_INT64(at(0, 7, 0), sim.fired[0].atUs);
+}
+
+void test_clock_step_back_rearms_earlier() {
+  scheduler.upsert(alarm(1, 7, 0));
+  TimingSim sim;
+  sim.pass(at(0, 6, 0));
+  sim.pass(at(0, 7, 0));
+  TEST_ASSERT_EQUAL(1, sim.fired.size());
+  // Часы ушли назад на 6:30: таймер — снова на 7:00, а не на завтра
+  TEST_ASSERT_EQUAL_INT64(30 * US_PER_MINUTE, sim.pass(at(0, 6, 30)));
+  // Шаг назад в пределах допуска — курсор не трогается
+  TimingSim near;
+  near.pass(at(0, 6, 0));
+  near.pass(at(0, 7, 0));
+  TEST_ASSERT_EQUAL_INT64(US_PER_DAY + 30 * US_PER_SECOND, near.pass(at(0, 7, 0) - 30 * US_PER_SECOND));
+  TEST_ASSERT_EQUAL(1, near.fired.size());
+}
+
+void test_schedule_change_rearms_timer() {
+  scheduler.upsert(alarm(1, 7, 0));
+  TimingSim sim;
+  TEST_ASSERT_EQUAL_INT64(60 * US_PER_MINUTE, sim.pass(at(0, 6, 0)));
+  // Новый будильник раньше текущего: уведомление TIMING_SCHEDULE
+  scheduler.upsert(alarm(2, 6, 10));
+  sim.requery = true;
+  TEST_ASSERT_EQUAL_INT64(10 * US_PER_MINUTE, sim.pass(at(0, 6, 0)));
+  scheduler.remove(2);
+  scheduler.remove(1);
+  sim.requery = true;
+  TEST_ASSERT_EQUAL_INT64(-1, sim.pass(at(0, 6, 1)));
+}
+
+// ---- AlarmStore ----
+
+class MemoryAlarmStorage : public AlarmStorage {
+public:
+  size_t read(uint8_t slot, size_t offset, uint8_t *data, size_t length) override {
+    const std::vector<uint8_t> &file = files[slot];
+    if (offset >= file.size()) {
+      return 0;
+    }
+    size_t count = file.size() - offset < length ? file.size() - offset : length;
+    memcpy(data, file.data() + offset, count);
+    return count;
+  }
+  bool write(uint8_t slot, const uint8_t *header, size_t headerLength, const uint8_t *alarms,
+             size_t alarmsLength) override {
+    std::vector<uint8_t> &file = files[slot];
+    file.assign(header, header + headerLength);
+    file.insert(file.end(), alarms, alarms + alarmsLength);
+    // Обрыв питания: в слоте осталось tornAt байт
+    if (tornAt >= 0 && (size_t)tornAt < file.size()) {
+      file.resize(tornAt);
+      return false;
+    }
+    return !fail;
+  }
+  std::vector<uint8_t> files[2];
+  int tornAt = -1;
+  bool fail = false;
+};
+
+void test_store_round_trip() {
+  MemoryAlarmStorage storage;
+  AlarmStore store(storage);
+  scheduler.upsert(alarm(1, 7, 0));
+  scheduler.upsert(alarm(2, 21, 30, 1 << 4, 9));
+  TEST_ASSERT_TRUE(store.commit(scheduler, 7));
+
+  AlarmScheduler loaded;
+  AlarmStore reader(storage);
+  uint32_t version = 0;
+  TEST_ASSERT_TRUE(reader.load(loaded, version));
+  TEST_ASSERT_EQUAL_UINT32(7, version);
+  TEST_ASSERT_EQUAL(2, loaded.size());
+  TEST_ASSERT_EQUAL_UINT8(9, loaded.find(2)->track);
+  // Индекс пересобран: в пятницу оба будильника
+  AlarmFire fire;
+  TEST_ASSERT_TRUE(loaded.nextFire(at(4, 8, 0), fire));
+  TEST_ASSERT_EQUAL_INT64(at(4, 21, 30), fire.atUs);
+  TEST_ASSERT_EQUAL(2, loaded.forEachOnWeekday(4, [](const AlarmEntry &, void *) {}, nullptr));
+}
+
+void test_store_torn_write_keeps_previous_copy() {
+  MemoryAlarmStorage storage;
+  AlarmStore store(storage);
+  scheduler.upsert(alarm(1, 7, 0));
+  TEST_ASSERT_TRUE(store.commit(scheduler, 1));
+  scheduler.upsert(alarm(2, 8, 0));
+  TEST_ASSERT_TRUE(store.commit(scheduler, 2));
+  scheduler.upsert(alarm(3, 9, 0));
+  // Обрыв на каждом байте новой копии: загружается версия 2
+  size_t full = sizeof(AlarmStoreHeader) + 3 * sizeof(AlarmEntry);
+  for (size_t cut = 0; cut < full; cut++) {
+    MemoryAlarmStorage copy = storage;
+    AlarmStore writer(copy);
+    AlarmScheduler current;
+    uint32_t version;
+    TEST_ASSERT_TRUE(writer.load(current, version));
+    copy.tornAt = (int)cut;
+    TEST_ASSERT_FALSE(writer.commit(scheduler, 3));
+
+    AlarmScheduler loaded;
+    AlarmStore reader(copy);
+    TEST_ASSERT_TRUE(reader.load(loaded, version));
+    TEST_ASSERT_EQUAL_UINT32(2, version);
+    TEST_ASSERT_EQUAL(2, loaded.size());
+  }
+}
+
+void test_store_bad_crc_falls_back() {
+  MemoryAlarmStorage storage;
+  AlarmStore store(storage);
+  scheduler.upsert(alarm(1, 7, 0));
+  TEST_ASSERT_TRUE(store.commit(scheduler, 10));
+  scheduler.upsert(alarm(2, 8, 0));
+  TEST_ASSERT_TRUE(store.commit(scheduler, 11));
+  // Бит в записи новой копии (слот 1)
+  storage.files[1][sizeof(AlarmStoreHeader) + 2] ^= 0x04;
+  AlarmScheduler loaded;
+  AlarmStore reader(storage);
+  uint32_t version;
+  TEST_ASSERT_TRUE(reader.load(loaded, version));
+  TEST_ASSERT_EQUAL_UINT32(10, version);
+  TEST_ASSERT_EQUAL(1, loaded.size());
+  // Следующая запись — на место испорченной, прежняя копия цела
+  TEST_ASSERT_TRUE(reader.commit(loaded, 11));
+  TEST_ASSERT_EQUAL_UINT32(10, *(const uint32_t *)&storage.files[0][8]);
+}
+
+void test_store_failed_write_and_empty_storage() {
+  MemoryAlarmStorage storage;
+  AlarmStore store(storage);
+  uint32_t version = 5;
+  TEST_ASSERT_FALSE(store.load(scheduler, version));
+  TEST_ASSERT_EQUAL_UINT32(5, version);
+  scheduler.upsert(alarm(1, 7, 0));
+  storage.fail = true;
+  TEST_ASSERT_FALSE(store.commit(scheduler, 1));
+  // Пустой набор — тоже корректная копия
+  storage.fail = false;
+  scheduler.clear();
+  TEST_ASSERT_TRUE(store.commit(scheduler, 2));
+  AlarmScheduler loaded;
+  loaded.upsert(alarm(9, 1, 0));
+  TEST_ASSERT_TRUE(AlarmStore(storage).load(loaded, version));
+  TEST_ASSERT_EQUAL(0, loaded.size());
+}
+
+void test_store_version_wraps() {
+  MemoryAlarmStorage storage;
+  AlarmStore store(storage);
+  scheduler.upsert(alarm(1, 7, 0));
+  TEST_ASSERT_TRUE(store.commit(scheduler, UINT32_MAX));
+  scheduler.upsert(alarm(2, 8, 0));
+  TEST_ASSERT_TRUE(store.commit(scheduler, 0));
+  AlarmScheduler loaded;
+  uint32_t version;
+  TEST_ASSERT_TRUE(AlarmStore(storage).load(loaded, version));
+  TEST_ASSERT_EQUAL_UINT32(0, version);
+  TEST_ASSERT_EQUAL(2, loaded.size());
+}
+
+// ---- OccurrenceCache ----
+
+static const int32_t kMondayDay = daysFromCivil(2026, 10, 12);
+
+struct WeekdayList {
+  std::vector<uint16_t> ids;
+};
+
+static void appendId(const AlarmEntry &entry, void *ctx) {
+  static_cast<WeekdayList *>(ctx)->ids.push_back(entry.id);
+}
+
+// Списки кэша совпадают с индексом планировщика на каждом дне окна
+static void assertCacheMatchesScheduler(const OccurrenceCache &cache) {
+  for (int32_t day = cache.today(); day < cache.today() + OccurrenceCache::kWindowDays; day++) {
+    WeekdayList expected;
+    scheduler.forEachOnWeekday(weekdayFromDays(day), appendId, &expected);
+    OccurrenceList list = cache.day(day);
+    TEST_ASSERT_EQUAL_UINT32(expected.ids.size(), list.size());
+    for (size_t i = 0; i < list.size(); i++) {
+      TEST_ASSERT_EQUAL_UINT16(expected.ids[i], list[i].alarmId);
+      if (i > 0) {
+        TEST_ASSERT_TRUE(list[i - 1].minuteOfDay <= list[i].minuteOfDay);
+      }
+    }
+  }
+}
+
+void test_occurrences_cover_window_and_month() {
+  static OccurrenceCache cache;
+  TEST_ASSERT_FALSE(cache.valid());
+  // 28 октября: окно уходит в ноябрь, месяц начинается 1 октября
+  int32_t today = daysFromCivil(2026, 10, 28);
+  cache.rebuild(today, scheduler);
+  TEST_ASSERT_TRUE(cache.covers(daysFromCivil(2026, 10, 1)));
+  TEST_ASSERT_TRUE(cache.covers(today + OccurrenceCache::kWindowDays - 1));
+  TEST_ASSERT_FALSE(cache.covers(today + OccurrenceCache::kWindowDays));
+  TEST_ASSERT_FALSE(cache.covers(daysFromCivil(2026, 9, 30)));
+  TEST_ASSERT_EQUAL_UINT32(0, cache.day(today).size());
+}
+
+void test_occurrences_follow_upsert_and_remove() {
+  static OccurrenceCache cache;
+  scheduler.upsert(alarm(1, 9, 0, 0x1F));       // будни
+  scheduler.upsert(alarm(2, 7, 30));
+  scheduler.upsert(alarm(3, 12, 0, 1 << 5));    // суббота
+  cache.rebuild(kMondayDay, scheduler);
+  assertCacheMatchesScheduler(cache);
+  TEST_ASSERT_EQUAL_UINT32(2, cache.day(kMondayDay).size());
+  TEST_ASSERT_EQUAL_UINT16(2, cache.day(kMondayDay)[0].alarmId);
+
+  // Перенос на другое время и другие дни
+  AlarmEntry moved = alarm(1, 6, 0, (1 << 5) | (1 << 6));
+  scheduler.upsert(moved);
+  cache.onUpsert(moved);
+  assertCacheMatchesScheduler(cache);
+  TEST_ASSERT_EQUAL_UINT16(1, cache.day(kMondayDay + 5)[0].alarmId);
+
+  // Выключенный будильник пропадает из всех дней
+  AlarmEntry off = alarm(2, 7, 30);
+  off.active = 0;
+  scheduler.upsert(off);
+  cache.onUpsert(off);
+  assertCacheMatchesScheduler(cache);
+
+  scheduler.remove(3);
+  cache.onRemove(3);
+  assertCacheMatchesScheduler(cache);
+  TEST_ASSERT_EQUAL_UINT32(1, cache.day(kMondayDay + 5).size());
+  TEST_ASSERT_EQUAL_UINT32(0, cache.day(kMondayDay).size());
+}
+
+void test_occurrences_full_table_fits_pool() {
+  static OccurrenceCache cache;
+  cache.rebuild(kMondayDay, scheduler);
+  // Точечные изменения до полной таблицы на все дни — ровно ёмкость пула
+  for (uint16_t id = 1; id <= ALARM_MAX_COUNT; id++) {
+    AlarmEntry entry = alarm(id, (id * 7) % 24, (id * 13) % 60);
+    TEST_ASSERT_TRUE(scheduler.upsert(entry));
+    cache.onUpsert(entry);
+  }
+  assertCacheMatchesScheduler(cache);
+  TEST_ASSERT_EQUAL_UINT32(ALARM_MAX_COUNT, cache.day(kMondayDay + 3).size());
+
+  // Замена в полном пуле: сначала удаление, место не кончается
+  AlarmEntry last = alarm(ALARM_MAX_COUNT, 0, 0);
+  scheduler.upsert(last);
+  cache.onUpsert(last);
+  assertCacheMatchesScheduler(cache);
+  TEST_ASSERT_EQUAL_UINT16(0, cache.day(kMondayDay)[0].minuteOfDay);
+
+  cache.rebuild(kMondayDay + 1, scheduler);
+  assertCacheMatchesScheduler(cache);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_next_fire_same_minute_is_inclusive);
+  RUN_TEST(test_next_fire_wraps_to_next_week);
+  RUN_TEST(test_next_fire_skips_inactive_and_empty);
+  RUN_TEST(test_next_fire_before_epoch);
+  RUN_TEST(test_collect_in_time_order_across_week_end);
+  RUN_TEST(test_collect_half_open_interval);
+  RUN_TEST(test_upsert_replaces_and_reindexes);
+  RUN_TEST(test_remove_keeps_index_of_moved_alarm);
+  RUN_TEST(test_upsert_rejects_bad_minute_and_full_table);
+  RUN_TEST(test_timer_fires_once_and_rearms);
+  RUN_TEST(test_first_sync_does_not_replay_history);
+  RUN_TEST(test_clock_step_forward_past_alarm_skips_it);
+  RUN_TEST(test_small_step_forward_catches_up);
+  RUN_TEST(test_clock_step_back_rearms_earlier);
+  RUN_TEST(test_schedule_change_rearms_timer);
+  RUN_TEST(test_store_round_trip);
+  RUN_TEST(test_store_torn_write_keeps_previous_copy);
+  RUN_TEST(test_store_bad_crc_falls_back);
+  RUN_TEST(test_store_failed_write_and_empty_storage);
+  RUN_TEST(test_store_version_wraps);
+  RUN_TEST(test_occurrences_cover_window_and_month);
+  RUN_TEST(test_occurrences_follow_upsert_and_remove);
+  RUN_TEST(test_occurrences_full_table_fits_pool);
+  exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,283 @@
+// Команды плеера: выдача id, схлопывание в очереди задачи аудио и
+// статусы, которые опрашивает API. Исполнитель — подделка AudioBackend
+// или DFPlayer на подделке UART, как в задаче аудио: pop(), команда,
+// complete().
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "audio_commands.h"
+#include "dfplayer.h"
+
+// Записывает вызовы; failVolume — плеер отказывает в громкости
+class FakeBackend : public AudioBackend {
+public:
+  struct Call {
+    AudioOp op;
+    uint16_t arg;
+  };
+
+  bool start() override { calls.push_back({AudioOp::Play, 0}); return true; }
+  bool stop() override { calls.push_back({AudioOp::Stop, 0}); return true; }
+  bool volume(uint8_t volume) override {
+    calls.push_back({AudioOp::Volume, volume});
+    return !failVolume;
+  }
+  bool play(uint16_t track) override {
+    calls.push_back({AudioOp::Track, track});
+    return true;
+  }
+
+  std::vector<Call> calls;
+  bool failVolume = false;
+};
+
+// Всё, что пишется в UART, остаётся в tx; ответов нет
+class CapturePort : public UartPort {
+public:
+  int available() override { return 0; }
+  int read() override { return -1; }
+  size_t write(const uint8_t *data, size_t length) override {
+    tx.insert(tx.end(), data, data + length);
+    return length;
+  }
+
+  std::vector<uint8_t> tx;
+};
+
+static AudioCommandLog *audioLog;
+static AudioCommandQueue *queue;
+
+// Команда из API: id выдаётся сразу, команда — в очередь
+static uint32_t submit(AudioOp op, uint16_t arg) {
+  AudioCommand command = {audioLog->issue(), op, arg};
+  TEST_ASSERT_TRUE(queue->push(command));
+  return command.id;
+}
+
+// Задача аудио: команды по очереди до пустой
+static void drain(AudioBackend &backend) {
+  AudioCommand command;
+  while (queue->pop(command)) {
+    queue->complete(command.id, runAudioCommand(backend, command));
+  }
+}
+
+static std::vector<AudioOp> pendingOps() {
+  std::vector<AudioOp> ops;
+  AudioCommand command;
+  std::vector<AudioCommand> taken;
+  while (queue->pop(command)) {
+    ops.push_back(command.op);
+    taken.push_back(command);
+  }
+  for (const AudioCommand &back : taken) {
+    queue->push(back);
+  }
+  return ops;
+}
+
+void setUp() {
+  audioLog = new AudioCommandLog();
+  queue = new AudioCommandQueue(*audioLog);
+}
+
+void tearDown() {
+  delete queue;
+  delete audioLog;
+}
+
+// ---- id и статусы ----
+
+void test_ids_and_statuses() {
+  uint32_t first = audioLog->issue();
+  uint32_t second = audioLog->issue();
+  TEST_ASSERT_TRUE(first != 0 && second != first);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Queued, audioLog->status(first));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Unknown, audioLog->status(0));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Unknown, audioLog->status(second + 1));
+
+  audioLog->set(first, AudioCommandStatus::Done);
+  TEST_ASSERT_EQUAL_STRING("done", audioCommandStatusName(audioLog->status(first)));
+  TEST_ASSERT_EQUAL_STRING("queued", audioCommandStatusName(audioLog->status(second)));
+
+  // Через kHistory команд слот занят другой: статус старой неизвестен
+  for (size_t i = 0; i < AudioCommandLog::kHistory; i++) {
+    audioLog->issue();
+  }
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Unknown, audioLog->status(first));
+}
+
+void test_done_and_failed() {
+  FakeBackend backend;
+  backend.failVolume = true;
+  uint32_t volume = submit(AudioOp::Volume, 12);
+  uint32_t track = submit(AudioOp::Track, 4);
+  drain(backend);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Failed, audioLog->status(volume));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, audioLog->status(track));
+  TEST_ASSERT_EQUAL_UINT32(2, backend.calls.size());
+  // Подготовку и удар исполняет StrikePrestage, не runAudioCommand
+  AudioCommand strike = {audioLog->issue(), AudioOp::Strike, 3};
+  TEST_ASSERT_FALSE(runAudioCommand(backend, strike));
+}
+
+// ---- схлопывание ----
+
+void test_volume_coalesces() {
+  FakeBackend backend;
+  uint32_t a = submit(AudioOp::Volume, 10);
+  uint32_t b = submit(AudioOp::Volume, 20);
+  uint32_t c = submit(AudioOp::Volume, 30);
+  TEST_ASSERT_EQUAL_UINT32(1, queue->pending());
+  TEST_ASSERT_EQUAL_UINT32(2, queue->coalescedCount());
+  drain(backend);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(a));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(b));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, audioLog->status(c));
+  TEST_ASSERT_EQUAL_UINT32(1, backend.calls.size());
+  TEST_ASSERT_EQUAL_UINT16(30, backend.calls[0].arg);
+}
+
+void test_new_volume_keeps_its_place_before_track() {
+  // Громкость 0 перед нарастанием, затем трек; следующая громкость
+  // заменяет первую на её месте, а не после запуска трека
+  FakeBackend backend;
+  uint32_t staging = submit(AudioOp::Volume, 0);
+  uint32_t track = submit(AudioOp::Track, 5);
+  uint32_t step = submit(AudioOp::Volume, 3);
+  drain(backend);
+  TEST_ASSERT_EQUAL_UINT32(2, backend.calls.size());
+  TEST_ASSERT_EQUAL(AudioOp::Volume, backend.calls[0].op);
+  TEST_ASSERT_EQUAL_UINT16(3, backend.calls[0].arg);
+  TEST_ASSERT_EQUAL(AudioOp::Track, backend.calls[1].op);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(staging));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, audioLog->status(track));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, audioLog->status(step));
+
+  // То же перед ударом
+  submit(AudioOp::Volume, 0);
+  submit(AudioOp::Strike, 2);
+  submit(AudioOp::Volume, 25);
+  std::vector<AudioOp> ops = pendingOps();
+  TEST_ASSERT_EQUAL_UINT32(2, ops.size());
+  TEST_ASSERT_EQUAL(AudioOp::Volume, ops[0]);
+  TEST_ASSERT_EQUAL(AudioOp::Strike, ops[1]);
+}
+
+void test_track_and_strike_replace_pending_start() {
+  uint32_t first = submit(AudioOp::Track, 1);
+  submit(AudioOp::Volume, 8);
+  uint32_t second = submit(AudioOp::Track, 2);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(first));
+  uint32_t strike = submit(AudioOp::Strike, 7);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(second));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Queued, audioLog->status(strike));
+
+  AudioCommand command;
+  TEST_ASSERT_TRUE(queue->pop(command));
+  TEST_ASSERT_EQUAL(AudioOp::Strike, command.op);
+  TEST_ASSERT_EQUAL_UINT16(7, command.arg);
+  TEST_ASSERT_EQUAL_UINT32(strike, command.id);
+  TEST_ASSERT_TRUE(queue->pop(command));
+  TEST_ASSERT_EQUAL(AudioOp::Volume, command.op);
+  TEST_ASSERT_FALSE(queue->pop(command));
+
+  // Новая подготовка заменяет ожидающую
+  uint32_t prestage = submit(AudioOp::Prestage, 1);
+  submit(AudioOp::Prestage, 2);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(prestage));
+  TEST_ASSERT_EQUAL_UINT32(1, queue->pending());
+}
+
+void test_stop_cancels_everything_but_volume() {
+  FakeBackend backend;
+  uint32_t volume = submit(AudioOp::Volume, 14);
+  uint32_t track = submit(AudioOp::Track, 3);
+  uint32_t prestage = submit(AudioOp::Prestage, 4);
+  uint32_t play = submit(AudioOp::Play, 0);
+  uint32_t stop = submit(AudioOp::Stop, 0);
+  TEST_ASSERT_EQUAL_UINT32(2, queue->pending());
+  drain(backend);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, audioLog->status(volume));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(track));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(prestage));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(play));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, audioLog->status(stop));
+  TEST_ASSERT_EQUAL_UINT32(2, backend.calls.size());
+  TEST_ASSERT_EQUAL(AudioOp::Volume, backend.calls[0].op);
+  TEST_ASSERT_EQUAL(AudioOp::Stop, backend.calls[1].op);
+}
+
+void test_full_queue() {
+  for (size_t i = 0; i < AudioCommandQueue::kCapacity - 1; i++) {
+    submit(AudioOp::Play, 0);
+  }
+  uint32_t volume = submit(AudioOp::Volume, 5);
+  AudioCommand extra = {audioLog->issue(), AudioOp::Play, 0};
+  TEST_ASSERT_FALSE(queue->push(extra));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Queued, audioLog->status(extra.id));
+  // Заменяющая команда места не требует
+  uint32_t louder = submit(AudioOp::Volume, 6);
+  TEST_ASSERT_EQUAL_UINT32(AudioCommandQueue::kCapacity, queue->pending());
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Coalesced, audioLog->status(volume));
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Queued, audioLog->status(louder));
+}
+
+// ---- DFPlayer на подделке UART ----
+
+void test_commands_reach_uart_in_order() {
+  CapturePort port;
+  DFPlayer player(port);
+  uint32_t nowMs = 1000;
+  player.begin(nowMs);
+  port.tx.clear();
+
+  submit(AudioOp::Volume, 0);
+  uint32_t track = submit(AudioOp::Track, 9);
+  submit(AudioOp::Volume, 4);
+  submit(AudioOp::Volume, 21);
+  // Задача аудио: команда не чаще kCommandIntervalMs
+  AudioCommand command;
+  while (queue->pop(command)) {
+    nowMs += DFPlayer::kCommandIntervalMs;
+    player.poll(nowMs);
+    TEST_ASSERT_EQUAL_UINT32(0, player.msUntilReady(nowMs));
+    queue->complete(command.id, runAudioCommand(player, command));
+  }
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, audioLog->status(track));
+
+  dfplayer::FrameParser parser;
+  std::vector<uint8_t> commands;
+  std::vector<uint16_t> params;
+  for (uint8_t byte : port.tx) {
+    if (parser.feed(byte)) {
+      commands.push_back(parser.command());
+      params.push_back(parser.param());
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, commands.size());
+  TEST_ASSERT_EQUAL_HEX8(dfplayer::CMD_VOLUME, commands[0]);
+  TEST_ASSERT_EQUAL_UINT16(21, params[0]);
+  TEST_ASSERT_EQUAL_HEX8(dfplayer::CMD_PLAY_TRACK, commands[1]);
+  TEST_ASSERT_EQUAL_UINT16(9, params[1]);
+  TEST_ASSERT_EQUAL_UINT8(21, player.currentVolume());
+  TEST_ASSERT_TRUE(player.playing());
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ids_and_statuses);
+  RUN_TEST(test_done_and_failed);
+  RUN_TEST(test_volume_coalesces);
+  RUN_TEST(test_new_volume_keeps_its_place_before_track);
+  RUN_TEST(test_track_and_strike_replace_pending_start);
+  RUN_TEST(test_stop_cancels_everything_but_volume);
+  RUN_TEST(test_full_queue);
+  RUN_TEST(test_commands_reach_uart_in_order);
+  exit(UNITY_END());
+}
+
+void loop() {}
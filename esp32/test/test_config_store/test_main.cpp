@@ -0,0 +1,285 @@
+// Настройки во flash: две копии с CRC32 на хранилище в памяти, где
+// запись можно оборвать на любом байте или испортить.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+
+#include <vector>
+
+#include "config_store.h"
+
+class MemoryConfigStorage : public ConfigStorage {
+public:
+  size_t read(uint8_t slot, uint8_t *data, size_t capacity) override {
+    size_t size = slots[slot].size() < capacity ? slots[slot].size() : capacity;
+    memcpy(data, slots[slot].data(), size);
+    return size;
+  }
+  bool write(uint8_t slot, const uint8_t *data, size_t length) override {
+    writes++;
+    if (fail) {
+      return false;
+    }
+    // Обрыв питания: во flash только начало записи, прошивка не узнаёт
+    size_t kept = length < tornAt ? length : tornAt;
+    slots[slot].assign(data, data + kept);
+    return true;
+  }
+
+  std::vector<uint8_t> slots[2];
+  size_t tornAt = SIZE_MAX;
+  bool fail = false;
+  uint32_t writes = 0;
+};
+
+static MemoryConfigStorage storage;
+
+static GongConfig makeConfig(const char *ssid, uint8_t volume) {
+  GongConfig config;
+  memset(&config, 0, sizeof(config));
+  copyConfigString(config.wifiSsid, sizeof(config.wifiSsid), ssid, strlen(ssid));
+  config.volume = volume;
+  config.missedGraceSec = 300;
+  strcpy(config.timezone, "MSK-3");
+  return config;
+}
+
+// Запись слота в обход ConfigStore: заданные номер, версия и длина
+static void writeRecord(uint8_t slot, uint32_t sequence, const GongConfig &config, uint16_t version = CONFIG_VERSION,
+                        uint16_t length = sizeof(GongConfig)) {
+  ConfigRecordHeader header;
+  header.magic = CONFIG_MAGIC;
+  header.version = version;
+  header.length = length;
+  header.sequence = sequence;
+  uint32_t crc = crc32(0, (const uint8_t *)&header, offsetof(ConfigRecordHeader, crc));
+  header.crc = crc32(crc, (const uint8_t *)&config, length);
+  storage.slots[slot].assign((const uint8_t *)&header, (const uint8_t *)&header + sizeof(header));
+  storage.slots[slot].insert(storage.slots[slot].end(), (const uint8_t *)&config, (const uint8_t *)&config + length);
+}
+
+// Загрузка после перезагрузки: новый ConfigStore на том же хранилище
+static bool reload(GongConfig &config, uint32_t *sequence = nullptr) {
+  ConfigStore store(storage);
+  memset(&config, 0, sizeof(config));
+  strcpy(config.triggerKey, "default");
+  bool ok = store.load(config);
+  if (sequence != nullptr) {
+    *sequence = store.sequence();
+  }
+  return ok;
+}
+
+void setUp() {
+  storage.slots[0].clear();
+  storage.slots[1].clear();
+  storage.tornAt = SIZE_MAX;
+  storage.fail = false;
+  storage.writes = 0;
+}
+
+void tearDown() {}
+
+void test_crc32_reference_value() {
+  // Контрольное значение CRC-32/ISO-HDLC
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32(0, (const uint8_t *)"123456789", 9));
+  // Подсчёт по частям совпадает с подсчётом целиком
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32(crc32(0, (const uint8_t *)"1234", 4), (const uint8_t *)"56789", 5));
+}
+
+void test_commits_alternate_slots_and_reload_newest() {
+  GongConfig config;
+  TEST_ASSERT_FALSE(reload(config));
+
+  ConfigStore store(storage);
+  TEST_ASSERT_TRUE(store.commit(makeConfig("first", 10)));
+  TEST_ASSERT_TRUE(store.commit(makeConfig("second", 20)));
+  TEST_ASSERT_TRUE(store.commit(makeConfig("third", 30)));
+  TEST_ASSERT_EQUAL_UINT32(3, store.sequence());
+  TEST_ASSERT_FALSE(storage.slots[0].empty());
+  TEST_ASSERT_FALSE(storage.slots[1].empty());
+
+  uint32_t sequence;
+  TEST_ASSERT_TRUE(reload(config, &sequence));
+  TEST_ASSERT_EQUAL_STRING("third", config.wifiSsid);
+  TEST_ASSERT_EQUAL_UINT8(30, config.volume);
+  TEST_ASSERT_EQUAL_UINT32(3, sequence);
+}
+
+void test_truncated_slot_keeps_previous_config() {
+  ConfigStore store(storage);
+  TEST_ASSERT_TRUE(store.commit(makeConfig("stable", 12)));
+  std::vector<uint8_t> slots[2] = {storage.slots[0], storage.slots[1]};
+  size_t recordSize = sizeof(ConfigRecordHeader) + sizeof(GongConfig);
+
+  // Питание пропало на каждом байте записи новой копии
+  for (size_t cut = 0; cut < recordSize; cut++) {
+    storage.slots[0] = slots[0];
+    storage.slots[1] = slots[1];
+    ConfigStore writer(storage);
+    GongConfig config;
+    TEST_ASSERT_TRUE(writer.load(config));
+    storage.tornAt = cut;
+    // Проверка чтением замечает обрыв
+    TEST_ASSERT_FALSE(writer.commit(makeConfig("lost", 25)));
+    storage.tornAt = SIZE_MAX;
+
+    uint32_t sequence;
+    TEST_ASSERT_TRUE(reload(config, &sequence));
+    TEST_ASSERT_EQUAL_STRING("stable", config.wifiSsid);
+    TEST_ASSERT_EQUAL_UINT8(12, config.volume);
+    TEST_ASSERT_EQUAL_UINT32(1, sequence);
+  }
+}
+
+void test_bad_crc_falls_back_to_older_slot() {
+  ConfigStore store(storage);
+  TEST_ASSERT_TRUE(store.commit(makeConfig("older", 5)));
+  TEST_ASSERT_TRUE(store.commit(makeConfig("newer", 6)));
+  // Бит испорчен в данных более новой копии (слот 1)
+  storage.slots[1][sizeof(ConfigRecordHeader) + 3] ^= 0x10;
+  GongConfig config;
+  uint32_t sequence;
+  TEST_ASSERT_TRUE(reload(config, &sequence));
+  TEST_ASSERT_EQUAL_STRING("older", config.wifiSsid);
+  TEST_ASSERT_EQUAL_UINT32(1, sequence);
+
+  // Испорчен заголовок — тоже не принимается
+  storage.slots[1] = storage.slots[0];
+  storage.slots[1][offsetof(ConfigRecordHeader, sequence)] = 9;
+  TEST_ASSERT_TRUE(reload(config, &sequence));
+  TEST_ASSERT_EQUAL_UINT32(1, sequence);
+
+  // Обе копии испорчены — настроек нет, значения по умолчанию не тронуты
+  storage.slots[0][sizeof(ConfigRecordHeader)] ^= 0x01;
+  TEST_ASSERT_FALSE(reload(config));
+  TEST_ASSERT_EQUAL_STRING("default", config.triggerKey);
+}
+
+void test_next_commit_after_fallback_overwrites_bad_slot() {
+  ConfigStore store(storage);
+  TEST_ASSERT_TRUE(store.commit(makeConfig("older", 5)));
+  TEST_ASSERT_TRUE(store.commit(makeConfig("newer", 6)));
+  storage.slots[1][sizeof(ConfigRecordHeader)] ^= 0xFF;
+  std::vector<uint8_t> good = storage.slots[0];
+
+  ConfigStore restarted(storage);
+  GongConfig config;
+  TEST_ASSERT_TRUE(restarted.load(config));
+  TEST_ASSERT_TRUE(restarted.commit(makeConfig("fixed", 7)));
+  // Пишется испорченный слот, целая копия остаётся
+  TEST_ASSERT_TRUE(storage.slots[0] == good);
+  TEST_ASSERT_EQUAL_UINT32(2, restarted.sequence());
+  TEST_ASSERT_TRUE(reload(config));
+  TEST_ASSERT_EQUAL_STRING("fixed", config.wifiSsid);
+}
+
+void test_sequence_wraps() {
+  writeRecord(0, 0xFFFFFFFF, makeConfig("before-wrap", 1));
+  writeRecord(1, 0, makeConfig("after-wrap", 2));
+  GongConfig config;
+  uint32_t sequence;
+  TEST_ASSERT_TRUE(reload(config, &sequence));
+  TEST_ASSERT_EQUAL_STRING("after-wrap", config.wifiSsid);
+  TEST_ASSERT_EQUAL_UINT32(0, sequence);
+
+  // Следующая запись после переполнения ложится на место старой копии
+  ConfigStore store(storage);
+  TEST_ASSERT_TRUE(store.load(config));
+  TEST_ASSERT_TRUE(store.commit(makeConfig("next", 3)));
+  TEST_ASSERT_EQUAL_UINT32(1, store.sequence());
+  TEST_ASSERT_TRUE(reload(config, &sequence));
+  TEST_ASSERT_EQUAL_STRING("next", config.wifiSsid);
+
+  // Порядок по разности номеров: слот 0 новее, хотя номер меньше
+  writeRecord(0, 5, makeConfig("small-newer", 4));
+  writeRecord(1, 0xFFFFFFF0, makeConfig("big-older", 5));
+  TEST_ASSERT_TRUE(reload(config, &sequence));
+  TEST_ASSERT_EQUAL_STRING("small-newer", config.wifiSsid);
+}
+
+void test_older_version_keeps_defaults_for_new_fields() {
+  // Версия 1 кончается перед triggerKey
+  GongConfig old = makeConfig("v1", 18);
+  writeRecord(0, 4, old, 1, offsetof(GongConfig, triggerKey));
+  ConfigStore store(storage);
+  GongConfig config;
+  memset(&config, 0, sizeof(config));
+  strcpy(config.triggerKey, "default");
+  TEST_ASSERT_TRUE(store.load(config));
+  TEST_ASSERT_EQUAL_UINT16(1, store.loadedVersion());
+  TEST_ASSERT_EQUAL_STRING("v1", config.wifiSsid);
+  TEST_ASSERT_EQUAL_STRING("default", config.triggerKey);
+  TEST_ASSERT_TRUE(store.commit(config));
+  TEST_ASSERT_EQUAL_UINT16(CONFIG_VERSION, store.loadedVersion());
+}
+
+void test_record_shorter_than_header_length_is_rejected() {
+  writeRecord(0, 1, makeConfig("short", 1));
+  storage.slots[0].resize(storage.slots[0].size() - 1);
+  GongConfig config;
+  TEST_ASSERT_FALSE(reload(config));
+  storage.slots[0].resize(sizeof(ConfigRecordHeader) - 1);
+  TEST_ASSERT_FALSE(reload(config));
+}
+
+void test_unterminated_strings_are_cut() {
+  GongConfig raw;
+  memset(&raw, 'x', sizeof(raw));
+  writeRecord(0, 1, raw);
+  GongConfig config;
+  TEST_ASSERT_TRUE(reload(config));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(config.wifiSsid) - 1, strlen(config.wifiSsid));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(config.wifiPass) - 1, strlen(config.wifiPass));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(config.timezone) - 1, strlen(config.timezone));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(config.ntpServer) - 1, strlen(config.ntpServer));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(config.triggerKey) - 1, strlen(config.triggerKey));
+}
+
+void test_failed_write_keeps_sequence() {
+  ConfigStore store(storage);
+  TEST_ASSERT_TRUE(store.commit(makeConfig("kept", 9)));
+  storage.fail = true;
+  TEST_ASSERT_FALSE(store.commit(makeConfig("failed", 10)));
+  TEST_ASSERT_EQUAL_UINT32(1, store.sequence());
+  storage.fail = false;
+  // Повтор пишет тот же слот с тем же номером
+  TEST_ASSERT_TRUE(store.commit(makeConfig("retry", 11)));
+  TEST_ASSERT_EQUAL_UINT32(2, store.sequence());
+  GongConfig config;
+  TEST_ASSERT_TRUE(reload(config));
+  TEST_ASSERT_EQUAL_STRING("retry", config.wifiSsid);
+  TEST_ASSERT_EQUAL_UINT32(3, storage.writes);
+}
+
+void test_legacy_config_lines() {
+  GongConfig config;
+  memset(&config, 0, sizeof(config));
+  static const char kSsid[] = "  wifi_ssid=Dhamma Hall \r";
+  static const char kPass[] = "wifi_pass=anicca";
+  static const char kOther[] = "volume=20";
+  TEST_ASSERT_TRUE(applyLegacyConfigLine(kSsid, strlen(kSsid), config));
+  TEST_ASSERT_TRUE(applyLegacyConfigLine(kPass, strlen(kPass), config));
+  TEST_ASSERT_FALSE(applyLegacyConfigLine(kOther, strlen(kOther), config));
+  TEST_ASSERT_EQUAL_STRING("Dhamma Hall", config.wifiSsid);
+  TEST_ASSERT_EQUAL_STRING("anicca", config.wifiPass);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc32_reference_value);
+  RUN_TEST(test_commits_alternate_slots_and_reload_newest);
+  RUN_TEST(test_truncated_slot_keeps_previous_config);
+  RUN_TEST(test_bad_crc_falls_back_to_older_slot);
+  RUN_TEST(test_next_commit_after_fallback_overwrites_bad_slot);
+  RUN_TEST(test_sequence_wraps);
+  RUN_TEST(test_older_version_keeps_defaults_for_new_fields);
+  RUN_TEST(test_record_shorter_than_header_length_is_rejected);
+  RUN_TEST(test_unterminated_strings_are_cut);
+  RUN_TEST(test_failed_write_keeps_sequence);
+  RUN_TEST(test_legacy_config_lines);
+  exit(UNITY_END());
+}
+
+void loop() {}
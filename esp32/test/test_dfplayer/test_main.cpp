@@ -0,0 +1,232 @@
+// Разбор ответов DFPlayer на подделке UART: тест подаёт байты порциями,
+// как они приходят между вызовами poll(), и проверяет кэш состояния.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "dfplayer.h"
+
+using namespace dfplayer;
+
+// Порт с записью: available() отдаёт только уже "пришедшие" байты
+class ReplayPort : public UartPort {
+public:
+  int available() override { return (int)rx.size(); }
+  int read() override {
+    if (rx.empty()) {
+      return -1;
+    }
+    uint8_t byte = rx.front();
+    rx.pop_front();
+    return byte;
+  }
+  size_t write(const uint8_t *data, size_t length) override {
+    tx.insert(tx.end(), data, data + length);
+    return length;
+  }
+
+  void arrive(const std::vector<uint8_t> &bytes) { rx.insert(rx.end(), bytes.begin(), bytes.end()); }
+
+  std::deque<uint8_t> rx;
+  std::vector<uint8_t> tx;
+};
+
+static ReplayPort *port;
+static DFPlayer *player;
+static uint32_t nowMs;
+
+static std::vector<uint8_t> frame(uint8_t command, uint16_t param) {
+  uint8_t bytes[DFPLAYER_FRAME_SIZE];
+  encodeFrame(command, param, false, bytes);
+  return std::vector<uint8_t>(bytes, bytes + DFPLAYER_FRAME_SIZE);
+}
+
+static std::vector<uint8_t> join(std::vector<uint8_t> a, const std::vector<uint8_t> &b) {
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+// Ответ на запрос состояния: SD есть, state — 0 стоп, 1 играет, 2 пауза
+static std::vector<uint8_t> status(uint8_t state) {
+  return frame(QUERY_STATUS, (uint16_t)(DEVICE_SD << 8) | state);
+}
+
+// Байты приходят порциями по chunk, после каждой — poll()
+static void replay(const std::vector<uint8_t> &bytes, size_t chunk) {
+  for (size_t i = 0; i < bytes.size(); i += chunk) {
+    size_t end = i + chunk < bytes.size() ? i + chunk : bytes.size();
+    port->arrive(std::vector<uint8_t>(bytes.begin() + i, bytes.begin() + end));
+    nowMs += 2;
+    player->poll(nowMs);
+  }
+}
+
+void setUp() {
+  port = new ReplayPort();
+  player = new DFPlayer(*port);
+  nowMs = 1000;
+  player->begin(nowMs);
+}
+
+void tearDown() {
+  delete player;
+  delete port;
+}
+
+void test_begin_queries_status_and_stays_offline() {
+  TEST_ASSERT_EQUAL_UINT32(DFPLAYER_FRAME_SIZE, port->tx.size());
+  std::vector<uint8_t> query = frame(QUERY_STATUS, 0);
+  TEST_ASSERT_EQUAL_MEMORY(query.data(), port->tx.data(), DFPLAYER_FRAME_SIZE);
+  player->poll(nowMs);
+  TEST_ASSERT_FALSE(player->online());
+  TEST_ASSERT_EQUAL_UINT32(0, player->framesReceived());
+}
+
+void test_frame_split_across_polls() {
+  std::vector<uint8_t> reply = status(1);
+  // Девять байт — кадра ещё нет, состояние прежнее
+  replay(std::vector<uint8_t>(reply.begin(), reply.end() - 1), 1);
+  TEST_ASSERT_FALSE(player->online());
+  TEST_ASSERT_FALSE(player->playing());
+  replay(std::vector<uint8_t>(reply.end() - 1, reply.end()), 1);
+  TEST_ASSERT_TRUE(player->online());
+  TEST_ASSERT_TRUE(player->sdPresent());
+  TEST_ASSERT_TRUE(player->playing());
+  TEST_ASSERT_EQUAL_UINT32(1, player->statusReplies());
+  TEST_ASSERT_EQUAL_UINT32(nowMs, player->lastRxMs());
+
+  // Разные порции одного потока дают одно и то же
+  for (size_t chunk = 2; chunk <= 7; chunk++) {
+    replay(join(frame(EVT_TRACK_DONE, 3), status(1)), chunk);
+    TEST_ASSERT_TRUE(player->playing());
+    replay(frame(EVT_TRACK_DONE, 3), chunk);
+    TEST_ASSERT_FALSE(player->playing());
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, player->rxErrors());
+  TEST_ASSERT_EQUAL_UINT32(1 + 6 * 3, player->framesReceived());
+}
+
+void test_garbage_between_frames_is_skipped() {
+  // Шум на линии после включения питания, в том числе байты 0xEF и 0xFF
+  std::vector<uint8_t> noise = {0x00, 0xEF, 0xFF, 0x06, 0x13, 0x37};
+  replay(join(join(noise, frame(EVT_INIT, DEVICE_SD)), noise), 3);
+  TEST_ASSERT_TRUE(player->online());
+  TEST_ASSERT_TRUE(player->sdPresent());
+  TEST_ASSERT_EQUAL_UINT32(1, player->framesReceived());
+  // Шум без 0x7E не начинает кадр — ошибок нет
+  TEST_ASSERT_EQUAL_UINT32(0, player->rxErrors());
+
+  // 0x7E в шуме: ложное начало кадра отбрасывается по второму байту
+  replay(join({0x7E, 0x42, 0x7E, 0x7E}, frame(EVT_MEDIA_REMOVE, DEVICE_SD)), 1);
+  TEST_ASSERT_FALSE(player->sdPresent());
+  TEST_ASSERT_EQUAL_UINT32(2, player->framesReceived());
+  TEST_ASSERT_TRUE(player->rxErrors() >= 1);
+}
+
+void test_wrong_checksum_keeps_cached_state() {
+  replay(status(1), 10);
+  TEST_ASSERT_TRUE(player->playing());
+
+  std::vector<uint8_t> bad = frame(EVT_TRACK_DONE, 3);
+  bad[8] ^= 0x01;
+  replay(bad, 4);
+  TEST_ASSERT_TRUE(player->playing());
+  TEST_ASSERT_EQUAL_UINT32(1, player->rxErrors());
+
+  // Неверный байт конца кадра
+  bad = frame(EVT_ERROR, 6);
+  bad[9] = 0x00;
+  replay(bad, 10);
+  TEST_ASSERT_EQUAL_UINT32(0, player->errorReports());
+  TEST_ASSERT_EQUAL_UINT32(2, player->rxErrors());
+
+  // Следующий целый кадр принимается
+  replay(frame(EVT_ERROR, 6), 5);
+  TEST_ASSERT_FALSE(player->playing());
+  TEST_ASSERT_EQUAL_UINT32(1, player->errorReports());
+  TEST_ASSERT_EQUAL_UINT8(6, player->lastError());
+  TEST_ASSERT_EQUAL_UINT32(2, player->framesReceived());
+}
+
+void test_truncated_frame_does_not_hide_the_next_one() {
+  // Плеер перезапустился посреди ответа: обрывок, за ним сообщение об
+  // инициализации. Кадр начинается внутри отброшенного обрывка.
+  std::vector<uint8_t> cut = status(1);
+  cut.resize(5);
+  replay(join(cut, frame(EVT_INIT, DEVICE_SD)), 3);
+  TEST_ASSERT_TRUE(player->online());
+  TEST_ASSERT_TRUE(player->sdPresent());
+  TEST_ASSERT_FALSE(player->playing());
+  TEST_ASSERT_EQUAL_UINT32(0, player->statusReplies());
+  TEST_ASSERT_EQUAL_UINT32(1, player->framesReceived());
+  TEST_ASSERT_EQUAL_UINT32(1, player->rxErrors());
+
+  // Потерянный байт: кадр короче на один, следующий цел
+  std::vector<uint8_t> lost = frame(EVT_MEDIA_REMOVE, DEVICE_SD);
+  lost.erase(lost.begin() + 6);
+  replay(join(lost, status(2)), 1);
+  TEST_ASSERT_TRUE(player->sdPresent());
+  TEST_ASSERT_FALSE(player->playing());
+  TEST_ASSERT_EQUAL_UINT32(1, player->statusReplies());
+  TEST_ASSERT_EQUAL_UINT32(2, player->framesReceived());
+}
+
+void test_interleaved_replies_and_commands() {
+  // Команды уходят, пока ответы на прежние ещё приходят по частям:
+  // кэш меняется по командам сразу, по кадрам — когда кадр собран
+  std::vector<uint8_t> burst = join(join(frame(EVT_ACK, 0), frame(QUERY_VOLUME, 25)), status(0));
+  replay(std::vector<uint8_t>(burst.begin(), burst.begin() + 13), 13);
+  TEST_ASSERT_TRUE(player->play(7));
+  TEST_ASSERT_TRUE(player->playing());
+  TEST_ASSERT_EQUAL_UINT16(7, player->track());
+  replay(std::vector<uint8_t>(burst.begin() + 13, burst.begin() + 20), 7);
+  TEST_ASSERT_EQUAL_UINT8(25, player->currentVolume());
+  TEST_ASSERT_TRUE(player->playing());
+  TEST_ASSERT_TRUE(player->volume(12));
+  // Ответ на запрос состояния — состояние самого плеера
+  replay(std::vector<uint8_t>(burst.begin() + 20, burst.end()), 4);
+  TEST_ASSERT_FALSE(player->playing());
+  TEST_ASSERT_EQUAL_UINT8(12, player->currentVolume());
+  TEST_ASSERT_EQUAL_UINT32(3, player->framesReceived());
+  TEST_ASSERT_EQUAL_UINT32(0, player->rxErrors());
+
+  // Отправленные кадры — по порядку, с верными контрольными суммами
+  FrameParser echo;
+  std::vector<uint8_t> commands;
+  for (uint8_t byte : port->tx) {
+    if (echo.feed(byte)) {
+      commands.push_back(echo.command());
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, commands.size());
+  TEST_ASSERT_EQUAL_HEX8(QUERY_STATUS, commands[0]);
+  TEST_ASSERT_EQUAL_HEX8(CMD_PLAY_TRACK, commands[1]);
+  TEST_ASSERT_EQUAL_HEX8(CMD_VOLUME, commands[2]);
+}
+
+void test_command_interval() {
+  TEST_ASSERT_EQUAL_UINT32(DFPlayer::kCommandIntervalMs, player->msUntilReady(nowMs));
+  TEST_ASSERT_EQUAL_UINT32(10, player->msUntilReady(nowMs + 20));
+  TEST_ASSERT_EQUAL_UINT32(0, player->msUntilReady(nowMs + DFPlayer::kCommandIntervalMs));
+  TEST_ASSERT_FALSE(player->volume(31));
+  TEST_ASSERT_FALSE(player->play(0));
+  TEST_ASSERT_EQUAL_UINT32(DFPLAYER_FRAME_SIZE, port->tx.size());
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_queries_status_and_stays_offline);
+  RUN_TEST(test_frame_split_across_polls);
+  RUN_TEST(test_garbage_between_frames_is_skipped);
+  RUN_TEST(test_wrong_checksum_keeps_cached_state);
+  RUN_TEST(test_truncated_frame_does_not_hide_the_next_one);
+  RUN_TEST(test_interleaved_replies_and_commands);
+  RUN_TEST(test_command_interval);
+  exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,282 @@
+// Журнал событий на flash в памяти, где питание можно оборвать на любом
+// байте записи: после повторного монтирования recover() и запросы по
+// времени должны видеть только целые записи, а журнал — продолжаться.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+
+#include <vector>
+
+#include "event_journal.h"
+
+static const uint32_t kStartTime = 1791763200;
+
+// Сегменты в памяти. powerCutAfter >= 0 — столько байт ещё дойдёт до
+// flash, затем питание пропадает: запись обрывается на полуслове, всё
+// дальнейшее не выполняется до powerOn()
+class MemoryJournalStorage : public JournalStorage {
+public:
+  size_t length(uint8_t segment) override { return _data[segment].size(); }
+
+  size_t read(uint8_t segment, size_t offset, uint8_t *data, size_t length) override {
+    const std::vector<uint8_t> &bytes = _data[segment];
+    if (offset >= bytes.size()) {
+      return 0;
+    }
+    size_t count = bytes.size() - offset < length ? bytes.size() - offset : length;
+    memcpy(data, bytes.data() + offset, count);
+    return count;
+  }
+
+  bool append(uint8_t segment, const uint8_t *data, size_t length) override {
+    if (_off) {
+      return false;
+    }
+    size_t count = length;
+    if (powerCutAfter >= 0 && (size_t)powerCutAfter < length) {
+      count = (size_t)powerCutAfter;
+      _off = true;
+    }
+    if (powerCutAfter >= 0) {
+      powerCutAfter -= (long)count;
+    }
+    _data[segment].insert(_data[segment].end(), data, data + count);
+    return !_off;
+  }
+
+  bool erase(uint8_t segment) override {
+    if (_off) {
+      return false;
+    }
+    _data[segment].clear();
+    return true;
+  }
+
+  void powerOn() {
+    _off = false;
+    powerCutAfter = -1;
+  }
+  bool off() const { return _off; }
+
+  long powerCutAfter = -1;
+
+private:
+  std::vector<uint8_t> _data[EVENT_JOURNAL_SEGMENTS];
+  bool _off = false;
+};
+
+// Событие с номером sequence: поля выводятся из номера, чтобы по
+// прочитанной записи было видно, что она целая и своя
+static JournalRecord event(uint32_t sequence) {
+  JournalRecord record = {};
+  record.time = kStartTime + sequence * 60;
+  record.type = (uint8_t)JournalEvent::Alarm;
+  record.code = (uint16_t)(sequence * 7);
+  record.alarmId = (uint16_t)(sequence % 100);
+  record.track = (uint16_t)(1 + sequence % 5);
+  record.latencyUs = (int32_t)sequence * 3;
+  return record;
+}
+
+static void fill(EventJournal &journal, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    JournalRecord record = event(journal.nextSequence());
+    TEST_ASSERT_TRUE(journal.append(record));
+  }
+}
+
+// Все записи страницами по 32: номера first..last подряд, поля целые
+static void assertRecords(EventJournal &journal, uint32_t from, uint32_t to, uint32_t first, uint32_t last) {
+  JournalRecord page[32];
+  uint32_t after = 0;
+  uint32_t expected = first;
+  bool more = true;
+  while (more) {
+    size_t count = journal.query(from, to, after, page, 32, more);
+    for (size_t i = 0; i < count; i++) {
+      JournalRecord want = event(expected);
+      TEST_ASSERT_EQUAL_UINT32(expected, page[i].sequence);
+      TEST_ASSERT_EQUAL_UINT32(want.time, page[i].time);
+      TEST_ASSERT_EQUAL_UINT16(want.code, page[i].code);
+      TEST_ASSERT_EQUAL_UINT16(want.alarmId, page[i].alarmId);
+      TEST_ASSERT_EQUAL_INT32(want.latencyUs, page[i].latencyUs);
+      expected++;
+    }
+    if (count > 0) {
+      after = page[count - 1].sequence;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(last + 1, expected);
+}
+
+static uint32_t timeOf(uint32_t sequence) { return kStartTime + sequence * 60; }
+
+void setUp() {}
+
+void tearDown() {}
+
+// ---- обрыв питания ----
+
+void test_power_cut_inside_record() {
+  const uint32_t kept = EventJournal::kRecordsPerSegment + 5;
+  for (size_t cut = 0; cut < sizeof(JournalRecord); cut++) {
+    MemoryJournalStorage storage;
+    {
+      EventJournal journal(storage);
+      journal.recover();
+      fill(journal, kept);
+      storage.powerCutAfter = (long)cut;
+      JournalRecord record = event(kept + 1);
+      TEST_ASSERT_FALSE(journal.append(record));
+      TEST_ASSERT_TRUE(storage.off());
+    }
+    storage.powerOn();
+
+    EventJournal journal(storage);
+    journal.recover();
+    TEST_ASSERT_EQUAL_UINT32(cut > 0 ? 1 : 0, journal.tornCount());
+    TEST_ASSERT_EQUAL_UINT32(kept, journal.recordCount());
+    TEST_ASSERT_EQUAL_UINT32(kept + 1, journal.nextSequence());
+    assertRecords(journal, 0, UINT32_MAX, 1, kept);
+    // Интервал вокруг оборванной записи — только целые
+    assertRecords(journal, timeOf(kept - 2), timeOf(kept + 1), kept - 2, kept);
+
+    // Журнал продолжается; после оборванного хвоста — с нового сегмента
+    fill(journal, 3);
+    assertRecords(journal, 0, UINT32_MAX, 1, kept + 3);
+    EventJournal again(storage);
+    again.recover();
+    TEST_ASSERT_EQUAL_UINT32(kept + 3, again.recordCount());
+    assertRecords(again, 0, UINT32_MAX, 1, kept + 3);
+  }
+}
+
+void test_power_cut_inside_segment_header() {
+  // Сегмент заполнен: следующая запись начинает новый с заголовка
+  const uint32_t kept = EventJournal::kRecordsPerSegment;
+  const size_t total = sizeof(JournalSegmentHeader) + sizeof(JournalRecord);
+  for (size_t cut = 0; cut < total; cut++) {
+    MemoryJournalStorage storage;
+    {
+      EventJournal journal(storage);
+      journal.recover();
+      fill(journal, kept);
+      storage.powerCutAfter = (long)cut;
+      JournalRecord record = event(kept + 1);
+      TEST_ASSERT_FALSE(journal.append(record));
+    }
+    storage.powerOn();
+
+    EventJournal journal(storage);
+    journal.recover();
+    // Оборванный заголовок — сегмента нет; целый заголовок и обрывок записи — хвост
+    TEST_ASSERT_EQUAL_UINT32(cut > sizeof(JournalSegmentHeader) ? 1 : 0, journal.tornCount());
+    TEST_ASSERT_EQUAL_UINT32(kept, journal.recordCount());
+    assertRecords(journal, 0, UINT32_MAX, 1, kept);
+    fill(journal, 2);
+    assertRecords(journal, 0, UINT32_MAX, 1, kept + 2);
+  }
+}
+
+void test_power_cut_while_wrapping() {
+  // Все сегменты заполнены: новая запись стирает самый старый
+  const uint32_t kept = EventJournal::kRecordsPerSegment * EVENT_JOURNAL_SEGMENTS;
+  for (size_t cut = 0; cut < sizeof(JournalSegmentHeader) + sizeof(JournalRecord); cut += 5) {
+    MemoryJournalStorage storage;
+    {
+      EventJournal journal(storage);
+      journal.recover();
+      fill(journal, kept);
+      storage.powerCutAfter = (long)cut;
+      JournalRecord record = event(kept + 1);
+      TEST_ASSERT_FALSE(journal.append(record));
+    }
+    storage.powerOn();
+
+    EventJournal journal(storage);
+    journal.recover();
+    // Первый сегмент уже стёрт: остались записи со второго
+    uint32_t first = EventJournal::kRecordsPerSegment + 1;
+    TEST_ASSERT_EQUAL_UINT32(kept - EventJournal::kRecordsPerSegment, journal.recordCount());
+    TEST_ASSERT_EQUAL_UINT32(kept + 1, journal.nextSequence());
+    assertRecords(journal, 0, UINT32_MAX, first, kept);
+    // Пустой сегмент с оборванной записью начинается заново на месте
+    fill(journal, 4);
+    assertRecords(journal, 0, UINT32_MAX, first, kept + 4);
+  }
+}
+
+void test_repeated_power_cuts() {
+  // Питание пропадает на каждой пятой записи, каждый раз на новом байте
+  MemoryJournalStorage storage;
+  uint32_t written = 0;
+  for (int boot = 0; boot < 40; boot++) {
+    EventJournal journal(storage);
+    journal.recover();
+    TEST_ASSERT_EQUAL_UINT32(written + 1, journal.nextSequence());
+    fill(journal, 4);
+    written += 4;
+    storage.powerCutAfter = 1 + boot % (sizeof(JournalRecord) - 1);
+    JournalRecord record = event(journal.nextSequence());
+    TEST_ASSERT_FALSE(journal.append(record));
+    storage.powerOn();
+  }
+  EventJournal journal(storage);
+  journal.recover();
+  // Каждый оборванный хвост закрыл свой сегмент; старые сегменты стёрты по кругу
+  TEST_ASSERT_TRUE(journal.tornCount() > 0);
+  uint32_t stored = journal.recordCount();
+  TEST_ASSERT_TRUE(stored > 0 && stored <= written);
+  assertRecords(journal, 0, UINT32_MAX, written - stored + 1, written);
+}
+
+// ---- запросы ----
+
+void test_range_query_reads_only_overlapping_segments() {
+  MemoryJournalStorage storage;
+  EventJournal journal(storage);
+  journal.recover();
+  fill(journal, EventJournal::kRecordsPerSegment * 4);
+  uint32_t before = journal.segmentReadCount();
+  // Интервал внутри третьего сегмента
+  uint32_t first = EventJournal::kRecordsPerSegment * 2 + 10;
+  assertRecords(journal, timeOf(first), timeOf(first + 20), first, first + 20);
+  TEST_ASSERT_EQUAL_UINT32(1, journal.segmentReadCount() - before);
+  TEST_ASSERT_EQUAL_UINT32(EventJournal::kRecordsPerSegment * 4, journal.appendedCount());
+}
+
+void test_failed_write_seals_segment() {
+  MemoryJournalStorage storage;
+  EventJournal journal(storage);
+  journal.recover();
+  fill(journal, 10);
+  // Ошибка записи без сброса: часть записи во flash, сегмент закрыт
+  storage.powerCutAfter = 7;
+  JournalRecord record = event(11);
+  TEST_ASSERT_FALSE(journal.append(record));
+  storage.powerOn();
+  TEST_ASSERT_EQUAL_UINT32(1, journal.writeErrorCount());
+  fill(journal, 5);
+  TEST_ASSERT_EQUAL_UINT32(15, journal.recordCount());
+  assertRecords(journal, 0, UINT32_MAX, 1, 15);
+
+  EventJournal mounted(storage);
+  mounted.recover();
+  TEST_ASSERT_EQUAL_UINT32(1, mounted.tornCount());
+  TEST_ASSERT_EQUAL_UINT32(15, mounted.recordCount());
+  assertRecords(mounted, 0, UINT32_MAX, 1, 15);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_power_cut_inside_record);
+  RUN_TEST(test_power_cut_inside_segment_header);
+  RUN_TEST(test_power_cut_while_wrapping);
+  RUN_TEST(test_repeated_power_cuts);
+  RUN_TEST(test_range_query_reads_only_overlapping_segments);
+  RUN_TEST(test_failed_write_seals_segment);
+  exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,251 @@
+// Сеанс воспроизведения на модельных часах: одноразовый таймер
+// срабатывает на nextAtUs(), округлённом вверх до тика, и тест
+// проверяет громкости, их частоту, момент остановки и вытеснение.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "playback_session.h"
+
+static const int64_t kMsUs = 1000;
+static const int64_t kTickUs = 1000;
+
+struct Fired {
+  PlaybackAction action;
+  uint8_t volume;
+  int64_t atUs;     // расписанный момент
+  int64_t firedUs;  // когда сработал таймер
+};
+
+// Таймер до untilUs: срабатывание — на ближайшем тике не раньше события
+static std::vector<Fired> runTimer(PlaybackSession &session, int64_t untilUs) {
+  std::vector<Fired> fired;
+  for (;;) {
+    int64_t next = session.nextAtUs();
+    if (next < 0 || next > untilUs) {
+      break;
+    }
+    int64_t now = (next + kTickUs - 1) / kTickUs * kTickUs;
+    uint8_t volume;
+    int64_t atUs;
+    PlaybackAction action;
+    while ((action = session.poll(now, volume, atUs)) != PlaybackAction::None) {
+      fired.push_back({action, volume, atUs, now});
+    }
+    TEST_ASSERT_TRUE(session.nextAtUs() < 0 || session.nextAtUs() > now);
+  }
+  return fired;
+}
+
+static PlaybackPlan plan(uint32_t durationMs, uint32_t fadeInMs, uint32_t fadeOutMs, uint8_t volume) {
+  PlaybackPlan p;
+  p.durationMs = durationMs;
+  p.fadeInMs = fadeInMs;
+  p.fadeOutMs = fadeOutMs;
+  p.volume = volume;
+  return p;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// ---- длительность ----
+
+void test_stop_within_one_tick() {
+  PlaybackSession session;
+  int64_t start = 1234567;
+  TEST_ASSERT_EQUAL(20, session.begin(plan(30000, 0, 0, 20), start));
+  TEST_ASSERT_TRUE(session.active());
+  TEST_ASSERT_EQUAL_INT64(start + 30000 * kMsUs, session.stopAtUs());
+  TEST_ASSERT_EQUAL_INT64(start + 30000 * kMsUs, session.nextAtUs());
+
+  uint8_t volume;
+  int64_t atUs;
+  TEST_ASSERT_EQUAL(PlaybackAction::None, session.poll(start + 30000 * kMsUs - 1, volume, atUs));
+
+  std::vector<Fired> fired = runTimer(session, start + 60000 * kMsUs);
+  TEST_ASSERT_EQUAL_UINT32(1, fired.size());
+  TEST_ASSERT_EQUAL(PlaybackAction::Stop, fired[0].action);
+  TEST_ASSERT_EQUAL_UINT8(20, fired[0].volume);
+  TEST_ASSERT_EQUAL_INT64(start + 30000 * kMsUs, fired[0].atUs);
+  TEST_ASSERT_TRUE(fired[0].firedUs - fired[0].atUs < kTickUs);
+  TEST_ASSERT_FALSE(session.active());
+  TEST_ASSERT_EQUAL_INT64(-1, session.nextAtUs());
+  TEST_ASSERT_EQUAL_INT64(-1, session.stopAtUs());
+}
+
+void test_unlimited_session_has_no_stop() {
+  PlaybackSession session;
+  TEST_ASSERT_EQUAL(0, session.begin(plan(0, 500, 3000, 15), 0));
+  // Без длительности затухания нет, после нарастания событий нет
+  std::vector<Fired> fired = runTimer(session, 3600000 * kMsUs);
+  TEST_ASSERT_EQUAL_UINT32(5, fired.size());
+  TEST_ASSERT_EQUAL_UINT8(15, fired.back().volume);
+  TEST_ASSERT_TRUE(session.active());
+  TEST_ASSERT_EQUAL_INT64(-1, session.nextAtUs());
+  TEST_ASSERT_EQUAL_INT64(-1, session.stopAtUs());
+  // Остановлен снаружи: громкость уже исходная
+  TEST_ASSERT_EQUAL(-1, session.end());
+}
+
+// ---- нарастание и затухание ----
+
+void test_fade_in_then_fade_out() {
+  PlaybackSession session;
+  // Нарастание 1 с и затухание 2 с при громкости 20 и 10 с звука
+  TEST_ASSERT_EQUAL(0, session.begin(plan(10000, 1000, 2000, 20), 0));
+  std::vector<Fired> fired = runTimer(session, 20000 * kMsUs);
+
+  // 10 шагов нарастания по 100 мс, 19 шагов затухания по 100 мс, остановка
+  TEST_ASSERT_EQUAL_UINT32(10 + 19 + 1, fired.size());
+  for (size_t i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(PlaybackAction::Volume, fired[i].action);
+    TEST_ASSERT_EQUAL_UINT8(2 * (i + 1), fired[i].volume);
+    TEST_ASSERT_EQUAL_INT64((int64_t)(i + 1) * 100 * kMsUs, fired[i].atUs);
+  }
+  for (size_t i = 10; i < 29; i++) {
+    TEST_ASSERT_EQUAL(PlaybackAction::Volume, fired[i].action);
+    TEST_ASSERT_TRUE(fired[i].volume < fired[i - 1].volume || i == 10);
+    TEST_ASSERT_TRUE(fired[i].volume > 0);
+    TEST_ASSERT_TRUE(fired[i].atUs > 8000 * kMsUs);
+  }
+  TEST_ASSERT_EQUAL_UINT8(19, fired[10].volume);
+  TEST_ASSERT_EQUAL_UINT8(1, fired[28].volume);
+  // Последний шаг затухания — сама остановка, громкость возвращается
+  TEST_ASSERT_EQUAL(PlaybackAction::Stop, fired[29].action);
+  TEST_ASSERT_EQUAL_UINT8(20, fired[29].volume);
+  TEST_ASSERT_EQUAL_INT64(10000 * kMsUs, fired[29].atUs);
+  for (const Fired &f : fired) {
+    TEST_ASSERT_TRUE(f.firedUs >= f.atUs && f.firedUs - f.atUs < kTickUs);
+  }
+  TEST_ASSERT_EQUAL_UINT32(29, session.rampCommandCount());
+}
+
+void test_ramp_command_rate_is_bounded() {
+  // Долгое затухание — шаги реже, короткое — крупнее; чаще шага никогда
+  const uint32_t fades[] = {50, 250, 1000, 2900, 60000};
+  for (uint32_t fade : fades) {
+    PlaybackSession session;
+    session.begin(plan(fade * 2, fade, fade, 30), 0);
+    std::vector<Fired> fired = runTimer(session, (int64_t)fade * 4 * kMsUs);
+    TEST_ASSERT_EQUAL(PlaybackAction::Stop, fired.back().action);
+    TEST_ASSERT_EQUAL_INT64((int64_t)fade * 2 * kMsUs, fired.back().atUs);
+    for (size_t i = 1; i < fired.size(); i++) {
+      TEST_ASSERT_TRUE(fired[i].atUs - fired[i - 1].atUs >= PLAYBACK_RAMP_STEP_MS * kMsUs);
+    }
+    // Громкость 0..30 — не больше 30 команд на нарастание и на затухание
+    uint32_t limit = fade / PLAYBACK_RAMP_STEP_MS < 30 ? fade / PLAYBACK_RAMP_STEP_MS : 30;
+    TEST_ASSERT_TRUE(session.rampCommandCount() <= 2 * limit);
+  }
+}
+
+void test_fades_longer_than_session_are_scaled() {
+  PlaybackSession session;
+  // 1.5 с + 0.5 с на сеанс в 1 с: 750 мс нарастания, 250 мс затухания
+  session.begin(plan(1000, 1500, 500, 10), 0);
+  std::vector<Fired> fired = runTimer(session, 5000 * kMsUs);
+  TEST_ASSERT_EQUAL(PlaybackAction::Stop, fired.back().action);
+  TEST_ASSERT_EQUAL_INT64(1000 * kMsUs, fired.back().atUs);
+  uint8_t peak = 0;
+  int64_t peakAt = 0;
+  for (const Fired &f : fired) {
+    if (f.action == PlaybackAction::Volume && f.volume > peak) {
+      peak = f.volume;
+      peakAt = f.atUs;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT8(10, peak);
+  TEST_ASSERT_EQUAL_INT64(750 * kMsUs, peakAt);
+}
+
+void test_late_timer_catches_up_in_order() {
+  PlaybackSession session;
+  session.begin(plan(3000, 0, 1000, 10), 0);
+  // Задача аудио занята: таймер сработал через 400 мс после остановки
+  std::vector<Fired> fired;
+  uint8_t volume;
+  int64_t atUs;
+  PlaybackAction action;
+  while ((action = session.poll(3400 * kMsUs, volume, atUs)) != PlaybackAction::None) {
+    fired.push_back({action, volume, atUs, 3400 * kMsUs});
+  }
+  TEST_ASSERT_EQUAL_UINT32(10, fired.size());
+  for (size_t i = 1; i < fired.size(); i++) {
+    TEST_ASSERT_TRUE(fired[i].atUs > fired[i - 1].atUs);
+  }
+  TEST_ASSERT_EQUAL(PlaybackAction::Stop, fired.back().action);
+  TEST_ASSERT_EQUAL_INT64(3000 * kMsUs, fired.back().atUs);
+  TEST_ASSERT_FALSE(session.active());
+}
+
+// ---- вытеснение и вмешательство ----
+
+void test_new_session_preempts_fade_out() {
+  PlaybackSession session;
+  session.begin(plan(10000, 0, 2000, 10), 0);
+  std::vector<Fired> fired = runTimer(session, 9000 * kMsUs);
+  TEST_ASSERT_EQUAL_UINT8(5, fired.back().volume);
+
+  // Новый сеанс без нарастания: сначала вернуть громкость
+  TEST_ASSERT_EQUAL(10, session.begin(plan(3000, 0, 0, 10), 9000 * kMsUs));
+  TEST_ASSERT_EQUAL_UINT32(2, session.sessionCount());
+  TEST_ASSERT_EQUAL_UINT32(1, session.preemptedCount());
+  // От прежнего сеанса ни шагов, ни остановки в 10 с
+  fired = runTimer(session, 30000 * kMsUs);
+  TEST_ASSERT_EQUAL_UINT32(1, fired.size());
+  TEST_ASSERT_EQUAL(PlaybackAction::Stop, fired[0].action);
+  TEST_ASSERT_EQUAL_INT64(12000 * kMsUs, fired[0].atUs);
+
+  // С нарастанием после остановки — с нуля
+  TEST_ASSERT_EQUAL(0, session.begin(plan(3000, 500, 0, 10), 20000 * kMsUs));
+  TEST_ASSERT_EQUAL_UINT32(1, session.preemptedCount());
+  // С нарастанием поверх нарастания на нуле — ничего ставить не нужно
+  TEST_ASSERT_EQUAL(-1, session.begin(plan(3000, 500, 0, 10), 20000 * kMsUs));
+  TEST_ASSERT_EQUAL_UINT32(2, session.preemptedCount());
+}
+
+void test_end_restores_volume() {
+  PlaybackSession session;
+  session.begin(plan(10000, 1000, 0, 20), 0);
+  std::vector<Fired> fired = runTimer(session, 400 * kMsUs);
+  TEST_ASSERT_EQUAL_UINT8(8, fired.back().volume);
+  TEST_ASSERT_EQUAL(20, session.end());
+  TEST_ASSERT_FALSE(session.active());
+  TEST_ASSERT_EQUAL_INT64(-1, session.nextAtUs());
+  TEST_ASSERT_EQUAL(-1, session.end());
+}
+
+void test_user_volume_during_fade_out() {
+  PlaybackSession session;
+  session.begin(plan(10000, 0, 2000, 10), 0);
+  std::vector<Fired> fired = runTimer(session, 8400 * kMsUs);
+  TEST_ASSERT_EQUAL_UINT8(8, fired.back().volume);
+  // Громче с пульта: затухание продолжается от новой громкости
+  session.setVolume(20);
+  fired = runTimer(session, 20000 * kMsUs);
+  TEST_ASSERT_EQUAL_UINT32(8, fired.size());
+  TEST_ASSERT_EQUAL_UINT8(14, fired[0].volume);
+  TEST_ASSERT_EQUAL_INT64(8600 * kMsUs, fired[0].atUs);
+  TEST_ASSERT_EQUAL_UINT8(2, fired[6].volume);
+  TEST_ASSERT_EQUAL(PlaybackAction::Stop, fired[7].action);
+  TEST_ASSERT_EQUAL_UINT8(20, fired[7].volume);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_stop_within_one_tick);
+  RUN_TEST(test_unlimited_session_has_no_stop);
+  RUN_TEST(test_fade_in_then_fade_out);
+  RUN_TEST(test_ramp_command_rate_is_bounded);
+  RUN_TEST(test_fades_longer_than_session_are_scaled);
+  RUN_TEST(test_late_timer_catches_up_in_order);
+  RUN_TEST(test_new_session_preempts_fade_out);
+  RUN_TEST(test_end_restores_volume);
+  RUN_TEST(test_user_volume_during_fade_out);
+  exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,409 @@
+// Подготовка удара на модели плеера: DFPlayer пишет кадры в UART, плеер
+// на другом конце начинает и прекращает играть с задержками настоящего
+// (холодный старт — поиск файла и запуск декодера, продолжение — почти
+// сразу) и сообщает фронты BUSY. Шаги задачи аудио повторяют audioTask:
+// сначала StrikePrestage::next(), затем очередь команд.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "audio_commands.h"
+#include "dfplayer.h"
+#include "strike_prestage.h"
+
+static const int64_t kMsUs = 1000;
+static const uint16_t kTrack = 3;
+static const uint8_t kVolume = 20;
+
+struct Sent {
+  uint8_t command;
+  uint16_t param;
+  int64_t atUs;
+};
+
+// Плеер по ту сторону UART. Звук слышен, когда трек играет при
+// ненулевой громкости; каждое начало звука запоминается
+class SimulatedPlayer : public UartPort {
+public:
+  int64_t coldStartUs = 180 * kMsUs;
+  int64_t resumeUs = 12 * kMsUs;
+  int64_t pauseUs = 8 * kMsUs;
+  // false — трек не запускается (нет файла, плеер завис)
+  bool starts = true;
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  size_t write(const uint8_t *data, size_t length) override {
+    for (size_t i = 0; i < length; i++) {
+      if (_parser.feed(data[i])) {
+        receive(_parser.command(), _parser.param());
+      }
+    }
+    return length;
+  }
+
+  // Отложенный переход, если его время пришло; true — фронт BUSY
+  bool advance(int64_t nowUs) {
+    if (!_pending || nowUs < _pendingAtUs) {
+      return false;
+    }
+    _pending = false;
+    if (playing == _pendingPlaying) {
+      return false;
+    }
+    playing = _pendingPlaying;
+    edgeAtUs = _pendingAtUs;
+    noteSound(edgeAtUs);
+    return true;
+  }
+
+  int64_t nowUs = 0;
+  bool playing = false;
+  bool audible = false;
+  uint8_t volume = 0;
+  uint16_t track = 0;
+  int64_t edgeAtUs = 0;
+  std::vector<Sent> sent;
+  std::vector<int64_t> soundStarts;
+
+private:
+  void receive(uint8_t command, uint16_t param) {
+    if (command == dfplayer::QUERY_STATUS) {
+      return;
+    }
+    sent.push_back({command, param, nowUs});
+    switch (command) {
+      case dfplayer::CMD_VOLUME:
+        volume = (uint8_t)param;
+        noteSound(nowUs);
+        break;
+      case dfplayer::CMD_PLAY_TRACK:
+        track = param;
+        schedule(starts, coldStartUs);
+        break;
+      case dfplayer::CMD_START:
+        schedule(track != 0, resumeUs);
+        break;
+      case dfplayer::CMD_PAUSE:
+      case dfplayer::CMD_STOP:
+        schedule(false, pauseUs);
+        break;
+      default:
+        break;
+    }
+  }
+
+  void schedule(bool nextPlaying, int64_t delayUs) {
+    _pending = true;
+    _pendingPlaying = nextPlaying;
+    _pendingAtUs = nowUs + delayUs;
+  }
+
+  void noteSound(int64_t atUs) {
+    bool now = playing && volume > 0;
+    if (now && !audible) {
+      soundStarts.push_back(atUs);
+    }
+    audible = now;
+  }
+
+  dfplayer::FrameParser _parser;
+  bool _pending = false;
+  bool _pendingPlaying = false;
+  int64_t _pendingAtUs = 0;
+};
+
+// Задача аудио с линией BUSY на модельных часах с шагом 1 мс
+class AudioLoop {
+public:
+  AudioLoop() : player(device), prestage(true), queue(log) {
+    player.begin(nowMs());
+    submit(AudioOp::Volume, kVolume);
+    run(100);
+  }
+
+  uint32_t submit(AudioOp op, uint16_t arg) {
+    AudioCommand command = {log.issue(), op, arg};
+    TEST_ASSERT_TRUE(queue.push(command));
+    return command.id;
+  }
+
+  void run(int64_t ms) {
+    for (int64_t i = 0; i < ms; i++) {
+      step();
+    }
+  }
+
+  // До подготовленного трека или отказа; время подготовки, мкс
+  int64_t stage(uint16_t track) {
+    int64_t startUs = nowUs;
+    submit(AudioOp::Prestage, track);
+    for (int i = 0; i < 5000 && (!prestage.staged() || queue.pending() > 0); i++) {
+      step();
+      if (i > 0 && !prestage.busy() && !prestage.staged()) {
+        break;
+      }
+    }
+    return nowUs - startUs;
+  }
+
+  // Кадры, отправленные с момента fromUs
+  std::vector<Sent> sentSince(int64_t fromUs) const {
+    std::vector<Sent> result;
+    for (const Sent &sent : device.sent) {
+      if (sent.atUs >= fromUs) {
+        result.push_back(sent);
+      }
+    }
+    return result;
+  }
+
+  uint32_t nowMs() const { return (uint32_t)(nowUs / kMsUs); }
+
+  int64_t nowUs = 1000000;
+  SimulatedPlayer device;
+  DFPlayer player;
+  StrikePrestage prestage;
+  AudioCommandLog log;
+  AudioCommandQueue queue;
+
+private:
+  void step() {
+    nowUs += kMsUs;
+    device.nowUs = nowUs;
+    if (device.advance(nowUs)) {
+      prestage.observe(device.playing, device.edgeAtUs);
+    }
+    player.poll(nowMs());
+    if (player.msUntilReady(nowMs()) > 0) {
+      return;
+    }
+    uint16_t arg;
+    PrestageAction action = prestage.next(nowUs, arg);
+    if (action != PrestageAction::None) {
+      runPrestageAction(player, action, arg);
+      return;
+    }
+    AudioCommand command;
+    bool found = _holding;
+    if (_holding) {
+      command = _held;
+      _holding = false;
+    } else {
+      found = queue.pop(command);
+    }
+    if (found && !execute(command)) {
+      _held = command;
+      _holding = true;
+    }
+  }
+
+  // Как executeAudioCommand в main.cpp
+  bool execute(const AudioCommand &command) {
+    bool ok = true;
+    switch (command.op) {
+      case AudioOp::Prestage:
+        prestage.prepare(command.arg, player.currentVolume(), player.playing(), nowUs);
+        break;
+      case AudioOp::Strike:
+        prestage.strike(command.arg, nowUs);
+        break;
+      case AudioOp::Volume:
+        if (command.arg > 30) {
+          ok = false;
+        } else if (prestage.setVolume((uint8_t)command.arg)) {
+          ok = runAudioCommand(player, command);
+        }
+        break;
+      default:
+        if (prestage.cancel()) {
+          return false;
+        }
+        ok = runAudioCommand(player, command);
+        break;
+    }
+    queue.complete(command.id, ok);
+    return true;
+  }
+
+  AudioCommand _held;
+  bool _holding = false;
+};
+
+static void assertSent(const std::vector<Sent> &sent, const std::vector<uint8_t> &commands) {
+  TEST_ASSERT_EQUAL_UINT32(commands.size(), sent.size());
+  for (size_t i = 0; i < commands.size(); i++) {
+    TEST_ASSERT_EQUAL_HEX8(commands[i], sent[i].command);
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// ---- подготовка ----
+
+void test_staging_is_silent_and_restores_volume() {
+  AudioLoop loop;
+  int64_t startUs = loop.nowUs;
+  loop.stage(kTrack);
+  TEST_ASSERT_TRUE(loop.prestage.staged());
+  TEST_ASSERT_EQUAL_UINT32(1, loop.prestage.preparedCount());
+  // громкость 0 -> трек -> пауза -> громкость
+  std::vector<Sent> sent = loop.sentSince(startUs);
+  assertSent(sent, {dfplayer::CMD_VOLUME, dfplayer::CMD_PLAY_TRACK, dfplayer::CMD_PAUSE, dfplayer::CMD_VOLUME});
+  TEST_ASSERT_EQUAL_UINT16(0, sent[0].param);
+  TEST_ASSERT_EQUAL_UINT16(kTrack, sent[1].param);
+  // Трек играл, но беззвучно
+  TEST_ASSERT_EQUAL_UINT32(0, loop.device.soundStarts.size());
+  TEST_ASSERT_FALSE(loop.device.playing);
+  TEST_ASSERT_EQUAL_UINT8(kVolume, loop.device.volume);
+  // Команды не чаще интервала плеера
+  for (size_t i = 1; i < sent.size(); i++) {
+    TEST_ASSERT_TRUE(sent[i].atUs - sent[i - 1].atUs >= DFPlayer::kCommandIntervalMs * kMsUs);
+  }
+}
+
+void test_volume_change_during_staging_waits_for_restore() {
+  AudioLoop loop;
+  int64_t startUs = loop.nowUs;
+  loop.submit(AudioOp::Prestage, kTrack);
+  loop.run(80);
+  TEST_ASSERT_TRUE(loop.prestage.busy());
+  uint32_t id = loop.submit(AudioOp::Volume, 25);
+  loop.run(1000);
+  TEST_ASSERT_TRUE(loop.prestage.staged());
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, loop.log.status(id));
+  // Новая громкость не отправлена поверх подготовки, а восстановлена ей
+  std::vector<Sent> sent = loop.sentSince(startUs);
+  assertSent(sent, {dfplayer::CMD_VOLUME, dfplayer::CMD_PLAY_TRACK, dfplayer::CMD_PAUSE, dfplayer::CMD_VOLUME});
+  TEST_ASSERT_EQUAL_UINT16(25, sent[3].param);
+  TEST_ASSERT_EQUAL_UINT32(0, loop.device.soundStarts.size());
+}
+
+// ---- удар ----
+
+void test_staged_strike_is_single_resume() {
+  AudioLoop loop;
+  loop.stage(kTrack);
+  TEST_ASSERT_TRUE(loop.prestage.staged());
+  loop.run(500);
+
+  int64_t strikeUs = loop.nowUs;
+  loop.submit(AudioOp::Strike, kTrack);
+  loop.run(500);
+  assertSent(loop.sentSince(strikeUs), {dfplayer::CMD_START});
+  TEST_ASSERT_EQUAL_UINT32(1, loop.device.soundStarts.size());
+  TEST_ASSERT_TRUE(loop.device.soundStarts[0] - strikeUs <= 2 * kMsUs + loop.device.resumeUs);
+
+  int32_t latencyUs;
+  bool prestaged;
+  TEST_ASSERT_TRUE(loop.prestage.takeLatency(latencyUs, prestaged));
+  TEST_ASSERT_TRUE(prestaged);
+  TEST_ASSERT_EQUAL_INT32(loop.device.resumeUs, latencyUs);
+  TEST_ASSERT_FALSE(loop.prestage.busy());
+}
+
+void test_unfinished_staging_falls_back_to_cold_start() {
+  AudioLoop loop;
+  loop.submit(AudioOp::Prestage, kTrack);
+  // Трек отправлен, плеер ещё ищет файл: громкость 0
+  loop.run(60);
+  TEST_ASSERT_TRUE(loop.prestage.busy());
+  TEST_ASSERT_EQUAL_UINT8(0, loop.device.volume);
+
+  int64_t strikeUs = loop.nowUs;
+  loop.submit(AudioOp::Strike, kTrack);
+  loop.run(1000);
+  // Громкость возвращается до запуска трека с начала
+  std::vector<Sent> sent = loop.sentSince(strikeUs);
+  assertSent(sent, {dfplayer::CMD_VOLUME, dfplayer::CMD_PLAY_TRACK});
+  TEST_ASSERT_EQUAL_UINT16(kVolume, sent[0].param);
+  TEST_ASSERT_EQUAL_UINT16(kTrack, sent[1].param);
+  TEST_ASSERT_EQUAL_UINT32(1, loop.device.soundStarts.size());
+  TEST_ASSERT_TRUE(loop.device.soundStarts[0] > sent[1].atUs);
+
+  int32_t latencyUs;
+  bool prestaged;
+  TEST_ASSERT_TRUE(loop.prestage.takeLatency(latencyUs, prestaged));
+  TEST_ASSERT_FALSE(prestaged);
+  TEST_ASSERT_EQUAL_INT32(loop.device.coldStartUs, latencyUs);
+  TEST_ASSERT_EQUAL_UINT32(0, loop.prestage.preparedCount());
+}
+
+void test_timed_out_staging_falls_back_to_cold_start() {
+  AudioLoop loop;
+  loop.device.starts = false;
+  int64_t startUs = loop.nowUs;
+  loop.stage(kTrack);
+  // Плеер не подтвердил начало: стоп и возврат громкости
+  TEST_ASSERT_FALSE(loop.prestage.staged());
+  TEST_ASSERT_FALSE(loop.prestage.busy());
+  TEST_ASSERT_EQUAL_UINT32(1, loop.prestage.failedCount());
+  TEST_ASSERT_TRUE(loop.nowUs - startUs > StrikePrestage::kConfirmTimeoutUs);
+  assertSent(loop.sentSince(startUs),
+             {dfplayer::CMD_VOLUME, dfplayer::CMD_PLAY_TRACK, dfplayer::CMD_STOP, dfplayer::CMD_VOLUME});
+  TEST_ASSERT_EQUAL_UINT8(kVolume, loop.device.volume);
+  TEST_ASSERT_EQUAL_UINT32(0, loop.device.soundStarts.size());
+
+  loop.device.starts = true;
+  loop.run(100);
+  int64_t strikeUs = loop.nowUs;
+  loop.submit(AudioOp::Strike, kTrack);
+  loop.run(1000);
+  assertSent(loop.sentSince(strikeUs), {dfplayer::CMD_PLAY_TRACK});
+  TEST_ASSERT_EQUAL_UINT32(1, loop.device.soundStarts.size());
+  int32_t latencyUs;
+  bool prestaged;
+  TEST_ASSERT_TRUE(loop.prestage.takeLatency(latencyUs, prestaged));
+  TEST_ASSERT_FALSE(prestaged);
+}
+
+void test_cancelling_command_falls_back_to_cold_start() {
+  AudioLoop loop;
+  loop.submit(AudioOp::Prestage, kTrack);
+  loop.run(60);
+  TEST_ASSERT_TRUE(loop.prestage.busy());
+
+  // Пользователь запускает другой трек посреди подготовки: сначала
+  // возвращается громкость, затем выполняется его команда
+  int64_t cancelUs = loop.nowUs;
+  uint32_t id = loop.submit(AudioOp::Track, 7);
+  loop.run(500);
+  TEST_ASSERT_EQUAL(AudioCommandStatus::Done, loop.log.status(id));
+  TEST_ASSERT_FALSE(loop.prestage.staged());
+  TEST_ASSERT_FALSE(loop.prestage.busy());
+  std::vector<Sent> sent = loop.sentSince(cancelUs);
+  assertSent(sent, {dfplayer::CMD_VOLUME, dfplayer::CMD_PLAY_TRACK});
+  TEST_ASSERT_EQUAL_UINT16(kVolume, sent[0].param);
+  TEST_ASSERT_EQUAL_UINT16(7, sent[1].param);
+  TEST_ASSERT_EQUAL_UINT32(1, loop.device.soundStarts.size());
+
+  // Удар после отмены — холодный старт своего трека
+  loop.submit(AudioOp::Stop, 0);
+  loop.run(100);
+  int64_t strikeUs = loop.nowUs;
+  loop.submit(AudioOp::Strike, kTrack);
+  loop.run(1000);
+  assertSent(loop.sentSince(strikeUs), {dfplayer::CMD_PLAY_TRACK});
+  int32_t latencyUs;
+  bool prestaged;
+  TEST_ASSERT_TRUE(loop.prestage.takeLatency(latencyUs, prestaged));
+  TEST_ASSERT_FALSE(prestaged);
+  TEST_ASSERT_EQUAL_INT32(loop.device.coldStartUs, latencyUs);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_staging_is_silent_and_restores_volume);
+  RUN_TEST(test_volume_change_during_staging_waits_for_restore);
+  RUN_TEST(test_staged_strike_is_single_resume);
+  RUN_TEST(test_unfinished_staging_falls_back_to_cold_start);
+  RUN_TEST(test_timed_out_staging_falls_back_to_cold_start);
+  RUN_TEST(test_cancelling_command_falls_back_to_cold_start);
+  exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,242 @@
+// Служба времени на синтетических обменах SNTP: кварц устройства
+// уходит на заданное число ppm, задержка сети случайная и несимметричная.
+// Ошибка utcUs() против истинного UTC не должна выходить за
+// uncertaintyUs() — ни в момент синхронизации, ни между ними.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <random>
+
+#include "time_service.h"
+
+static const int64_t kSecondUs = 1000000;
+
+// Устройство и сеть: истинное UTC от монотонных часов —
+// utc = utc0 + mono * (1 + driftPpb / 1e9)
+struct Simulation {
+  int64_t utc0Us;
+  int64_t driftPpb;
+  // Задержка в одну сторону: base + случайная часть 0..jitter
+  uint32_t baseLatencyUs;
+  uint32_t jitterUs;
+  std::minstd_rand random;
+
+  Simulation(int64_t drift, uint32_t base, uint32_t jitter, uint32_t seed = 1)
+    : utc0Us(1791763200LL * kSecondUs), driftPpb(drift), baseLatencyUs(base), jitterUs(jitter), random(seed) {}
+
+  int64_t trueUtc(int64_t monoUs) const {
+    return utc0Us + monoUs + monoUs * driftPpb / 1000000000LL;
+  }
+  int64_t monoAt(int64_t utcUs) const {
+    // Обратное к trueUtc с точностью до микросекунды
+    int64_t mono = (utcUs - utc0Us) - (utcUs - utc0Us) * driftPpb / 1000000000LL;
+    while (trueUtc(mono) < utcUs) mono++;
+    while (trueUtc(mono) > utcUs) mono--;
+    return mono;
+  }
+  uint32_t latency() {
+    return baseLatencyUs + (jitterUs ? random() % (jitterUs + 1) : 0);
+  }
+
+  // Обмен SNTP, начатый в момент t1 по монотонным часам; extraUs —
+  // дополнительная задержка ответа (очередь в сети)
+  TimeSample exchange(int64_t t1MonoUs, uint32_t extraUs = 0) {
+    int64_t t2 = trueUtc(t1MonoUs) + latency();
+    int64_t t3 = t2 + 200;
+    int64_t t4 = monoAt(t3 + latency() + extraUs);
+    TimeSample sample;
+    TEST_ASSERT_TRUE(TimeService::sampleFromExchange(t1MonoUs, t2, t3, t4, sample));
+    return sample;
+  }
+};
+
+// |utcUs - истина| <= uncertaintyUs на отрезке [fromUs, toUs] по монотонным часам
+static int64_t assertWithinBound(const TimeService &time, const Simulation &sim, int64_t fromUs, int64_t toUs,
+                                 int64_t stepUs) {
+  int64_t worst = 0;
+  for (int64_t mono = fromUs; mono <= toUs; mono += stepUs) {
+    int64_t error = time.utcUs(mono) - sim.trueUtc(mono);
+    if (error < 0) error = -error;
+    if (error > (int64_t)time.uncertaintyUs(mono)) {
+      char text[160];
+      snprintf(text, sizeof(text), "mono %lld: error %lld us > bound %u us", (long long)mono, (long long)error,
+               time.uncertaintyUs(mono));
+      TEST_FAIL_MESSAGE(text);
+    }
+    if (error > worst) worst = error;
+  }
+  return worst;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_exchange_midpoint_and_delay() {
+  TimeSample sample;
+  // Запрос 10 мс туда, 1 мс на сервере, 30 мс обратно
+  TEST_ASSERT_TRUE(TimeService::sampleFromExchange(1000000, 5000000, 5001000, 1041000, sample));
+  TEST_ASSERT_EQUAL_INT64(1020500, sample.monoUs);
+  TEST_ASSERT_EQUAL_INT64(5000500, sample.utcUs);
+  TEST_ASSERT_EQUAL_UINT32(40000, sample.delayUs);
+  // Ответ раньше запроса и удержание дольше обмена — противоречие
+  TEST_ASSERT_FALSE(TimeService::sampleFromExchange(1000000, 5000000, 5001000, 999999, sample));
+  TEST_ASSERT_FALSE(TimeService::sampleFromExchange(1000000, 5000000, 4999999, 1041000, sample));
+  TEST_ASSERT_FALSE(TimeService::sampleFromExchange(1000000, 5000000, 5100000, 1041000, sample));
+}
+
+void test_unknown_time_before_first_sample() {
+  TimeService time;
+  TEST_ASSERT_EQUAL(TimeSource::None, time.source());
+  TEST_ASSERT_EQUAL_INT64(-1, time.utcUs(0));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, time.uncertaintyUs(0));
+}
+
+void test_error_bound_with_drift_and_latency() {
+  // Кварц спешит на 35 ppm, задержка 5..45 мс в каждую сторону
+  Simulation sim(-35000, 5000, 40000);
+  TimeService time;
+  int64_t mono = 3 * kSecondUs;
+  int64_t interval = 16 * kSecondUs;
+  for (int i = 0; i < 60; i++) {
+    time.addSample(sim.exchange(mono));
+    // Граница держится до следующей синхронизации
+    assertWithinBound(time, sim, mono, mono + interval, kSecondUs);
+    mono += interval;
+    if (i == 8) {
+      interval = 64 * kSecondUs;
+    }
+  }
+  TEST_ASSERT_EQUAL(TimeSource::Sntp, time.source());
+  TEST_ASSERT_TRUE(time.syncCount() + time.rejectedCount() == 60);
+  // Граница не вырождена: не больше половины худшей задержки и запаса
+  TEST_ASSERT_TRUE(time.uncertaintyUs(mono) < 50000);
+  // Уход найден с точностью оценки
+  int64_t driftError = time.driftPpb() - sim.driftPpb;
+  if (driftError < 0) driftError = -driftError;
+  TEST_ASSERT_TRUE(driftError < 10000);
+}
+
+void test_holdover_without_sync() {
+  // Тихая сеть: уход оценивается точно, без WiFi час время идёт с поправкой
+  Simulation sim(22000, 2000, 3000, 7);
+  TimeService time;
+  int64_t mono = kSecondUs;
+  for (int i = 0; i < 16; i++) {
+    time.addSample(sim.exchange(mono));
+    mono += 64 * kSecondUs;
+  }
+  int64_t driftError = time.driftPpb() - sim.driftPpb;
+  if (driftError < 0) driftError = -driftError;
+  TEST_ASSERT_TRUE(driftError < 2000);
+
+  int64_t last = mono - 64 * kSecondUs;
+  int64_t worst = assertWithinBound(time, sim, last, last + 3600 * kSecondUs, 60 * kSecondUs);
+  // Без поправки на уход ошибка за час была бы 79 мс
+  TEST_ASSERT_TRUE(worst < 20000);
+  TEST_ASSERT_TRUE(time.uncertaintyUs(last + 3600 * kSecondUs) < 200000);
+}
+
+void test_delayed_reply_is_rejected_then_accepted() {
+  Simulation sim(10000, 3000, 2000, 3);
+  TimeService time;
+  int64_t mono = kSecondUs;
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(time.addSample(sim.exchange(mono)));
+    mono += 16 * kSecondUs;
+  }
+  // Ответ постоял в очереди 200 мс — выборка отброшена, время не сдвинулось
+  int64_t before = time.utcUs(mono);
+  TEST_ASSERT_FALSE(time.addSample(sim.exchange(mono, 200000)));
+  TEST_ASSERT_EQUAL_INT64(before, time.utcUs(mono));
+  TEST_ASSERT_EQUAL_UINT32(1, time.rejectedCount());
+  assertWithinBound(time, sim, mono, mono + 16 * kSecondUs, kSecondUs);
+
+  // Сеть стала медленнее насовсем: после трёх отказов выборка принимается
+  mono += 16 * kSecondUs;
+  TEST_ASSERT_FALSE(time.addSample(sim.exchange(mono, 100000)));
+  mono += 16 * kSecondUs;
+  TEST_ASSERT_FALSE(time.addSample(sim.exchange(mono, 100000)));
+  mono += 16 * kSecondUs;
+  TEST_ASSERT_TRUE(time.addSample(sim.exchange(mono, 100000)));
+  assertWithinBound(time, sim, mono, mono + 16 * kSecondUs, kSecondUs);
+}
+
+void test_step_resets_history_keeps_drift() {
+  Simulation sim(-15000, 2000, 2000, 5);
+  TimeService time;
+  int64_t mono = kSecondUs;
+  for (int i = 0; i < 12; i++) {
+    time.addSample(sim.exchange(mono));
+    mono += 64 * kSecondUs;
+  }
+  int32_t drift = time.driftPpb();
+  // Сервер перевёл часы на 5 с
+  sim.utc0Us += 5 * kSecondUs;
+  TEST_ASSERT_TRUE(time.addSample(sim.exchange(mono)));
+  TEST_ASSERT_TRUE(time.lastOffsetUs() > 4 * kSecondUs);
+  TEST_ASSERT_EQUAL_INT32(drift, time.driftPpb());
+  assertWithinBound(time, sim, mono, mono + 64 * kSecondUs, kSecondUs);
+}
+
+void test_anchor_survives_reset() {
+  Simulation sim(30000, 2000, 4000, 9);
+  TimeService time;
+  int64_t mono = kSecondUs;
+  for (int i = 0; i < 12; i++) {
+    time.addSample(sim.exchange(mono));
+    mono += 64 * kSecondUs;
+  }
+  // RTC идёт от включения питания, монотонные часы — от сброса
+  int64_t rtcAtSave = mono + 123 * kSecondUs;
+  TimeAnchor anchor;
+  time.saveAnchor(mono, rtcAtSave, anchor);
+
+  // Сброс через 10 с (по RTC, ошибка хода RTC в пределах допуска)
+  int64_t resetGap = 10 * kSecondUs;
+  int64_t monoAfter = 200000;
+  TimeService restored;
+  TEST_ASSERT_TRUE(restored.restoreAnchor(anchor, monoAfter, rtcAtSave + resetGap));
+  TEST_ASSERT_EQUAL(TimeSource::Restored, restored.source());
+  int64_t truth = sim.trueUtc(mono + resetGap);
+  int64_t error = restored.utcUs(monoAfter) - truth;
+  if (error < 0) error = -error;
+  TEST_ASSERT_TRUE(error <= (int64_t)restored.uncertaintyUs(monoAfter));
+
+  // Повреждённая запись и разрыв больше суток не принимаются
+  TimeAnchor bad = anchor;
+  bad.utcUs += 1;
+  TEST_ASSERT_FALSE(restored.restoreAnchor(bad, monoAfter, rtcAtSave + resetGap));
+  TEST_ASSERT_FALSE(restored.restoreAnchor(anchor, monoAfter, rtcAtSave + 86401LL * kSecondUs));
+  TEST_ASSERT_FALSE(restored.restoreAnchor(anchor, monoAfter, rtcAtSave - 1));
+}
+
+void test_mono_delay_follows_drift() {
+  Simulation sim(50000, 1000, 1000, 11);
+  TimeService time;
+  int64_t mono = kSecondUs;
+  for (int i = 0; i < 10; i++) {
+    time.addSample(sim.exchange(mono));
+    mono += 64 * kSecondUs;
+  }
+  // Кварц отстаёт на 50 ppm: минута по UTC короче по монотонным часам
+  int64_t delay = time.monoDelayUs(60 * kSecondUs);
+  int64_t expected = sim.monoAt(sim.trueUtc(mono) + 60 * kSecondUs) - mono;
+  TEST_ASSERT_INT64_WITHIN(200, expected, delay);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_exchange_midpoint_and_delay);
+  RUN_TEST(test_unknown_time_before_first_sample);
+  RUN_TEST(test_error_bound_with_drift_and_latency);
+  RUN_TEST(test_holdover_without_sync);
+  RUN_TEST(test_delayed_reply_is_rejected_then_accepted);
+  RUN_TEST(test_step_resets_history_keeps_drift);
+  RUN_TEST(test_anchor_survives_reset);
+  RUN_TEST(test_mono_delay_follows_drift);
+  exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,445 @@
+// Запросы API через GongWebServer на loopback без кучи: тест считает
+// new и malloc в задаче сервера, пока настоящие обработчики из
+// api_routes.cpp (громкость, смена WiFi, изменение будильника, пакет
+// синхронизации, список) разбирают аргументы-виды, пишут настройки и
+// набор будильников в память через ConfigStore и AlarmStore и отвечают
+// JsonWriter в арене запроса. После первых запросов (буферы String и
+// векторов сервера уже выросли) выделений быть не должно, и арена не
+// должна переполняться.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <lwip/sockets.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include "alarm_json.h"
+#include "alarm_store.h"
+#include "api_routes.h"
+#include "config_store.h"
+#include "gong_web_server.h"
+
+// ---- учёт выделений памяти ----
+
+// Как в bench/bench.cpp: вызовы перехватываются поверх функций glibc,
+// считаются только в потоке теста и только при countAllocations
+static thread_local bool countAllocations = false;
+static thread_local uint32_t allocationCount = 0;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+  if (countAllocations) allocationCount++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  if (countAllocations) allocationCount++;
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  if (countAllocations) allocationCount++;
+  return __libc_realloc(ptr, size);
+}
+}
+
+static void *countedAlloc(size_t size) {
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+// ---- состояние прошивки в памяти ----
+
+// Слоты фиксированного размера: запись не трогает кучу
+class MemoryConfigStorage : public ConfigStorage {
+public:
+  size_t read(uint8_t slot, uint8_t *data, size_t capacity) override {
+    size_t size = _length[slot] < capacity ? _length[slot] : capacity;
+    memcpy(data, _data[slot], size);
+    return size;
+  }
+  bool write(uint8_t slot, const uint8_t *data, size_t length) override {
+    if (length > sizeof(_data[slot])) {
+      return false;
+    }
+    memcpy(_data[slot], data, length);
+    _length[slot] = length;
+    return true;
+  }
+
+private:
+  uint8_t _data[2][512];
+  size_t _length[2] = {0, 0};
+};
+
+class MemoryAlarmStorage : public AlarmStorage {
+public:
+  size_t read(uint8_t slot, size_t offset, uint8_t *data, size_t length) override {
+    if (offset >= _length[slot]) {
+      return 0;
+    }
+    size_t size = _length[slot] - offset < length ? _length[slot] - offset : length;
+    memcpy(data, _data[slot] + offset, size);
+    return size;
+  }
+  bool write(uint8_t slot, const uint8_t *header, size_t headerLength, const uint8_t *alarms,
+             size_t alarmsLength) override {
+    if (fail || headerLength + alarmsLength > sizeof(_data[slot])) {
+      return false;
+    }
+    memcpy(_data[slot], header, headerLength);
+    memcpy(_data[slot] + headerLength, alarms, alarmsLength);
+    _length[slot] = headerLength + alarmsLength;
+    return true;
+  }
+
+  bool fail = false;
+
+private:
+  uint8_t _data[2][sizeof(AlarmStoreHeader) + ALARM_MAX_COUNT * sizeof(AlarmEntry)];
+  size_t _length[2] = {0, 0};
+};
+
+// Как FirmwareApi в main.cpp, но без задач: команды плееру и пробы сети
+// только запоминаются
+class MemoryApi : public ApiHost {
+public:
+  MemoryApi() : configStore(configStorage), alarmStore(alarmStorage) {
+    memset(&current, 0, sizeof(current));
+    copyConfigString(current.wifiSsid, sizeof(current.wifiSsid), "ASUS", 4);
+    copyConfigString(current.wifiPass, sizeof(current.wifiPass), "password", 8);
+    current.volume = 20;
+  }
+
+  const GongConfig &config() override { return current; }
+  bool commitConfig(const GongConfig &next) override {
+    if (!configStore.commit(next)) {
+      return false;
+    }
+    current = next;
+    return true;
+  }
+  uint32_t submitVolume(uint8_t volume) override {
+    playerVolume = volume;
+    return ++commands;
+  }
+  uint32_t startWiFiTrial(const WiFiNetwork &network) override {
+    trial = network;
+    return ++trials;
+  }
+
+  void lockAlarms() override { locked++; }
+  void unlockAlarms() override { locked--; }
+  AlarmScheduler &scheduler() override { return alarms; }
+  OccurrenceCache &occurrences() override { return cache; }
+  uint32_t alarmsVersion() override { return version; }
+  bool saveAlarms() override {
+    if (!alarmStore.commit(alarms, version + 1)) {
+      return false;
+    }
+    version++;
+    return true;
+  }
+  void restoreAlarms() override {
+    uint32_t stored;
+    if (!alarmStore.load(alarms, stored)) {
+      alarms.clear();
+    }
+  }
+  void scheduleChanged() override { changes++; }
+
+  MemoryConfigStorage configStorage;
+  ConfigStore configStore;
+  MemoryAlarmStorage alarmStorage;
+  AlarmStore alarmStore;
+  GongConfig current;
+  AlarmScheduler alarms;
+  OccurrenceCache cache;
+  uint32_t version = 0;
+  uint8_t playerVolume = 0;
+  uint32_t commands = 0;
+  WiFiNetwork trial = {};
+  uint32_t trials = 0;
+  int locked = 0;
+  uint32_t changes = 0;
+};
+
+static GongWebServer *server;
+static MemoryApi *api;
+
+static AlarmEntry alarmAt(uint16_t id, uint16_t minuteOfDay) {
+  AlarmEntry alarm = {};
+  alarm.id = id;
+  alarm.duration = 30;
+  alarm.minuteOfDay = minuteOfDay;
+  alarm.days = 0x1F;
+  alarm.active = 1;
+  alarm.track = 1;
+  return alarm;
+}
+
+// ---- клиент ----
+
+static int connectClient() {
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(server->port());
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&address, sizeof(address)));
+  int noDelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  return fd;
+}
+
+static char response[4096];
+
+// Заголовки и тело: по Content-Length или до последнего чанка
+static bool complete(size_t received) {
+  response[received] = '\0';
+  const char *end = strstr(response, "\r\n\r\n");
+  if (!end) {
+    return false;
+  }
+  if (strstr(response, "Transfer-Encoding: chunked")) {
+    return received >= 5 && strcmp(response + received - 5, "0\r\n\r\n") == 0;
+  }
+  const char *length = strstr(response, "Content-Length: ");
+  return length && received >= (size_t)(end + 4 - response) + (size_t)atoi(length + 16);
+}
+
+// Запрос и ответ в потоке теста; код ответа или -1
+static int exchange(int fd, const char *request, size_t length) {
+  size_t sent = 0;
+  size_t received = 0;
+  for (int pass = 0; pass < 5000 && !complete(received); pass++) {
+    if (sent < length) {
+      ssize_t n = send(fd, request + sent, length - sent, MSG_DONTWAIT);
+      if (n > 0) {
+        sent += n;
+      }
+    }
+    server->handleClient();
+    ssize_t n = recv(fd, response + received, sizeof(response) - 1 - received, MSG_DONTWAIT);
+    if (n > 0) {
+      received += n;
+    }
+  }
+  if (!complete(received)) {
+    return -1;
+  }
+  return atoi(response + 9);
+}
+
+static int exchange(int fd, const char *request) { return exchange(fd, request, strlen(request)); }
+
+// Громкость туда и обратно (настройки пишутся каждый раз), смена сети
+// со страницей по шаблону, изменение будильника, полный пакет
+// синхронизации, список и ошибка без аргумента
+static const char *kRequests[] = {
+  "POST /api/audio/volume?value=17 HTTP/1.1\r\nHost: gong.local\r\nContent-Length: 0\r\n\r\n",
+  "POST /api/audio/volume?value=18 HTTP/1.1\r\nHost: gong.local\r\nContent-Length: 0\r\n\r\n",
+  "POST /api/wifi HTTP/1.1\r\nHost: gong.local\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: 43\r\n\r\n"
+  "ssid=Dhamma+Hall&pass=anicca%2Ddukkha%21%21",
+  "PUT /api/alarms/12 HTTP/1.1\r\nHost: gong.local\r\nContent-Type: application/json\r\nContent-Length: 44\r\n\r\n"
+  "{\"time\":\"07:30\",\"duration\":30,\"active\":true}",
+  "POST /api/alarms/sync HTTP/1.1\r\nHost: gong.local\r\nContent-Type: application/json\r\nContent-Length: 163\r\n\r\n"
+  "{\"full\":true,\"upserts\":[{\"id\":12,\"time\":\"07:30\",\"days\":[0,1,2,3,4],\"duration\":30,\"active\":true},{\"id\":14,\"time\":\"19:00\",\"days\":[5,6],\"duration\":45,\"active\":true}]}",
+  "GET /api/alarms HTTP/1.1\r\nHost: gong.local\r\nContent-Length: 0\r\n\r\n",
+  "POST /api/audio/volume HTTP/1.1\r\nHost: gong.local\r\nContent-Length: 0\r\n\r\n",
+};
+static const int kCodes[] = {202, 202, 202, 200, 200, 200, 400};
+static const size_t kRequestCount = sizeof(kRequests) / sizeof(kRequests[0]);
+
+static const char kMissingAlarm[] =
+  "PUT /api/alarms/99 HTTP/1.1\r\nHost: gong.local\r\nContent-Type: application/json\r\nContent-Length: 44\r\n\r\n"
+  "{\"time\":\"07:30\",\"duration\":30,\"active\":true}";
+// base отстала от версии набора
+static const char kStaleSync[] =
+  "POST /api/alarms/sync HTTP/1.1\r\nHost: gong.local\r\nContent-Type: application/json\r\nContent-Length: 38\r\n\r\n"
+  "{\"base\":1,\"upserts\":[],\"deletes\":[13]}";
+
+void setUp() {
+  api = new MemoryApi();
+  api->alarms.upsert(alarmAt(12, 6 * 60));
+  api->alarms.upsert(alarmAt(13, 21 * 60));
+  TEST_ASSERT_TRUE(api->saveAlarms());
+  api->cache.rebuild(20000, api->alarms);
+  server = new GongWebServer(0);
+  registerApiRoutes(*server, *api);
+  TEST_ASSERT_TRUE(server->begin());
+}
+
+void tearDown() {
+  server->close();
+  delete server;
+  delete api;
+}
+
+void test_responses() {
+  int fd = connectClient();
+  TEST_ASSERT_EQUAL(202, exchange(fd, kRequests[0]));
+  TEST_ASSERT_NOT_NULL(strstr(response, "\"volume\":17,\"id\":1"));
+  TEST_ASSERT_EQUAL(17, api->playerVolume);
+  TEST_ASSERT_EQUAL(17, api->current.volume);
+  TEST_ASSERT_EQUAL_UINT32(1, api->configStore.sequence());
+
+  TEST_ASSERT_EQUAL(202, exchange(fd, kRequests[2]));
+  TEST_ASSERT_NOT_NULL(strstr(response, "Transfer-Encoding: chunked"));
+  TEST_ASSERT_EQUAL_UINT32(1, api->trials);
+  TEST_ASSERT_EQUAL_STRING("Dhamma Hall", api->trial.ssid);
+  TEST_ASSERT_EQUAL_STRING("anicca-dukkha!!", api->trial.pass);
+
+  TEST_ASSERT_EQUAL(200, exchange(fd, kRequests[3]));
+  TEST_ASSERT_EQUAL(7 * 60 + 30, api->alarms.find(12)->minuteOfDay);
+  TEST_ASSERT_EQUAL_UINT32(2, api->version);
+  TEST_ASSERT_EQUAL_UINT32(1, api->changes);
+
+  TEST_ASSERT_EQUAL(200, exchange(fd, kRequests[4]));
+  TEST_ASSERT_NOT_NULL(strstr(response, "\"version\":3,\"upserts\":2,\"deletes\":0"));
+  TEST_ASSERT_EQUAL(2, api->alarms.size());
+  TEST_ASSERT_NULL(api->alarms.find(13));
+  TEST_ASSERT_NOT_NULL(api->alarms.find(14));
+  TEST_ASSERT_TRUE(api->cache.valid());
+
+  // Сохранённый набор совпадает с применённым
+  AlarmScheduler stored;
+  uint32_t storedVersion = 0;
+  TEST_ASSERT_TRUE(api->alarmStore.load(stored, storedVersion));
+  TEST_ASSERT_EQUAL_UINT32(3, storedVersion);
+  TEST_ASSERT_EQUAL(2, stored.size());
+
+  TEST_ASSERT_EQUAL(200, exchange(fd, kRequests[5]));
+  TEST_ASSERT_NOT_NULL(strstr(response, "\"time\":\"19:00\""));
+  TEST_ASSERT_NOT_NULL(strstr(response, "\"version\":3"));
+
+  TEST_ASSERT_EQUAL(400, exchange(fd, kRequests[6]));
+  TEST_ASSERT_NOT_NULL(strstr(response, "volume required"));
+
+  TEST_ASSERT_EQUAL(404, exchange(fd, kMissingAlarm));
+  TEST_ASSERT_EQUAL(409, exchange(fd, kStaleSync));
+  TEST_ASSERT_EQUAL(2, api->alarms.size());
+  TEST_ASSERT_EQUAL_UINT32(3, api->version);
+  TEST_ASSERT_EQUAL(0, api->locked);
+  close(fd);
+}
+
+// Пакет больше документа разбора — 413, набор не тронут. Запрос
+// больше буфера соединения, и в куче только этот буфер сервера
+// (растёт вдвое); разбор и ответ без выделений
+void test_oversized_sync_is_rejected() {
+  static char request[ALARM_SYNC_BODY_MAX + 256];
+  static char body[ALARM_SYNC_BODY_MAX];
+  size_t length = snprintf(body, sizeof(body), "{\"base\":1,\"deletes\":[");
+  for (int i = 0; i < 4500; i++) {
+    length += snprintf(body + length, sizeof(body) - length, "%s%d", i ? "," : "", i % 10);
+  }
+  length += snprintf(body + length, sizeof(body) - length, "]}");
+  TEST_ASSERT_TRUE(length < sizeof(body) - 1);
+  size_t requestLength = snprintf(request, sizeof(request),
+                                  "POST /api/alarms/sync HTTP/1.1\r\nHost: gong.local\r\n"
+                                  "Content-Type: application/json\r\nContent-Length: %u\r\n\r\n%s",
+                                  (unsigned)length, body);
+
+  int fd = connectClient();
+  TEST_ASSERT_EQUAL(413, exchange(fd, request, requestLength));
+  allocationCount = 0;
+  countAllocations = true;
+  int code = exchange(fd, request, requestLength);
+  countAllocations = false;
+  TEST_ASSERT_EQUAL(413, code);
+  uint32_t growth = 0;
+  for (size_t capacity = HTTP_IN_STATIC; capacity <= requestLength; capacity *= 2) {
+    growth++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(growth, allocationCount);
+  TEST_ASSERT_EQUAL(2, api->alarms.size());
+  TEST_ASSERT_EQUAL_UINT32(1, api->version);
+  close(fd);
+}
+
+void test_keep_alive_requests_do_not_allocate() {
+  int fd = connectClient();
+  // Первый проход: String и векторы сервера вырастают до рабочего размера
+  for (size_t i = 0; i < kRequestCount; i++) {
+    TEST_ASSERT_EQUAL(kCodes[i], exchange(fd, kRequests[i]));
+  }
+
+  allocationCount = 0;
+  countAllocations = true;
+  for (int round = 0; round < 200; round++) {
+    for (size_t i = 0; i < kRequestCount; i++) {
+      int code = exchange(fd, kRequests[i]);
+      if (code != kCodes[i]) {
+        countAllocations = false;
+        TEST_ASSERT_EQUAL(kCodes[i], code);
+      }
+    }
+  }
+  countAllocations = false;
+  TEST_ASSERT_EQUAL_UINT32(0, allocationCount);
+  TEST_ASSERT_EQUAL_UINT32(0, server->arena().overflowCount());
+  TEST_ASSERT_EQUAL_UINT32(0, server->heapBufferCount());
+  TEST_ASSERT_EQUAL_UINT32(0, server->arena().used());
+  TEST_ASSERT_TRUE(server->arena().highWater() > 0);
+  TEST_ASSERT_EQUAL_UINT32(1 + 201 * 2, api->version);
+  TEST_ASSERT_EQUAL_UINT32(201 * 2, api->commands);
+  TEST_ASSERT_EQUAL(0, api->locked);
+  close(fd);
+}
+
+void test_new_connections_do_not_allocate() {
+  // Соединение на каждый запрос, как у браузера без keep-alive
+  int fd;
+  for (size_t i = 0; i < kRequestCount; i++) {
+    fd = connectClient();
+    TEST_ASSERT_EQUAL(kCodes[i], exchange(fd, kRequests[i]));
+    close(fd);
+  }
+
+  allocationCount = 0;
+  countAllocations = true;
+  for (int round = 0; round < 50; round++) {
+    for (size_t i = 0; i < kRequestCount; i++) {
+      fd = connectClient();
+      int code = exchange(fd, kRequests[i]);
+      close(fd);
+      if (code != kCodes[i]) {
+        countAllocations = false;
+        TEST_ASSERT_EQUAL(kCodes[i], code);
+      }
+    }
+  }
+  countAllocations = false;
+  TEST_ASSERT_EQUAL_UINT32(0, allocationCount);
+  TEST_ASSERT_EQUAL_UINT32(0, server->arena().overflowCount());
+  TEST_ASSERT_EQUAL_UINT32(50 * kRequestCount, server->acceptedCount() - kRequestCount);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_responses);
+  RUN_TEST(test_oversized_sync_is_rejected);
+  RUN_TEST(test_keep_alive_requests_do_not_allocate);
+  RUN_TEST(test_new_connections_do_not_allocate);
+  exit(UNITY_END());
+}
+
+void loop() {}
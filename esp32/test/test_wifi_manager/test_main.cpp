@@ -0,0 +1,331 @@
+// Менеджер WiFi на симуляторе драйвера: события приходят от теста,
+// время — аргумент tick(), случайные числа задаются тестом.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+
+#include "wifi_manager.h"
+
+class SimWiFiDriver : public WiFiDriver {
+public:
+  void begin(const WiFiNetwork &network, int32_t channel, const uint8_t *bssid) override {
+    begins++;
+    lastNetwork = network;
+    lastChannel = channel;
+    lastFast = bssid != nullptr;
+    if (bssid != nullptr) {
+      memcpy(lastBssid, bssid, sizeof(lastBssid));
+    }
+  }
+  void disconnect() override { disconnects++; }
+  bool currentAp(uint8_t bssid[6], int32_t &channel) override {
+    memcpy(bssid, apBssid, sizeof(apBssid));
+    channel = apChannel;
+    return true;
+  }
+  uint32_t random() override { return nextRandom; }
+
+  uint32_t begins = 0;
+  uint32_t disconnects = 0;
+  WiFiNetwork lastNetwork = {};
+  int32_t lastChannel = -1;
+  bool lastFast = false;
+  uint8_t lastBssid[6] = {0};
+
+  // Точка доступа, к которой "подключились"
+  uint8_t apBssid[6] = {0x24, 0x0a, 0xc4, 0x01, 0x02, 0x03};
+  int32_t apChannel = 6;
+  uint32_t nextRandom = 0;
+};
+
+static SimWiFiDriver *driver;
+static WiFiManager *wifi;
+
+static WiFiNetwork network(const char *ssid, const char *pass = "secret", uint8_t lastOctet = 0) {
+  WiFiNetwork net = {};
+  strncpy(net.ssid, ssid, sizeof(net.ssid) - 1);
+  strncpy(net.pass, pass, sizeof(net.pass) - 1);
+  if (lastOctet != 0) {
+    net.staticIp = 1;
+    uint8_t ip[4] = {192, 168, 1, lastOctet};
+    memcpy(net.ip, ip, 4);
+  }
+  return net;
+}
+
+// Подключение с нуля: полное сканирование и адрес
+static void connect(uint32_t nowMs) {
+  wifi->start(nowMs);
+  wifi->onEvent(WiFiLinkEvent::Connected);
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  TEST_ASSERT_EQUAL_UINT32(WiFiManager::kNoDeadline, wifi->tick(nowMs + 100));
+  TEST_ASSERT_TRUE(wifi->connected());
+}
+
+void setUp() {
+  driver = new SimWiFiDriver();
+  wifi = new WiFiManager(*driver);
+  wifi->setNetwork(network("home"));
+}
+
+void tearDown() {
+  delete wifi;
+  delete driver;
+}
+
+// ---- подключение и кэш точки доступа ----
+
+void test_first_connect_scans_and_caches_ap() {
+  wifi->start(0);
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  TEST_ASSERT_FALSE(driver->lastFast);
+  TEST_ASSERT_EQUAL_INT32(0, driver->lastChannel);
+  TEST_ASSERT_EQUAL_UINT32(WiFiManager::kConnectTimeoutMs - 100, wifi->tick(100));
+
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  TEST_ASSERT_EQUAL_UINT32(WiFiManager::kNoDeadline, wifi->tick(200));
+  TEST_ASSERT_TRUE(wifi->connected());
+  TEST_ASSERT_TRUE(wifi->hasCachedAp());
+}
+
+void test_link_loss_reconnects_to_cached_ap_without_scan() {
+  connect(0);
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  TEST_ASSERT_EQUAL_UINT32(WiFiManager::kFastConnectTimeoutMs, wifi->tick(1000));
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  TEST_ASSERT_EQUAL_UINT32(1, wifi->reconnectCount());
+  TEST_ASSERT_TRUE(driver->lastFast);
+  TEST_ASSERT_EQUAL_INT32(6, driver->lastChannel);
+  TEST_ASSERT_EQUAL_MEMORY(driver->apBssid, driver->lastBssid, 6);
+}
+
+void test_fast_connect_timeout_falls_back_to_scan_at_once() {
+  connect(0);
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(1000);
+  uint32_t begins = driver->begins;
+  // Точка доступа сменила канал: быстрая попытка истекает
+  wifi->tick(1000 + WiFiManager::kFastConnectTimeoutMs);
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  TEST_ASSERT_EQUAL_UINT32(begins + 1, driver->begins);
+  TEST_ASSERT_FALSE(driver->lastFast);
+  TEST_ASSERT_FALSE(wifi->hasCachedAp());
+  TEST_ASSERT_EQUAL_UINT32(1, driver->disconnects);
+  TEST_ASSERT_EQUAL_UINT32(0, wifi->attempt());
+
+  // Новый канал запоминается после подключения. События на
+  // disconnect() во время сканирования драйвер не прислал — следующий
+  // обрыв всё равно замечается
+  driver->apChannel = 11;
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  wifi->tick(6000);
+  TEST_ASSERT_TRUE(wifi->hasCachedAp());
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(7000);
+  TEST_ASSERT_EQUAL_INT32(11, driver->lastChannel);
+}
+
+void test_new_credentials_drop_cached_ap() {
+  connect(0);
+  // Та же сеть, другая адресация — точка доступа та же
+  wifi->setNetwork(network("home", "secret", 50));
+  TEST_ASSERT_TRUE(wifi->hasCachedAp());
+  wifi->setNetwork(network("home", "other"));
+  TEST_ASSERT_FALSE(wifi->hasCachedAp());
+  wifi->setNetwork(network("home"));
+  connect(1000);
+  wifi->setNetwork(network("office"));
+  TEST_ASSERT_FALSE(wifi->hasCachedAp());
+}
+
+// ---- задержка между попытками ----
+
+void test_backoff_doubles_with_equal_jitter_and_caps() {
+  wifi->start(0);
+  uint32_t nowMs = 0;
+  for (uint32_t attempt = 0; attempt < 12; attempt++) {
+    // Младшая половина задержки фиксирована: random() = 0 — ровно половина
+    driver->nextRandom = 0;
+    nowMs += WiFiManager::kConnectTimeoutMs;
+    uint32_t delayMs = wifi->tick(nowMs);
+    uint64_t full = (uint64_t)WiFiManager::kBackoffBaseMs << attempt;
+    if (full > WiFiManager::kBackoffMaxMs) {
+      full = WiFiManager::kBackoffMaxMs;
+    }
+    TEST_ASSERT_EQUAL(WiFiManager::BACKOFF, wifi->state());
+    TEST_ASSERT_EQUAL_UINT32(attempt + 1, wifi->attempt());
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)full / 2, delayMs);
+    // Пока задержка не истекла, новой попытки нет
+    uint32_t begins = driver->begins;
+    wifi->tick(nowMs + delayMs - 1);
+    TEST_ASSERT_EQUAL_UINT32(begins, driver->begins);
+    nowMs += delayMs;
+    TEST_ASSERT_EQUAL_UINT32(WiFiManager::kConnectTimeoutMs, wifi->tick(nowMs));
+    TEST_ASSERT_EQUAL_UINT32(begins + 1, driver->begins);
+  }
+}
+
+void test_backoff_jitter_stays_within_bounds() {
+  wifi->start(0);
+  // Третья неудача: полная задержка 2000 мс, случайная половина 0..1000
+  uint32_t nowMs = 0;
+  for (int i = 0; i < 2; i++) {
+    nowMs += WiFiManager::kConnectTimeoutMs;
+    nowMs += wifi->tick(nowMs);
+    wifi->tick(nowMs);
+  }
+  driver->nextRandom = 1000;
+  nowMs += WiFiManager::kConnectTimeoutMs;
+  TEST_ASSERT_EQUAL_UINT32(2000, wifi->tick(nowMs));
+  nowMs += 2000;
+  wifi->tick(nowMs);
+  // Остаток от деления держит задержку в пределах при любом random()
+  driver->nextRandom = 0xFFFFFFFF;
+  nowMs += WiFiManager::kConnectTimeoutMs;
+  uint32_t delayMs = wifi->tick(nowMs);
+  TEST_ASSERT_TRUE(delayMs >= 2000 && delayMs <= 4000);
+}
+
+void test_own_disconnect_is_not_a_link_loss() {
+  wifi->start(0);
+  wifi->tick(WiFiManager::kConnectTimeoutMs);
+  TEST_ASSERT_EQUAL(WiFiManager::BACKOFF, wifi->state());
+  TEST_ASSERT_EQUAL_UINT32(1, driver->disconnects);
+  wifi->tick(WiFiManager::kConnectTimeoutMs + 250);
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  // Событие от нашего disconnect() приходит уже во время новой попытки
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(WiFiManager::kConnectTimeoutMs + 300);
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  TEST_ASSERT_EQUAL_UINT32(1, wifi->attempt());
+  // Настоящий отказ — следующая задержка
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(WiFiManager::kConnectTimeoutMs + 400);
+  TEST_ASSERT_EQUAL(WiFiManager::BACKOFF, wifi->state());
+  TEST_ASSERT_EQUAL_UINT32(2, wifi->attempt());
+}
+
+void test_success_resets_backoff() {
+  wifi->start(0);
+  uint32_t nowMs = 0;
+  for (int i = 0; i < 4; i++) {
+    nowMs += WiFiManager::kConnectTimeoutMs;
+    nowMs += wifi->tick(nowMs);
+    wifi->tick(nowMs);
+  }
+  TEST_ASSERT_EQUAL_UINT32(4, wifi->attempt());
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  wifi->tick(nowMs + 10);
+  TEST_ASSERT_TRUE(wifi->connected());
+  TEST_ASSERT_EQUAL_UINT32(0, wifi->attempt());
+}
+
+void test_last_event_wins_within_one_tick() {
+  wifi->start(0);
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  wifi->tick(100);
+  TEST_ASSERT_TRUE(wifi->connected());
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(200);
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  TEST_ASSERT_EQUAL_UINT32(1, wifi->reconnectCount());
+}
+
+// ---- проба новой сети ----
+
+void test_trial_applies_new_network() {
+  connect(0);
+  wifi->tryNetwork(network("office", "pass2"), 1000);
+  TEST_ASSERT_EQUAL(WiFiManager::TRIAL_RUNNING, wifi->trialState());
+  TEST_ASSERT_EQUAL_STRING("office", driver->lastNetwork.ssid);
+  TEST_ASSERT_FALSE(driver->lastFast);
+  // Отключение от прежней сети — наше, проба продолжается
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(1100);
+  TEST_ASSERT_EQUAL(WiFiManager::TRIAL_RUNNING, wifi->trialState());
+
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  wifi->tick(3500);
+  TEST_ASSERT_EQUAL(WiFiManager::TRIAL_APPLIED, wifi->trialState());
+  TEST_ASSERT_EQUAL_STRING("office", wifi->network().ssid);
+  TEST_ASSERT_EQUAL_UINT32(2500, wifi->trialDowntimeMs());
+  TEST_ASSERT_EQUAL_UINT32(1, wifi->appliedCount());
+  TEST_ASSERT_EQUAL_UINT32(0, wifi->rolledBackCount());
+}
+
+void test_trial_of_addressing_keeps_cached_ap() {
+  connect(0);
+  wifi->tryNetwork(network("home", "secret", 77), 1000);
+  TEST_ASSERT_TRUE(driver->lastFast);
+  TEST_ASSERT_EQUAL_INT32(6, driver->lastChannel);
+  TEST_ASSERT_EQUAL_UINT8(77, driver->lastNetwork.ip[3]);
+}
+
+void test_trial_timeout_rolls_back_to_previous_ap() {
+  connect(0);
+  wifi->tryNetwork(network("office", "wrong"), 1000);
+  uint32_t disconnects = driver->disconnects;
+  // Новая сеть молчит: после тайм-аута — прежняя по сохранённой точке
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(1000 + WiFiManager::kConnectTimeoutMs);
+  TEST_ASSERT_EQUAL(WiFiManager::TRIAL_ROLLED_BACK, wifi->trialState());
+  TEST_ASSERT_EQUAL_UINT32(disconnects + 1, driver->disconnects);
+  TEST_ASSERT_EQUAL_STRING("home", driver->lastNetwork.ssid);
+  TEST_ASSERT_TRUE(driver->lastFast);
+  TEST_ASSERT_EQUAL_MEMORY(driver->apBssid, driver->lastBssid, 6);
+  TEST_ASSERT_EQUAL_UINT32(0, wifi->attempt());
+  TEST_ASSERT_EQUAL_STRING("home", wifi->network().ssid);
+
+  // Простой считается до адреса в прежней сети
+  TEST_ASSERT_EQUAL_UINT32(0, wifi->trialDowntimeMs());
+  wifi->onEvent(WiFiLinkEvent::GotIp);
+  wifi->tick(1000 + WiFiManager::kConnectTimeoutMs + 800);
+  TEST_ASSERT_TRUE(wifi->connected());
+  TEST_ASSERT_EQUAL_UINT32(WiFiManager::kConnectTimeoutMs + 800, wifi->trialDowntimeMs());
+  TEST_ASSERT_EQUAL_UINT32(1, wifi->rolledBackCount());
+  TEST_ASSERT_EQUAL_UINT32(0, wifi->appliedCount());
+}
+
+void test_trial_rejected_rolls_back_at_once() {
+  connect(0);
+  wifi->tryNetwork(network("office", "wrong"), 1000);
+  uint32_t disconnects = driver->disconnects;
+  wifi->onEvent(WiFiLinkEvent::Disconnected); // прежняя сеть (наше)
+  wifi->tick(1100);
+  wifi->onEvent(WiFiLinkEvent::Disconnected); // отказ новой сети
+  wifi->tick(1600);
+  TEST_ASSERT_EQUAL(WiFiManager::TRIAL_ROLLED_BACK, wifi->trialState());
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  // Драйвер и так отключён — лишнего disconnect() нет
+  TEST_ASSERT_EQUAL_UINT32(disconnects, driver->disconnects);
+  TEST_ASSERT_EQUAL_STRING("home", driver->lastNetwork.ssid);
+  // Дальше — обычные попытки без новой пробы
+  wifi->onEvent(WiFiLinkEvent::Disconnected);
+  wifi->tick(1700);
+  TEST_ASSERT_EQUAL(WiFiManager::CONNECTING, wifi->state());
+  TEST_ASSERT_FALSE(driver->lastFast);
+  TEST_ASSERT_EQUAL_UINT32(1, wifi->rolledBackCount());
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_connect_scans_and_caches_ap);
+  RUN_TEST(test_link_loss_reconnects_to_cached_ap_without_scan);
+  RUN_TEST(test_fast_connect_timeout_falls_back_to_scan_at_once);
+  RUN_TEST(test_new_credentials_drop_cached_ap);
+  RUN_TEST(test_backoff_doubles_with_equal_jitter_and_caps);
+  RUN_TEST(test_backoff_jitter_stays_within_bounds);
+  RUN_TEST(test_own_disconnect_is_not_a_link_loss);
+  RUN_TEST(test_success_resets_backoff);
+  RUN_TEST(test_last_event_wins_within_one_tick);
+  RUN_TEST(test_trial_applies_new_network);
+  RUN_TEST(test_trial_of_addressing_keeps_cached_ap);
+  RUN_TEST(test_trial_timeout_rolls_back_to_previous_ap);
+  RUN_TEST(test_trial_rejected_rolls_back_at_once);
+  exit(UNITY_END());
+}
+
+void loop() {}
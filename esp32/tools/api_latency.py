@@ -0,0 +1,166 @@
+"""Задержка ответов JSON API прошивки (env:native или плата).
+
+Без --url запускает прошивку под Linux, заводит будильники (чтобы
+расписание и календарь были не пустыми) и по очереди шлёт запросы к
+маршрутам JSON API — как страница: новое соединение на каждый запрос.
+Проверяется:
+- все ответы 200 и разбираются как JSON;
+- медиана задержки каждого маршрута со стороны клиента — меньше
+  --limit-ms (10 мс);
+- медиана обработки по /api/stats/routes — тоже.
+С --url мерит устройство и будильники не заводит.
+
+    pio run -e native
+    python3 tools/api_latency.py --program .pio/build/native/program
+    python3 tools/api_latency.py --url http://192.168.1.57 --requests 50
+
+Код возврата 1 — проверка не прошла.
+"""
+
+import argparse
+import http.client
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.parse
+
+# (метод, путь, маршрут в /api/stats/routes)
+ROUTES = [
+    ("GET", "/api/time", "GET /api/time"),
+    ("GET", "/api/wifi/status", "GET /api/wifi/status"),
+    ("GET", "/api/audio/status", "GET /api/audio/status"),
+    ("GET", "/api/alarms", "GET /api/alarms"),
+    ("GET", "/api/schedule?date=2026-10-12", "GET /api/schedule"),
+    ("GET", "/api/calendar?month=2026-10", "GET /api/calendar"),
+    ("GET", "/api/config", "GET /api/config"),
+    ("GET", "/api/boot", "GET /api/boot"),
+    ("GET", "/api/journal?limit=32", "GET /api/journal"),
+]
+
+
+class Device:
+    def __init__(self, host, port, program=None):
+        self.host = host
+        self.port = port
+        self.process = None
+        self.fs = None
+        if program is not None:
+            self.fs = tempfile.TemporaryDirectory()
+            env = dict(os.environ, GONG_FS_DIR=self.fs.name, GONG_HTTP_PORT=str(port))
+            self.process = subprocess.Popen([program], env=env, stdout=subprocess.DEVNULL,
+                                            stderr=subprocess.DEVNULL)
+
+    def request(self, method, path, body=None, content_type=None):
+        """(статус, тело, секунды от подключения до конца ответа)."""
+        headers = {"Content-Type": content_type} if content_type else {}
+        start = time.perf_counter()
+        connection = http.client.HTTPConnection(self.host, self.port, timeout=5)
+        try:
+            connection.request(method, path, body=body, headers=headers)
+            response = connection.getresponse()
+            data = response.read().decode()
+            return response.status, data, time.perf_counter() - start
+        finally:
+            connection.close()
+
+    def wait_ready(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                if json.loads(self.request("GET", "/api/wifi/status")[1])["connected"]:
+                    return
+            except OSError:
+                pass
+            time.sleep(0.2)
+        raise SystemExit("устройство не подключилось к WiFi")
+
+    def add_alarms(self, count):
+        for i in range(count):
+            body = json.dumps({"time": "%02d:%02d" % (6 + i % 12, (i * 7) % 60), "days": [0, 1, 2, 3, 4],
+                               "duration": 10, "track": 1 + i % 5, "active": True})
+            self.request("POST", "/api/alarms", body, "application/json")
+
+    def stop(self):
+        if self.process is not None:
+            self.process.terminate()
+            self.process.wait()
+            self.fs.cleanup()
+
+
+class Checks:
+    def __init__(self):
+        self.failed = 0
+
+    def expect(self, ok, text):
+        print("%-4s %s" % ("OK" if ok else "FAIL", text))
+        if not ok:
+            self.failed += 1
+
+
+def median(values):
+    ordered = sorted(values)
+    return ordered[len(ordered) // 2] if ordered else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8098)
+    parser.add_argument("--url", help="устройство, например http://192.168.1.57; прошивка не запускается")
+    parser.add_argument("--requests", type=int, default=200, help="запросов на маршрут")
+    parser.add_argument("--alarms", type=int, default=40, help="сколько будильников завести")
+    parser.add_argument("--limit-ms", type=float, default=10.0)
+    args = parser.parse_args()
+
+    checks = Checks()
+    if args.url:
+        parsed = urllib.parse.urlparse(args.url)
+        device = Device(parsed.hostname, parsed.port or 80)
+    else:
+        device = Device("127.0.0.1", args.port, args.program)
+    try:
+        device.wait_ready()
+        if not args.url:
+            device.add_alarms(args.alarms)
+        measured = []
+        for method, path, route in ROUTES:
+            latencies = []
+            bad = []
+            for _ in range(args.requests):
+                status, body, seconds = device.request(method, path)
+                latencies.append(seconds * 1000)
+                try:
+                    json.loads(body)
+                except ValueError:
+                    status = "не JSON"
+                if status != 200:
+                    bad.append(status)
+            measured.append((route, latencies, bad))
+        stats = json.loads(device.request("GET", "/api/stats/routes")[1])["routes"]
+    finally:
+        device.stop()
+
+    server = {stat["route"]: stat for stat in stats}
+    print("%-24s %10s %10s %10s %12s" % ("маршрут", "p50, мс", "p99, мс", "макс, мс", "сервер p50"))
+    for route, latencies, bad in measured:
+        ordered = sorted(latencies)
+        p50 = median(latencies)
+        p99 = ordered[min(len(ordered) - 1, int(len(ordered) * 0.99))]
+        stat = server.get(route)
+        server_p50 = stat["p50_us"] / 1000 if stat else None
+        print("%-24s %10.3f %10.3f %10.3f %12s" % (route, p50, p99, ordered[-1],
+                                                   "%.3f" % server_p50 if server_p50 is not None else "-"))
+        checks.expect(not bad, "%s: ответы 200 с JSON%s" % (route, ": %s" % bad[:3] if bad else ""))
+        checks.expect(p50 < args.limit_ms, "%s: медиана %.3f мс < %.0f мс" % (route, p50, args.limit_ms))
+        checks.expect(stat is not None and stat["count"] >= args.requests and server_p50 < args.limit_ms,
+                      "%s: в /api/stats/routes медиана обработки < %.0f мс" % (route, args.limit_ms))
+
+    print("проверок не прошло: %d" % checks.failed)
+    return 1 if checks.failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
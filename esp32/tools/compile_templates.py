@@ -0,0 +1,143 @@
+"""Разбор HTML-шаблонов из templates/ при сборке.
+
+Шаблон превращается в массив сегментов (см. src/template_renderer.h):
+литералы, слоты {{name}} и секции {{#name}}...{{/name}}. Имена слотов
+всех шаблонов собираются в общее перечисление TemplateSlot.
+Результат — src/web_templates.h.
+
+Запускается PlatformIO перед сборкой (extra_scripts = pre:...),
+можно запустить и вручную: python3 tools/compile_templates.py
+"""
+
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 — определено в SCons
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+TEMPLATES_DIR = os.path.join(PROJECT_DIR, "templates")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "web_templates.h")
+
+TAG = re.compile(r"\{\{([#/]?)([a-z_][a-z0-9_]*)\}\}\n?")
+
+
+def c_string(text):
+    data = text.encode("utf-8")
+    out = []
+    for b in data:
+        if b == 0x22:
+            out.append('\\"')
+        elif b == 0x5C:
+            out.append("\\\\")
+        elif b == 0x0A:
+            out.append("\\n")
+        elif 0x20 <= b < 0x7F:
+            out.append(chr(b))
+        else:
+            out.append("\\%03o" % b)
+    return '"' + "".join(out) + '"', len(data)
+
+
+def parse(name, source, slots):
+    segments = []
+    open_sections = []
+    pos = 0
+    # Номер первого сегмента, с которым ещё можно склеивать литералы:
+    # границы секций склейку запрещают
+    boundary = [0]
+
+    # Соседние литералы склеиваются сразу
+    def add_literal(text):
+        if not text:
+            return
+        if len(segments) > boundary[0] and segments[-1][0] == "TEMPLATE_LITERAL":
+            segments[-1][2] += text
+        else:
+            segments.append(["TEMPLATE_LITERAL", None, text])
+
+    for match in TAG.finditer(source):
+        kind, slot = match.group(1), match.group(2)
+        add_literal(source[pos:match.start()])
+        pos = match.end()
+        if slot not in slots:
+            slots.append(slot)
+        if kind == "#":
+            open_sections.append((slot, len(segments)))
+            segments.append(["TEMPLATE_SECTION", slot, 0])
+        elif kind == "/":
+            if not open_sections or open_sections[-1][0] != slot:
+                raise SystemExit("%s: непарный {{/%s}}" % (name, slot))
+            _, start = open_sections.pop()
+            segments[start][2] = len(segments) - start - 1
+        else:
+            segments.append(["TEMPLATE_SLOT", slot, None])
+            # Перевод строки съедается только после тегов секций
+            if match.group(0).endswith("\n"):
+                add_literal("\n")
+        if kind:
+            boundary[0] = len(segments)
+    if open_sections:
+        raise SystemExit("%s: не закрыта секция {{#%s}}" % (name, open_sections[-1][0]))
+    add_literal(source[pos:])
+    return segments
+
+
+def slot_enum(slot):
+    return "SLOT_" + slot.upper()
+
+
+def render(templates, slots):
+    lines = [
+        "// Сгенерировано tools/compile_templates.py из templates/ — не редактировать вручную",
+        "#pragma once",
+        "",
+        '#include "template_renderer.h"',
+        "",
+        "enum TemplateSlot : uint8_t {",
+    ]
+    for slot in slots:
+        lines.append("  %s," % slot_enum(slot))
+    lines.append("  SLOT_COUNT")
+    lines.append("};")
+    lines.append("")
+    for name, segments in templates:
+        symbol = "kTemplate_" + name
+        lines.append("static const TemplateSegment %sSegments[] = {" % symbol)
+        for kind, slot, value in segments:
+            if kind == "TEMPLATE_LITERAL":
+                text, length = c_string(value)
+                lines.append("  {TEMPLATE_LITERAL, 0, %s, %d}," % (text, length))
+            elif kind == "TEMPLATE_SLOT":
+                lines.append("  {TEMPLATE_SLOT, %s, nullptr, 0}," % slot_enum(slot))
+            else:
+                lines.append("  {TEMPLATE_SECTION, %s, nullptr, %d}," % (slot_enum(slot), value))
+        lines.append("};")
+        lines.append("static const WebTemplate %s = {%sSegments, %d};" % (symbol, symbol, len(segments)))
+        lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    slots = []
+    templates = []
+    for filename in sorted(os.listdir(TEMPLATES_DIR)):
+        if not filename.endswith(".html"):
+            continue
+        with open(os.path.join(TEMPLATES_DIR, filename), "r", encoding="utf-8") as f:
+            source = f.read()
+        name = os.path.splitext(filename)[0]
+        templates.append((name, parse(filename, source, slots)))
+    output = render(templates, slots)
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, "r", encoding="utf-8") as f:
+            if f.read() == output:
+                return
+    with open(OUTPUT, "w", encoding="utf-8") as f:
+        f.write(output)
+    print("compile_templates: %s" % OUTPUT)
+
+
+main()
@@ -0,0 +1,129 @@
+"""Встраивание веб-ресурсов из data/ в прошивку.
+
+Каждый файл сжимается gzip и превращается в массив байт во flash
+(src/web_assets.h). ETag — хэш содержимого. Ссылки из HTML на
+другие ресурсы получают суффикс ?v=<хэш>, поэтому такие ресурсы
+можно кэшировать в браузере бессрочно.
+
+Запускается PlatformIO перед сборкой (extra_scripts = pre:...),
+можно запустить и вручную: python3 tools/embed_assets.py
+"""
+
+import gzip
+import hashlib
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 — определено в SCons
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+DATA_DIR = os.path.join(PROJECT_DIR, "data")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "web_assets.h")
+
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "application/javascript; charset=utf-8",
+    ".css": "text/css; charset=utf-8",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+# Файлы, которые отдаются по другому адресу
+ROUTES = {
+    "home.html": "/",
+}
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def symbol_name(name):
+    return "kAsset_" + re.sub(r"[^0-9A-Za-z]", "_", name)
+
+
+def load_assets():
+    assets = []
+    for name in sorted(os.listdir(DATA_DIR)):
+        path = os.path.join(DATA_DIR, name)
+        ext = os.path.splitext(name)[1]
+        if name.startswith(".") or not os.path.isfile(path) or ext not in CONTENT_TYPES:
+            continue
+        with open(path, "rb") as f:
+            raw = f.read()
+        assets.append({"name": name, "ext": ext, "raw": raw})
+
+    # Хэши не-HTML ресурсов нужны до обработки HTML, который на них ссылается
+    for asset in assets:
+        if asset["ext"] != ".html":
+            asset["hash"] = content_hash(asset["raw"])
+    for asset in assets:
+        if asset["ext"] == ".html":
+            text = asset["raw"].decode("utf-8")
+            for other in assets:
+                if other["ext"] == ".html":
+                    continue
+                pattern = r'((?:src|href)=["\']/?)' + re.escape(other["name"]) + r'(["\'])'
+                text = re.sub(pattern, r"\g<1>" + other["name"] + "?v=" + other["hash"][:8] + r"\g<2>", text)
+            asset["raw"] = text.encode("utf-8")
+            asset["hash"] = content_hash(asset["raw"])
+
+    for asset in assets:
+        asset["gzip"] = gzip.compress(asset["raw"], 9, mtime=0)
+        asset["path"] = ROUTES.get(asset["name"], "/" + asset["name"])
+    return assets
+
+
+def render(assets):
+    lines = [
+        "// Сгенерировано tools/embed_assets.py из data/ — не редактировать вручную",
+        "#pragma once",
+        "",
+        '#include "web_asset.h"',
+        "",
+    ]
+    for asset in assets:
+        data = asset["gzip"]
+        lines.append("// %s: %d -> %d байт" % (asset["name"], len(asset["raw"]), len(data)))
+        lines.append("static const uint8_t %s[] PROGMEM = {" % symbol_name(asset["name"]))
+        for i in range(0, len(data), 16):
+            lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("static const WebAsset kWebAssets[] = {")
+    for asset in assets:
+        lines.append('  {"%s", "GET %s", "%s", "\\"%s\\"", %s, sizeof(%s), %s},' % (
+            asset["path"],
+            asset["path"],
+            CONTENT_TYPES[asset["ext"]],
+            asset["hash"],
+            symbol_name(asset["name"]),
+            symbol_name(asset["name"]),
+            "false" if asset["ext"] == ".html" else "true",
+        ))
+    lines.append("};")
+    lines.append("")
+    lines.append("#define WEB_ASSET_COUNT (sizeof(kWebAssets) / sizeof(kWebAssets[0]))")
+    lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    output = render(load_assets())
+    os.makedirs(os.path.dirname(OUTPUT), exist_ok=True)
+    # Не трогаем файл без изменений, чтобы не пересобирать зависимых
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, "r", encoding="utf-8") as f:
+            if f.read() == output:
+                return
+    with open(OUTPUT, "w", encoding="utf-8") as f:
+        f.write(output)
+    print("embed_assets: %s" % OUTPUT)
+
+
+main()
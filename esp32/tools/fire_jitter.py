@@ -0,0 +1,194 @@
+"""Опоздание ударов относительно расписания при нагрузке на HTTP (env:native).
+
+Запускает прошивку под Linux, ставит серию групповых ударов без нагрузки,
+затем такую же серию, пока несколько потоков непрерывно запрашивают
+календарь, список будильников, метрики и создают/удаляют будильники.
+Опоздание каждого удара прошивка сама пишет в гистограмму
+gong_fire_late_seconds{source="group"}; скрипт сравнивает её прирост
+за обе серии. На хосте приоритеты задач не моделируются, поэтому
+результат — верхняя оценка: на плате TimingTask вытесняет HTTP.
+
+    pio run -e native
+    python3 tools/fire_jitter.py --program .pio/build/native/program
+
+Код возврата 1 — удар не прозвучал или p99 опоздания под нагрузкой
+больше --max-p99-ms.
+"""
+
+import argparse
+import http.client
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+BUCKET_RE = re.compile(r'^gong_fire_late_seconds_bucket\{source="group",le="([^"]+)"\} (\d+)')
+SUM_RE = re.compile(r'^gong_fire_late_seconds_sum\{source="group"\} ([0-9.]+)')
+
+
+class Device:
+    def __init__(self, program, port):
+        self.base = "http://127.0.0.1:%d" % port
+        self.port = port
+        self.fs = tempfile.TemporaryDirectory()
+        env = dict(os.environ, GONG_FS_DIR=self.fs.name, GONG_HTTP_PORT=str(port))
+        self.process = subprocess.Popen([program], env=env, stdout=subprocess.DEVNULL,
+                                        stderr=subprocess.DEVNULL)
+
+    def request(self, method, path, body=None):
+        data = body.encode() if body is not None else (b"" if method == "POST" else None)
+        request = urllib.request.Request(self.base + path, data=data, method=method,
+                                         headers={"Content-Type": "application/json"} if body else {})
+        with urllib.request.urlopen(request, timeout=5) as response:
+            return json.loads(response.read().decode() or "{}")
+
+    def wait_ready(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                if self.request("GET", "/api/audio/status").get("online"):
+                    return
+            except OSError:
+                pass
+            time.sleep(0.2)
+        raise SystemExit("устройство не ответило")
+
+    def histogram(self):
+        """Корзины (граница в мс, накопленное число) и сумма опозданий в мс."""
+        with urllib.request.urlopen(self.base + "/api/metrics", timeout=5) as response:
+            text = response.read().decode()
+        buckets, total = [], 0.0
+        for line in text.splitlines():
+            match = BUCKET_RE.match(line)
+            if match:
+                le = float("inf") if match.group(1) == "+Inf" else float(match.group(1)) * 1000
+                buckets.append((le, int(match.group(2))))
+            match = SUM_RE.match(line)
+            if match:
+                total = float(match.group(1)) * 1000
+        return buckets, total
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+        self.fs.cleanup()
+
+
+def delta(before, after):
+    buckets = [(le, count - before[0][i][1]) for i, (le, count) in enumerate(after[0])]
+    return buckets, after[1] - before[1]
+
+
+def percentile(buckets, percent):
+    """Верхняя граница корзины, в которую попадает перцентиль."""
+    count = buckets[-1][1] if buckets else 0
+    for le, cumulative in buckets:
+        if count and cumulative * 100 >= count * percent:
+            return le
+    return 0.0
+
+
+def load_worker(port, stop, counts, index):
+    paths = ["/api/calendar?month=2026-01", "/api/alarms", "/api/metrics", "/api/schedule?date=2026-01-05"]
+    alarm = json.dumps({"time": "03:00", "days": [1, 2, 3], "duration": 5, "track": 1, "active": True})
+    connection = None
+    step = index
+    while not stop.is_set():
+        try:
+            if connection is None:
+                connection = http.client.HTTPConnection("127.0.0.1", port, timeout=5)
+            if step % 8 == 7:
+                connection.request("POST", "/api/alarms", alarm, {"Content-Type": "application/json"})
+                created = json.loads(connection.getresponse().read() or b"{}")
+                if "id" in created:
+                    connection.request("DELETE", "/api/alarms/%d" % created["id"])
+                    connection.getresponse().read()
+            else:
+                connection.request("GET", paths[step % len(paths)])
+                connection.getresponse().read()
+            counts[index] += 1
+        except (OSError, http.client.HTTPException):
+            connection = None
+        step += 1
+
+
+def warm_up(device, args):
+    """Сокет группы открывается после подключения WiFi: ждём первый удар."""
+    deadline = time.monotonic() + 10
+    while time.monotonic() < deadline:
+        device.request("POST", "/api/group/play?num=1&delay_ms=%d" % args.delay_ms)
+        time.sleep((args.delay_ms + args.gap_ms) / 1000.0)
+        buckets, _ = device.histogram()
+        if buckets and buckets[-1][1] > 0:
+            return
+    raise SystemExit("групповые удары не доходят")
+
+
+def series(device, args, name):
+    before = device.histogram()
+    for _ in range(args.strikes):
+        device.request("POST", "/api/group/play?num=2&delay_ms=%d" % args.delay_ms)
+        time.sleep((args.delay_ms + args.gap_ms) / 1000.0)
+    time.sleep(0.5)
+    buckets, total = delta(before, device.histogram())
+    count = buckets[-1][1] if buckets else 0
+    p50 = percentile(buckets, 50)
+    p99 = percentile(buckets, 99)
+    print("%-16s ударов %3d/%d  p50 <= %.2f мс  p99 <= %.2f мс  среднее %.3f мс" %
+          (name, count, args.strikes, p50, p99, total / count if count else 0.0))
+    return count, p99
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8094)
+    parser.add_argument("--strikes", type=int, default=20, help="ударов в каждой серии")
+    parser.add_argument("--delay-ms", type=int, default=200, help="запас от команды до удара")
+    parser.add_argument("--gap-ms", type=int, default=150, help="пауза после удара")
+    parser.add_argument("--clients", type=int, default=8, help="потоков нагрузки")
+    parser.add_argument("--max-p99-ms", type=float, default=10.0)
+    args = parser.parse_args()
+
+    device = Device(args.program, args.port)
+    ok = True
+    try:
+        device.wait_ready()
+        device.request("POST", "/api/config?trigger_key=fire-jitter")
+        warm_up(device, args)
+        count, _ = series(device, args, "без нагрузки")
+        ok = count == args.strikes
+
+        stop = threading.Event()
+        counts = [0] * args.clients
+        workers = [threading.Thread(target=load_worker, args=(args.port, stop, counts, i), daemon=True)
+                   for i in range(args.clients)]
+        started = time.monotonic()
+        for worker in workers:
+            worker.start()
+        try:
+            count, p99 = series(device, args, "под нагрузкой")
+        finally:
+            stop.set()
+            for worker in workers:
+                worker.join()
+        elapsed = time.monotonic() - started
+        print("нагрузка: %d запросов, %.0f в секунду" % (sum(counts), sum(counts) / elapsed))
+        if count != args.strikes:
+            print("часть ударов не прозвучала")
+            ok = False
+        if p99 > args.max_p99_ms:
+            print("p99 под нагрузкой больше %.1f мс" % args.max_p99_ms)
+            ok = False
+    finally:
+        device.stop()
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
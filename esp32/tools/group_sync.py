@@ -0,0 +1,233 @@
+"""Согласованность группового удара нескольких устройств (env:native).
+
+Запускает --devices экземпляров прошивки под Linux с общим ключом
+групповых ударов и журналом поддельного плеера (GONG_DFPLAYER_LOG=1:
+начало звука по часам хоста). Время устройства берут у SNTP-сервера
+этого скрипта на loopback, который отвечает со случайной задержкой до
+--ntp-jitter-ms, — у каждого устройства своя ошибка оценки времени,
+как у плат в одной сети. Затем первое устройство --strikes раз шлёт
+POST /api/group/play, пакет multicast доходит до всех (и до самого
+отправителя), и по журналам сравнивается начало звука:
+- звук есть на каждом устройстве и не раньше момента удара;
+- разброс начала звука между устройствами — не больше --max-spread-ms;
+- опоздание относительно момента удара — не больше --max-late-ms.
+
+    pio run -e native
+    python3 tools/group_sync.py --program .pio/build/native/program --devices 4
+
+Код возврата 1 — проверка не прошла.
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+
+SOUND_RE = re.compile(r"^\[fake_uart\] (\d+\.\d+) sound on track (\d+)")
+NTP_EPOCH = 2208988800
+
+
+def ntp_stamp(unix):
+    seconds = int(unix)
+    return struct.pack("!II", seconds + NTP_EPOCH, int((unix - seconds) * (1 << 32)) & 0xFFFFFFFF)
+
+
+class SntpServer:
+    """SNTP-сервер stratum 2 по часам хоста; ответ задерживается на
+    случайное время — несимметричная задержка, как у WiFi."""
+
+    def __init__(self, port, jitter_ms):
+        self.jitter_ms = jitter_ms
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.socket.bind(("127.0.0.1", port))
+        self.requests = 0
+        threading.Thread(target=self._serve, daemon=True).start()
+
+    def _serve(self):
+        while True:
+            try:
+                data, address = self.socket.recvfrom(512)
+            except OSError:
+                return
+            if len(data) < 48:
+                continue
+            received = time.time()
+            self.requests += 1
+            threading.Thread(target=self._reply, args=(data, address, received), daemon=True).start()
+
+    def _reply(self, request, address, received):
+        time.sleep(random.uniform(0, self.jitter_ms) / 1000.0)
+        reply = bytearray(48)
+        reply[0] = (0 << 6) | (4 << 3) | 4  # LI 0, версия 4, режим сервера
+        reply[1] = 2
+        reply[24:32] = request[40:48]       # originate = transmit запроса
+        reply[32:40] = ntp_stamp(received)
+        reply[40:48] = ntp_stamp(time.time())
+        try:
+            self.socket.sendto(bytes(reply), address)
+        except OSError:
+            pass
+
+    def close(self):
+        self.socket.close()
+
+
+class Device:
+    def __init__(self, program, port, args):
+        self.base = "http://127.0.0.1:%d" % port
+        self.lines = []
+        self.lock = threading.Lock()
+        self.fs = tempfile.TemporaryDirectory()
+        env = dict(os.environ,
+                   GONG_FS_DIR=self.fs.name,
+                   GONG_HTTP_PORT=str(port),
+                   GONG_DFPLAYER_LOG="1",
+                   GONG_DFPLAYER_TRACK_MS="1500",
+                   GONG_DFPLAYER_START_MS=str(args.start_ms),
+                   GONG_DFPLAYER_START_JITTER_MS=str(args.jitter_ms))
+        self.process = subprocess.Popen([program], env=env, stdout=subprocess.PIPE,
+                                        stderr=subprocess.STDOUT, text=True, errors="replace")
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            with self.lock:
+                self.lines.append(line.rstrip("\n"))
+
+    def request(self, method, path, form=None):
+        data = urllib.parse.urlencode(form).encode() if form is not None else (b"" if method == "POST" else None)
+        request = urllib.request.Request(self.base + path, data=data, method=method)
+        try:
+            with urllib.request.urlopen(request, timeout=5) as response:
+                return response.status, json.loads(response.read().decode() or "{}")
+        except urllib.error.HTTPError as error:
+            return error.code, {}
+
+    def wait_online(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                if self.request("GET", "/api/audio/status")[1].get("online"):
+                    return
+            except OSError:
+                pass
+            time.sleep(0.2)
+        raise SystemExit("%s: устройство не ответило" % self.base)
+
+    def wait_sntp(self, timeout):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            status = self.request("GET", "/api/time")[1]
+            if status.get("source") == "sntp":
+                return status
+            time.sleep(0.5)
+        return None
+
+    def first_sound(self, since):
+        with self.lock:
+            lines = list(self.lines)
+        for line in lines:
+            match = SOUND_RE.match(line)
+            if match and float(match.group(1)) >= since:
+                return float(match.group(1)), int(match.group(2))
+        return None, None
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+        self.fs.cleanup()
+
+
+class Checks:
+    def __init__(self):
+        self.failed = 0
+
+    def expect(self, ok, text):
+        print("%-4s %s" % ("OK" if ok else "FAIL", text))
+        if not ok:
+            self.failed += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8120, help="HTTP первого устройства, дальше подряд")
+    parser.add_argument("--devices", type=int, default=4)
+    parser.add_argument("--strikes", type=int, default=5)
+    parser.add_argument("--delay-ms", type=int, default=1500, help="запас delay_ms группового удара")
+    parser.add_argument("--ntp-port", type=int, default=12323)
+    parser.add_argument("--ntp-jitter-ms", type=float, default=4.0)
+    parser.add_argument("--start-ms", type=int, default=150, help="запуск трека в модели плеера")
+    parser.add_argument("--jitter-ms", type=int, default=100, help="разброс запуска трека в модели плеера")
+    parser.add_argument("--max-spread-ms", type=float, default=30.0)
+    parser.add_argument("--max-late-ms", type=float, default=50.0)
+    args = parser.parse_args()
+
+    checks = Checks()
+    ntp = SntpServer(args.ntp_port, args.ntp_jitter_ms)
+    devices = [Device(args.program, args.port + i, args) for i in range(args.devices)]
+    spreads = []
+    try:
+        for device in devices:
+            device.wait_online()
+            device.request("POST", "/api/config", {"trigger_key": "group-sync",
+                                                   "ntp_server": "127.0.0.1:%d" % args.ntp_port})
+        for device in devices:
+            status = device.wait_sntp(30)
+            checks.expect(status is not None, "%s: время по SNTP%s" % (
+                device.base, ", неопределённость %.3f мс" % status["uncertainty_ms"] if status else ""))
+
+        for strike in range(args.strikes):
+            track = 1 + strike % 5
+            for device in devices:
+                device.request("POST", "/api/audio/stop")
+            time.sleep(0.5)
+            since = time.time()
+            status, sent = devices[0].request("POST", "/api/group/play?num=%d&delay_ms=%d" % (track, args.delay_ms))
+            if status != 202:
+                checks.expect(False, "удар %d: POST /api/group/play: HTTP %d" % (strike + 1, status))
+                continue
+            fire_at = sent["fire_at_ms"] / 1000.0
+            time.sleep(max(0.0, fire_at - time.time()) + 0.6)
+
+            starts = []
+            for device in devices:
+                at, played = device.first_sound(since)
+                if at is None or played != track:
+                    checks.expect(False, "удар %d: %s — звука трека %d нет" % (strike + 1, device.base, track))
+                    continue
+                starts.append(at)
+            if len(starts) != len(devices):
+                continue
+            spread = (max(starts) - min(starts)) * 1000
+            early = (fire_at - min(starts)) * 1000
+            late = (max(starts) - fire_at) * 1000
+            spreads.append(spread)
+            checks.expect(spread <= args.max_spread_ms and early <= 0 and late <= args.max_late_ms,
+                          "удар %d: разброс %.1f мс, первый %+.1f мс, последний %+.1f мс от момента удара"
+                          % (strike + 1, spread, -early, late))
+    finally:
+        for device in devices:
+            device.stop()
+        ntp.close()
+
+    if spreads:
+        print("разброс по ударам: медиана %.1f мс, максимум %.1f мс; запросов SNTP: %d"
+              % (sorted(spreads)[len(spreads) // 2], max(spreads), ntp.requests))
+    print("проверок не прошло: %d" % checks.failed)
+    return 1 if checks.failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,121 @@
+"""Пропускная способность и хвост задержек веб-сервера прошивки (env:native).
+
+Держит N соединений keep-alive, каждое шлёт запросы подряд (--pipeline —
+сколько запросов уходит, не дожидаясь ответов), и считает запросы в
+секунду и перцентили задержки. --stalled открывает соединения, которые
+присылают ползапроса и замолкают, — остальные клиенты не должны это
+заметить. --close — новое соединение на каждый запрос.
+
+    pio run -e native
+    GONG_HTTP_PORT=8080 .pio/build/native/program &
+    python3 tools/http_load.py --port 8080 --clients 16 --stalled 4
+"""
+
+import argparse
+import asyncio
+import sys
+import time
+
+
+def percentile(values, percent):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * percent / 100))]
+
+
+async def read_response(reader):
+    head = await reader.readuntil(b"\r\n\r\n")
+    status = int(head.split(b" ", 2)[1])
+    length = 0
+    chunked = False
+    for line in head.split(b"\r\n"):
+        lower = line.lower()
+        if lower.startswith(b"content-length:"):
+            length = int(line.split(b":", 1)[1])
+        elif lower.startswith(b"transfer-encoding:") and b"chunked" in lower:
+            chunked = True
+    if chunked:
+        while True:
+            size = int((await reader.readuntil(b"\r\n")).strip(), 16)
+            await reader.readexactly(size + 2)
+            if size == 0:
+                break
+    elif length:
+        await reader.readexactly(length)
+    return status
+
+
+async def client(args, request, deadline, latencies, errors):
+    reader = writer = None
+    while time.monotonic() < deadline:
+        try:
+            if writer is None:
+                reader, writer = await asyncio.open_connection(args.host, args.port)
+            start = time.perf_counter()
+            writer.write(request * args.pipeline)
+            for _ in range(args.pipeline):
+                status = await read_response(reader)
+                if status != 200:
+                    errors.append(status)
+            elapsed = (time.perf_counter() - start) * 1000
+            latencies.extend([elapsed] * args.pipeline)
+            if args.close:
+                writer.close()
+                writer = None
+        except (OSError, asyncio.IncompleteReadError) as error:
+            errors.append(type(error).__name__)
+            writer = None
+    if writer is not None:
+        writer.close()
+
+
+async def stalled(args, hold):
+    _, writer = await asyncio.open_connection(args.host, args.port)
+    writer.write(b"GET /api/time HTTP/1.1\r\nHo")
+    await asyncio.sleep(hold)
+    writer.close()
+
+
+async def run(args):
+    connection = b"close" if args.close else b"keep-alive"
+    request = b"GET %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n\r\n" % (
+        args.path.encode(), args.host.encode(), connection)
+    latencies = []
+    errors = []
+    hold = asyncio.gather(*[stalled(args, args.seconds + 1) for _ in range(args.stalled)])
+    await asyncio.sleep(0.2)
+    start = time.monotonic()
+    deadline = start + args.seconds
+    await asyncio.gather(*[client(args, request, deadline, latencies, errors) for _ in range(args.clients)])
+    elapsed = time.monotonic() - start
+    await hold
+    return latencies, errors, elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--path", default="/api/time")
+    parser.add_argument("--clients", type=int, default=16)
+    parser.add_argument("--pipeline", type=int, default=1)
+    parser.add_argument("--stalled", type=int, default=0)
+    parser.add_argument("--seconds", type=float, default=5)
+    parser.add_argument("--close", action="store_true")
+    args = parser.parse_args()
+
+    latencies, errors, elapsed = asyncio.run(run(args))
+    print("%s: %d клиентов, конвейер %d, зависших %d, %s"
+          % (args.path, args.clients, args.pipeline, args.stalled, "close" if args.close else "keep-alive"))
+    print("запросов: %d за %.1f с — %.0f в секунду" % (len(latencies), elapsed, len(latencies) / elapsed))
+    print("задержка, мс: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f"
+          % (percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+             max(latencies) if latencies else 0))
+    if errors:
+        print("ошибок: %d (%s)" % (len(errors), ", ".join(sorted(set(map(str, errors))))))
+    return 1 if errors or not latencies else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,210 @@
+"""Восстановление журнала событий после обрыва питания (env:native).
+
+Скрипт сам записывает сегменты журнала в каталог ФС прошивки (формат —
+src/event_journal.h): несколько заполненных сегментов, испорченную
+запись посреди сегмента, оборванную запись в конце последнего и
+недописанный заголовок следующего. Затем запускает прошивку и проверяет:
+- при загрузке найден оборванный хвост, все целые записи на месте;
+- постраничное чтение /api/journal отдаёт записи по порядку без пропусков,
+  кроме испорченной;
+- запрос по времени читает только сегменты, пересекающие интервал;
+- запись после восстановления продолжает нумерацию в новом сегменте.
+После этого процесс убивается (SIGKILL — как обрыв питания), к файлу
+текущего сегмента дописывается половина записи, и проверки повторяются
+после второго запуска.
+
+    pio run -e native
+    python3 tools/journal_recovery.py --program .pio/build/native/program
+
+Код возврата 1 — проверка не прошла.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+import zlib
+
+SEGMENT_MAGIC = 0x4E524A47
+SEGMENT_SIZE = 4096
+HEADER = struct.Struct("<IIII")
+RECORD = struct.Struct("<IIBBHHHiI")
+RECORDS_PER_SEGMENT = (SEGMENT_SIZE - HEADER.size) // RECORD.size
+EVENT_GROUP = 4
+
+# Синтетические записи: по минуте между событиями с этого момента
+BASE_TIME = 1700000000
+FULL_SEGMENTS = 5
+TAIL_RECORDS = 10
+CORRUPT_SEQUENCE = 2 * RECORDS_PER_SEGMENT + 7
+
+
+def segment_path(root, index):
+    return os.path.join(root, "journal%02u.bin" % index)
+
+
+def header(epoch):
+    data = struct.pack("<III", SEGMENT_MAGIC, epoch, 0)
+    return data + struct.pack("<I", zlib.crc32(data))
+
+
+def record(sequence):
+    data = RECORD.pack(sequence, BASE_TIME + sequence * 60, EVENT_GROUP, 0, 0, 0, 1, 1000, 0)[:-4]
+    return data + struct.pack("<I", zlib.crc32(data))
+
+
+def record_time(sequence):
+    return BASE_TIME + sequence * 60
+
+
+def write_journal(root):
+    """Заполненные сегменты 0..4, хвост в 5 с оборванной записью, обрывок заголовка в 7."""
+    sequence = 1
+    for index in range(FULL_SEGMENTS + 1):
+        count = RECORDS_PER_SEGMENT if index < FULL_SEGMENTS else TAIL_RECORDS
+        data = bytearray(header(index + 1))
+        for _ in range(count):
+            item = bytearray(record(sequence))
+            if sequence == CORRUPT_SEQUENCE:
+                item[5] ^= 0xFF
+            data += item
+            sequence += 1
+        if index == FULL_SEGMENTS:
+            data += record(sequence)[:11]
+        with open(segment_path(root, index), "wb") as file:
+            file.write(data)
+    with open(segment_path(root, 7), "wb") as file:
+        file.write(header(99)[:5])
+    return sequence - 1
+
+
+class Device:
+    def __init__(self, program, root, port):
+        self.base = "http://127.0.0.1:%d" % port
+        env = dict(os.environ, GONG_FS_DIR=root, GONG_HTTP_PORT=str(port))
+        self.process = subprocess.Popen([program], env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                self.get("/api/boot")
+                break
+            except OSError:
+                time.sleep(0.2)
+        else:
+            raise SystemExit("устройство не ответило")
+        # Запись о загрузке уходит во flash из journalTask
+        time.sleep(0.5)
+
+    def get(self, path):
+        with urllib.request.urlopen(self.base + path, timeout=5) as response:
+            return json.loads(response.read().decode())
+
+    def metric(self, name):
+        with urllib.request.urlopen(self.base + "/api/metrics", timeout=5) as response:
+            for line in response.read().decode().splitlines():
+                match = re.match(r"^%s (\d+)" % name, line)
+                if match:
+                    return int(match.group(1))
+        return None
+
+    def kill(self):
+        self.process.kill()
+        self.process.wait()
+
+
+class Checks:
+    def __init__(self):
+        self.failed = 0
+
+    def expect(self, ok, text):
+        print("%-4s %s" % ("OK" if ok else "FAIL", text))
+        if not ok:
+            self.failed += 1
+
+
+def read_all(device, limit):
+    events, after, pages = [], 0, 0
+    while True:
+        page = device.get("/api/journal?after=%d&limit=%d" % (after, limit))
+        events += page["events"]
+        pages += 1
+        if "next" not in page:
+            return events, pages
+        after = page["next"]
+
+
+def check_run(device, checks, synthetic, torn_expected):
+    torn = device.metric("gong_journal_torn_segments")
+    checks.expect(torn == torn_expected, "оборванных хвостов при загрузке: %s" % torn)
+    events, pages = read_all(device, 32)
+    sequences = [event["sequence"] for event in events]
+    checks.expect(all(a < b for a, b in zip(sequences, sequences[1:])), "записи по возрастанию номера")
+    expected = [s for s in range(1, synthetic + 1) if s != CORRUPT_SEQUENCE]
+    checks.expect(sequences[:len(expected)] == expected,
+                  "синтетические записи целы, испорченная #%d пропущена (%d страниц)" % (CORRUPT_SEQUENCE, pages))
+    boots = [event for event in events if event["type"] == "boot"]
+    return sequences, boots
+
+
+def check_range(device, checks):
+    # Интервал внутри сегмента 3: читается только он
+    first = 3 * RECORDS_PER_SEGMENT + 20
+    before = device.metric("gong_journal_segment_reads_total")
+    page = device.get("/api/journal?from=%d&to=%d" % (record_time(first), record_time(first + 9)))
+    reads = device.metric("gong_journal_segment_reads_total") - before
+    sequences = [event["sequence"] for event in page["events"]]
+    checks.expect(sequences == list(range(first, first + 10)), "запрос по времени: записи #%d-#%d" % (first, first + 9))
+    checks.expect(reads == 1, "запрос по времени прочитал сегментов: %d" % reads)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8095)
+    args = parser.parse_args()
+
+    checks = Checks()
+    with tempfile.TemporaryDirectory() as root:
+        synthetic = write_journal(root)
+
+        device = Device(args.program, root, args.port)
+        try:
+            sequences, boots = check_run(device, checks, synthetic, 1)
+            checks.expect(len(boots) == 1 and boots[0]["sequence"] == synthetic + 1,
+                          "запись о загрузке продолжает нумерацию: #%d" % (synthetic + 1))
+            header_ok = open(segment_path(root, 6), "rb").read(HEADER.size) == header(FULL_SEGMENTS + 2)
+            checks.expect(header_ok, "запись продолжена с нового сегмента")
+            check_range(device, checks)
+        finally:
+            device.kill()
+
+        # Обрыв питания во время записи: половина записи в конце сегмента
+        last = sequences[-1]
+        with open(segment_path(root, 6), "ab") as file:
+            file.write(record(last + 1)[:13])
+
+        device = Device(args.program, root, args.port)
+        try:
+            # Хвост сегмента 5 остаётся до его стирания: теперь их два
+            before = sequences
+            sequences, boots = check_run(device, checks, synthetic, 2)
+            checks.expect(sequences[:len(before)] == before, "записи до обрыва на месте")
+            checks.expect(len(boots) == 2 and boots[-1]["sequence"] > last,
+                          "после второго обрыва нумерация продолжается: #%d" % boots[-1]["sequence"])
+            header_ok = open(segment_path(root, 7), "rb").read(HEADER.size) == header(FULL_SEGMENTS + 3)
+            checks.expect(header_ok, "недописанный заголовок сегмента 7 заменён новым")
+        finally:
+            device.kill()
+
+    print("проверок не прошло: %d" % checks.failed)
+    return 1 if checks.failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
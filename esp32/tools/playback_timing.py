@@ -0,0 +1,220 @@
+"""Длительность и шаги громкости сеанса воспроизведения на модели DFPlayer.
+
+Запускает прошивку под Linux (env:native) с журналом поддельного плеера
+(GONG_DFPLAYER_LOG=1: кадры UART по часам хоста) и по кадрам проверяет:
+- остановка (0x16) — через duration_ms после начала сеанса, с точностью
+  до --max-late-ms;
+- громкость (0x06) во время нарастания только растёт, во время
+  затухания только падает, кадры не чаще PLAYBACK_RAMP_STEP_MS;
+- после остановки громкость возвращена к исходной;
+- новый сеанс посреди затухания вытесняет прежний: громкость
+  возвращена до запуска трека, прежняя остановка не приходит;
+- POST /api/audio/stop посреди нарастания возвращает громкость.
+
+    pio run -e native
+    python3 tools/playback_timing.py --program .pio/build/native/program
+
+Код возврата 1 — хотя бы одна проверка не прошла.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+TX_RE = re.compile(r"^\[fake_uart\] (\d+\.\d+) tx 7E FF 06 ([0-9A-F]{2}) [0-9A-F]{2} ([0-9A-F]{2}) ([0-9A-F]{2}) ")
+
+CMD_TRACK = 0x03
+CMD_VOLUME = 0x06
+CMD_PLAY = 0x0D
+CMD_STOP = 0x16
+
+
+class Device:
+    def __init__(self, program, port):
+        self.base = "http://127.0.0.1:%d" % port
+        self.lines = []
+        self.lock = threading.Lock()
+        self.fs = tempfile.TemporaryDirectory()
+        # Трек длиннее любого сеанса: остановить его может только прошивка
+        env = dict(os.environ,
+                   GONG_FS_DIR=self.fs.name,
+                   GONG_HTTP_PORT=str(port),
+                   GONG_DFPLAYER_LOG="1",
+                   GONG_DFPLAYER_TRACK_MS="600000")
+        self.process = subprocess.Popen([program], env=env, stdout=subprocess.PIPE,
+                                        stderr=subprocess.STDOUT, text=True, errors="replace")
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            with self.lock:
+                self.lines.append(line.rstrip("\n"))
+
+    def request(self, method, path):
+        request = urllib.request.Request(self.base + path, data=b"" if method == "POST" else None, method=method)
+        with urllib.request.urlopen(request, timeout=5) as response:
+            return json.loads(response.read().decode() or "{}")
+
+    def wait_ready(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                if self.request("GET", "/api/audio/status").get("online"):
+                    return
+            except OSError:
+                pass
+            time.sleep(0.2)
+        raise SystemExit("устройство не ответило")
+
+    def frames(self, since):
+        """Кадры после момента since (UNIX, с): (время, команда, аргумент)."""
+        with self.lock:
+            lines = list(self.lines)
+        frames = []
+        for line in lines:
+            match = TX_RE.match(line)
+            if match and float(match.group(1)) >= since:
+                frames.append((float(match.group(1)), int(match.group(2), 16),
+                               int(match.group(3), 16) << 8 | int(match.group(4), 16)))
+        return frames
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+        self.fs.cleanup()
+
+
+def report(name, problems, results, detail=""):
+    print("%-30s%s" % (name, "ok" + detail if not problems else problems[0]))
+    for problem in problems[1:]:
+        print("%-30s%s" % ("", problem))
+    results.append(not problems)
+
+
+def check_ramp(volumes, rising, min_gap):
+    problems = []
+    for (at0, v0), (at1, v1) in zip(volumes, volumes[1:]):
+        if (v1 < v0) if rising else (v1 > v0):
+            problems.append("громкость %d -> %d против направления" % (v0, v1))
+        if at1 - at0 < min_gap:
+            problems.append("кадры громкости через %.0f мс" % ((at1 - at0) * 1000))
+    return problems
+
+
+def session(device, args, name, duration_ms, fade_in_ms, fade_out_ms, results):
+    """Один сеанс до конца: остановка вовремя, шаги по направлению."""
+    device.request("POST", "/api/audio/stop")
+    time.sleep(0.5)
+    since = time.time()
+    device.request("POST", "/api/audio/track?num=2&duration_ms=%d&fade_in_ms=%d&fade_out_ms=%d"
+                   % (duration_ms, fade_in_ms, fade_out_ms))
+    time.sleep(duration_ms / 1000.0 + 0.5)
+    frames = device.frames(since)
+    problems = []
+    stops = [at for at, command, _ in frames if command == CMD_STOP]
+    if not frames or not stops:
+        report(name, ["остановки нет"], results)
+        return
+    # Начало сеанса — первый кадр после запроса (громкость 0 или трек)
+    start = frames[0][0]
+    late_ms = (stops[0] - start) * 1000 - duration_ms
+    if late_ms < -1 or late_ms > args.max_late_ms:
+        problems.append("остановка через %.1f мс вместо %d" % ((stops[0] - start) * 1000, duration_ms))
+    volumes = [(at, arg) for at, command, arg in frames if command == CMD_VOLUME and at < stops[0]]
+    peak = max(range(len(volumes)), key=lambda i: volumes[i][1]) if volumes else 0
+    min_gap = (args.step_ms - args.gap_slack_ms) / 1000.0
+    if fade_in_ms:
+        problems += check_ramp(volumes[:peak + 1], True, min_gap)
+    if fade_out_ms:
+        problems += check_ramp(volumes[peak:], False, min_gap)
+    restored = [arg for at, command, arg in frames if command == CMD_VOLUME and at >= stops[0]]
+    if restored[-1:] != [args.volume]:
+        problems.append("громкость после остановки не возвращена к %d" % args.volume)
+    ramps = len(volumes) - (1 if fade_in_ms else 0)
+    report(name, problems, results, ": %d шагов, остановка %+.1f мс" % (ramps, late_ms))
+
+
+def preempt(device, args, results):
+    """Новый сеанс посреди затухания прежнего."""
+    device.request("POST", "/api/audio/stop")
+    time.sleep(0.5)
+    since = time.time()
+    device.request("POST", "/api/audio/track?num=2&duration_ms=3000&fade_out_ms=2000")
+    time.sleep(2.0)
+    switched = time.time()
+    device.request("POST", "/api/audio/track?num=3&duration_ms=1500")
+    answered = time.time()
+    time.sleep(3.0)
+    frames = device.frames(since)
+    problems = []
+    after = [(at, command, arg) for at, command, arg in frames if at >= switched]
+    tracks = [at for at, command, arg in after if command == CMD_TRACK and arg == 3]
+    stops = [at for at, command, _ in after if command == CMD_STOP]
+    if not tracks:
+        report("вытеснение", ["второй трек не запущен"], results)
+        return
+    before = [(at, arg) for at, command, arg in after if command == CMD_VOLUME and at < tracks[0]]
+    if before[-1:] == [] or before[-1][1] != args.volume:
+        problems.append("громкость не возвращена до второго трека")
+    # Кадры вытесненного затухания ещё в очереди, поэтому начало второго
+    # сеанса — между запросом и ответом
+    if len(stops) != 1:
+        problems.append("остановок: %d вместо одной" % len(stops))
+    elif not switched + 1.5 <= stops[0] <= answered + 1.5 + args.max_late_ms / 1000.0:
+        problems.append("остановка второго сеанса через %.1f мс после запроса" % ((stops[0] - switched) * 1000))
+    report("вытеснение", problems, results)
+
+
+def stop_mid_fade(device, args, results):
+    """Остановка вручную посреди нарастания."""
+    device.request("POST", "/api/audio/stop")
+    time.sleep(0.5)
+    device.request("POST", "/api/audio/track?num=2&duration_ms=10000&fade_in_ms=3000")
+    time.sleep(1.0)
+    since = time.time()
+    device.request("POST", "/api/audio/stop")
+    time.sleep(3.0)
+    frames = device.frames(since)
+    volumes = [arg for _, command, arg in frames if command == CMD_VOLUME]
+    problems = []
+    if volumes != [args.volume]:
+        problems.append("после остановки громкость %s вместо [%d]" % (volumes, args.volume))
+    report("остановка посреди нарастания", problems, results)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8094)
+    parser.add_argument("--volume", type=int, default=20, help="громкость в настройках прошивки")
+    parser.add_argument("--step-ms", type=int, default=100, help="PLAYBACK_RAMP_STEP_MS прошивки")
+    parser.add_argument("--gap-slack-ms", type=int, default=10,
+                        help="допуск на интервал между кадрами: команды ждут очередь аудио")
+    parser.add_argument("--max-late-ms", type=int, default=20, help="допуск на остановку")
+    args = parser.parse_args()
+
+    device = Device(args.program, args.port)
+    results = []
+    try:
+        device.wait_ready()
+        device.request("POST", "/api/audio/volume?value=%d" % args.volume)
+        session(device, args, "3 с без затуханий", 3000, 0, 0, results)
+        session(device, args, "3 с, 1 с + 1 с", 3000, 1000, 1000, results)
+        session(device, args, "4 с, затухание 3 с", 4000, 0, 3000, results)
+        session(device, args, "1 с, 0.2 с + 2 с", 1000, 200, 2000, results)
+        preempt(device, args, results)
+        stop_mid_fade(device, args, results)
+    finally:
+        device.stop()
+    return 0 if results and all(results) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
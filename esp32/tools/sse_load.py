@@ -0,0 +1,210 @@
+"""Нагрузочная проверка /api/events на прошивке под Linux (env:native).
+
+Запускает --program с временным каталогом SPIFFS (или подключается к
+уже запущенному устройству по --host/--port, если --program не задан),
+замеряет задержку GET /api/time без подписчиков, затем открывает
+--clients подписчиков SSE и замеряет её снова. Проверки:
+- каждый подписчик получает событие time каждую секунду и не отключён;
+- gong_event_clients в /api/metrics равен числу подписчиков;
+- событие сериализуется один раз (gong_events_published_total), а
+  пишется каждому подписчику (gong_event_writes_total);
+- p50 под нагрузкой — не больше --max-p50-ratio от p50 без неё
+  (с запасом --slack-ms на дрожание часов хоста), p99 — не больше
+  --max-p99-ms.
+
+    pio run -e native
+    python3 tools/sse_load.py --program .pio/build/native/program --clients 20
+
+Код возврата 1 — проверка не прошла.
+"""
+
+import argparse
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+
+def percentile(values, percent):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * percent / 100))]
+
+
+class Device:
+    """Прошивка под Linux со своим каталогом SPIFFS."""
+
+    def __init__(self, program, port):
+        self.fs = tempfile.TemporaryDirectory()
+        env = dict(os.environ, GONG_FS_DIR=self.fs.name, GONG_HTTP_PORT=str(port))
+        self.process = subprocess.Popen([program], env=env, stdout=subprocess.DEVNULL,
+                                        stderr=subprocess.DEVNULL)
+
+    def wait_online(self, base):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                urllib.request.urlopen(base + "/api/time", timeout=1).read()
+                return
+            except OSError:
+                time.sleep(0.2)
+        raise SystemExit("%s: устройство не ответило" % base)
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+        self.fs.cleanup()
+
+
+class Checks:
+    def __init__(self):
+        self.failed = 0
+
+    def expect(self, ok, text):
+        print("%-4s %s" % ("OK" if ok else "FAIL", text))
+        if not ok:
+            self.failed += 1
+
+
+class Subscriber(threading.Thread):
+    def __init__(self, host, port):
+        super().__init__(daemon=True)
+        self.host = host
+        self.port = port
+        self.counts = {}
+        self.status = None
+        self.closed = False
+        self.stop = threading.Event()
+
+    def run(self):
+        sock = socket.create_connection((self.host, self.port), timeout=5)
+        sock.sendall(b"GET /api/events HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n"
+                     % self.host.encode())
+        sock.settimeout(0.5)
+        buffer = b""
+        head_done = False
+        while not self.stop.is_set():
+            try:
+                data = sock.recv(4096)
+            except socket.timeout:
+                continue
+            if not data:
+                self.closed = True
+                break
+            buffer += data
+            if not head_done:
+                if b"\r\n\r\n" not in buffer:
+                    continue
+                head, buffer = buffer.split(b"\r\n\r\n", 1)
+                self.status = int(head.split(b" ", 2)[1])
+                head_done = True
+            while b"\n\n" in buffer:
+                frame, buffer = buffer.split(b"\n\n", 1)
+                for line in frame.split(b"\n"):
+                    if line.startswith(b"event: "):
+                        name = line[7:].decode()
+                        self.counts[name] = self.counts.get(name, 0) + 1
+        sock.close()
+
+
+def time_latencies(base, seconds):
+    latencies = []
+    deadline = time.monotonic() + seconds
+    while time.monotonic() < deadline:
+        start = time.perf_counter()
+        urllib.request.urlopen(base + "/api/time", timeout=5).read()
+        latencies.append((time.perf_counter() - start) * 1000)
+        time.sleep(0.05)
+    return latencies
+
+
+def event_metrics(base):
+    text = urllib.request.urlopen(base + "/api/metrics", timeout=5).read().decode()
+    values = {}
+    for line in text.splitlines():
+        if line.startswith("gong_event"):
+            name, value = line.rsplit(" ", 1)
+            values[name] = float(value)
+    return values
+
+
+def run(args, base):
+    checks = Checks()
+    idle = time_latencies(base, args.baseline_seconds)
+    before = event_metrics(base)
+    subscribers = [Subscriber(args.host, args.port) for _ in range(args.clients)]
+    for subscriber in subscribers:
+        subscriber.start()
+    time.sleep(0.5)
+    loaded = time_latencies(base, args.seconds)
+    after = event_metrics(base)
+    for subscriber in subscribers:
+        subscriber.stop.set()
+    for subscriber in subscribers:
+        subscriber.join()
+
+    idle_p50 = percentile(idle, 50)
+    loaded_p50 = percentile(loaded, 50)
+    loaded_p99 = percentile(loaded, 99)
+    print("GET /api/time без подписчиков: p50 %.2f мс, p99 %.2f мс" % (idle_p50, percentile(idle, 99)))
+    print("GET /api/time при %d подписчиках: p50 %.2f мс, p99 %.2f мс" % (args.clients, loaded_p50, loaded_p99))
+    checks.expect(loaded_p50 <= idle_p50 * args.max_p50_ratio + args.slack_ms,
+                  "p50 под нагрузкой %.2f мс, допустимо %.2f мс"
+                  % (loaded_p50, idle_p50 * args.max_p50_ratio + args.slack_ms))
+    checks.expect(loaded_p99 <= args.max_p99_ms,
+                  "p99 под нагрузкой %.2f мс, допустимо %.2f мс" % (loaded_p99, args.max_p99_ms))
+
+    clients = after.get("gong_event_clients", -1)
+    checks.expect(clients == args.clients, "gong_event_clients %d при %d подписчиках" % (clients, args.clients))
+    published = after.get("gong_events_published_total", 0) - before.get("gong_events_published_total", 0)
+    writes = after.get("gong_event_writes_total", 0) - before.get("gong_event_writes_total", 0)
+    checks.expect(published > 0 and writes >= published * args.clients,
+                  "событий сериализовано: %d, записей в соединения: %d (%.1f на событие)"
+                  % (published, writes, writes / published if published else 0))
+
+    expected = int(args.seconds) - 1
+    for index, subscriber in enumerate(subscribers):
+        ticks = subscriber.counts.get("time", 0)
+        checks.expect(subscriber.status == 200 and not subscriber.closed and ticks >= expected,
+                      "клиент %2d: статус %s, %s, событий time ожидалось не меньше %d"
+                      % (index, subscriber.status, dict(sorted(subscriber.counts.items())), expected))
+    return checks.failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", help="запустить прошивку; без него — к уже запущенной по --host/--port")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--clients", type=int, default=20)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--baseline-seconds", type=float, default=3)
+    parser.add_argument("--max-p50-ratio", type=float, default=2.0)
+    parser.add_argument("--slack-ms", type=float, default=1.0)
+    parser.add_argument("--max-p99-ms", type=float, default=50.0)
+    args = parser.parse_args()
+    base = "http://%s:%d" % (args.host, args.port)
+
+    device = None
+    if args.program:
+        args.host = "127.0.0.1"
+        base = "http://127.0.0.1:%d" % args.port
+        device = Device(args.program, args.port)
+    try:
+        if device:
+            device.wait_online(base)
+        failed = run(args, base)
+    finally:
+        if device:
+            device.stop()
+    print("проверок не прошло: %d" % failed)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,212 @@
+"""Задержка удара от момента будильника до звука на модели DFPlayer.
+
+Запускает прошивку под Linux (env:native) с журналом поддельного плеера
+(GONG_DFPLAYER_LOG=1: кадры и начало звука по часам хоста) и сравнивает:
+- групповые удары с запасом — трек подготовлен заранее, звук должен
+  начаться сразу после момента удара;
+- групповой удар без запаса — подготовка не успевает, удар холодным
+  стартом, громкость после подготовки возвращена;
+- холодный старт POST /api/audio/track для сравнения;
+- с --alarm — удар будильника на ближайшей границе минуты.
+Во время подготовки звука быть не должно. Задержку, которую замерила
+сама прошивка (gong_strike_last_latency_seconds), печатает рядом.
+
+    pio run -e native
+    python3 tools/strike_latency.py --program .pio/build/native/program
+
+Код возврата 1 — звук раньше удара, удар опоздал больше --max-late-ms
+или не прозвучал.
+"""
+
+import argparse
+import datetime
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+SOUND_RE = re.compile(r"^\[fake_uart\] (\d+\.\d+) sound (on|off) track (\d+)")
+TX_RE = re.compile(r"^\[fake_uart\] (\d+\.\d+) tx 7E FF 06 ([0-9A-F]{2}) ")
+
+
+class Device:
+    def __init__(self, program, port, track_ms, start_ms, jitter_ms):
+        self.base = "http://127.0.0.1:%d" % port
+        self.lines = []
+        self.lock = threading.Lock()
+        self.fs = tempfile.TemporaryDirectory()
+        env = dict(os.environ,
+                   GONG_FS_DIR=self.fs.name,
+                   GONG_HTTP_PORT=str(port),
+                   GONG_DFPLAYER_LOG="1",
+                   GONG_DFPLAYER_TRACK_MS=str(track_ms),
+                   GONG_DFPLAYER_START_MS=str(start_ms),
+                   GONG_DFPLAYER_START_JITTER_MS=str(jitter_ms))
+        self.process = subprocess.Popen([program], env=env, stdout=subprocess.PIPE,
+                                        stderr=subprocess.STDOUT, text=True, errors="replace")
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            with self.lock:
+                self.lines.append(line.rstrip("\n"))
+
+    def request(self, method, path, body=None):
+        data = body.encode() if body is not None else (b"" if method == "POST" else None)
+        request = urllib.request.Request(self.base + path, data=data, method=method,
+                                         headers={"Content-Type": "application/json"} if body else {})
+        with urllib.request.urlopen(request, timeout=5) as response:
+            return json.loads(response.read().decode() or "{}")
+
+    def wait_ready(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                if self.request("GET", "/api/audio/status").get("online"):
+                    return
+            except OSError:
+                pass
+            time.sleep(0.2)
+        raise SystemExit("устройство не ответило")
+
+    def metric(self, name):
+        with urllib.request.urlopen(self.base + "/api/metrics", timeout=5) as response:
+            for line in response.read().decode().splitlines():
+                if line.startswith(name + " "):
+                    return float(line.split()[-1])
+        return None
+
+    def events(self, since):
+        """Звук и кадры после момента since (UNIX, с)."""
+        with self.lock:
+            lines = list(self.lines)
+        sounds, frames = [], []
+        for line in lines:
+            match = SOUND_RE.match(line)
+            if match and float(match.group(1)) >= since:
+                sounds.append((float(match.group(1)), match.group(2), int(match.group(3))))
+            match = TX_RE.match(line)
+            if match and float(match.group(1)) >= since:
+                frames.append((float(match.group(1)), int(match.group(2), 16)))
+        return sounds, frames
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+        self.fs.cleanup()
+
+
+def first_sound(sounds, after=0.0):
+    for at, state, track in sounds:
+        if state == "on" and at >= after:
+            return at, track
+    return None, None
+
+
+def check_strike(device, name, since, fire_at, track, max_late_ms, results):
+    sounds, _ = device.events(since)
+    early = [s for s in sounds if s[1] == "on" and s[0] < fire_at]
+    at, played = first_sound(sounds, fire_at)
+    reported = device.metric("gong_strike_last_latency_seconds")
+    ok = not early and at is not None and played == track
+    late_ms = (at - fire_at) * 1000 if at is not None else None
+    if late_ms is not None and late_ms > max_late_ms:
+        ok = False
+    line = "%-24s" % name
+    line += "звук через %6.1f мс" % late_ms if late_ms is not None else "звука нет"
+    if reported is not None:
+        line += ", прошивка: %.1f мс" % (reported * 1000)
+    if early:
+        line += "  <-- звук до удара (%.3f)" % early[0][0]
+    elif not ok:
+        line += "  <-- ожидалось не больше %d мс" % max_late_ms
+    print(line)
+    results.append(ok)
+
+
+def group_strike(device, args, name, delay_ms, track, max_late_ms, results):
+    device.request("POST", "/api/audio/stop")
+    time.sleep(0.5)
+    since = time.time()
+    sent = device.request("POST", "/api/group/play?num=%d&delay_ms=%d" % (track, delay_ms))
+    fire_at = sent["fire_at_ms"] / 1000.0
+    time.sleep(max(0.0, fire_at - time.time()) + 0.6)
+    check_strike(device, name, since, fire_at, track, max_late_ms, results)
+
+
+def cold_track(device, track, results):
+    device.request("POST", "/api/audio/stop")
+    time.sleep(0.5)
+    since = time.time()
+    device.request("POST", "/api/audio/track?num=%d" % track)
+    time.sleep(0.6)
+    sounds, frames = device.events(since)
+    sent = [at for at, command in frames if command == 0x03]
+    at, _ = first_sound(sounds, since)
+    if not sent or at is None:
+        print("%-24sзвука нет" % "трек вручную")
+        results.append(False)
+        return
+    print("%-24sзвук через %6.1f мс после команды плееру" % ("трек вручную", (at - sent[0]) * 1000))
+
+
+def alarm_strike(device, args, results):
+    now = time.time()
+    fire_at = (int(now) // 60 + 1) * 60
+    if fire_at - now < 5:
+        fire_at += 60
+    device_time = device.request("GET", "/api/time")
+    local_now = datetime.datetime.fromisoformat(device_time["iso"])
+    utc_now = datetime.datetime.utcfromtimestamp(int(now))
+    offset = datetime.timedelta(minutes=round((local_now - utc_now).total_seconds() / 60))
+    local_fire = datetime.datetime.utcfromtimestamp(fire_at) + offset
+    body = json.dumps({"time": local_fire.strftime("%H:%M"), "duration": 5, "track": 4,
+                       "days": list(range(7)), "active": True})
+    alarm = device.request("POST", "/api/alarms", body)
+    print("будильник %s, ждём %.0f с..." % (local_fire.strftime("%H:%M"), fire_at - now))
+    since = time.time()
+    time.sleep(fire_at - time.time() + 0.6)
+    check_strike(device, "будильник", since, fire_at, 4, args.max_late_ms, results)
+    device.request("DELETE", "/api/alarms/%d" % alarm["id"])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8093)
+    parser.add_argument("--strikes", type=int, default=3, help="групповых ударов с запасом")
+    parser.add_argument("--start-ms", type=int, default=150, help="запуск трека в модели плеера")
+    parser.add_argument("--jitter-ms", type=int, default=100)
+    parser.add_argument("--max-late-ms", type=int, default=50, help="допуск для подготовленного удара")
+    parser.add_argument("--alarm", action="store_true", help="также удар будильника (ждёт границы минуты)")
+    args = parser.parse_args()
+
+    device = Device(args.program, args.port, 1500, args.start_ms, args.jitter_ms)
+    results = []
+    try:
+        device.wait_ready()
+        device.request("POST", "/api/config?trigger_key=strike-latency")
+        for i in range(args.strikes):
+            group_strike(device, args, "групповой, запас 2 с", 2000, 3, args.max_late_ms, results)
+        # Подготовка не успевает: холодный старт, громкость не должна остаться нулевой
+        cold_limit = args.start_ms + args.jitter_ms + 100
+        group_strike(device, args, "групповой, запас 50 мс", 50, 2, cold_limit, results)
+        cold_track(device, 1, results)
+        if args.alarm:
+            alarm_strike(device, args, results)
+        volume = device.request("GET", "/api/audio/status").get("volume")
+        if volume == 0:
+            print("громкость осталась нулевой после подготовки")
+            results.append(False)
+    finally:
+        device.stop()
+    return 0 if results and all(results) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
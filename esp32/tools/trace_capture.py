@@ -0,0 +1,224 @@
+"""Снимок трассировки прошивки: GET /api/trace (env:native или плата).
+
+Без --url запускает прошивку под Linux, ставит групповой удар и снимает
+трассировку после него; с --url только читает её с устройства. Снимок
+сохраняется в --out — файл открывается в chrome://tracing или
+ui.perfetto.dev. Проверяется:
+- ответ — JSON формата Chrome trace;
+- время событий каждого потока не убывает;
+- begin/end каждого потока парные (end без begin в начале кольца и
+  незакрытые begin в конце — допустимы: кольцо перезаписывается,
+  снимок идёт во время работы);
+- на хосте: цепочка удара fire_group -> audio_command -> uart_write.
+Затем печатает самые долгие участки по именам.
+
+    pio run -e native
+    python3 tools/trace_capture.py --program .pio/build/native/program --out trace.json
+    python3 tools/trace_capture.py --url http://192.168.1.57 --out trace.json
+
+Код возврата 1 — проверка не прошла.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+from collections import defaultdict
+
+FIRE_COUNT_RE = re.compile(r'^gong_fire_late_seconds_count\{source="group"\} (\d+)')
+
+
+class Device:
+    def __init__(self, base, program=None, port=0):
+        self.base = base
+        self.process = None
+        self.fs = None
+        if program is not None:
+            self.fs = tempfile.TemporaryDirectory()
+            env = dict(os.environ, GONG_FS_DIR=self.fs.name, GONG_HTTP_PORT=str(port))
+            self.process = subprocess.Popen([program], env=env, stdout=subprocess.DEVNULL,
+                                            stderr=subprocess.DEVNULL)
+
+    def request(self, method, path, form=None):
+        data = urllib.parse.urlencode(form).encode() if form is not None else (b"" if method == "POST" else None)
+        request = urllib.request.Request(self.base + path, data=data, method=method)
+        try:
+            with urllib.request.urlopen(request, timeout=5) as response:
+                return response.status, response.read().decode()
+        except urllib.error.HTTPError as error:
+            return error.code, error.read().decode()
+
+    def metric(self, pattern):
+        for line in self.request("GET", "/api/metrics")[1].splitlines():
+            match = pattern.match(line)
+            if match:
+                return int(match.group(1))
+        return 0
+
+    def wait_ready(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                if json.loads(self.request("GET", "/api/wifi/status")[1])["connected"]:
+                    return
+            except OSError:
+                pass
+            time.sleep(0.2)
+        raise SystemExit("устройство не подключилось к WiFi")
+
+    def strike(self):
+        """Групповой удар; True — прошивка отметила его в метриках."""
+        self.request("POST", "/api/config", {"trigger_key": "trace-capture"})
+        before = self.metric(FIRE_COUNT_RE)
+        deadline = time.monotonic() + 5
+        while time.monotonic() < deadline:
+            self.request("POST", "/api/group/play?num=1&delay_ms=200")
+            time.sleep(0.5)
+            if self.metric(FIRE_COUNT_RE) > before:
+                return True
+        return False
+
+    def stop(self):
+        if self.process is not None:
+            self.process.terminate()
+            self.process.wait()
+            self.fs.cleanup()
+
+
+class Checks:
+    def __init__(self):
+        self.failed = 0
+
+    def expect(self, ok, text):
+        print("%-4s %s" % ("OK" if ok else "FAIL", text))
+        if not ok:
+            self.failed += 1
+
+
+def thread_names(events):
+    names = {}
+    for event in events:
+        if event.get("ph") == "M" and event.get("name") == "thread_name":
+            names[(event["pid"], event["tid"])] = event["args"]["name"]
+    return names
+
+
+def spans(events, checks):
+    """Участки (имя, поток, начало, длительность) по парам begin/end;
+    проверяет порядок времени и вложенность в каждом потоке."""
+    threads = defaultdict(list)
+    for event in events:
+        if event.get("ph") in ("B", "E", "i"):
+            threads[(event["pid"], event["tid"])].append(event)
+
+    unordered = []
+    mismatched = []
+    result = []
+    for thread, thread_events in threads.items():
+        stack = []
+        last = None
+        for event in thread_events:
+            if last is not None and event["ts"] < last:
+                unordered.append((thread, event["name"], last, event["ts"]))
+            last = event["ts"]
+            if event["ph"] == "B":
+                stack.append(event)
+            elif event["ph"] == "E":
+                if not stack:
+                    continue
+                begin = stack.pop()
+                if begin["name"] != event["name"]:
+                    mismatched.append((thread, begin["name"], event["name"]))
+                    continue
+                result.append((begin["name"], thread, begin["ts"], event["ts"] - begin["ts"]))
+    checks.expect(not unordered, "время в потоках не убывает%s" % (": %s" % unordered[:3] if unordered else ""))
+    checks.expect(not mismatched, "begin/end парные%s" % (": %s" % mismatched[:3] if mismatched else ""))
+    return result
+
+
+def strike_chain(spans_list, names):
+    """Первая цепочка fire_group -> audio_command -> uart_write: мкс от
+    решения об ударе до начала записи в UART; None — цепочки нет."""
+    def task(span):
+        return names.get(span[1], "")
+
+    fires = [s for s in spans_list if s[0] == "fire_group"]
+    commands = [s for s in spans_list if s[0] == "audio_command" and task(s) == "AudioTask"]
+    writes = [s for s in spans_list if s[0] == "uart_write" and task(s) == "AudioTask"]
+    for fire in sorted(fires, key=lambda s: s[2]):
+        command = next((c for c in sorted(commands, key=lambda s: s[2]) if c[2] >= fire[2]), None)
+        if command is None:
+            continue
+        write = next((w for w in sorted(writes, key=lambda s: s[2]) if w[2] >= command[2]), None)
+        if write is not None:
+            return write[2] - fire[2]
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8097)
+    parser.add_argument("--url", help="устройство, например http://192.168.1.57; прошивка не запускается")
+    parser.add_argument("--out", help="куда сохранить снимок")
+    parser.add_argument("--top", type=int, default=10, help="сколько участков печатать")
+    args = parser.parse_args()
+
+    checks = Checks()
+    if args.url:
+        device = Device(args.url.rstrip("/"))
+    else:
+        device = Device("http://127.0.0.1:%d" % args.port, args.program, args.port)
+    try:
+        device.wait_ready()
+        if not args.url:
+            checks.expect(device.strike(), "групповой удар прозвучал")
+            time.sleep(0.3)
+        status, body = device.request("GET", "/api/trace")
+    finally:
+        device.stop()
+
+    checks.expect(status == 200, "GET /api/trace: HTTP %d" % status)
+    try:
+        trace = json.loads(body)
+        events = trace["traceEvents"]
+    except (ValueError, KeyError) as error:
+        checks.expect(False, "формат Chrome trace: %s" % error)
+        return 1
+    if args.out:
+        with open(args.out, "w") as out:
+            out.write(body)
+        print("снимок: %s" % args.out)
+
+    names = thread_names(events)
+    recorded = [event for event in events if event.get("ph") != "M"]
+    checks.expect(len(recorded) > 0, "событий в снимке: %d" % len(recorded))
+    spans_list = spans(events, checks)
+    if not args.url:
+        chain = strike_chain(spans_list, names)
+        checks.expect(chain is not None, "цепочка удара fire_group -> audio_command -> uart_write%s"
+                      % (": %.3f мс" % (chain / 1000) if chain is not None else ""))
+
+    totals = defaultdict(lambda: [0, 0.0, 0.0])
+    for name, thread, _, duration in spans_list:
+        total = totals[(name, names.get(thread, "tid %d" % thread[1]))]
+        total[0] += 1
+        total[1] += duration
+        total[2] = max(total[2], duration)
+    print("%-28s %-14s %6s %12s %12s" % ("участок", "задача", "раз", "всего, мс", "макс, мс"))
+    for (name, task), (count, duration, longest) in sorted(totals.items(), key=lambda item: -item[1][2])[:args.top]:
+        print("%-28s %-14s %6d %12.3f %12.3f" % (name, task, count, duration / 1000, longest / 1000))
+
+    print("проверок не прошло: %d" % checks.failed)
+    return 1 if checks.failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
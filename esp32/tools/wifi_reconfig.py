@@ -0,0 +1,207 @@
+"""Смена WiFi и настроек без перезагрузки (env:native).
+
+Запускает прошивку с симулятором WiFi, которому известны две сети
+(GONG_WIFI_NETWORKS), и проверяет:
+- POST /api/wifi с верным паролем: устройство подключается к новой сети,
+  сохраняет её, не перезагружается; простой связи — время подключения;
+- POST /api/wifi с неверным паролем: прежняя сеть возвращается по
+  известной точке доступа быстрее полного поиска, конфиг не меняется;
+- новая адресация в POST /api/config — такая же проба;
+- часовой пояс, громкость и ключ групповых ударов действуют сразу:
+  местное время сдвигается, групповой удар после смены ключа звучит.
+
+    pio run -e native
+    python3 tools/wifi_reconfig.py --program .pio/build/native/program
+
+Код возврата 1 — проверка не прошла.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+
+OLD_NETWORK = ("ASUS", "password")
+NEW_NETWORK = ("Dhamma Hall", "anicca-dukkha-anatta")
+FIRE_COUNT_RE = re.compile(r'^gong_fire_late_seconds_count\{source="group"\} (\d+)')
+
+
+class Device:
+    def __init__(self, program, port, scan_ms):
+        self.base = "http://127.0.0.1:%d" % port
+        self.fs = tempfile.TemporaryDirectory()
+        networks = ",".join("%s:%s" % network for network in (OLD_NETWORK, NEW_NETWORK))
+        env = dict(os.environ, GONG_FS_DIR=self.fs.name, GONG_HTTP_PORT=str(port),
+                   GONG_WIFI_NETWORKS=networks, GONG_WIFI_SCAN_MS=str(scan_ms))
+        self.process = subprocess.Popen([program], env=env, stdout=subprocess.DEVNULL,
+                                        stderr=subprocess.DEVNULL)
+
+    def request(self, method, path, form=None):
+        data = urllib.parse.urlencode(form).encode() if form is not None else (b"" if method == "POST" else None)
+        request = urllib.request.Request(self.base + path, data=data, method=method)
+        try:
+            with urllib.request.urlopen(request, timeout=5) as response:
+                return response.status, response.read().decode()
+        except urllib.error.HTTPError as error:
+            return error.code, error.read().decode()
+
+    def get(self, path):
+        return json.loads(self.request("GET", path)[1])
+
+    def metric(self, pattern):
+        for line in self.request("GET", "/api/metrics")[1].splitlines():
+            match = pattern.match(line)
+            if match:
+                return int(match.group(1))
+        return 0
+
+    def wait_ready(self):
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                if self.get("/api/wifi/status")["connected"]:
+                    return
+            except OSError:
+                pass
+            time.sleep(0.2)
+        raise SystemExit("устройство не подключилось к WiFi")
+
+    def wait_trial(self, trial, timeout=20):
+        """Итог пробы с id trial, когда связь вернулась."""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            status = self.get("/api/wifi/status")
+            if status["id"] == trial and status["state"] != "running" and status.get("downtime_ms"):
+                return status
+            time.sleep(0.05)
+        return self.get("/api/wifi/status")
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+        self.fs.cleanup()
+
+
+class Checks:
+    def __init__(self):
+        self.failed = 0
+
+    def expect(self, ok, text):
+        print("%-4s %s" % ("OK" if ok else "FAIL", text))
+        if not ok:
+            self.failed += 1
+
+
+def boot_marker(device):
+    boot = device.get("/api/boot")
+    return boot["reset_reason"], boot["ready_us"]
+
+
+def check_wifi_change(device, checks, scan_ms):
+    boot = boot_marker(device)
+    status, _ = device.request("POST", "/api/wifi", {"ssid": NEW_NETWORK[0], "pass": NEW_NETWORK[1]})
+    checks.expect(status == 202, "новая сеть принята на пробу (HTTP %d)" % status)
+    trial = device.get("/api/wifi/status")["id"]
+    result = device.wait_trial(trial)
+    checks.expect(result["state"] == "applied", "новая сеть подключена: %s" % result["state"])
+    downtime = result.get("downtime_ms", 0)
+    checks.expect(0 < downtime < scan_ms + 1000, "простой связи %d мс" % downtime)
+    config = device.get("/api/config")
+    checks.expect(config["ssid"] == NEW_NETWORK[0], "сеть сохранена: %s" % config["ssid"])
+    checks.expect(boot_marker(device) == boot, "без перезагрузки")
+
+
+def check_rollback(device, checks, scan_ms):
+    before = device.get("/api/config")
+    status, _ = device.request("POST", "/api/wifi", {"ssid": OLD_NETWORK[0], "pass": "wrong-password"})
+    checks.expect(status == 202, "сеть с неверным паролем принята на пробу")
+    again, _ = device.request("POST", "/api/wifi", {"ssid": OLD_NETWORK[0], "pass": OLD_NETWORK[1]})
+    checks.expect(again == 409, "вторая смена, пока идёт первая: HTTP %d" % again)
+    trial = device.get("/api/wifi/status")["id"]
+    result = device.wait_trial(trial)
+    checks.expect(result["state"] == "rolled_back", "возврат к прежней сети: %s" % result["state"])
+    checks.expect(result["connected"], "связь восстановлена")
+    # Проба — полный поиск, возврат — по известной точке доступа: второго
+    # поиска нет
+    downtime = result.get("downtime_ms", 0)
+    checks.expect(0 < downtime < scan_ms + 500, "простой связи с возвратом %d мс" % downtime)
+    after = device.get("/api/config")
+    checks.expect(after["ssid"] == before["ssid"] and after["sequence"] == before["sequence"],
+                  "конфиг не изменился")
+
+
+def check_addressing(device, checks):
+    form = {"static_ip": "1", "ip": "192.168.1.50", "gateway": "192.168.1.1",
+            "subnet": "255.255.255.0", "dns": "192.168.1.1"}
+    status, body = device.request("POST", "/api/config", form)
+    trial = json.loads(body).get("wifi_trial", 0)
+    checks.expect(status == 202 and trial > 0, "новая адресация принята на пробу (HTTP %d)" % status)
+    unchanged = device.get("/api/config")["static_ip"]
+    result = device.wait_trial(trial)
+    config = device.get("/api/config")
+    checks.expect(result["state"] == "applied" and config["static_ip"] and config["ip"] == "192.168.1.50",
+                  "статический адрес сохранён после подключения (до него static_ip=%s)" % unchanged)
+    # Та же точка доступа: без поиска каналов
+    checks.expect(result.get("downtime_ms", 0) < 500, "простой при смене адреса %d мс" % result.get("downtime_ms", 0))
+
+
+def check_live_settings(device, checks):
+    device.request("POST", "/api/config", {"timezone": "UTC0"})
+    utc = device.get("/api/time")["time"]
+    status, body = device.request("POST", "/api/config", {"timezone": "<+05>-5", "volume": "12"})
+    shifted = device.get("/api/time")["time"]
+    hours = (int(shifted[:2]) - int(utc[:2])) % 24
+    checks.expect(status == 200 and hours == 5, "часовой пояс сразу: %s -> %s" % (utc, shifted))
+    checks.expect(device.get("/api/config")["volume"] == 12, "громкость сохранена")
+    # Команда громкости уходит плееру после записи конфига
+    volume_id = json.loads(body).get("volume_id", 0)
+    known = volume_id > 0 and device.request("GET", "/api/audio/command?id=%d" % volume_id)[0] == 200
+    checks.expect(known, "команда громкости после записи: volume_id=%d" % volume_id)
+
+    device.request("POST", "/api/config", {"trigger_key": "wifi-reconfig"})
+    before = device.metric(FIRE_COUNT_RE)
+    deadline = time.monotonic() + 5
+    fired = before
+    while fired == before and time.monotonic() < deadline:
+        device.request("POST", "/api/group/play?num=1&delay_ms=200")
+        time.sleep(0.5)
+        fired = device.metric(FIRE_COUNT_RE)
+    checks.expect(fired > before, "групповой удар с новым ключом")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program")
+    parser.add_argument("--port", type=int, default=8096)
+    parser.add_argument("--scan-ms", type=int, default=1500, help="поиск точки доступа в симуляторе")
+    args = parser.parse_args()
+
+    checks = Checks()
+    device = Device(args.program, args.port, args.scan_ms)
+    try:
+        device.wait_ready()
+        check_wifi_change(device, checks, args.scan_ms)
+        check_rollback(device, checks, args.scan_ms)
+        check_live_settings(device, checks)
+        # Последней: на хосте статический адрес не настоящий, групповые
+        # удары с ним не ходят
+        check_addressing(device, checks)
+        journal = device.get("/api/journal?limit=32")["events"]
+        changes = [event["code"] for event in journal if event["type"] == "wifi_change"]
+        checks.expect(changes == [1, 0, 1], "смены сети в журнале: %s" % changes)
+    finally:
+        device.stop()
+
+    print("проверок не прошло: %d" % checks.failed)
+    return 1 if checks.failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())